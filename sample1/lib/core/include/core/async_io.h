@@ -0,0 +1,175 @@
+#pragma once
+
+#include "core/core.h"
+#include "core/inplace_function.h"
+#include "core/thread_pool.h"
+#include "core/vfs.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace core {
+namespace io {
+////////////////////////////////////////////////////////////////////////////////
+// Asynchronous file reads.
+//
+//     core::io::ReadRequest request;
+//     request.path        = "assets/scene.bin";
+//     request.destination = stagingBuffer.mapped;   // read straight into it
+//     request.size        = stagingBuffer.size;
+//     request.onComplete  = [](const core::io::ReadResult& result) { ... };
+//     core::io::ReadHandle read = ioService.Read(std::move(request));
+//
+// On Linux the reads are batched through io_uring by a single I/O thread;
+// elsewhere (or when io_uring is not allowed, e.g. seccomp'd containers) a
+// small thread pool issues blocking pread() calls. Higher priorities are
+// always dequeued first; requests already handed to the kernel are not
+// preempted.
+
+enum class Backend : uint8_t {
+    Auto,       //!< io_uring when available, thread pool otherwise
+    IoUring,
+    ThreadPool,
+};
+
+enum class Priority : uint8_t { Low, Normal, High, Count };
+
+enum class Status : uint8_t { Pending, Completed, Failed, Cancelled };
+
+struct ReadResult {
+    Status   status    = Status::Pending;
+    int      error     = 0;   //!< errno of the failure
+    uint64_t bytesRead = 0;   //!< short of the requested size when the file ends first
+    //! ReadRequest::destination, or buffer.data() when the service allocated it
+    uint8_t*        data = nullptr;
+    vfs::FileHandle buffer;
+};
+
+struct ReadRequest {
+    using Callback = InplaceFunction<void(const ReadResult&), 48>;
+
+    std::string path;   //!< native path
+    uint64_t    offset = 0;
+    //! 0: up to the end of the file (requires destination == nullptr)
+    uint64_t size = 0;
+    //! Caller memory receiving the data (e.g. a mapped upload buffer). It must
+    //! stay valid until the request is completed, cancelled or not.
+    //! nullptr: the service allocates ReadResult::buffer.
+    void*    destination = nullptr;
+    Priority priority    = Priority::Normal;
+    //! called once, from an I/O thread, before the handle is marked done
+    Callback onComplete;
+};
+
+namespace detail {
+struct ReadState;
+}   // namespace detail
+
+class ReadHandle {
+    std::shared_ptr<detail::ReadState> _state;
+
+public:
+    ReadHandle() = default;
+    explicit ReadHandle(std::shared_ptr<detail::ReadState> state)
+        : _state(std::move(state))
+    {
+    }
+
+    bool isValid() const { return _state != nullptr; }
+    explicit operator bool() const { return isValid(); }
+
+    //! true for an invalid handle
+    bool isDone() const;
+    //! Blocks until the request is done (completed, failed or cancelled).
+    //! The result lives as long as the handle. An invalid handle returns a
+    //! Status::Failed result right away.
+    const ReadResult& Wait() const;
+
+    const detail::ReadState* state() const { return _state.get(); }
+};
+
+struct Stats {
+    uint64_t requestCount     = 0;
+    uint64_t completedCount   = 0;
+    uint64_t failedCount      = 0;
+    uint64_t cancelledCount   = 0;
+    uint64_t bytesRead        = 0;
+    uint64_t busyTimeNs       = 0;   //!< time with at least one read in flight
+    uint32_t queuedCount      = 0;   //!< waiting for a slot
+    uint32_t inFlightCount    = 0;   //!< current queue depth
+    uint32_t maxInFlightCount = 0;
+
+    //! achieved throughput while reads were in flight
+    double throughputMBps() const { return busyTimeNs != 0 ? (bytesRead * 1e3) / busyTimeNs : 0.0; }
+};
+
+struct Config {
+    Backend  backend     = Backend::Auto;
+    uint32_t queueDepth  = 64;   //!< reads in flight at once
+    uint32_t threadCount = 2;    //!< thread pool backend only
+};
+
+class IoService {
+public:
+    explicit IoService(const Config& config = Config());
+    //! cancels the queued requests and waits for the ones in flight
+    ~IoService();
+
+    IoService(const IoService&)            = delete;
+    IoService& operator=(const IoService&) = delete;
+
+    ReadHandle Read(ReadRequest&& request);
+    //! Queued requests are dropped right away. Requests in flight still
+    //! complete their read, then report Status::Cancelled.
+    //! Returns false when the request was already done.
+    bool Cancel(const ReadHandle& handle);
+    //! blocks until nothing is queued or in flight
+    void WaitIdle();
+
+    //! Backend::ThreadPool once io_uring has failed
+    Backend backend() const;
+    Stats   GetStats() const;
+
+private:
+    using StatePtr = std::shared_ptr<detail::ReadState>;
+
+    bool     _PopNext(StatePtr& state);
+    //! error: errno on failure
+    bool     _Prepare(detail::ReadState& state, int& error);
+    void     _Complete(detail::ReadState& state, Status status, int error);
+    void     _Finish(detail::ReadState& state, Status status, int error);
+    void     _BeginRead();
+    void     _EndRead();
+    void     _ThreadPoolRead();
+    bool     _InitIoUring();
+    void     _IoUringLoop();
+    //! io_uring thread, once the ring has failed
+    void     _FallBackToThreadPool();
+    void     _WakeIoUring();
+    uint32_t _QueuedCount() const;
+
+    Config  _config;
+    Backend _backend = Backend::ThreadPool;   //!< guarded by _mutex once the service runs
+
+    mutable std::mutex      _mutex;
+    std::condition_variable _idle;
+    std::deque<StatePtr>    _queues[static_cast<size_t>(Priority::Count)];
+    Stats                   _stats;
+    uint64_t                _busyStartNs = 0;
+    bool                    _stopping    = false;
+
+    std::unique_ptr<ThreadPool> _threadPool;
+
+    struct IoUring;
+    std::unique_ptr<IoUring> _ioUring;
+    std::thread              _ioThread;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace io
+}   // namespace core
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "core/core.h"
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#define INOTIFY IN_USE
+#else   // #if defined(__linux__)
+#define INOTIFY NOT_IN_USE
+#endif   // #else   // #if defined(__linux__)
+
+namespace core {
+////////////////////////////////////////////////////////////////////////////////
+
+//! Reports modifications of a set of files, without blocking.
+//!
+//! On Linux the parent directories are watched through inotify, so files that
+//! are replaced (write + rename, like editors and compilers do) keep being
+//! watched. Elsewhere Poll() compares modification times, at most every
+//! kPollInterval.
+class FileWatcher {
+public:
+    static constexpr std::chrono::milliseconds kPollInterval {250};
+
+    FileWatcher();
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&)            = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    //! the file does not need to exist yet, its directory does
+    bool Watch(const std::string& nativePath);
+
+    //! Appends the watched paths (as given to Watch()) written since the last
+    //! call, each once. Returns whether any was.
+    bool Poll(std::vector<std::string>& changedPaths);
+
+    size_t watchedCount() const { return _files.size(); }
+
+private:
+    struct WatchedFile {
+        std::string                     path;
+        std::string                     name;             //!< inside its directory
+        int                             directory = -1;   //!< inotify watch descriptor
+        std::filesystem::file_time_type lastWriteTime;
+    };
+    std::vector<WatchedFile> _files;
+
+#if USING(INOTIFY)
+    int _inotifyFd = -1;
+#else    // #if USING(INOTIFY)
+    std::chrono::steady_clock::time_point _lastPoll;
+#endif   // #else    // #if USING(INOTIFY)
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace core
@@ -0,0 +1,203 @@
+#pragma once
+
+#include "core/core.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace core {
+////////////////////////////////////////////////////////////////////////////////
+
+//! std::vector-like container with a compile-time capacity and no heap usage.
+//! Overflowing the capacity is a programming error: it logs and aborts in
+//! every build, rather than writing past the storage. Check full() first when
+//! the element count is not bounded by construction.
+template <typename T, size_t N> class FixedVector {
+    static_assert(N > 0, "FixedVector needs some capacity");
+
+public:
+    using value_type      = T;
+    using size_type       = size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference       = T&;
+    using const_reference = const T&;
+    using pointer         = T*;
+    using const_pointer   = const T*;
+    using iterator        = T*;
+    using const_iterator  = const T*;
+
+public:
+    FixedVector() = default;
+    explicit FixedVector(size_t count) { resize(count); }
+    FixedVector(size_t count, const T& value) { resize(count, value); }
+    FixedVector(std::initializer_list<T> values) { assign(values.begin(), values.end()); }
+
+    FixedVector(const FixedVector& other) { assign(other.begin(), other.end()); }
+    FixedVector(FixedVector&& other) noexcept(std::is_nothrow_move_constructible<T>::value)
+    {
+        for (T& value : other) {
+            new (_Data() + _size++) T(std::move(value));
+        }
+        other.clear();
+    }
+    ~FixedVector() { clear(); }
+
+    FixedVector& operator=(const FixedVector& other)
+    {
+        if (this != &other) {
+            assign(other.begin(), other.end());
+        }
+        return *this;
+    }
+    FixedVector& operator=(FixedVector&& other) noexcept(std::is_nothrow_move_constructible<T>::value)
+    {
+        if (this != &other) {
+            clear();
+            for (T& value : other) {
+                new (_Data() + _size++) T(std::move(value));
+            }
+            other.clear();
+        }
+        return *this;
+    }
+
+    template <typename It, typename = typename std::iterator_traits<It>::iterator_category>
+    void assign(It first, It last)
+    {
+        clear();
+        for (; first != last; ++first) {
+            emplace_back(*first);
+        }
+    }
+
+    // element access
+    T& operator[](size_t index)
+    {
+        ASSERT(index < _size);
+        return _Data()[index];
+    }
+    const T& operator[](size_t index) const
+    {
+        ASSERT(index < _size);
+        return _Data()[index];
+    }
+    T&       front() { return (*this)[0]; }
+    const T& front() const { return (*this)[0]; }
+    T&       back() { return (*this)[_size - 1]; }
+    const T& back() const { return (*this)[_size - 1]; }
+    T*       data() { return _Data(); }
+    const T* data() const { return _Data(); }
+
+    // iterators
+    iterator       begin() { return _Data(); }
+    const_iterator begin() const { return _Data(); }
+    const_iterator cbegin() const { return _Data(); }
+    iterator       end() { return _Data() + _size; }
+    const_iterator end() const { return _Data() + _size; }
+    const_iterator cend() const { return _Data() + _size; }
+
+    // capacity
+    bool                    empty() const { return _size == 0; }
+    bool                    full() const { return _size == N; }
+    size_t                  size() const { return _size; }
+    static constexpr size_t capacity() { return N; }
+    static constexpr size_t max_size() { return N; }
+
+    // modifiers
+    void clear()
+    {
+        for (size_t i = 0; i < _size; ++i) {
+            _Data()[i].~T();
+        }
+        _size = 0;
+    }
+
+    void push_back(const T& value) { emplace_back(value); }
+    void push_back(T&& value) { emplace_back(std::move(value)); }
+
+    template <typename... ArgsT> T& emplace_back(ArgsT&&... args)
+    {
+        _CheckCapacity(_size + 1);
+        T* value = new (_Data() + _size) T(std::forward<ArgsT>(args)...);
+        ++_size;
+        return *value;
+    }
+
+    void pop_back()
+    {
+        ASSERT(_size > 0);
+        _Data()[--_size].~T();
+    }
+
+    void resize(size_t count)
+    {
+        _CheckCapacity(count);
+        while (_size > count) {
+            pop_back();
+        }
+        while (_size < count) {
+            emplace_back();
+        }
+    }
+    void resize(size_t count, const T& value)
+    {
+        _CheckCapacity(count);
+        while (_size > count) {
+            pop_back();
+        }
+        while (_size < count) {
+            emplace_back(value);
+        }
+    }
+
+    iterator erase(const_iterator position)
+    {
+        T* it = _Data() + (position - _Data());
+        ASSERT(it >= begin() && it < end());
+        std::move(it + 1, end(), it);
+        pop_back();
+        return it;
+    }
+
+    //! O(1) removal that does not keep the element order
+    void erase_unordered(size_t index)
+    {
+        ASSERT(index < _size);
+        if (index != _size - 1) {
+            _Data()[index] = std::move(_Data()[_size - 1]);
+        }
+        pop_back();
+    }
+
+    bool operator==(const FixedVector& other) const
+    {
+        return _size == other._size && std::equal(begin(), end(), other.begin());
+    }
+    bool operator!=(const FixedVector& other) const { return !operator==(other); }
+
+private:
+    static void _CheckCapacity(size_t count)
+    {
+        if (count > N) {
+            LOG_ERROR("FixedVector overflow (capacity %zu)", N);
+            DebugBreak();
+            abort();
+        }
+    }
+
+    T*       _Data() { return reinterpret_cast<T*>(_storage); }
+    const T* _Data() const { return reinterpret_cast<const T*>(_storage); }
+
+private:
+    size_t _size = 0;
+    alignas(T) unsigned char _storage[N * sizeof(T)];
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace core
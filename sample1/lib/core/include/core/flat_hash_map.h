@@ -0,0 +1,802 @@
+#pragma once
+
+#include "core/core.h"
+#include "core/hash.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FLAT_HASH_SSE2 IN_USE
+#include <emmintrin.h>
+#else
+#define FLAT_HASH_SSE2 NOT_IN_USE
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace core {
+////////////////////////////////////////////////////////////////////////////////
+// Open addressing hash tables in the spirit of abseil's Swiss tables:
+// - one control byte per slot (empty/deleted or 7 bits of the hash),
+// - probing compares a whole group of control bytes at once (SSE2, or 8 bytes
+//   SWAR on other targets) so most lookups touch a single cache line,
+// - FlatHashMap/FlatHashSet keep the values inline (pointers are invalidated
+//   on rehash), NodeHashMap/NodeHashSet keep them in stable heap nodes.
+
+namespace detail {
+
+using ctrl_t                         = int8_t;
+static constexpr ctrl_t kCtrlEmpty   = -128;   // 0b10000000
+static constexpr ctrl_t kCtrlDeleted = -2;     // 0b11111110
+// full slots store H2 in [0, 127]
+
+inline uint32_t
+countTrailingZeros(uint64_t value)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return index;
+#else
+    return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+}
+inline uint32_t
+countLeadingZeros(uint64_t value)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return 63 - index;
+#else
+    return static_cast<uint32_t>(__builtin_clzll(value));
+#endif
+}
+
+//! Iterable set of matching positions inside a group
+template <typename T, int SignificantBits, int Shift = 0> class BitMask {
+    T _mask;
+
+public:
+    explicit BitMask(T mask)
+        : _mask(mask)
+    {
+    }
+
+    BitMask& operator++()
+    {
+        _mask &= (_mask - 1);
+        return *this;
+    }
+    uint32_t operator*() const { return countTrailingZeros(_mask) >> Shift; }
+    BitMask  begin() const { return *this; }
+    BitMask  end() const { return BitMask(0); }
+    bool     operator!=(const BitMask& other) const { return _mask != other._mask; }
+    explicit operator bool() const { return _mask != 0; }
+
+    uint32_t LowestBitSet() const { return countTrailingZeros(_mask) >> Shift; }
+    uint32_t TrailingZeros() const { return countTrailingZeros(_mask) >> Shift; }
+    uint32_t LeadingZeros() const
+    {
+        constexpr int kExtraBits = 64 - (SignificantBits << Shift);
+        return countLeadingZeros(static_cast<uint64_t>(_mask) << kExtraBits) >> Shift;
+    }
+};
+
+#if USING(FLAT_HASH_SSE2)
+struct Group {
+    static constexpr size_t kWidth = 16;
+    __m128i                 _ctrl;
+
+    explicit Group(const ctrl_t* pos)
+        : _ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pos)))
+    {
+    }
+
+    BitMask<uint32_t, kWidth> Match(ctrl_t h2) const
+    {
+        const __m128i match = _mm_set1_epi8(static_cast<char>(h2));
+        return BitMask<uint32_t, kWidth>(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(match, _ctrl))));
+    }
+    BitMask<uint32_t, kWidth> MatchEmpty() const { return Match(kCtrlEmpty); }
+    BitMask<uint32_t, kWidth> MatchEmptyOrDeleted() const
+    {
+        return BitMask<uint32_t, kWidth>(static_cast<uint32_t>(_mm_movemask_epi8(_ctrl)));
+    }
+};
+#else    // #if USING(FLAT_HASH_SSE2)
+struct Group {
+    static constexpr size_t   kWidth = 8;
+    static constexpr uint64_t kLsbs  = 0x0101010101010101ull;
+    static constexpr uint64_t kMsbs  = 0x8080808080808080ull;
+    uint64_t                  _ctrl;
+
+    explicit Group(const ctrl_t* pos) { memcpy(&_ctrl, pos, sizeof(_ctrl)); }
+
+    // may report false positives, which are discarded by the key comparison
+    BitMask<uint64_t, kWidth, 3> Match(ctrl_t h2) const
+    {
+        const uint64_t x = _ctrl ^ (kLsbs * static_cast<uint8_t>(h2));
+        return BitMask<uint64_t, kWidth, 3>((x - kLsbs) & ~x & kMsbs);
+    }
+    BitMask<uint64_t, kWidth, 3> MatchEmpty() const
+    {
+        return BitMask<uint64_t, kWidth, 3>((_ctrl & (~_ctrl << 6)) & kMsbs);
+    }
+    BitMask<uint64_t, kWidth, 3> MatchEmptyOrDeleted() const { return BitMask<uint64_t, kWidth, 3>(_ctrl & kMsbs); }
+};
+#endif   // #else    // #if USING(FLAT_HASH_SSE2)
+
+inline const ctrl_t*
+emptyGroup()
+{
+    alignas(16) static const ctrl_t kEmptyGroup[16] = {kCtrlEmpty, kCtrlEmpty, kCtrlEmpty, kCtrlEmpty, kCtrlEmpty,
+        kCtrlEmpty, kCtrlEmpty, kCtrlEmpty, kCtrlEmpty, kCtrlEmpty, kCtrlEmpty, kCtrlEmpty, kCtrlEmpty, kCtrlEmpty,
+        kCtrlEmpty, kCtrlEmpty};
+    return kEmptyGroup;
+}
+
+template <typename T, typename = void> struct IsTransparent : std::false_type { };
+template <typename T> struct IsTransparent<T, std::void_t<typename T::is_transparent>> : std::true_type { };
+
+template <typename T, typename = void> struct IsAvalanching : std::false_type { };
+template <typename T> struct IsAvalanching<T, std::void_t<typename T::is_avalanching>> : std::true_type { };
+
+template <bool Transparent> struct KeyArgImpl {
+    template <typename K, typename KeyT> using type = KeyT;
+};
+template <> struct KeyArgImpl<true> {
+    template <typename K, typename KeyT> using type = K;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// slot policies
+
+template <typename K, typename V> struct FlatMapPolicy {
+    using key_type   = K;
+    using value_type = std::pair<const K, V>;
+    using slot_type  = std::pair<K, V>;
+
+    static const K&    Key(const slot_type& slot) { return slot.first; }
+    static value_type& Element(slot_type& slot) { return *std::launder(reinterpret_cast<value_type*>(&slot)); }
+    static const value_type& Element(const slot_type& slot)
+    {
+        return *std::launder(reinterpret_cast<const value_type*>(&slot));
+    }
+
+    template <typename... ArgsT> static void Construct(slot_type* slot, ArgsT&&... args)
+    {
+        new (slot) slot_type(std::forward<ArgsT>(args)...);
+    }
+    static void Destroy(slot_type* slot) { slot->~slot_type(); }
+    static void Transfer(slot_type* destination, slot_type* source)
+    {
+        new (destination) slot_type(std::move(*source));
+        source->~slot_type();
+    }
+};
+
+template <typename K> struct FlatSetPolicy {
+    using key_type   = K;
+    using value_type = K;
+    using slot_type  = K;
+
+    static const K& Key(const slot_type& slot) { return slot; }
+    static const K& Element(const slot_type& slot) { return slot; }
+
+    template <typename... ArgsT> static void Construct(slot_type* slot, ArgsT&&... args)
+    {
+        new (slot) slot_type(std::forward<ArgsT>(args)...);
+    }
+    static void Destroy(slot_type* slot) { slot->~slot_type(); }
+    static void Transfer(slot_type* destination, slot_type* source)
+    {
+        new (destination) slot_type(std::move(*source));
+        source->~slot_type();
+    }
+};
+
+//! slots only hold a pointer: elements never move once inserted
+template <typename K, typename V> struct NodeMapPolicy {
+    using key_type   = K;
+    using value_type = std::pair<const K, V>;
+    using slot_type  = value_type*;
+
+    static const K&          Key(const slot_type& slot) { return slot->first; }
+    static value_type&       Element(slot_type& slot) { return *slot; }
+    static const value_type& Element(const slot_type& slot) { return *slot; }
+
+    template <typename... ArgsT> static void Construct(slot_type* slot, ArgsT&&... args)
+    {
+        *slot = new value_type(std::forward<ArgsT>(args)...);
+    }
+    static void Destroy(slot_type* slot) { delete *slot; }
+    static void Transfer(slot_type* destination, slot_type* source) { *destination = *source; }
+};
+
+template <typename K> struct NodeSetPolicy {
+    using key_type   = K;
+    using value_type = K;
+    using slot_type  = K*;
+
+    static const K& Key(const slot_type& slot) { return *slot; }
+    static const K& Element(const slot_type& slot) { return *slot; }
+
+    template <typename... ArgsT> static void Construct(slot_type* slot, ArgsT&&... args)
+    {
+        *slot = new K(std::forward<ArgsT>(args)...);
+    }
+    static void Destroy(slot_type* slot) { delete *slot; }
+    static void Transfer(slot_type* destination, slot_type* source) { *destination = *source; }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename Policy, typename HashT, typename EqT> class RawHashTable {
+public:
+    using key_type        = typename Policy::key_type;
+    using value_type      = typename Policy::value_type;
+    using slot_type       = typename Policy::slot_type;
+    using hasher          = HashT;
+    using key_equal       = EqT;
+    using size_type       = size_t;
+    using difference_type = std::ptrdiff_t;
+
+    template <typename K>
+    using key_arg = typename KeyArgImpl<IsTransparent<HashT>::value && IsTransparent<EqT>::value>::template type<K,
+        key_type>;
+
+private:
+    static constexpr size_t kWidth = Group::kWidth;
+
+    template <bool IsConst> class Iterator {
+        friend class RawHashTable;
+        using table_ctrl_t = typename std::conditional<IsConst, const ctrl_t, ctrl_t>::type;
+        using table_slot_t = typename std::conditional<IsConst, const slot_type, slot_type>::type;
+
+        table_ctrl_t* _ctrl = nullptr;
+        table_slot_t* _slot = nullptr;
+        table_ctrl_t* _end  = nullptr;
+
+        Iterator(table_ctrl_t* ctrl, table_slot_t* slot, table_ctrl_t* end)
+            : _ctrl(ctrl)
+            , _slot(slot)
+            , _end(end)
+        {
+            _SkipEmpty();
+        }
+
+        void _SkipEmpty()
+        {
+            while (_ctrl != _end && *_ctrl < 0) {
+                ++_ctrl;
+                ++_slot;
+            }
+        }
+
+    public:
+        using mutable_reference = decltype(Policy::Element(std::declval<slot_type&>()));
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = typename RawHashTable::value_type;
+        using difference_type   = std::ptrdiff_t;
+        using reference         = typename std::conditional<IsConst, const value_type&, mutable_reference>::type;
+        using pointer           = typename std::remove_reference<reference>::type*;
+
+        Iterator() = default;
+        template <bool WasConst, typename = typename std::enable_if<IsConst && !WasConst>::type>
+        Iterator(const Iterator<WasConst>& other)
+            : _ctrl(other._ctrl)
+            , _slot(other._slot)
+            , _end(other._end)
+        {
+        }
+
+        reference operator*() const { return Policy::Element(*_slot); }
+        pointer   operator->() const { return &Policy::Element(*_slot); }
+        Iterator& operator++()
+        {
+            ++_ctrl;
+            ++_slot;
+            _SkipEmpty();
+            return *this;
+        }
+        Iterator operator++(int)
+        {
+            Iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+        bool operator==(const Iterator& other) const { return _ctrl == other._ctrl; }
+        bool operator!=(const Iterator& other) const { return _ctrl != other._ctrl; }
+
+        template <bool> friend class Iterator;
+    };
+
+public:
+    using iterator       = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+public:
+    RawHashTable() = default;
+    explicit RawHashTable(size_t bucketCount, const HashT& hash = HashT(), const EqT& eq = EqT())
+        : _hash(hash)
+        , _eq(eq)
+    {
+        reserve(bucketCount);
+    }
+    RawHashTable(const RawHashTable& other)
+        : _hash(other._hash)
+        , _eq(other._eq)
+    {
+        reserve(other._size);
+        for (size_t i = 0; i < other._capacity; ++i) {
+            if (other._ctrl[i] >= 0) {
+                const size_t hash   = other._HashKey(Policy::Key(other._slots[i]));
+                const size_t target = _PrepareInsert(hash);
+                Policy::Construct(_slots + target, Policy::Element(other._slots[i]));
+            }
+        }
+    }
+    RawHashTable(RawHashTable&& other) noexcept
+        : _hash(std::move(other._hash))
+        , _eq(std::move(other._eq))
+    {
+        _Steal(other);
+    }
+    ~RawHashTable() { _DestroyAndDeallocate(); }
+
+    RawHashTable& operator=(const RawHashTable& other)
+    {
+        if (this != &other) {
+            RawHashTable copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+    RawHashTable& operator=(RawHashTable&& other) noexcept
+    {
+        if (this != &other) {
+            _DestroyAndDeallocate();
+            _hash = std::move(other._hash);
+            _eq   = std::move(other._eq);
+            _Steal(other);
+        }
+        return *this;
+    }
+
+    // iterators
+    iterator       begin() { return iterator(_ctrl, _slots, _ctrl + _capacity); }
+    const_iterator begin() const { return const_iterator(_ctrl, _slots, _ctrl + _capacity); }
+    const_iterator cbegin() const { return begin(); }
+    iterator       end() { return iterator(_ctrl + _capacity, _slots + _capacity, _ctrl + _capacity); }
+    const_iterator end() const { return const_iterator(_ctrl + _capacity, _slots + _capacity, _ctrl + _capacity); }
+    const_iterator cend() const { return end(); }
+
+    // capacity
+    bool   empty() const { return _size == 0; }
+    size_t size() const { return _size; }
+    size_t capacity() const { return _capacity; }
+    float  load_factor() const { return _capacity > 0 ? static_cast<float>(_size) / _capacity : 0.f; }
+
+    void reserve(size_t count)
+    {
+        const size_t requiredCapacity = _CapacityForSize(count);
+        if (requiredCapacity > _capacity) {
+            _Resize(requiredCapacity);
+        }
+    }
+
+    void clear()
+    {
+        if (_capacity == 0) {
+            return;
+        }
+        for (size_t i = 0; i < _capacity; ++i) {
+            if (_ctrl[i] >= 0) {
+                Policy::Destroy(_slots + i);
+            }
+        }
+        memset(_ctrl, static_cast<uint8_t>(kCtrlEmpty), _capacity + kWidth);
+        _size       = 0;
+        _growthLeft = _CapacityToGrowth(_capacity);
+    }
+
+    // lookup
+    template <typename K = key_type> iterator find(const key_arg<K>& key)
+    {
+        const size_t index = _FindIndex(key, _HashKey(key));
+        return index != kNotFound ? _IteratorAt(index) : end();
+    }
+    template <typename K = key_type> const_iterator find(const key_arg<K>& key) const
+    {
+        const size_t index = _FindIndex(key, _HashKey(key));
+        return index != kNotFound ? _IteratorAt(index) : end();
+    }
+    template <typename K = key_type> bool contains(const key_arg<K>& key) const
+    {
+        return _FindIndex(key, _HashKey(key)) != kNotFound;
+    }
+    template <typename K = key_type> size_t count(const key_arg<K>& key) const { return contains(key) ? 1 : 0; }
+
+    // modifiers
+    template <typename K = key_type> size_t erase(const key_arg<K>& key)
+    {
+        const size_t index = _FindIndex(key, _HashKey(key));
+        if (index == kNotFound) {
+            return 0;
+        }
+        _EraseAt(index);
+        return 1;
+    }
+    iterator erase(const_iterator position)
+    {
+        const size_t index = static_cast<size_t>(position._ctrl - _ctrl);
+        ASSERT(index < _capacity && _ctrl[index] >= 0);
+        _EraseAt(index);
+        return iterator(_ctrl + index + 1, _slots + index + 1, _ctrl + _capacity);
+    }
+    iterator erase(iterator position) { return erase(const_iterator(position)); }
+
+    void swap(RawHashTable& other) noexcept
+    {
+        RawHashTable tmp(std::move(other));
+        other = std::move(*this);
+        *this = std::move(tmp);
+    }
+
+    hasher    hash_function() const { return _hash; }
+    key_equal key_eq() const { return _eq; }
+
+protected:
+    static constexpr size_t kNotFound = ~size_t(0);
+
+    template <typename K> size_t _HashKey(const K& key) const
+    {
+        const size_t hash = _hash(key);
+        return IsAvalanching<HashT>::value ? hash : static_cast<size_t>(hashValue(hash));
+    }
+    static size_t _H1(size_t hash) { return hash >> 7; }
+    static ctrl_t _H2(size_t hash) { return static_cast<ctrl_t>(hash & 0x7f); }
+
+    static size_t _CapacityToGrowth(size_t capacity) { return capacity - capacity / 8; }
+    static size_t _CapacityForSize(size_t size)
+    {
+        if (size == 0) {
+            return 0;
+        }
+        size_t capacity = kWidth;
+        while (_CapacityToGrowth(capacity) < size) {
+            capacity *= 2;
+        }
+        return capacity;
+    }
+
+    iterator _IteratorAt(size_t index) { return iterator(_ctrl + index, _slots + index, _ctrl + _capacity); }
+    const_iterator _IteratorAt(size_t index) const
+    {
+        return const_iterator(_ctrl + index, _slots + index, _ctrl + _capacity);
+    }
+
+    template <typename K> size_t _FindIndex(const K& key, size_t hash) const
+    {
+        if (_capacity == 0) {
+            return kNotFound;
+        }
+        const size_t mask = _capacity - 1;
+        const ctrl_t h2   = _H2(hash);
+        size_t       pos  = _H1(hash) & mask;
+        size_t       step = 0;
+        while (true) {
+            const Group group(_ctrl + pos);
+            for (uint32_t i : group.Match(h2)) {
+                const size_t index = (pos + i) & mask;
+                if (_eq(Policy::Key(_slots[index]), key)) {
+                    return index;
+                }
+            }
+            if (group.MatchEmpty()) {
+                return kNotFound;
+            }
+            step += kWidth;
+            pos = (pos + step) & mask;
+            ASSERT(step <= _capacity);
+        }
+    }
+
+    size_t _FindFirstNonFull(size_t hash) const
+    {
+        const size_t mask = _capacity - 1;
+        size_t       pos  = _H1(hash) & mask;
+        size_t       step = 0;
+        while (true) {
+            const Group group(_ctrl + pos);
+            const auto  candidates = group.MatchEmptyOrDeleted();
+            if (candidates) {
+                return (pos + candidates.LowestBitSet()) & mask;
+            }
+            step += kWidth;
+            pos = (pos + step) & mask;
+            ASSERT(step <= _capacity);
+        }
+    }
+
+    void _SetCtrl(size_t index, ctrl_t value)
+    {
+        _ctrl[index] = value;
+        if (index < kWidth) {   // keep the cloned bytes so groups can be read past the end
+            _ctrl[_capacity + index] = value;
+        }
+    }
+
+    //! returns the index of a free slot for 'hash', growing the table if needed
+    size_t _PrepareInsert(size_t hash)
+    {
+        if (_capacity == 0) {
+            _Resize(kWidth);
+        }
+        size_t target = _FindFirstNonFull(hash);
+        if (_growthLeft == 0 && _ctrl[target] != kCtrlDeleted) {
+            _RehashAndGrowIfNecessary();
+            target = _FindFirstNonFull(hash);
+        }
+        ++_size;
+        _growthLeft -= (_ctrl[target] == kCtrlEmpty) ? 1 : 0;
+        _SetCtrl(target, _H2(hash));
+        return target;
+    }
+
+    //! finds 'key' or reserves a slot for it. The slot must be constructed by the caller when .second is true.
+    template <typename K> std::pair<size_t, bool> _FindOrPrepareInsert(const K& key)
+    {
+        const size_t hash  = _HashKey(key);
+        const size_t index = _FindIndex(key, hash);
+        if (index != kNotFound) {
+            return {index, false};
+        }
+        return {_PrepareInsert(hash), true};
+    }
+
+    void _EraseAt(size_t index)
+    {
+        Policy::Destroy(_slots + index);
+        --_size;
+
+        // the slot can go back to empty only if no probe sequence ever walked past it while it was full
+        const size_t indexBefore = (index - kWidth) & (_capacity - 1);
+        const auto   emptyAfter  = Group(_ctrl + index).MatchEmpty();
+        const auto   emptyBefore = Group(_ctrl + indexBefore).MatchEmpty();
+        const bool   wasNeverFull
+            = emptyBefore && emptyAfter && (emptyAfter.TrailingZeros() + emptyBefore.LeadingZeros()) < kWidth;
+        _SetCtrl(index, wasNeverFull ? kCtrlEmpty : kCtrlDeleted);
+        _growthLeft += wasNeverFull ? 1 : 0;
+    }
+
+    void _RehashAndGrowIfNecessary()
+    {
+        if (_capacity > kWidth && _size <= _CapacityToGrowth(_capacity) / 2) {
+            _Resize(_capacity);   // mostly tombstones: clean them up in place
+        } else {
+            _Resize(_capacity * 2);
+        }
+    }
+
+    void _Resize(size_t newCapacity)
+    {
+        ASSERT(newCapacity >= kWidth && (newCapacity & (newCapacity - 1)) == 0);
+        ctrl_t*      oldCtrl     = _ctrl;
+        slot_type*   oldSlots    = _slots;
+        const size_t oldCapacity = _capacity;
+
+        _Allocate(newCapacity);
+        for (size_t i = 0; i < oldCapacity; ++i) {
+            if (oldCtrl[i] >= 0) {
+                const size_t hash   = _HashKey(Policy::Key(oldSlots[i]));
+                const size_t target = _FindFirstNonFull(hash);
+                _SetCtrl(target, _H2(hash));
+                Policy::Transfer(_slots + target, oldSlots + i);
+            }
+        }
+        _growthLeft = _CapacityToGrowth(_capacity) - _size;
+
+        if (oldCapacity > 0) {
+            _Deallocate(oldCtrl, oldCapacity);
+        }
+    }
+
+    static size_t _SlotOffset(size_t capacity)
+    {
+        const size_t ctrlBytes = capacity + kWidth;
+        return (ctrlBytes + alignof(slot_type) - 1) & ~(alignof(slot_type) - 1);
+    }
+    static size_t _AllocationSize(size_t capacity) { return _SlotOffset(capacity) + capacity * sizeof(slot_type); }
+
+    void _Allocate(size_t capacity)
+    {
+        static_assert(alignof(slot_type) <= alignof(std::max_align_t), "over-aligned slots are not supported");
+        char* memory = static_cast<char*>(::operator new(_AllocationSize(capacity)));
+        _ctrl        = reinterpret_cast<ctrl_t*>(memory);
+        _slots       = reinterpret_cast<slot_type*>(memory + _SlotOffset(capacity));
+        _capacity    = capacity;
+        memset(_ctrl, static_cast<uint8_t>(kCtrlEmpty), capacity + kWidth);
+    }
+    static void _Deallocate(ctrl_t* ctrl, size_t /* capacity */) { ::operator delete(ctrl); }
+
+    void _DestroyAndDeallocate()
+    {
+        if (_capacity == 0) {
+            return;
+        }
+        for (size_t i = 0; i < _capacity; ++i) {
+            if (_ctrl[i] >= 0) {
+                Policy::Destroy(_slots + i);
+            }
+        }
+        _Deallocate(_ctrl, _capacity);
+        _ResetToEmpty();
+    }
+
+    void _ResetToEmpty()
+    {
+        _ctrl       = const_cast<ctrl_t*>(emptyGroup());
+        _slots      = nullptr;
+        _capacity   = 0;
+        _size       = 0;
+        _growthLeft = 0;
+    }
+
+    void _Steal(RawHashTable& other)
+    {
+        _ctrl       = other._ctrl;
+        _slots      = other._slots;
+        _capacity   = other._capacity;
+        _size       = other._size;
+        _growthLeft = other._growthLeft;
+        other._ResetToEmpty();
+    }
+
+protected:
+    ctrl_t*    _ctrl       = const_cast<ctrl_t*>(emptyGroup());
+    slot_type* _slots      = nullptr;
+    size_t     _capacity   = 0;
+    size_t     _size       = 0;
+    size_t     _growthLeft = 0;
+    HashT      _hash;
+    EqT        _eq;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename Policy, typename HashT, typename EqT> class RawHashMap : public RawHashTable<Policy, HashT, EqT> {
+    using Base = RawHashTable<Policy, HashT, EqT>;
+
+public:
+    using typename Base::const_iterator;
+    using typename Base::iterator;
+    using typename Base::key_type;
+    using typename Base::value_type;
+    using mapped_type = typename value_type::second_type;
+    template <typename K> using key_arg = typename Base::template key_arg<K>;
+
+    using Base::Base;
+
+    template <typename K = key_type, typename... ArgsT>
+    std::pair<iterator, bool> try_emplace(key_arg<K>&& key, ArgsT&&... args)
+    {
+        return _TryEmplace(std::forward<key_arg<K>>(key), std::forward<ArgsT>(args)...);
+    }
+    template <typename K = key_type, typename... ArgsT>
+    std::pair<iterator, bool> try_emplace(const key_arg<K>& key, ArgsT&&... args)
+    {
+        return _TryEmplace(key, std::forward<ArgsT>(args)...);
+    }
+    //! same as try_emplace: the value is not built when the key already exists
+    template <typename K, typename... ArgsT> std::pair<iterator, bool> emplace(K&& key, ArgsT&&... args)
+    {
+        return _TryEmplace(std::forward<K>(key), std::forward<ArgsT>(args)...);
+    }
+
+    std::pair<iterator, bool> insert(const value_type& value) { return _TryEmplace(value.first, value.second); }
+    std::pair<iterator, bool> insert(value_type&& value)
+    {
+        return _TryEmplace(std::move(value.first), std::move(value.second));
+    }
+    template <typename K = key_type, typename V>
+    std::pair<iterator, bool> insert_or_assign(key_arg<K>&& key, V&& value)
+    {
+        auto result = _TryEmplace(std::forward<key_arg<K>>(key), std::forward<V>(value));
+        if (!result.second) {
+            result.first->second = std::forward<V>(value);
+        }
+        return result;
+    }
+
+    template <typename K = key_type> mapped_type& operator[](key_arg<K>&& key)
+    {
+        return _TryEmplace(std::forward<key_arg<K>>(key)).first->second;
+    }
+    template <typename K = key_type> mapped_type& operator[](const key_arg<K>& key)
+    {
+        return _TryEmplace(key).first->second;
+    }
+
+    template <typename K = key_type> mapped_type& at(const key_arg<K>& key)
+    {
+        auto it = this->find(key);
+        ASSERT_MSG(it != this->end(), "key not found");
+        return it->second;
+    }
+    template <typename K = key_type> const mapped_type& at(const key_arg<K>& key) const
+    {
+        auto it = this->find(key);
+        ASSERT_MSG(it != this->end(), "key not found");
+        return it->second;
+    }
+
+private:
+    template <typename K, typename... ArgsT> std::pair<iterator, bool> _TryEmplace(K&& key, ArgsT&&... args)
+    {
+        const auto result = this->_FindOrPrepareInsert(key);
+        if (result.second) {
+            Policy::Construct(this->_slots + result.first, std::piecewise_construct,
+                std::forward_as_tuple(std::forward<K>(key)), std::forward_as_tuple(std::forward<ArgsT>(args)...));
+        }
+        return {this->_IteratorAt(result.first), result.second};
+    }
+};
+
+template <typename Policy, typename HashT, typename EqT> class RawHashSet : public RawHashTable<Policy, HashT, EqT> {
+    using Base = RawHashTable<Policy, HashT, EqT>;
+
+public:
+    using typename Base::iterator;
+    using typename Base::key_type;
+
+    using Base::Base;
+
+    std::pair<iterator, bool> insert(const key_type& key) { return _Insert(key); }
+    std::pair<iterator, bool> insert(key_type&& key) { return _Insert(std::move(key)); }
+    template <typename... ArgsT> std::pair<iterator, bool> emplace(ArgsT&&... args)
+    {
+        return _Insert(key_type(std::forward<ArgsT>(args)...));
+    }
+
+private:
+    template <typename K> std::pair<iterator, bool> _Insert(K&& key)
+    {
+        const auto result = this->_FindOrPrepareInsert(key);
+        if (result.second) {
+            Policy::Construct(this->_slots + result.first, std::forward<K>(key));
+        }
+        return {this->_IteratorAt(result.first), result.second};
+    }
+};
+
+}   // namespace detail
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename K, typename V, typename HashT = Hash<K>, typename EqT = std::equal_to<>>
+using FlatHashMap = detail::RawHashMap<detail::FlatMapPolicy<K, V>, HashT, EqT>;
+
+template <typename K, typename HashT = Hash<K>, typename EqT = std::equal_to<>>
+using FlatHashSet = detail::RawHashSet<detail::FlatSetPolicy<K>, HashT, EqT>;
+
+//! Stable-handle variants: pointers/references to the elements survive rehashing
+template <typename K, typename V, typename HashT = Hash<K>, typename EqT = std::equal_to<>>
+using NodeHashMap = detail::RawHashMap<detail::NodeMapPolicy<K, V>, HashT, EqT>;
+
+template <typename K, typename HashT = Hash<K>, typename EqT = std::equal_to<>>
+using NodeHashSet = detail::RawHashSet<detail::NodeSetPolicy<K>, HashT, EqT>;
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace core
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+namespace core {
+////////////////////////////////////////////////////////////////////////////////
+// Fast non-cryptographic hashing, based on wyhash (final4, public domain).
+// Results are only stable for a given build: do not persist them, except the
+// ones of hashBytesStable(), made for file formats.
+
+static constexpr uint64_t kHashDefaultSeed = 0xa0761d6478bd642full;
+
+namespace detail {
+static constexpr uint64_t kWySecret[4]
+    = {0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull};
+
+inline void
+wyMultiply(uint64_t& a, uint64_t& b)
+{
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = a;
+    r *= b;
+    a = static_cast<uint64_t>(r);
+    b = static_cast<uint64_t>(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    a = _umul128(a, b, &b);
+#else
+    const uint64_t ha = a >> 32, hb = b >> 32, la = static_cast<uint32_t>(a), lb = static_cast<uint32_t>(b);
+    const uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t = rl + (rm0 << 32);
+    uint64_t       c  = t < rl;
+    const uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    const uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+    a                 = lo;
+    b                 = hi;
+#endif
+}
+
+inline uint64_t
+wyMix(uint64_t a, uint64_t b)
+{
+    wyMultiply(a, b);
+    return a ^ b;
+}
+
+// reads are little endian, so the results do not depend on the platform
+inline uint64_t
+wyRead8(const uint8_t* p)
+{
+    uint64_t v;
+    memcpy(&v, p, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+inline uint64_t
+wyRead4(const uint8_t* p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+    return v;
+}
+inline uint64_t
+wyRead3(const uint8_t* p, size_t k)
+{
+    return (static_cast<uint64_t>(p[0]) << 16) | (static_cast<uint64_t>(p[k >> 1]) << 8) | p[k - 1];
+}
+
+//! wyhash final4
+inline uint64_t
+wyHash(const void* data, size_t size, uint64_t seed)
+{
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    seed ^= wyMix(seed ^ kWySecret[0], kWySecret[1]);
+    uint64_t a, b;
+    if (size <= 16) {
+        if (size >= 4) {
+            a = (wyRead4(p) << 32) | wyRead4(p + ((size >> 3) << 2));
+            b = (wyRead4(p + size - 4) << 32) | wyRead4(p + size - 4 - ((size >> 3) << 2));
+        } else if (size > 0) {
+            a = wyRead3(p, size);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = size;
+        if (i >= 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = wyMix(wyRead8(p) ^ kWySecret[1], wyRead8(p + 8) ^ seed);
+                see1 = wyMix(wyRead8(p + 16) ^ kWySecret[2], wyRead8(p + 24) ^ see1);
+                see2 = wyMix(wyRead8(p + 32) ^ kWySecret[3], wyRead8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i >= 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = wyMix(wyRead8(p) ^ kWySecret[1], wyRead8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = wyRead8(p + i - 16);
+        b = wyRead8(p + i - 8);
+    }
+    a ^= kWySecret[1];
+    b ^= seed;
+    wyMultiply(a, b);
+    return wyMix(a ^ kWySecret[0] ^ size, b ^ kWySecret[1]);
+}
+}   // namespace detail
+
+//! Hashes an arbitrary block of memory
+inline uint64_t
+hashBytes(const void* data, size_t size, uint64_t seed = kHashDefaultSeed)
+{
+    return detail::wyHash(data, size, seed);
+}
+
+//! Hash of persisted data (file formats): the same on every build and
+//! platform, pinned by the tests. It never changes, hashBytes() may: a format
+//! moving to another hash bumps its version. Each format has its own seed.
+inline uint64_t
+hashBytesStable(const void* data, size_t size, uint64_t seed)
+{
+    return detail::wyHash(data, size, seed);
+}
+
+//! Hashes a single 64-bit value (integers, pointers, enums, handles)
+inline uint64_t
+hashValue(uint64_t value, uint64_t seed = kHashDefaultSeed)
+{
+    return detail::wyMix(value ^ detail::kWySecret[0], seed ^ detail::kWySecret[1]);
+}
+
+inline uint64_t
+hashCombine(uint64_t seed, uint64_t value)
+{
+    return detail::wyMix(seed ^ detail::kWySecret[2], value ^ detail::kWySecret[3]);
+}
+
+//! FNV-1a, usable at compile time (see StringId). Slower and weaker than
+//! hashBytes(): only use it where a constexpr hash is required.
+static constexpr uint64_t kFnv1aOffset = 0xcbf29ce484222325ull;
+static constexpr uint64_t kFnv1aPrime  = 0x100000001b3ull;
+
+constexpr uint64_t
+hashFnv1a(const char* data, size_t size, uint64_t seed = kFnv1aOffset)
+{
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ static_cast<uint8_t>(data[i])) * kFnv1aPrime;
+    }
+    return hash;
+}
+
+//! Hashes the object representation of a POD struct.
+//! Padding bytes take part in the hash: zero-initialize the struct ({} or memset)
+//! before filling it, or two equal structs may hash differently.
+template <typename T>
+uint64_t
+hashPod(const T& value, uint64_t seed = kHashDefaultSeed)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "hashPod only works on trivially copyable types");
+    return hashBytes(&value, sizeof(T), seed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! Hash functor used by the core containers. Marked as avalanching so that the
+//! containers can use the result as is.
+template <typename T, typename Enable = void> struct Hash;
+
+template <typename T>
+struct Hash<T, typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type> {
+    using is_avalanching = void;
+    size_t operator()(T value) const { return static_cast<size_t>(hashValue(static_cast<uint64_t>(value))); }
+};
+
+template <typename T> struct Hash<T*> {
+    using is_avalanching = void;
+    size_t operator()(const T* value) const
+    {
+        return static_cast<size_t>(hashValue(reinterpret_cast<uintptr_t>(value)));
+    }
+};
+
+//! strings support heterogeneous lookup (std::string, std::string_view and string literals)
+struct StringHash {
+    using is_avalanching = void;
+    using is_transparent = void;
+    size_t operator()(std::string_view value) const
+    {
+        return static_cast<size_t>(hashBytes(value.data(), value.size()));
+    }
+};
+template <> struct Hash<std::string> : StringHash { };
+template <> struct Hash<std::string_view> : StringHash { };
+
+//! Opt-in hash for POD keys, see hashPod()
+template <typename T> struct PodHash {
+    using is_avalanching = void;
+    size_t operator()(const T& value) const { return static_cast<size_t>(hashPod(value)); }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace core
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "core/core.h"
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace core {
+////////////////////////////////////////////////////////////////////////////////
+
+static constexpr size_t kInplaceFunctionDefaultCapacity = 32;
+
+namespace detail {
+template <typename R, typename... ArgsT> struct InplaceFunctionVTable {
+    R (*invoke)(void* storage, ArgsT&&... args);
+    void (*copy)(void* destination, const void* source);
+    void (*move)(void* destination, void* source);
+    void (*destroy)(void* storage);
+};
+
+template <typename F, typename R, typename... ArgsT> struct InplaceFunctionVTableFor {
+    static R Invoke(void* storage, ArgsT&&... args)
+    {
+        return (*static_cast<F*>(storage))(std::forward<ArgsT>(args)...);
+    }
+    static void Copy(void* destination, const void* source) { new (destination) F(*static_cast<const F*>(source)); }
+    static void Move(void* destination, void* source) { new (destination) F(std::move(*static_cast<F*>(source))); }
+    static void Destroy(void* storage) { static_cast<F*>(storage)->~F(); }
+
+    static const InplaceFunctionVTable<R, ArgsT...>* Get()
+    {
+        static const InplaceFunctionVTable<R, ArgsT...> vtable {&Invoke, &Copy, &Move, &Destroy};
+        return &vtable;
+    }
+};
+}   // namespace detail
+
+template <typename SignatureT, size_t Capacity = kInplaceFunctionDefaultCapacity> class InplaceFunction;
+
+//! std::function replacement that stores the callable inside the object itself.
+//! Callables bigger than Capacity are rejected at compile time instead of being
+//! moved to the heap.
+template <typename R, typename... ArgsT, size_t Capacity> class InplaceFunction<R(ArgsT...), Capacity> {
+    template <typename, size_t> friend class InplaceFunction;
+
+    using VTable = detail::InplaceFunctionVTable<R, ArgsT...>;
+
+    template <typename F>
+    using EnableIfCallable = typename std::enable_if<!std::is_same<typename std::decay<F>::type, InplaceFunction>::value
+        && std::is_convertible<decltype(std::declval<typename std::decay<F>::type&>()(std::declval<ArgsT>()...)),
+            R>::value>::type;
+
+public:
+    static constexpr size_t capacity = Capacity;
+
+    InplaceFunction() = default;
+    InplaceFunction(std::nullptr_t) { }
+
+    template <typename F, typename = EnableIfCallable<F>> InplaceFunction(F&& callable)
+    {
+        using FunctorT = typename std::decay<F>::type;
+        static_assert(sizeof(FunctorT) <= Capacity, "callable too big for this InplaceFunction, increase Capacity");
+        static_assert(alignof(FunctorT) <= alignof(std::max_align_t), "over-aligned callable");
+        static_assert(std::is_copy_constructible<FunctorT>::value, "InplaceFunction requires copyable callables");
+
+        new (_storage) FunctorT(std::forward<F>(callable));
+        _vtable = detail::InplaceFunctionVTableFor<FunctorT, R, ArgsT...>::Get();
+    }
+
+    InplaceFunction(const InplaceFunction& other)
+    {
+        if (other._vtable != nullptr) {
+            other._vtable->copy(_storage, other._storage);
+            _vtable = other._vtable;
+        }
+    }
+    InplaceFunction(InplaceFunction&& other) noexcept
+    {
+        if (other._vtable != nullptr) {
+            other._vtable->move(_storage, other._storage);
+            _vtable = other._vtable;
+            other.reset();
+        }
+    }
+    //! smaller functions can always be stored into bigger ones
+    template <size_t OtherCapacity, typename = typename std::enable_if<(OtherCapacity < Capacity)>::type>
+    InplaceFunction(InplaceFunction<R(ArgsT...), OtherCapacity>&& other) noexcept
+    {
+        if (other._vtable != nullptr) {
+            other._vtable->move(_storage, other._storage);
+            _vtable = other._vtable;
+            other.reset();
+        }
+    }
+    ~InplaceFunction() { reset(); }
+
+    InplaceFunction& operator=(const InplaceFunction& other)
+    {
+        if (this != &other) {
+            reset();
+            if (other._vtable != nullptr) {
+                other._vtable->copy(_storage, other._storage);
+                _vtable = other._vtable;
+            }
+        }
+        return *this;
+    }
+    InplaceFunction& operator=(InplaceFunction&& other) noexcept
+    {
+        if (this != &other) {
+            reset();
+            if (other._vtable != nullptr) {
+                other._vtable->move(_storage, other._storage);
+                _vtable = other._vtable;
+                other.reset();
+            }
+        }
+        return *this;
+    }
+    InplaceFunction& operator=(std::nullptr_t)
+    {
+        reset();
+        return *this;
+    }
+    template <typename F, typename = EnableIfCallable<F>> InplaceFunction& operator=(F&& callable)
+    {
+        *this = InplaceFunction(std::forward<F>(callable));
+        return *this;
+    }
+
+    R operator()(ArgsT... args) const
+    {
+        ASSERT_MSG(_vtable != nullptr, "calling an empty InplaceFunction");
+        return _vtable->invoke(const_cast<unsigned char*>(_storage), std::forward<ArgsT>(args)...);
+    }
+
+    explicit operator bool() const { return _vtable != nullptr; }
+
+    void reset()
+    {
+        if (_vtable != nullptr) {
+            _vtable->destroy(_storage);
+            _vtable = nullptr;
+        }
+    }
+
+private:
+    const VTable* _vtable = nullptr;
+    alignas(std::max_align_t) unsigned char _storage[Capacity];
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace core
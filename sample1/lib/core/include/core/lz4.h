@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace core {
+namespace lz4 {
+////////////////////////////////////////////////////////////////////////////////
+// Compressor/decompressor for the LZ4 block format (no frame header): fast
+// greedy matching with a single hash table, decoding at memory speed.
+// Streams are compatible with the reference LZ4_compress_default() and
+// LZ4_decompress_safe().
+
+//! worst case compressed size for srcSize bytes
+inline size_t
+compressBound(size_t srcSize)
+{
+    return srcSize + srcSize / 255 + 16;
+}
+
+//! Returns the compressed size, 0 when dstCapacity is too small
+//! (dstCapacity >= compressBound(srcSize) never fails).
+size_t compress(const void* src, size_t srcSize, void* dst, size_t dstCapacity);
+
+//! Decodes exactly dstSize bytes. Malformed or truncated input never reads or
+//! writes out of bounds, it makes the call return false.
+bool decompress(const void* src, size_t srcSize, void* dst, size_t dstSize);
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace lz4
+}   // namespace core
@@ -1,15 +1,76 @@
 #pragma once
 
+#include "core/core.h"
+
+#include <cstddef>
+#include <cstdint>
+
+//! Counts every global operator new/delete (see memory.cpp): debug builds,
+//! release builds opt in with the CORE_TRACK_ALLOCATIONS CMake option.
+#if USING(IS_DEBUG) || defined(CORE_TRACK_ALLOCATIONS)
+#define TRACK_ALLOCATIONS IN_USE
+#else   // #if USING(IS_DEBUG) || defined(CORE_TRACK_ALLOCATIONS)
+#define TRACK_ALLOCATIONS NOT_IN_USE
+#endif   // #else   // #if USING(IS_DEBUG) || defined(CORE_TRACK_ALLOCATIONS)
+
 namespace core {
 /////////////////////////////////////////////////////////////////////////////////
 
-template <typename T>
-bool
-isAligned(const T value, size_t alignmentBytes)
+//! alignmentBytes must be a power of two
+inline bool
+isAligned(const void* ptr, size_t alignmentBytes)
+{
+    return (reinterpret_cast<uintptr_t>(ptr) & (alignmentBytes - 1)) == 0;
+}
+inline bool
+isAligned(uint64_t value, size_t alignmentBytes)
 {
-    T* valuePtr = &value;
-    return (valuePtr % alignmentBytes) == 0;
+    return (value & (alignmentBytes - 1)) == 0;
 }
+inline uint64_t
+alignUp(uint64_t value, size_t alignmentBytes)
+{
+    return (value + alignmentBytes - 1) & ~static_cast<uint64_t>(alignmentBytes - 1);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+
+namespace memory {
+
+struct AllocationStats {
+    uint64_t allocationCount = 0;
+    uint64_t freeCount       = 0;
+    uint64_t allocatedBytes  = 0;
+};
+
+//! Totals since startup, all threads included.
+//! Always zero when TRACK_ALLOCATIONS is not in use.
+AllocationStats getAllocationStats();
+
+//! Measures the heap activity between construction and the call to Get()
+class AllocationCounter {
+    AllocationStats _start;
+
+public:
+    AllocationCounter()
+        : _start(getAllocationStats())
+    {
+    }
+
+    void Reset() { _start = getAllocationStats(); }
+
+    AllocationStats Get() const
+    {
+        const AllocationStats now = getAllocationStats();
+        AllocationStats       delta;
+        delta.allocationCount = now.allocationCount - _start.allocationCount;
+        delta.freeCount       = now.freeCount - _start.freeCount;
+        delta.allocatedBytes  = now.allocatedBytes - _start.allocatedBytes;
+        return delta;
+    }
+};
+
+}   // namespace memory
 
 /////////////////////////////////////////////////////////////////////////////////
 }   // namespace core
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "core/core.h"
+#include "core/hash.h"
+#include "core/vfs.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace core {
+namespace pak {
+////////////////////////////////////////////////////////////////////////////////
+// Pak archives: many files in one, opened with one open() + one mmap().
+//
+// Layout (little endian):
+//   Header                  at offset 0
+//   entry data              raw entries 4K aligned (served as views of the
+//                           mapping), LZ4 entries 16 bytes aligned
+//   Entry[entryCount]       sorted by pathHash, 16 bytes aligned
+//   names                   the '/' separated paths, not null terminated
+//
+// pathHash is FNV-1a (same as core::StringId), contentHash is hashBytesStable()
+// of the uncompressed data and tocHash hashBytesStable() of the entries and
+// the names: changing any of them requires a kVersion bump.
+
+static constexpr uint32_t kMagic         = 0x314b4150;   // "PAK1"
+static constexpr uint32_t kVersion       = 1;
+static constexpr uint64_t kRawAlignment  = 4096;
+static constexpr uint64_t kDataAlignment = 16;
+static constexpr uint64_t kHashSeed      = 0x70616b2d68617368ull;
+
+enum class Compression : uint8_t { None = 0, Lz4 = 1 };
+
+struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t reserved;
+    uint64_t tocOffset;
+    uint64_t namesOffset;
+    uint64_t namesSize;
+    uint64_t tocHash;   //!< entries + names
+};
+static_assert(sizeof(Header) == 48, "pak header layout changed");
+
+struct Entry {
+    uint64_t    pathHash;
+    uint64_t    offset;
+    uint64_t    size;         //!< uncompressed
+    uint64_t    storedSize;   //!< in the archive
+    uint64_t    contentHash;
+    uint32_t    nameOffset;
+    uint16_t    nameLength;
+    Compression compression;
+    uint8_t     reserved;
+};
+static_assert(sizeof(Entry) == 48, "pak entry layout changed");
+
+inline uint64_t
+pathHash(std::string_view path)
+{
+    return hashFnv1a(path.data(), path.size());
+}
+
+inline uint64_t
+contentHash(const void* data, size_t size)
+{
+    return hashBytesStable(data, size, kHashSeed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! Builds a pak file (offline, see the pak_packer tool)
+class PakWriter {
+    struct Input {
+        std::string     path;
+        vfs::FileHandle data;
+        bool            compress;
+    };
+    std::vector<Input> _inputs;
+
+public:
+    struct Summary {
+        uint32_t entryCount       = 0;
+        uint32_t compressedCount  = 0;
+        uint64_t uncompressedSize = 0;
+        uint64_t archiveSize      = 0;
+    };
+
+    //! Entries only stay compressed when it saves at least 1/16th of their size.
+    //! Files read in place (SPIR-V, mesh blobs...) should pass compress = false.
+    void Add(std::string path, vfs::FileHandle data, bool compress = true);
+
+    //! writes to nativePath + ".tmp" then renames, the previous pak stays valid until then
+    bool Write(const char* nativePath, Summary* summary = nullptr) const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! vfs mount serving the files of a pak
+class ArchiveMount : public vfs::IMount {
+    vfs::FileHandle _archive;
+    const Entry*    _entries    = nullptr;
+    uint32_t        _entryCount = 0;
+    const char*     _names      = nullptr;
+
+public:
+    //! nullptr when the file is missing or not a valid pak
+    static std::unique_ptr<ArchiveMount> Load(const char* nativePath);
+
+    vfs::FileHandle Open(std::string_view path) override;
+    bool            Exists(std::string_view path) const override;
+
+    const Entry*     Find(std::string_view path) const;
+    uint32_t         entryCount() const { return _entryCount; }
+    const Entry&     entry(uint32_t index) const { return _entries[index]; }
+    std::string_view entryPath(const Entry& entry) const
+    {
+        return std::string_view(_names + entry.nameOffset, entry.nameLength);
+    }
+
+    //! decompresses/hashes every entry, false on the first mismatch
+    bool Verify() const;
+
+private:
+    bool _Validate(const char* nativePath);
+    bool _ReadEntry(const Entry& entry, vfs::FileHandle& data) const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace pak
+}   // namespace core
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "core/core.h"
+#include "core/memory.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace core {
+////////////////////////////////////////////////////////////////////////////////
+// Allocators over a range of offsets [0, size) for transient data (per frame
+// uniforms, staging copies...), the memory itself lives elsewhere.
+
+//! Bump allocator: everything is released at once by Reset().
+class LinearAllocator {
+public:
+    static constexpr uint64_t kInvalidOffset = UINT64_MAX;
+
+    LinearAllocator() = default;
+    explicit LinearAllocator(uint64_t size)
+        : _size(size)
+    {
+    }
+
+    //! alignment: power of two, kInvalidOffset when full
+    uint64_t Allocate(uint64_t size, uint64_t alignment = 1)
+    {
+        const uint64_t offset = alignUp(_used, static_cast<size_t>(alignment));
+        if (offset > _size || size > _size - offset) {
+            return kInvalidOffset;
+        }
+        _used = offset + size;
+        return offset;
+    }
+    void Reset() { _used = 0; }
+
+    uint64_t size() const { return _size; }
+    uint64_t usedBytes() const { return _used; }
+
+private:
+    uint64_t _size = 0;
+    uint64_t _used = 0;
+};
+
+//! FIFO allocator: released in allocation order, in batches. Typically one
+//! batch per frame, released once the GPU is done with the frame:
+//!
+//!     offset = ring.Allocate(size, alignment);
+//!     ...
+//!     frameMarkers[frame] = ring.head();   // end of the frame
+//!     ...
+//!     ring.Release(frameMarkers[frame]);   // its fence is signaled
+//!
+//! Positions are 64 bits and never wrap: the offset is position % size. An
+//! allocation never straddles the end of the range, the bytes skipped are
+//! released with the batch.
+class RingAllocator {
+public:
+    static constexpr uint64_t kInvalidOffset = UINT64_MAX;
+
+    RingAllocator() = default;
+    explicit RingAllocator(uint64_t size)
+        : _size(size)
+    {
+    }
+
+    //! alignment: power of two dividing the size, kInvalidOffset when full
+    uint64_t Allocate(uint64_t size, uint64_t alignment = 1)
+    {
+        ASSERT_MSG(_size % alignment == 0, "ring size must be a multiple of the alignment");
+        if (_size == 0 || size > _size) {
+            return kInvalidOffset;
+        }
+        if (_head == _tail && _head % _size != 0) {
+            // empty: the whole range is available from the next lap
+            _head = _tail = _head - _head % _size + _size;
+        }
+        const uint64_t lap    = _head - _head % _size;
+        const uint64_t offset = alignUp(_head % _size, static_cast<size_t>(alignment));
+        // not enough room before the end: restart at the beginning
+        const uint64_t position = offset + size <= _size ? lap + offset : lap + _size;
+        if (position + size - _tail > _size) {
+            return kInvalidOffset;
+        }
+        _head = position + size;
+        return position % _size;
+    }
+
+    //! position to pass to Release() to free everything allocated up to now
+    uint64_t head() const { return _head; }
+    //! marker: a previous head(). Markers older than the last one released
+    //! are ignored, everything before them is already free.
+    void Release(uint64_t marker)
+    {
+        ASSERT_MSG(marker <= _head, "unknown ring marker");
+        _tail = std::max(_tail, marker);
+    }
+    void Reset() { _head = _tail = 0; }
+
+    uint64_t size() const { return _size; }
+    uint64_t usedBytes() const { return _head - _tail; }
+
+private:
+    uint64_t _size = 0;
+    uint64_t _head = 0;
+    uint64_t _tail = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace core
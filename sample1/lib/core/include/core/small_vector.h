@@ -0,0 +1,309 @@
+#pragma once
+
+#include "core/core.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace core {
+////////////////////////////////////////////////////////////////////////////////
+
+//! std::vector-like container keeping up to N elements inline.
+//! It only touches the heap once it grows past N elements.
+template <typename T, size_t N> class SmallVector {
+    static_assert(N > 0, "SmallVector needs some inline capacity");
+
+public:
+    using value_type      = T;
+    using size_type       = size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference       = T&;
+    using const_reference = const T&;
+    using pointer         = T*;
+    using const_pointer   = const T*;
+    using iterator        = T*;
+    using const_iterator  = const T*;
+
+    static constexpr size_t inline_capacity = N;
+
+public:
+    SmallVector() = default;
+    explicit SmallVector(size_t count) { resize(count); }
+    SmallVector(size_t count, const T& value) { assign(count, value); }
+    SmallVector(std::initializer_list<T> values) { assign(values.begin(), values.end()); }
+    template <typename It, typename = typename std::iterator_traits<It>::iterator_category>
+    SmallVector(It first, It last)
+    {
+        assign(first, last);
+    }
+
+    SmallVector(const SmallVector& other) { assign(other.begin(), other.end()); }
+    SmallVector(SmallVector&& other) noexcept(std::is_nothrow_move_constructible<T>::value)
+    {
+        _MoveFrom(std::move(other));
+    }
+    ~SmallVector()
+    {
+        clear();
+        _ReleaseHeap();
+    }
+
+    SmallVector& operator=(const SmallVector& other)
+    {
+        if (this != &other) {
+            assign(other.begin(), other.end());
+        }
+        return *this;
+    }
+    SmallVector& operator=(SmallVector&& other) noexcept(std::is_nothrow_move_constructible<T>::value)
+    {
+        if (this != &other) {
+            clear();
+            _ReleaseHeap();
+            _MoveFrom(std::move(other));
+        }
+        return *this;
+    }
+    SmallVector& operator=(std::initializer_list<T> values)
+    {
+        assign(values.begin(), values.end());
+        return *this;
+    }
+
+    void assign(size_t count, const T& value)
+    {
+        clear();
+        reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            new (_data + i) T(value);
+        }
+        _size = count;
+    }
+    template <typename It, typename = typename std::iterator_traits<It>::iterator_category>
+    void assign(It first, It last)
+    {
+        clear();
+        reserve(static_cast<size_t>(std::distance(first, last)));
+        for (; first != last; ++first) {
+            new (_data + _size) T(*first);
+            ++_size;
+        }
+    }
+
+    // element access
+    T& operator[](size_t index)
+    {
+        ASSERT(index < _size);
+        return _data[index];
+    }
+    const T& operator[](size_t index) const
+    {
+        ASSERT(index < _size);
+        return _data[index];
+    }
+    T&       front() { return (*this)[0]; }
+    const T& front() const { return (*this)[0]; }
+    T&       back() { return (*this)[_size - 1]; }
+    const T& back() const { return (*this)[_size - 1]; }
+    T*       data() { return _data; }
+    const T* data() const { return _data; }
+
+    // iterators
+    iterator       begin() { return _data; }
+    const_iterator begin() const { return _data; }
+    const_iterator cbegin() const { return _data; }
+    iterator       end() { return _data + _size; }
+    const_iterator end() const { return _data + _size; }
+    const_iterator cend() const { return _data + _size; }
+
+    // capacity
+    bool   empty() const { return _size == 0; }
+    size_t size() const { return _size; }
+    size_t capacity() const { return _capacity; }
+    bool   isInline() const { return _data == _InlineData(); }
+
+    void reserve(size_t newCapacity)
+    {
+        if (newCapacity > _capacity) {
+            _Grow(newCapacity);
+        }
+    }
+    void shrink_to_fit()
+    {
+        if (isInline() || _size == _capacity) {
+            return;
+        }
+        if (_size <= N) {
+            T* heapData = _data;
+            _Relocate(heapData, _size, _InlineData());
+            ::operator delete(heapData);
+            _data     = _InlineData();
+            _capacity = N;
+        } else {
+            _Grow(_size);
+        }
+    }
+
+    // modifiers
+    void clear()
+    {
+        _Destroy(_data, _data + _size);
+        _size = 0;
+    }
+
+    void push_back(const T& value) { emplace_back(value); }
+    void push_back(T&& value) { emplace_back(std::move(value)); }
+
+    template <typename... ArgsT> T& emplace_back(ArgsT&&... args)
+    {
+        if (_size == _capacity) {
+            // the argument may alias an element, so build it before relocating
+            T value(std::forward<ArgsT>(args)...);
+            _Grow(_NextCapacity(_size + 1));
+            new (_data + _size) T(std::move(value));
+        } else {
+            new (_data + _size) T(std::forward<ArgsT>(args)...);
+        }
+        return _data[_size++];
+    }
+
+    void pop_back()
+    {
+        ASSERT(_size > 0);
+        _data[--_size].~T();
+    }
+
+    void resize(size_t count)
+    {
+        if (count < _size) {
+            _Destroy(_data + count, _data + _size);
+        } else {
+            reserve(count);
+            for (size_t i = _size; i < count; ++i) {
+                new (_data + i) T();
+            }
+        }
+        _size = count;
+    }
+    void resize(size_t count, const T& value)
+    {
+        if (count < _size) {
+            _Destroy(_data + count, _data + _size);
+        } else {
+            reserve(count);
+            for (size_t i = _size; i < count; ++i) {
+                new (_data + i) T(value);
+            }
+        }
+        _size = count;
+    }
+
+    iterator insert(const_iterator position, const T& value) { return emplace(position, value); }
+    iterator insert(const_iterator position, T&& value) { return emplace(position, std::move(value)); }
+    template <typename... ArgsT> iterator emplace(const_iterator position, ArgsT&&... args)
+    {
+        const size_t index = static_cast<size_t>(position - _data);
+        ASSERT(index <= _size);
+        emplace_back(std::forward<ArgsT>(args)...);
+        std::rotate(_data + index, _data + _size - 1, _data + _size);
+        return _data + index;
+    }
+
+    iterator erase(const_iterator position) { return erase(position, position + 1); }
+    iterator erase(const_iterator first, const_iterator last)
+    {
+        T* firstIt = _data + (first - _data);
+        T* lastIt  = _data + (last - _data);
+        ASSERT(firstIt >= _data && lastIt <= end() && firstIt <= lastIt);
+        T* newEnd = std::move(lastIt, end(), firstIt);
+        _Destroy(newEnd, end());
+        _size -= static_cast<size_t>(lastIt - firstIt);
+        return firstIt;
+    }
+
+    //! O(1) removal that does not keep the element order
+    void erase_unordered(size_t index)
+    {
+        ASSERT(index < _size);
+        if (index != _size - 1) {
+            _data[index] = std::move(_data[_size - 1]);
+        }
+        pop_back();
+    }
+
+    bool operator==(const SmallVector& other) const
+    {
+        return _size == other._size && std::equal(begin(), end(), other.begin());
+    }
+    bool operator!=(const SmallVector& other) const { return !operator==(other); }
+
+private:
+    T*       _InlineData() { return reinterpret_cast<T*>(_inlineStorage); }
+    const T* _InlineData() const { return reinterpret_cast<const T*>(_inlineStorage); }
+
+    static size_t _NextCapacity(size_t minCapacity) { return std::max(minCapacity, minCapacity * 3 / 2); }
+
+    static void _Destroy(T* first, T* last)
+    {
+        for (; first != last; ++first) {
+            first->~T();
+        }
+    }
+    static void _Relocate(T* source, size_t count, T* destination)
+    {
+        for (size_t i = 0; i < count; ++i) {
+            new (destination + i) T(std::move_if_noexcept(source[i]));
+            source[i].~T();
+        }
+    }
+
+    void _Grow(size_t newCapacity)
+    {
+        ASSERT(newCapacity > _capacity);
+        static_assert(alignof(T) <= alignof(std::max_align_t), "over-aligned types need an aligned allocation");
+        T* newData = static_cast<T*>(::operator new(newCapacity * sizeof(T)));
+        _Relocate(_data, _size, newData);
+        _ReleaseHeap();
+        _data     = newData;
+        _capacity = newCapacity;
+    }
+
+    void _ReleaseHeap()
+    {
+        if (!isInline()) {
+            ::operator delete(_data);
+            _data     = _InlineData();
+            _capacity = N;
+        }
+    }
+
+    void _MoveFrom(SmallVector&& other)
+    {
+        ASSERT(_size == 0 && isInline());
+        if (other.isInline()) {
+            _Relocate(other._data, other._size, _InlineData());
+            _size = other._size;
+        } else {   // steal the heap block
+            _data           = other._data;
+            _size           = other._size;
+            _capacity       = other._capacity;
+            other._data     = other._InlineData();
+            other._capacity = N;
+        }
+        other._size = 0;
+    }
+
+private:
+    T*     _data     = _InlineData();
+    size_t _size     = 0;
+    size_t _capacity = N;
+    alignas(T) unsigned char _inlineStorage[N * sizeof(T)];
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace core
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "core/core.h"
+#include "core/hash.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+//! Keeps the original string of every runtime-built StringId so ids can be
+//! printed, and reports two strings hashing to the same id.
+#if USING(IS_DEBUG)
+#define STRING_ID_INTERN IN_USE
+#else   // #if USING(IS_DEBUG)
+#define STRING_ID_INTERN NOT_IN_USE
+#endif   // #else   // #if USING(IS_DEBUG)
+
+namespace core {
+////////////////////////////////////////////////////////////////////////////////
+// Names of resources (buffers, shaders, pipelines...) as a 64-bit FNV-1a hash.
+// Literals are hashed at compile time:
+//
+//     constexpr core::StringId kName = "shaders/shader.vert.spv";
+//     using namespace core::literals;
+//     if (buffer.name == "vertices"_sid) { ... }
+//
+// Runtime strings (and literals hashed at runtime) go through _Intern() when
+// STRING_ID_INTERN is in use, which reports collisions; constexpr ids are not
+// interned and print as their hash unless their string was. Ids compare by
+// hash only, a StringId is 8 bytes in every build: do not persist them, the
+// hash may change.
+
+class StringId {
+    uint64_t _value = 0;
+
+public:
+    constexpr StringId() = default;
+
+    //! Literals hash at compile time. Any char array binds here: the hash
+    //! stops at the first '\0', so a runtime buffer hashes (and interns) its
+    //! string, not its capacity.
+    template <size_t N>
+    constexpr StringId(const char (&literal)[N])
+        : StringId(FromLiteral(literal, _Length(literal, N)))
+    {
+    }
+
+    explicit StringId(std::string_view name)
+        : _value(hashFnv1a(name.data(), name.size()))
+    {
+#if USING(STRING_ID_INTERN)
+        _Intern(name, _value);
+#endif   // #if USING(STRING_ID_INTERN)
+    }
+
+    static constexpr StringId FromValue(uint64_t value)
+    {
+        StringId id;
+        id._value = value;
+        return id;
+    }
+
+    //! interned when evaluated at runtime
+    static constexpr StringId FromLiteral(const char* literal, size_t length)
+    {
+        StringId id;
+        id._value = hashFnv1a(literal, length);
+#if USING(STRING_ID_INTERN)
+        if (!__builtin_is_constant_evaluated()) {
+            _Intern(std::string_view(literal, length), id._value);
+        }
+#endif   // #if USING(STRING_ID_INTERN)
+        return id;
+    }
+
+    //! Registers the name for reverse lookup (no-op without STRING_ID_INTERN)
+    static StringId Intern(std::string_view name) { return StringId(name); }
+
+    //! Original string when interned, "<sid:0x...>" otherwise (that one lives in
+    //! a thread local buffer, overwritten by the next call).
+    const char* c_str() const;
+
+    constexpr uint64_t value() const { return _value; }
+    constexpr bool     isValid() const { return _value != 0; }
+    constexpr explicit operator bool() const { return isValid(); }
+
+    constexpr bool operator==(const StringId& other) const { return _value == other._value; }
+    constexpr bool operator!=(const StringId& other) const { return !(*this == other); }
+    constexpr bool operator<(const StringId& other) const { return _value < other._value; }
+
+private:
+    static constexpr size_t _Length(const char* chars, size_t capacity)
+    {
+        size_t length = 0;
+        while (length < capacity && chars[length] != '\0') {
+            ++length;
+        }
+        return length;
+    }
+
+    static void _Intern(std::string_view name, uint64_t value);
+};
+
+static_assert(sizeof(StringId) == sizeof(uint64_t), "StringId is a hash, in every build");
+
+namespace literals {
+constexpr StringId
+operator""_sid(const char* literal, size_t size)
+{
+    return StringId::FromLiteral(literal, size);
+}
+}   // namespace literals
+
+//! FNV-1a does not spread its low bits well enough for power-of-two tables
+template <> struct Hash<StringId> {
+    using is_avalanching = void;
+    size_t operator()(StringId id) const { return static_cast<size_t>(hashValue(id.value())); }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace core
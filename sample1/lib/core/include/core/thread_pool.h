@@ -0,0 +1,51 @@
+#pragma once
+
+#include "core/core.h"
+#include "core/inplace_function.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace core {
+////////////////////////////////////////////////////////////////////////////////
+
+//! Fixed set of worker threads running tasks in submission order.
+//! Tasks must not throw; the destructor runs the tasks still queued.
+class ThreadPool {
+public:
+    static constexpr size_t kTaskCapacity = 64;
+    using Task                            = InplaceFunction<void(void), kTaskCapacity>;
+
+    //! 0: one thread per hardware thread, minus the calling one
+    explicit ThreadPool(uint32_t threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&)            = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void Submit(Task&& task);
+    //! blocks until every submitted task has run (do not call from a task)
+    void WaitIdle();
+
+    uint32_t threadCount() const { return static_cast<uint32_t>(_threads.size()); }
+
+    static uint32_t defaultThreadCount();
+
+private:
+    void _WorkerLoop();
+
+    std::vector<std::thread> _threads;
+    std::deque<Task>         _tasks;
+    std::mutex               _mutex;
+    std::condition_variable  _taskAvailable;
+    std::condition_variable  _idle;
+    uint32_t                 _runningTasks = 0;
+    bool                     _stopping     = false;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace core
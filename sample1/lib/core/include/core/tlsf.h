@@ -0,0 +1,90 @@
+#pragma once
+
+#include "core/core.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace core {
+////////////////////////////////////////////////////////////////////////////////
+// Two-Level Segregated Fit allocator over a range of offsets [0, size): the
+// memory itself lives elsewhere (a VkDeviceMemory block, a GPU buffer...).
+//
+// Free regions are binned by size class: first level = power of two, second
+// level = kSecondLevelCount linear subdivisions. Allocate() and Free() are
+// O(1) (two bit scans, no search), neighbors are coalesced on Free(), and the
+// waste is bounded by the second level granularity (1/16th).
+// Bookkeeping lives in a node array: no allocation per Allocate() once the
+// array has grown to the peak region count.
+
+class TlsfAllocator {
+public:
+    static constexpr uint64_t kInvalidOffset    = UINT64_MAX;
+    static constexpr uint32_t kInvalidNode      = UINT32_MAX;
+    static constexpr uint32_t kSecondLevelLog2  = 4;
+    static constexpr uint32_t kSecondLevelCount = 1u << kSecondLevelLog2;
+    static constexpr uint32_t kFirstLevelCount  = 64 - kSecondLevelLog2 + 1;
+
+    struct Allocation {
+        uint64_t offset = kInvalidOffset;
+        uint64_t size   = 0;
+        uint32_t node   = kInvalidNode;
+
+        bool isValid() const { return offset != kInvalidOffset; }
+    };
+
+    struct Stats {
+        uint64_t size              = 0;
+        uint64_t usedBytes         = 0;
+        uint32_t allocationCount   = 0;
+        uint32_t freeRegionCount   = 0;
+        uint64_t largestFreeRegion = 0;
+
+        uint64_t freeBytes() const { return size - usedBytes; }
+    };
+
+    TlsfAllocator() = default;
+    explicit TlsfAllocator(uint64_t size) { Reset(size); }
+
+    //! forgets every allocation, the whole range becomes one free region
+    void Reset(uint64_t size);
+
+    //! alignment: power of two. Invalid allocation when no free region fits.
+    Allocation Allocate(uint64_t size, uint64_t alignment = 1);
+    void       Free(const Allocation& allocation);
+
+    uint64_t size() const { return _size; }
+    bool     empty() const { return _stats.allocationCount == 0; }
+
+    //! largestFreeRegion is computed on call: O(size classes)
+    Stats GetStats() const;
+
+private:
+    struct Node {
+        uint64_t offset       = 0;
+        uint64_t size         = 0;
+        uint32_t prevPhysical = kInvalidNode;
+        uint32_t nextPhysical = kInvalidNode;
+        uint32_t prevFree     = kInvalidNode;
+        uint32_t nextFree     = kInvalidNode;
+        bool     used         = false;
+    };
+
+    uint32_t _NewNode(uint64_t offset, uint64_t size);
+    void     _DeleteNode(uint32_t node);
+    void     _InsertFree(uint32_t node);
+    void     _RemoveFree(uint32_t node);
+
+    uint64_t              _size = 0;
+    std::vector<Node>     _nodes;
+    std::vector<uint32_t> _unusedNodes;
+
+    uint64_t _firstLevelBitmap = 0;
+    uint32_t _secondLevelBitmaps[kFirstLevelCount] {};
+    uint32_t _freeLists[kFirstLevelCount][kSecondLevelCount];
+
+    Stats _stats;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace core
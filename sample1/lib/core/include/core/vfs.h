@@ -0,0 +1,171 @@
+#pragma once
+
+#include "core/core.h"
+#include "core/flat_hash_map.h"
+#include "core/memory.h"
+#include "core/small_vector.h"
+#include "core/string_id.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace core {
+namespace vfs {
+////////////////////////////////////////////////////////////////////////////////
+// Read-only virtual file system.
+//
+//     core::vfs::FileSystem fs;
+//     fs.Mount("", std::make_unique<core::vfs::DirectoryMount>("."));
+//     core::vfs::FileHandle file = fs.Open("shaders/shader.vert.spv");
+//     if (file) { use(file.dataAs<uint32_t>(), file.size()); }
+//
+// Files are memory mapped whenever possible: opening one costs no copy and
+// the pages are only read when touched. FileHandle is a reference counted
+// view; the mapping lives as long as one handle (or the cache) points to it.
+// Mapped files must be replaced (write to a new file + rename), never
+// rewritten in place, or the existing views change under their users.
+
+//! heap backed files are at least this aligned, mapped files are page aligned
+static constexpr size_t kFileDataAlignment = 64;
+
+namespace detail {
+struct FileBlob;
+}   // namespace detail
+
+class FileHandle {
+    detail::FileBlob* _blob = nullptr;
+    const uint8_t*    _data = nullptr;
+    size_t            _size = 0;
+
+public:
+    FileHandle() = default;
+    ~FileHandle() { reset(); }
+
+    FileHandle(const FileHandle& other);
+    FileHandle(FileHandle&& other) noexcept;
+    FileHandle& operator=(const FileHandle& other);
+    FileHandle& operator=(FileHandle&& other) noexcept;
+
+    //! Maps a file of the native file system. Invalid handle on failure.
+    static FileHandle MapFile(const char* nativePath);
+    //! Heap backed, kFileDataAlignment aligned buffer to be filled through
+    //! MutableData() before the handle is shared (decompression, generated data).
+    static FileHandle Allocate(size_t size);
+
+    //! View on a range of this file, keeping the whole file alive
+    FileHandle SubView(size_t offset, size_t size) const;
+
+    const uint8_t* data() const { return _data; }
+    size_t         size() const { return _size; }
+    bool           isValid() const { return _blob != nullptr; }
+    explicit operator bool() const { return isValid(); }
+
+    std::string_view asString() const { return std::string_view(reinterpret_cast<const char*>(_data), _size); }
+
+    template <typename T> const T* dataAs() const
+    {
+        ASSERT_MSG(isAligned(_data, alignof(T)), "file data is not aligned for this type");
+        return reinterpret_cast<const T*>(_data);
+    }
+
+    //! only allowed on the handle returned by Allocate(), before it is copied
+    uint8_t* MutableData();
+
+    uint32_t useCount() const;
+    void     reset();
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! Called from any thread, concurrently
+class IMount {
+public:
+    virtual ~IMount() = default;
+
+    //! path is relative to the mount point, '/' separated
+    virtual FileHandle Open(std::string_view path)         = 0;
+    virtual bool       Exists(std::string_view path) const = 0;
+};
+
+//! Maps files of a native directory
+class DirectoryMount : public IMount {
+    std::string _root;
+
+public:
+    explicit DirectoryMount(std::string root);
+
+    FileHandle Open(std::string_view path) override;
+    bool       Exists(std::string_view path) const override;
+
+private:
+    std::string _NativePath(std::string_view path) const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+enum class CacheMode {
+    Cached,     //!< kept in the read-through cache until evicted
+    Uncached,   //!< loaded once (still served from the cache when already there)
+};
+
+struct Stats {
+    uint64_t openCount       = 0;   //!< Open() calls
+    uint64_t cacheHitCount   = 0;
+    uint64_t failedOpenCount = 0;
+    uint64_t bytesLoaded     = 0;   //!< mapped or read from the mounts
+    uint64_t cachedFiles     = 0;
+    uint64_t cachedBytes     = 0;
+    uint64_t loadTimeNs      = 0;   //!< time spent in the mounts (cache misses)
+    uint64_t maxLoadTimeNs   = 0;
+};
+
+//! Mounts are searched from the last mounted to the first one, so later
+//! mounts (patches, mods) override files of earlier ones. Thread safe.
+class FileSystem {
+    struct MountPoint {
+        std::string prefix;   //!< without the trailing '/'
+        //! shared with the Open() calls in progress, which run unlocked
+        std::shared_ptr<IMount> mount;
+    };
+
+    mutable std::mutex                _mutex;
+    std::vector<MountPoint>           _mounts;
+    uint64_t                          _mountGeneration = 0;   //!< a file loaded meanwhile is not cached
+    FlatHashMap<StringId, FileHandle> _cache;
+    Stats                             _stats;
+
+    struct MountMatch {
+        std::shared_ptr<IMount> mount;
+        std::string_view        relativePath;
+    };
+    using MountMatches = SmallVector<MountMatch, 4>;
+
+    //! the mounts of path, the last mounted first: the callers use them
+    //! without holding the lock
+    void _MatchMounts(std::string_view path, MountMatches& matches) const;
+
+public:
+    //! prefix is a directory stripped from the paths given to the mount ("" for
+    //! the root): "data" and "data/" match "data/x", not "database/x"
+    void Mount(std::string_view prefix, std::unique_ptr<IMount> mount);
+    void UnmountAll();
+
+    FileHandle Open(std::string_view path, CacheMode cacheMode = CacheMode::Cached);
+    bool       Exists(std::string_view path) const;
+
+    //! drops the cached handle, the next Open() reloads the file
+    void Evict(std::string_view path);
+    void ClearCache();
+
+    Stats GetStats() const;
+    void  ResetStats();
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace vfs
+}   // namespace core
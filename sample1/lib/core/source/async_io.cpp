@@ -0,0 +1,743 @@
+#include "core/async_io.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+#if defined(__linux__)
+#define IO_URING IN_USE
+#else   // #if defined(__linux__)
+#define IO_URING NOT_IN_USE
+#endif   // #else   // #if defined(__linux__)
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#else   // #if defined(_WIN32)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif   // #else   // #if defined(_WIN32)
+
+#if USING(IO_URING)
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif   // #if USING(IO_URING)
+
+namespace core {
+namespace io {
+/////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+//! big reads are split so cancellation and priorities are not stuck behind them
+constexpr uint64_t kMaxReadChunk = 4 * 1024 * 1024;
+
+uint64_t
+nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+#if defined(_WIN32)
+int
+openReadOnly(const char* path)
+{
+    return _open(path, _O_RDONLY | _O_BINARY);
+}
+int64_t
+readAt(int fd, void* destination, uint64_t size, uint64_t offset)
+{
+    // no pread on windows: seek + read, each request owns its descriptor
+    if (_lseeki64(fd, static_cast<int64_t>(offset), SEEK_SET) < 0) {
+        return -1;
+    }
+    return _read(fd, destination, static_cast<unsigned>(size));
+}
+int64_t
+fileSize(int fd)
+{
+    return _filelengthi64(fd);
+}
+void
+closeFile(int fd)
+{
+    _close(fd);
+}
+#else    // #if defined(_WIN32)
+int
+openReadOnly(const char* path)
+{
+    return open(path, O_RDONLY | O_CLOEXEC);
+}
+int64_t
+readAt(int fd, void* destination, uint64_t size, uint64_t offset)
+{
+    return pread(fd, destination, size, static_cast<off_t>(offset));
+}
+int64_t
+fileSize(int fd)
+{
+    struct stat fileStat;
+    return fstat(fd, &fileStat) == 0 ? static_cast<int64_t>(fileStat.st_size) : -1;
+}
+void
+closeFile(int fd)
+{
+    close(fd);
+}
+#endif   // #else    // #if defined(_WIN32)
+}   // namespace
+
+namespace detail {
+struct ReadState {
+    ReadRequest request;
+    ReadResult  result;
+
+    std::mutex              mutex;
+    std::condition_variable doneCondition;
+    bool                    done = false;
+
+    std::atomic<bool> cancelRequested {false};
+
+    // owned by the I/O thread once dequeued
+    int      fd   = -1;
+    uint64_t size = 0;   //!< resolved request size
+#if USING(IO_URING)
+    struct iovec               iov;
+    std::shared_ptr<ReadState> keepAlive;   //!< while referenced by the ring
+#endif   // #if USING(IO_URING)
+};
+}   // namespace detail
+
+/////////////////////////////////////////////////////////////////////////////////
+
+bool
+ReadHandle::isDone() const
+{
+    if (!_state) {
+        return true;
+    }
+    std::lock_guard<std::mutex> lock(_state->mutex);
+    return _state->done;
+}
+
+const ReadResult&
+ReadHandle::Wait() const
+{
+    ASSERT_MSG(_state, "waiting on an invalid read handle");
+    if (!_state) {
+        static const ReadResult invalid = []() {
+            ReadResult result;
+            result.status = Status::Failed;
+            result.error  = EINVAL;
+            return result;
+        }();
+        return invalid;
+    }
+    std::unique_lock<std::mutex> lock(_state->mutex);
+    _state->doneCondition.wait(lock, [this]() { return _state->done; });
+    return _state->result;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+// io_uring, through the raw syscalls (no liburing dependency)
+
+#if USING(IO_URING)
+struct IoService::IoUring {
+    static constexpr uint64_t kWakeTag = 0;
+
+    int ringFd = -1;
+    int wakeFd = -1;
+
+    void*         sqRing     = nullptr;
+    size_t        sqRingSize = 0;
+    void*         cqRing     = nullptr;
+    size_t        cqRingSize = 0;
+    io_uring_sqe* sqes       = nullptr;
+    size_t        sqesSize   = 0;
+
+    unsigned*     sqTail  = nullptr;
+    unsigned*     sqMask  = nullptr;
+    unsigned*     sqArray = nullptr;
+    unsigned*     cqHead  = nullptr;
+    unsigned*     cqTail  = nullptr;
+    unsigned*     cqMask  = nullptr;
+    io_uring_cqe* cqes    = nullptr;
+
+    unsigned     toSubmit = 0;
+    uint64_t     wakeValue = 0;
+    struct iovec wakeIov;
+
+    ~IoUring()
+    {
+        if (sqes != nullptr) {
+            munmap(sqes, sqesSize);
+        }
+        if (cqRing != nullptr && cqRing != sqRing) {
+            munmap(cqRing, cqRingSize);
+        }
+        if (sqRing != nullptr) {
+            munmap(sqRing, sqRingSize);
+        }
+        if (ringFd >= 0) {
+            close(ringFd);
+        }
+        if (wakeFd >= 0) {
+            close(wakeFd);
+        }
+    }
+
+    bool Init(unsigned entries)
+    {
+        io_uring_params params {};
+        ringFd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (ringFd < 0) {
+            return false;
+        }
+
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP) {
+            sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+        }
+        sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd,
+            IORING_OFF_SQ_RING);
+        if (sqRing == MAP_FAILED) {
+            sqRing = nullptr;
+            return false;
+        }
+        if (params.features & IORING_FEAT_SINGLE_MMAP) {
+            cqRing = sqRing;
+        } else {
+            cqRing = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd,
+                IORING_OFF_CQ_RING);
+            if (cqRing == MAP_FAILED) {
+                cqRing = nullptr;
+                return false;
+            }
+        }
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqesMemory
+            = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+        if (sqesMemory == MAP_FAILED) {
+            return false;
+        }
+        sqes = static_cast<io_uring_sqe*>(sqesMemory);
+
+        uint8_t* sq = static_cast<uint8_t*>(sqRing);
+        uint8_t* cq = static_cast<uint8_t*>(cqRing);
+        sqTail      = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask      = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray     = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cqHead      = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail      = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask      = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes        = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        wakeFd = eventfd(0, EFD_CLOEXEC);
+        return wakeFd >= 0;
+    }
+
+    void QueueReadv(int fd, struct iovec* iov, uint64_t offset, uint64_t userData)
+    {
+        // single producer (the I/O thread): only the tail needs ordering
+        const unsigned tail  = *sqTail;
+        const unsigned index = tail & *sqMask;
+        io_uring_sqe&  sqe   = sqes[index];
+        memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode    = IORING_OP_READV;
+        sqe.fd        = fd;
+        sqe.addr      = reinterpret_cast<uint64_t>(iov);
+        sqe.len       = 1;
+        sqe.off       = offset;
+        sqe.user_data = userData;
+        sqArray[index] = index;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        ++toSubmit;
+    }
+
+    void QueueWakeRead()
+    {
+        wakeIov.iov_base = &wakeValue;
+        wakeIov.iov_len  = sizeof(wakeValue);
+        QueueReadv(wakeFd, &wakeIov, 0, kWakeTag);
+    }
+
+    //! submits the queued entries and waits for at least one completion,
+    //! error: errno on failure
+    bool SubmitAndWait(int& error)
+    {
+        while (true) {
+            const int result = static_cast<int>(
+                syscall(__NR_io_uring_enter, ringFd, toSubmit, 1, IORING_ENTER_GETEVENTS, nullptr, 0));
+            if (result >= 0) {
+                toSubmit -= std::min<unsigned>(toSubmit, static_cast<unsigned>(result));
+                return true;
+            }
+            if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                error = errno;
+                LOG_ERROR("io_uring_enter failed: %d", error);
+                return false;
+            }
+        }
+    }
+
+    template <typename FuncT> void Reap(FuncT&& func)
+    {
+        unsigned       head = *cqHead;
+        const unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            const io_uring_cqe& cqe = cqes[head & *cqMask];
+            func(cqe.user_data, cqe.res);
+        }
+        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+    }
+};
+#else    // #if USING(IO_URING)
+struct IoService::IoUring { };
+#endif   // #else    // #if USING(IO_URING)
+
+/////////////////////////////////////////////////////////////////////////////////
+
+IoService::IoService(const Config& config)
+    : _config(config)
+{
+    _config.queueDepth  = std::max(_config.queueDepth, 1u);
+    _config.threadCount = std::max(_config.threadCount, 1u);
+
+    if (_config.backend != Backend::ThreadPool && _InitIoUring()) {
+        _backend  = Backend::IoUring;
+        _ioThread = std::thread([this]() { _IoUringLoop(); });
+        return;
+    }
+    if (_config.backend == Backend::IoUring) {
+        LOG_WARN("io_uring is not available, falling back to the thread pool");
+    }
+    _backend    = Backend::ThreadPool;
+    _threadPool = std::make_unique<ThreadPool>(_config.threadCount);
+}
+
+IoService::~IoService()
+{
+    std::deque<StatePtr> cancelled;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+        for (auto& queue : _queues) {
+            cancelled.insert(cancelled.end(), queue.begin(), queue.end());
+            queue.clear();
+        }
+        _stats.cancelledCount += cancelled.size();
+    }
+    for (StatePtr& state : cancelled) {
+        _Complete(*state, Status::Cancelled, 0);
+    }
+
+    if (_ioThread.joinable()) {
+        _WakeIoUring();
+        _ioThread.join();
+    }
+    _ioUring.reset();
+    _threadPool.reset();
+}
+
+ReadHandle
+IoService::Read(ReadRequest&& request)
+{
+    auto state     = std::make_shared<detail::ReadState>();
+    state->request = std::move(request);
+    ReadHandle handle(state);
+
+    const size_t queueIndex = static_cast<size_t>(state->request.priority);
+    if (queueIndex >= static_cast<size_t>(Priority::Count)
+        || (state->request.size == 0 && state->request.destination != nullptr)) {
+        LOG_ERROR("Invalid read request for '%s'", state->request.path.c_str());
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            ++_stats.requestCount;
+            ++_stats.failedCount;
+        }
+        _Complete(*state, Status::Failed, EINVAL);
+        return handle;
+    }
+
+    Backend backend;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        ++_stats.requestCount;
+        _queues[queueIndex].push_back(std::move(state));
+        backend = _backend;   // io_uring falls back to the thread pool on failure
+    }
+
+    if (backend == Backend::IoUring) {
+        _WakeIoUring();
+    } else {
+        // each task serves the most urgent request queued when it runs
+        _threadPool->Submit([this]() { _ThreadPoolRead(); });
+    }
+    return handle;
+}
+
+bool
+IoService::Cancel(const ReadHandle& handle)
+{
+    if (!handle) {
+        return false;
+    }
+    detail::ReadState* target = const_cast<detail::ReadState*>(handle.state());
+
+    StatePtr removed;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (auto& queue : _queues) {
+            auto it = std::find_if(queue.begin(), queue.end(), [target](const StatePtr& state) {
+                return state.get() == target;
+            });
+            if (it != queue.end()) {
+                removed = std::move(*it);
+                queue.erase(it);
+                ++_stats.cancelledCount;
+                break;
+            }
+        }
+    }
+    if (removed) {
+        _Complete(*removed, Status::Cancelled, 0);
+        _idle.notify_all();
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(target->mutex);
+    if (target->done) {
+        return false;
+    }
+    target->cancelRequested.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+void
+IoService::WaitIdle()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _idle.wait(lock, [this]() { return _QueuedCount() == 0 && _stats.inFlightCount == 0; });
+}
+
+Backend
+IoService::backend() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _backend;
+}
+
+Stats
+IoService::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    Stats                       stats = _stats;
+    stats.queuedCount                 = _QueuedCount();
+    if (stats.inFlightCount > 0) {
+        stats.busyTimeNs += nowNs() - _busyStartNs;
+    }
+    return stats;
+}
+
+uint32_t
+IoService::_QueuedCount() const
+{
+    size_t count = 0;
+    for (const auto& queue : _queues) {
+        count += queue.size();
+    }
+    return static_cast<uint32_t>(count);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+
+bool
+IoService::_PopNext(StatePtr& state)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (size_t i = static_cast<size_t>(Priority::Count); i-- > 0;) {
+        if (!_queues[i].empty()) {
+            state = std::move(_queues[i].front());
+            _queues[i].pop_front();
+            _BeginRead();
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+IoService::_BeginRead()
+{
+    if (_stats.inFlightCount++ == 0) {
+        _busyStartNs = nowNs();
+    }
+    _stats.maxInFlightCount = std::max(_stats.maxInFlightCount, _stats.inFlightCount);
+}
+
+void
+IoService::_EndRead()
+{
+    if (--_stats.inFlightCount == 0) {
+        _stats.busyTimeNs += nowNs() - _busyStartNs;
+    }
+}
+
+bool
+IoService::_Prepare(detail::ReadState& state, int& error)
+{
+    const ReadRequest& request = state.request;
+
+    state.fd = openReadOnly(request.path.c_str());
+    if (state.fd < 0) {
+        error = errno;   // before the logging overwrites it
+        LOG_ERROR("Couldn't open the file '%s'", request.path.c_str());
+        return false;
+    }
+
+    state.size = request.size;
+    if (state.size == 0) {
+        const int64_t size = fileSize(state.fd);
+        if (size < 0) {
+            error = errno;
+            return false;
+        }
+        state.size = static_cast<uint64_t>(size) > request.offset ? static_cast<uint64_t>(size) - request.offset : 0;
+    }
+
+    if (request.destination != nullptr) {
+        state.result.data = static_cast<uint8_t*>(request.destination);
+    } else {
+        state.result.buffer = vfs::FileHandle::Allocate(static_cast<size_t>(state.size));
+        state.result.data   = state.result.buffer.MutableData();
+    }
+    return true;
+}
+
+void
+IoService::_Complete(detail::ReadState& state, Status status, int error)
+{
+    if (state.fd >= 0) {
+        closeFile(state.fd);
+        state.fd = -1;
+    }
+    if (status == Status::Completed && state.result.buffer && state.result.bytesRead < state.size) {
+        state.result.buffer = state.result.buffer.SubView(0, static_cast<size_t>(state.result.bytesRead));
+    }
+    state.result.status = status;
+    state.result.error  = error;
+
+    if (state.request.onComplete) {
+        state.request.onComplete(state.result);
+        state.request.onComplete.reset();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.done = true;
+    }
+    state.doneCondition.notify_all();
+}
+
+void
+IoService::_Finish(detail::ReadState& state, Status status, int error)
+{
+    // counted before the waiters are released, in flight until the callback returned
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stats.bytesRead += state.result.bytesRead;
+        _stats.completedCount += status == Status::Completed ? 1 : 0;
+        _stats.failedCount += status == Status::Failed ? 1 : 0;
+        _stats.cancelledCount += status == Status::Cancelled ? 1 : 0;
+    }
+    _Complete(state, status, error);
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _EndRead();
+    }
+    _idle.notify_all();
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+
+void
+IoService::_ThreadPoolRead()
+{
+    StatePtr state;
+    if (!_PopNext(state)) {
+        return;   // cancelled meanwhile
+    }
+
+    Status status = Status::Completed;
+    int    error  = 0;
+    if (!_Prepare(*state, error)) {
+        status = Status::Failed;
+    }
+    while (status == Status::Completed && state->result.bytesRead < state->size) {
+        if (state->cancelRequested.load(std::memory_order_relaxed)) {
+            status = Status::Cancelled;
+            break;
+        }
+        const uint64_t chunk = std::min(state->size - state->result.bytesRead, kMaxReadChunk);
+        const int64_t  bytes = readAt(state->fd, state->result.data + state->result.bytesRead, chunk,
+            state->request.offset + state->result.bytesRead);
+        if (bytes < 0) {
+            const int readError = errno;
+            if (readError == EINTR) {
+                continue;
+            }
+            status = Status::Failed;
+            error  = readError;
+        } else if (bytes == 0) {
+            break;   // end of file
+        } else {
+            state->result.bytesRead += static_cast<uint64_t>(bytes);
+        }
+    }
+
+    _Finish(*state, status, error);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+
+bool
+IoService::_InitIoUring()
+{
+#if USING(IO_URING)
+    _ioUring = std::make_unique<IoUring>();
+    // one extra entry for the wake-up read
+    if (!_ioUring->Init(_config.queueDepth + 1)) {
+        _ioUring.reset();
+        return false;
+    }
+    return true;
+#else    // #if USING(IO_URING)
+    return false;
+#endif   // #else    // #if USING(IO_URING)
+}
+
+void
+IoService::_WakeIoUring()
+{
+#if USING(IO_URING)
+    const uint64_t one     = 1;
+    const ssize_t  written = write(_ioUring->wakeFd, &one, sizeof(one));
+    UNUSED(written);   // the counter can only overflow after 2^64 wake-ups
+#endif   // #if USING(IO_URING)
+}
+
+void
+IoService::_FallBackToThreadPool()
+{
+    uint32_t queued = 0;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        LOG_WARN("io_uring failed, falling back to the thread pool");
+        _backend    = Backend::ThreadPool;
+        _threadPool = std::make_unique<ThreadPool>(_config.threadCount);
+        queued      = _QueuedCount();
+    }
+    // one task per queued request, Read() submits the tasks of the next ones
+    for (uint32_t i = 0; i < queued; ++i) {
+        _threadPool->Submit([this]() { _ThreadPoolRead(); });
+    }
+}
+
+void
+IoService::_IoUringLoop()
+{
+#if USING(IO_URING)
+    IoUring& ring     = *_ioUring;
+    uint32_t inFlight = 0;
+    // the reads queued on the ring, to fail them if it breaks
+    std::vector<detail::ReadState*> reads;
+
+    auto queueNextChunk = [&ring](detail::ReadState& state) {
+        const uint64_t done = state.result.bytesRead;
+        state.iov.iov_base  = state.result.data + done;
+        state.iov.iov_len   = static_cast<size_t>(std::min(state.size - done, kMaxReadChunk));
+        ring.QueueReadv(state.fd, &state.iov, state.request.offset + done, reinterpret_cast<uint64_t>(&state));
+    };
+    auto finish = [this, &inFlight, &reads](detail::ReadState& state, Status status, int error) {
+        reads.erase(std::remove(reads.begin(), reads.end(), &state), reads.end());
+        StatePtr keepAlive = std::move(state.keepAlive);
+        _Finish(state, status, error);
+        --inFlight;
+    };
+    auto onCompletion = [&](uint64_t userData, int result) {
+        if (userData == IoUring::kWakeTag) {
+            ring.QueueWakeRead();
+            return;
+        }
+        detail::ReadState& read = *reinterpret_cast<detail::ReadState*>(userData);
+        if (result == -EINTR || result == -EAGAIN) {
+            queueNextChunk(read);
+        } else if (result < 0) {
+            finish(read, Status::Failed, -result);
+        } else {
+            read.result.bytesRead += static_cast<uint64_t>(result);
+            if (read.cancelRequested.load(std::memory_order_relaxed)) {
+                finish(read, Status::Cancelled, 0);
+            } else if (result == 0 || read.result.bytesRead == read.size) {
+                finish(read, Status::Completed, 0);   // done, or end of file
+            } else {
+                queueNextChunk(read);
+            }
+        }
+    };
+
+    ring.QueueWakeRead();
+    while (true) {
+        StatePtr state;
+        while (inFlight < _config.queueDepth && _PopNext(state)) {
+            ++inFlight;
+            detail::ReadState& read = *state;
+            read.keepAlive          = std::move(state);
+            int error = 0;
+            if (!_Prepare(read, error)) {
+                finish(read, Status::Failed, error);
+            } else if (read.size == 0) {
+                finish(read, Status::Completed, 0);
+            } else {
+                reads.push_back(&read);
+                queueNextChunk(read);
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_stopping && inFlight == 0 && _QueuedCount() == 0) {
+                break;
+            }
+        }
+
+        int error = 0;
+        if (!ring.SubmitAndWait(error)) {
+            // The ring is unusable: what already completed is reaped, the
+            // other reads on the ring fail, and the thread pool serves the
+            // queued requests and the next ones.
+            ring.Reap(onCompletion);
+            while (!reads.empty()) {
+                finish(*reads.back(), Status::Failed, error);
+            }
+            _FallBackToThreadPool();
+            break;
+        }
+        ring.Reap(onCompletion);
+    }
+#endif   // #if USING(IO_URING)
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace io
+}   // namespace core
@@ -0,0 +1,136 @@
+#include "core/file_watcher.h"
+
+#include <algorithm>
+#include <cerrno>
+
+#if USING(INOTIFY)
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif   // #if USING(INOTIFY)
+
+namespace core {
+/////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+std::filesystem::file_time_type
+lastWriteTime(const std::string& path)
+{
+    std::error_code error;
+    const auto      time = std::filesystem::last_write_time(path, error);
+    return error ? std::filesystem::file_time_type::min() : time;
+}
+
+void
+appendOnce(std::vector<std::string>& paths, const std::string& path)
+{
+    if (std::find(paths.begin(), paths.end(), path) == paths.end()) {
+        paths.push_back(path);
+    }
+}
+}   // namespace
+
+/////////////////////////////////////////////////////////////////////////////////
+
+FileWatcher::FileWatcher()
+{
+#if USING(INOTIFY)
+    _inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (_inotifyFd < 0) {
+        LOG_ERROR("inotify_init1 failed (errno %d): file changes are not reported", errno);
+    }
+#endif   // #if USING(INOTIFY)
+}
+
+FileWatcher::~FileWatcher()
+{
+#if USING(INOTIFY)
+    if (_inotifyFd >= 0) {
+        close(_inotifyFd);
+    }
+#endif   // #if USING(INOTIFY)
+}
+
+bool
+FileWatcher::Watch(const std::string& nativePath)
+{
+    const std::filesystem::path path(nativePath);
+    std::filesystem::path       directory = path.parent_path();
+    if (directory.empty()) {
+        directory = ".";
+    }
+
+    WatchedFile file;
+    file.path          = nativePath;
+    file.name          = path.filename().string();
+    file.lastWriteTime = lastWriteTime(nativePath);
+
+#if USING(INOTIFY)
+    if (_inotifyFd < 0) {
+        return false;
+    }
+    // adding a directory twice returns its existing descriptor
+    file.directory = inotify_add_watch(_inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (file.directory < 0) {
+        LOG_ERROR("Can't watch '%s' (errno %d)", directory.c_str(), errno);
+        return false;
+    }
+#else    // #if USING(INOTIFY)
+    std::error_code error;
+    if (!std::filesystem::is_directory(directory, error)) {
+        LOG_ERROR("Can't watch '%s': no such directory", directory.string().c_str());
+        return false;
+    }
+#endif   // #else    // #if USING(INOTIFY)
+
+    _files.push_back(std::move(file));
+    return true;
+}
+
+bool
+FileWatcher::Poll(std::vector<std::string>& changedPaths)
+{
+    const size_t initialCount = changedPaths.size();
+
+#if USING(INOTIFY)
+    if (_inotifyFd < 0) {
+        return false;
+    }
+    alignas(inotify_event) char buffer[4096];
+    for (;;) {
+        const ssize_t length = read(_inotifyFd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break;   // EAGAIN: nothing more for now
+        }
+        for (ssize_t offset = 0; offset < length;) {
+            const inotify_event& event = *reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += sizeof(inotify_event) + event.len;
+            if (event.len == 0) {
+                continue;
+            }
+            for (WatchedFile& file : _files) {
+                if (file.directory == event.wd && file.name == event.name) {
+                    appendOnce(changedPaths, file.path);
+                }
+            }
+        }
+    }
+#else    // #if USING(INOTIFY)
+    const auto now = std::chrono::steady_clock::now();
+    if (now - _lastPoll < kPollInterval) {
+        return false;
+    }
+    _lastPoll = now;
+    for (WatchedFile& file : _files) {
+        const auto writeTime = lastWriteTime(file.path);
+        if (writeTime != file.lastWriteTime) {
+            file.lastWriteTime = writeTime;
+            appendOnce(changedPaths, file.path);
+        }
+    }
+#endif   // #else    // #if USING(INOTIFY)
+
+    return changedPaths.size() != initialCount;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace core
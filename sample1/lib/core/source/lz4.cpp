@@ -0,0 +1,218 @@
+#include "core/lz4.h"
+
+#include <cstring>
+#include <memory>
+
+namespace core {
+namespace lz4 {
+/////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+constexpr size_t   kMinMatch     = 4;
+constexpr size_t   kLastLiterals = 5;    // the block always ends with literals
+constexpr size_t   kMatchLimit   = 12;   // no match starts in the last 12 bytes
+constexpr size_t   kMaxOffset    = 65535;
+constexpr uint32_t kHashLog      = 14;
+
+inline uint32_t
+read32(const uint8_t* p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint32_t
+hash32(uint32_t sequence)
+{
+    return (sequence * 2654435761u) >> (32 - kHashLog);
+}
+
+//! length continuation bytes: 255, 255, ..., remainder
+inline bool
+writeLength(uint8_t*& op, const uint8_t* opEnd, size_t length)
+{
+    for (; length >= 255; length -= 255) {
+        if (op >= opEnd) {
+            return false;
+        }
+        *op++ = 255;
+    }
+    if (op >= opEnd) {
+        return false;
+    }
+    *op++ = static_cast<uint8_t>(length);
+    return true;
+}
+
+bool
+writeSequence(uint8_t*& op, const uint8_t* opEnd, const uint8_t* literals, size_t literalLength, size_t offset,
+    size_t matchLength)
+{
+    if (op >= opEnd) {
+        return false;
+    }
+    uint8_t* token = op++;
+    *token         = static_cast<uint8_t>((literalLength >= 15 ? 15 : literalLength) << 4);
+    if (literalLength >= 15 && !writeLength(op, opEnd, literalLength - 15)) {
+        return false;
+    }
+    if (static_cast<size_t>(opEnd - op) < literalLength) {
+        return false;
+    }
+    if (literalLength != 0) {
+        memcpy(op, literals, literalLength);
+        op += literalLength;
+    }
+
+    if (matchLength == 0) {
+        return true;   // last sequence
+    }
+    if (opEnd - op < 2) {
+        return false;
+    }
+    *op++ = static_cast<uint8_t>(offset);
+    *op++ = static_cast<uint8_t>(offset >> 8);
+
+    const size_t matchCode = matchLength - kMinMatch;
+    *token |= static_cast<uint8_t>(matchCode >= 15 ? 15 : matchCode);
+    return matchCode < 15 || writeLength(op, opEnd, matchCode - 15);
+}
+
+//! reads a length continuation, false when running out of input
+inline bool
+readLength(const uint8_t*& ip, const uint8_t* ipEnd, size_t& length)
+{
+    uint8_t byte;
+    do {
+        if (ip >= ipEnd) {
+            return false;
+        }
+        byte = *ip++;
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+}   // namespace
+
+/////////////////////////////////////////////////////////////////////////////////
+
+size_t
+compress(const void* src, size_t srcSize, void* dst, size_t dstCapacity)
+{
+    const uint8_t* const source = static_cast<const uint8_t*>(src);
+    uint8_t*             op     = static_cast<uint8_t*>(dst);
+    const uint8_t* const opEnd  = op + dstCapacity;
+
+    size_t anchor = 0;
+    if (srcSize > kMatchLimit) {
+        // 64 KB of positions: heap rather than stack
+        std::unique_ptr<uint32_t[]> table(new uint32_t[size_t(1) << kHashLog]());
+
+        const size_t matchStartLimit = srcSize - kMatchLimit;
+        const size_t matchEndLimit   = srcSize - kLastLiterals;
+        size_t       ip              = 1;   // the zeroed table already points at position 0
+
+        while (ip < matchStartLimit) {
+            const uint32_t sequence = read32(source + ip);
+            const uint32_t h        = hash32(sequence);
+            size_t         ref      = table[h];
+            table[h]                = static_cast<uint32_t>(ip);
+
+            if (ref >= ip || ip - ref > kMaxOffset || read32(source + ref) != sequence) {
+                // skip faster through incompressible data
+                ip += 1 + ((ip - anchor) >> 6);
+                continue;
+            }
+
+            // extend backwards over the pending literals, then forwards
+            while (ip > anchor && ref > 0 && source[ip - 1] == source[ref - 1]) {
+                --ip;
+                --ref;
+            }
+            size_t matchLength = kMinMatch;
+            while (ip + matchLength < matchEndLimit && source[ip + matchLength] == source[ref + matchLength]) {
+                ++matchLength;
+            }
+
+            if (!writeSequence(op, opEnd, source + anchor, ip - anchor, ip - ref, matchLength)) {
+                return 0;
+            }
+            ip += matchLength;
+            anchor = ip;
+            if (ip < matchStartLimit) {
+                table[hash32(read32(source + ip - 2))] = static_cast<uint32_t>(ip - 2);
+            }
+        }
+    }
+
+    if (!writeSequence(op, opEnd, source + anchor, srcSize - anchor, 0, 0)) {
+        return 0;
+    }
+    return static_cast<size_t>(op - static_cast<uint8_t*>(dst));
+}
+
+bool
+decompress(const void* src, size_t srcSize, void* dst, size_t dstSize)
+{
+    const uint8_t*       ip    = static_cast<const uint8_t*>(src);
+    const uint8_t* const ipEnd = ip + srcSize;
+    uint8_t* const       start = static_cast<uint8_t*>(dst);
+    uint8_t*             op    = start;
+    uint8_t* const       opEnd = op + dstSize;
+
+    while (ip < ipEnd) {
+        const uint8_t token = *ip++;
+
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !readLength(ip, ipEnd, literalLength)) {
+            return false;
+        }
+        if (static_cast<size_t>(ipEnd - ip) < literalLength || static_cast<size_t>(opEnd - op) < literalLength) {
+            return false;
+        }
+        if (literalLength != 0) {
+            memcpy(op, ip, literalLength);
+            ip += literalLength;
+            op += literalLength;
+        }
+
+        if (ip == ipEnd) {
+            break;   // the last sequence has no match
+        }
+
+        if (ipEnd - ip < 2) {
+            return false;
+        }
+        const size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        if (offset == 0 || offset > static_cast<size_t>(op - start)) {
+            return false;
+        }
+
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !readLength(ip, ipEnd, matchLength)) {
+            return false;
+        }
+        matchLength += kMinMatch;
+        if (static_cast<size_t>(opEnd - op) < matchLength) {
+            return false;
+        }
+
+        const uint8_t* match = op - offset;
+        if (offset >= matchLength) {
+            memcpy(op, match, matchLength);
+            op += matchLength;
+        } else {
+            // overlapping copy repeats the last offset bytes
+            for (size_t i = 0; i < matchLength; ++i) {
+                *op++ = *match++;
+            }
+        }
+    }
+    return op == opEnd;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace lz4
+}   // namespace core
@@ -0,0 +1,206 @@
+#include "core/memory.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if defined(_WIN32)
+#include <malloc.h>   // _aligned_malloc
+#endif   // #if defined(_WIN32)
+
+namespace core {
+namespace memory {
+/////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+std::atomic<uint64_t> s_allocationCount {0};
+std::atomic<uint64_t> s_freeCount {0};
+std::atomic<uint64_t> s_allocatedBytes {0};
+}   // namespace
+
+AllocationStats
+getAllocationStats()
+{
+    AllocationStats stats;
+    stats.allocationCount = s_allocationCount.load(std::memory_order_relaxed);
+    stats.freeCount       = s_freeCount.load(std::memory_order_relaxed);
+    stats.allocatedBytes  = s_allocatedBytes.load(std::memory_order_relaxed);
+    return stats;
+}
+
+#if USING(TRACK_ALLOCATIONS)
+namespace {
+void*
+trackedAlloc(size_t size) noexcept
+{
+    s_allocationCount.fetch_add(1, std::memory_order_relaxed);
+    s_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    return std::malloc(size != 0 ? size : 1);
+}
+
+void
+trackedFree(void* ptr) noexcept
+{
+    if (ptr != nullptr) {
+        s_freeCount.fetch_add(1, std::memory_order_relaxed);
+        std::free(ptr);
+    }
+}
+
+//! the std::align_val_t overloads: alignment is a power of two
+void*
+trackedAlignedAlloc(size_t size, std::align_val_t alignment) noexcept
+{
+    s_allocationCount.fetch_add(1, std::memory_order_relaxed);
+    s_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    const size_t alignmentBytes = static_cast<size_t>(alignment);
+#if defined(_WIN32)
+    return _aligned_malloc(size != 0 ? size : 1, alignmentBytes);
+#else   // #if defined(_WIN32)
+    // aligned_alloc() wants a size multiple of the alignment
+    return std::aligned_alloc(alignmentBytes, static_cast<size_t>(alignUp(size != 0 ? size : 1, alignmentBytes)));
+#endif   // #else   // #if defined(_WIN32)
+}
+
+void
+trackedAlignedFree(void* ptr) noexcept
+{
+    if (ptr != nullptr) {
+        s_freeCount.fetch_add(1, std::memory_order_relaxed);
+#if defined(_WIN32)
+        _aligned_free(ptr);
+#else   // #if defined(_WIN32)
+        std::free(ptr);
+#endif   // #else   // #if defined(_WIN32)
+    }
+}
+}   // namespace
+#endif   // #if USING(TRACK_ALLOCATIONS)
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace memory
+}   // namespace core
+
+#if USING(TRACK_ALLOCATIONS)
+
+void*
+operator new(size_t size)
+{
+    void* ptr = core::memory::trackedAlloc(size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+void*
+operator new[](size_t size)
+{
+    void* ptr = core::memory::trackedAlloc(size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+void*
+operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return core::memory::trackedAlloc(size);
+}
+void*
+operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return core::memory::trackedAlloc(size);
+}
+
+void
+operator delete(void* ptr) noexcept
+{
+    core::memory::trackedFree(ptr);
+}
+void
+operator delete[](void* ptr) noexcept
+{
+    core::memory::trackedFree(ptr);
+}
+void
+operator delete(void* ptr, size_t) noexcept
+{
+    core::memory::trackedFree(ptr);
+}
+void
+operator delete[](void* ptr, size_t) noexcept
+{
+    core::memory::trackedFree(ptr);
+}
+void
+operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+    core::memory::trackedFree(ptr);
+}
+void
+operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+    core::memory::trackedFree(ptr);
+}
+
+void*
+operator new(size_t size, std::align_val_t alignment)
+{
+    void* ptr = core::memory::trackedAlignedAlloc(size, alignment);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+void*
+operator new[](size_t size, std::align_val_t alignment)
+{
+    void* ptr = core::memory::trackedAlignedAlloc(size, alignment);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+void*
+operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return core::memory::trackedAlignedAlloc(size, alignment);
+}
+void*
+operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return core::memory::trackedAlignedAlloc(size, alignment);
+}
+
+void
+operator delete(void* ptr, std::align_val_t) noexcept
+{
+    core::memory::trackedAlignedFree(ptr);
+}
+void
+operator delete[](void* ptr, std::align_val_t) noexcept
+{
+    core::memory::trackedAlignedFree(ptr);
+}
+void
+operator delete(void* ptr, size_t, std::align_val_t) noexcept
+{
+    core::memory::trackedAlignedFree(ptr);
+}
+void
+operator delete[](void* ptr, size_t, std::align_val_t) noexcept
+{
+    core::memory::trackedAlignedFree(ptr);
+}
+void
+operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    core::memory::trackedAlignedFree(ptr);
+}
+void
+operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    core::memory::trackedAlignedFree(ptr);
+}
+
+#endif   // #if USING(TRACK_ALLOCATIONS)
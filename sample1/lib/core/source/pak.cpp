@@ -0,0 +1,271 @@
+#include "core/pak.h"
+
+#include "core/lz4.h"
+#include "core/memory.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+namespace core {
+namespace pak {
+/////////////////////////////////////////////////////////////////////////////////
+
+void
+PakWriter::Add(std::string path, vfs::FileHandle data, bool compress)
+{
+    ASSERT_MSG(data, "invalid data for '%s'", path.c_str());
+    _inputs.push_back(Input {std::move(path), std::move(data), compress});
+}
+
+namespace {
+bool
+writeAt(FILE* file, uint64_t offset, const void* data, size_t size)
+{
+    // empty sections may come from empty vectors: no data pointer for fwrite
+    if (size == 0) {
+        return true;
+    }
+    // fseek offsets are long: fine for the sizes paks are built for
+    return fseek(file, static_cast<long>(offset), SEEK_SET) == 0 && fwrite(data, 1, size, file) == size;
+}
+}   // namespace
+
+bool
+PakWriter::Write(const char* nativePath, Summary* summary) const
+{
+    std::vector<const Input*> inputs;
+    inputs.reserve(_inputs.size());
+    for (const Input& input : _inputs) {
+        if (input.path.size() > UINT16_MAX) {
+            LOG_ERROR("Path too long for a pak entry: '%s'", input.path.c_str());
+            return false;
+        }
+        inputs.push_back(&input);
+    }
+    std::sort(inputs.begin(), inputs.end(), [](const Input* a, const Input* b) {
+        const uint64_t hashA = pathHash(a->path);
+        const uint64_t hashB = pathHash(b->path);
+        return hashA != hashB ? hashA < hashB : a->path < b->path;
+    });
+    for (size_t i = 1; i < inputs.size(); ++i) {
+        if (inputs[i - 1]->path == inputs[i]->path) {
+            LOG_ERROR("Duplicated pak entry '%s'", inputs[i]->path.c_str());
+            return false;
+        }
+    }
+
+    const std::string tmpPath = std::string(nativePath) + ".tmp";
+    FILE*             file    = fopen(tmpPath.c_str(), "wb");
+    if (file == nullptr) {
+        LOG_ERROR("Couldn't create '%s'", tmpPath.c_str());
+        return false;
+    }
+
+    Summary              stats;
+    std::vector<Entry>   entries(inputs.size());
+    std::string          names;
+    std::vector<uint8_t> compressed;
+    uint64_t             offset = sizeof(Header);
+    bool                 result = true;
+
+    for (size_t i = 0; i < inputs.size() && result; ++i) {
+        const Input& input = *inputs[i];
+        Entry&       entry = entries[i];
+        memset(&entry, 0, sizeof(entry));
+        entry.pathHash    = pathHash(input.path);
+        entry.size        = input.data.size();
+        entry.contentHash = contentHash(input.data.data(), input.data.size());
+        entry.nameOffset  = static_cast<uint32_t>(names.size());
+        entry.nameLength  = static_cast<uint16_t>(input.path.size());
+        names += input.path;
+
+        const void* stored = input.data.data();
+        entry.storedSize   = entry.size;
+        if (input.compress && entry.size > 0) {
+            compressed.resize(lz4::compressBound(input.data.size()));
+            const size_t compressedSize
+                = lz4::compress(input.data.data(), input.data.size(), compressed.data(), compressed.size());
+            if (compressedSize != 0 && compressedSize <= entry.size - entry.size / 16) {
+                entry.compression = Compression::Lz4;
+                entry.storedSize  = compressedSize;
+                stored            = compressed.data();
+                ++stats.compressedCount;
+            }
+        }
+
+        offset       = alignUp(offset, entry.compression == Compression::None ? kRawAlignment : kDataAlignment);
+        entry.offset = offset;
+        result       = entry.storedSize == 0 || writeAt(file, offset, stored, static_cast<size_t>(entry.storedSize));
+        offset += entry.storedSize;
+        stats.uncompressedSize += entry.size;
+    }
+
+    Header header {};
+    header.magic       = kMagic;
+    header.version     = kVersion;
+    header.entryCount  = static_cast<uint32_t>(entries.size());
+    header.tocOffset   = alignUp(offset, kDataAlignment);
+    header.namesOffset = header.tocOffset + entries.size() * sizeof(Entry);
+    header.namesSize   = names.size();
+    header.tocHash
+        = hashBytesStable(names.data(), names.size(), contentHash(entries.data(), entries.size() * sizeof(Entry)));
+
+    result = result && writeAt(file, header.tocOffset, entries.data(), entries.size() * sizeof(Entry))
+          && writeAt(file, header.namesOffset, names.data(), names.size())
+          && writeAt(file, 0, &header, sizeof(header));
+    result = (fclose(file) == 0) && result;
+
+    std::error_code error;
+    if (result) {
+        std::filesystem::rename(tmpPath, nativePath, error);
+        result = !error;
+    }
+    if (!result) {
+        LOG_ERROR("Couldn't write '%s'", nativePath);
+        std::filesystem::remove(tmpPath, error);
+        return false;
+    }
+
+    stats.entryCount  = header.entryCount;
+    stats.archiveSize = header.namesOffset + header.namesSize;
+    if (summary != nullptr) {
+        *summary = stats;
+    }
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+
+std::unique_ptr<ArchiveMount>
+ArchiveMount::Load(const char* nativePath)
+{
+    std::unique_ptr<ArchiveMount> mount(new ArchiveMount());
+    mount->_archive = vfs::FileHandle::MapFile(nativePath);
+    if (!mount->_archive) {
+        LOG_ERROR("Couldn't open the pak '%s'", nativePath);
+        return nullptr;
+    }
+    if (!mount->_Validate(nativePath)) {
+        return nullptr;
+    }
+    return mount;
+}
+
+bool
+ArchiveMount::_Validate(const char* nativePath)
+{
+    const uint64_t archiveSize = _archive.size();
+    if (archiveSize < sizeof(Header)) {
+        LOG_ERROR("'%s' is not a pak", nativePath);
+        return false;
+    }
+    const Header& header = *_archive.dataAs<Header>();
+    if (header.magic != kMagic || header.version != kVersion) {
+        LOG_ERROR("'%s' is not a pak or has an unsupported version", nativePath);
+        return false;
+    }
+    const uint64_t tocSize = uint64_t(header.entryCount) * sizeof(Entry);
+    if (!isAligned(header.tocOffset, kDataAlignment) || header.tocOffset > archiveSize
+        || tocSize > archiveSize - header.tocOffset || header.namesOffset != header.tocOffset + tocSize
+        || header.namesSize > archiveSize - header.namesOffset) {
+        LOG_ERROR("'%s': corrupted table of contents", nativePath);
+        return false;
+    }
+    const uint8_t* toc   = _archive.data() + header.tocOffset;
+    const char*    names = reinterpret_cast<const char*>(_archive.data() + header.namesOffset);
+    if (hashBytesStable(names, header.namesSize, contentHash(toc, tocSize)) != header.tocHash) {
+        LOG_ERROR("'%s': table of contents hash mismatch", nativePath);
+        return false;
+    }
+
+    _entries    = reinterpret_cast<const Entry*>(toc);
+    _entryCount = header.entryCount;
+    _names      = names;
+    for (uint32_t i = 0; i < _entryCount; ++i) {
+        const Entry& entry = _entries[i];
+        const bool   valid = entry.offset <= archiveSize && entry.storedSize <= archiveSize - entry.offset
+                        && uint64_t(entry.nameOffset) + entry.nameLength <= header.namesSize
+                        && (i == 0 || _entries[i - 1].pathHash <= entry.pathHash)
+                        && ((entry.compression == Compression::None && entry.storedSize == entry.size)
+                            || entry.compression == Compression::Lz4);
+        if (!valid) {
+            LOG_ERROR("'%s': corrupted entry %u", nativePath, i);
+            return false;
+        }
+    }
+    return true;
+}
+
+const Entry*
+ArchiveMount::Find(std::string_view path) const
+{
+    const uint64_t hash  = pathHash(path);
+    const Entry*   end   = _entries + _entryCount;
+    const Entry*   entry = std::lower_bound(
+        _entries, end, hash, [](const Entry& entry, uint64_t value) { return entry.pathHash < value; });
+    // the names settle (very unlikely) hash collisions
+    for (; entry != end && entry->pathHash == hash; ++entry) {
+        if (entryPath(*entry) == path) {
+            return entry;
+        }
+    }
+    return nullptr;
+}
+
+bool
+ArchiveMount::_ReadEntry(const Entry& entry, vfs::FileHandle& data) const
+{
+    if (entry.compression == Compression::None) {
+        data = _archive.SubView(static_cast<size_t>(entry.offset), static_cast<size_t>(entry.size));
+        return true;
+    }
+
+    data = vfs::FileHandle::Allocate(static_cast<size_t>(entry.size));
+    if (!lz4::decompress(_archive.data() + entry.offset, static_cast<size_t>(entry.storedSize), data.MutableData(),
+            static_cast<size_t>(entry.size))) {
+        LOG_ERROR("Corrupted pak entry '%.*s'", static_cast<int>(entry.nameLength), _names + entry.nameOffset);
+        data.reset();
+        return false;
+    }
+    return true;
+}
+
+vfs::FileHandle
+ArchiveMount::Open(std::string_view path)
+{
+    vfs::FileHandle data;
+    const Entry*    entry = Find(path);
+    if (entry != nullptr && _ReadEntry(*entry, data)) {
+#if USING(IS_DEBUG)
+        ASSERT_MSG(contentHash(data.data(), data.size()) == entry->contentHash, "pak entry '%.*s' content mismatch",
+            static_cast<int>(path.size()), path.data());
+#endif   // #if USING(IS_DEBUG)
+    }
+    return data;
+}
+
+bool
+ArchiveMount::Exists(std::string_view path) const
+{
+    return Find(path) != nullptr;
+}
+
+bool
+ArchiveMount::Verify() const
+{
+    for (uint32_t i = 0; i < _entryCount; ++i) {
+        vfs::FileHandle data;
+        if (!_ReadEntry(_entries[i], data) || contentHash(data.data(), data.size()) != _entries[i].contentHash) {
+            LOG_ERROR("pak entry '%.*s' is corrupted", static_cast<int>(_entries[i].nameLength),
+                _names + _entries[i].nameOffset);
+            return false;
+        }
+    }
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace pak
+}   // namespace core
@@ -0,0 +1,62 @@
+#include "core/string_id.h"
+
+#include "core/flat_hash_map.h"
+
+#include <cstdio>
+#include <mutex>
+#include <string>
+
+namespace core {
+/////////////////////////////////////////////////////////////////////////////////
+
+#if USING(STRING_ID_INTERN)
+namespace {
+struct InternTable {
+    std::mutex mutex;
+    // nodes: c_str() hands out pointers into the strings
+    NodeHashMap<uint64_t, std::string> names;
+};
+
+InternTable&
+internTable()
+{
+    static InternTable* s_table = new InternTable();   // leaked: ids may be printed during static destruction
+    return *s_table;
+}
+}   // namespace
+
+void
+StringId::_Intern(std::string_view name, uint64_t value)
+{
+    InternTable&                table = internTable();
+    std::lock_guard<std::mutex> lock(table.mutex);
+
+    auto result = table.names.try_emplace(value, name);
+    if (!result.second && result.first->second != name) {
+        FAIL_MSG("StringId collision: '%s' and '%.*s' both hash to 0x%016llx", result.first->second.c_str(),
+            static_cast<int>(name.size()), name.data(), static_cast<unsigned long long>(value));
+    }
+}
+#endif   // #if USING(STRING_ID_INTERN)
+
+const char*
+StringId::c_str() const
+{
+#if USING(STRING_ID_INTERN)
+    {
+        InternTable&                table = internTable();
+        std::lock_guard<std::mutex> lock(table.mutex);
+
+        auto it = table.names.find(_value);
+        if (it != table.names.end()) {
+            return it->second.c_str();
+        }
+    }
+#endif   // #if USING(STRING_ID_INTERN)
+    thread_local char s_buffer[32];
+    snprintf(s_buffer, sizeof(s_buffer), "<sid:0x%016llx>", static_cast<unsigned long long>(_value));
+    return s_buffer;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace core
@@ -0,0 +1,79 @@
+#include "core/thread_pool.h"
+
+namespace core {
+/////////////////////////////////////////////////////////////////////////////////
+
+uint32_t
+ThreadPool::defaultThreadCount()
+{
+    const uint32_t hardwareThreads = std::thread::hardware_concurrency();
+    return hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+}
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+    threadCount = threadCount != 0 ? threadCount : defaultThreadCount();
+    _threads.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; ++i) {
+        _threads.emplace_back([this]() { _WorkerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _taskAvailable.notify_all();
+    for (std::thread& thread : _threads) {
+        thread.join();
+    }
+}
+
+void
+ThreadPool::Submit(Task&& task)
+{
+    ASSERT(task);
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _tasks.push_back(std::move(task));
+    }
+    _taskAvailable.notify_one();
+}
+
+void
+ThreadPool::WaitIdle()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _idle.wait(lock, [this]() { return _tasks.empty() && _runningTasks == 0; });
+}
+
+void
+ThreadPool::_WorkerLoop()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true) {
+        _taskAvailable.wait(lock, [this]() { return _stopping || !_tasks.empty(); });
+        if (_tasks.empty()) {
+            return;   // stopping and drained
+        }
+
+        Task task = std::move(_tasks.front());
+        _tasks.pop_front();
+        ++_runningTasks;
+        lock.unlock();
+
+        task();
+        task.reset();   // captures are released outside of the lock
+
+        lock.lock();
+        --_runningTasks;
+        if (_tasks.empty() && _runningTasks == 0) {
+            _idle.notify_all();
+        }
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace core
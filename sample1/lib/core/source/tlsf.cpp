@@ -0,0 +1,274 @@
+#include "core/tlsf.h"
+
+#include "core/memory.h"
+
+#include <algorithm>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace core {
+/////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+inline uint32_t
+floorLog2(uint64_t value)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return index;
+#else
+    return 63 - static_cast<uint32_t>(__builtin_clzll(value));
+#endif
+}
+
+inline uint32_t
+lowestBit(uint64_t value)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return index;
+#else
+    return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+}
+
+//! size class of a free region
+inline void
+mapping(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel)
+{
+    if (size < TlsfAllocator::kSecondLevelCount) {
+        // small sizes: one class per size
+        firstLevel  = 0;
+        secondLevel = static_cast<uint32_t>(size);
+        return;
+    }
+    const uint32_t log2 = floorLog2(size);
+    firstLevel          = log2 - TlsfAllocator::kSecondLevelLog2 + 1;
+    secondLevel
+        = static_cast<uint32_t>(size >> (log2 - TlsfAllocator::kSecondLevelLog2)) - TlsfAllocator::kSecondLevelCount;
+}
+
+//! first size class whose regions are all at least size bytes
+inline void
+mappingSearch(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel)
+{
+    if (size >= TlsfAllocator::kSecondLevelCount) {
+        size += (uint64_t(1) << (floorLog2(size) - TlsfAllocator::kSecondLevelLog2)) - 1;
+    }
+    mapping(size, firstLevel, secondLevel);
+}
+}   // namespace
+
+/////////////////////////////////////////////////////////////////////////////////
+
+void
+TlsfAllocator::Reset(uint64_t size)
+{
+    ASSERT_MSG(size < (uint64_t(1) << 62), "TLSF range too large");
+    _size = size;
+    _nodes.clear();
+    _unusedNodes.clear();
+    _firstLevelBitmap = 0;
+    for (uint32_t firstLevel = 0; firstLevel < kFirstLevelCount; ++firstLevel) {
+        _secondLevelBitmaps[firstLevel] = 0;
+        for (uint32_t secondLevel = 0; secondLevel < kSecondLevelCount; ++secondLevel) {
+            _freeLists[firstLevel][secondLevel] = kInvalidNode;
+        }
+    }
+    _stats      = Stats();
+    _stats.size = size;
+
+    if (size != 0) {
+        _InsertFree(_NewNode(0, size));
+    }
+}
+
+TlsfAllocator::Allocation
+TlsfAllocator::Allocate(uint64_t size, uint64_t alignment)
+{
+    ASSERT_MSG(alignment != 0 && (alignment & (alignment - 1)) == 0, "alignment must be a power of two");
+    if (size == 0 || size > _size || alignment > _size) {
+        return Allocation();
+    }
+
+    // any region of the class found fits the worst alignment padding
+    uint32_t firstLevel, secondLevel;
+    mappingSearch(size + alignment - 1, firstLevel, secondLevel);
+    if (firstLevel >= kFirstLevelCount) {
+        return Allocation();
+    }
+    uint32_t secondLevelMap = _secondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+    if (secondLevelMap == 0) {
+        const uint64_t firstLevelMap
+            = firstLevel + 1 < 64 ? _firstLevelBitmap & (~uint64_t(0) << (firstLevel + 1)) : 0;
+        if (firstLevelMap == 0) {
+            return Allocation();
+        }
+        firstLevel     = lowestBit(firstLevelMap);
+        secondLevelMap = _secondLevelBitmaps[firstLevel];
+    }
+    secondLevel = lowestBit(secondLevelMap);
+
+    uint32_t node = _freeLists[firstLevel][secondLevel];
+    _RemoveFree(node);
+
+    // the padding in front and the remainder behind go back to the free lists
+    const uint64_t padding = alignUp(_nodes[node].offset, static_cast<size_t>(alignment)) - _nodes[node].offset;
+    if (padding != 0) {
+        const uint32_t front       = _NewNode(_nodes[node].offset, padding);
+        _nodes[front].prevPhysical = _nodes[node].prevPhysical;
+        _nodes[front].nextPhysical = node;
+        if (_nodes[node].prevPhysical != kInvalidNode) {
+            _nodes[_nodes[node].prevPhysical].nextPhysical = front;
+        }
+        _nodes[node].prevPhysical = front;
+        _nodes[node].offset += padding;
+        _nodes[node].size -= padding;
+        _InsertFree(front);
+    }
+    if (_nodes[node].size > size) {
+        const uint32_t back       = _NewNode(_nodes[node].offset + size, _nodes[node].size - size);
+        _nodes[back].prevPhysical = node;
+        _nodes[back].nextPhysical = _nodes[node].nextPhysical;
+        if (_nodes[node].nextPhysical != kInvalidNode) {
+            _nodes[_nodes[node].nextPhysical].prevPhysical = back;
+        }
+        _nodes[node].nextPhysical = back;
+        _nodes[node].size         = size;
+        _InsertFree(back);
+    }
+
+    _nodes[node].used = true;
+    _stats.usedBytes += size;
+    ++_stats.allocationCount;
+
+    Allocation allocation;
+    allocation.offset = _nodes[node].offset;
+    allocation.size   = size;
+    allocation.node   = node;
+    return allocation;
+}
+
+void
+TlsfAllocator::Free(const Allocation& allocation)
+{
+    uint32_t node = allocation.node;
+    ASSERT_MSG(node < _nodes.size() && _nodes[node].used && _nodes[node].offset == allocation.offset,
+        "invalid or already freed TLSF allocation");
+    _nodes[node].used = false;
+    _stats.usedBytes -= _nodes[node].size;
+    --_stats.allocationCount;
+
+    // free neighbors are merged: two free regions are never adjacent
+    const uint32_t prev = _nodes[node].prevPhysical;
+    if (prev != kInvalidNode && !_nodes[prev].used) {
+        _RemoveFree(prev);
+        _nodes[prev].size += _nodes[node].size;
+        _nodes[prev].nextPhysical = _nodes[node].nextPhysical;
+        if (_nodes[node].nextPhysical != kInvalidNode) {
+            _nodes[_nodes[node].nextPhysical].prevPhysical = prev;
+        }
+        _DeleteNode(node);
+        node = prev;
+    }
+    const uint32_t next = _nodes[node].nextPhysical;
+    if (next != kInvalidNode && !_nodes[next].used) {
+        _RemoveFree(next);
+        _nodes[node].size += _nodes[next].size;
+        _nodes[node].nextPhysical = _nodes[next].nextPhysical;
+        if (_nodes[next].nextPhysical != kInvalidNode) {
+            _nodes[_nodes[next].nextPhysical].prevPhysical = node;
+        }
+        _DeleteNode(next);
+    }
+    _InsertFree(node);
+}
+
+TlsfAllocator::Stats
+TlsfAllocator::GetStats() const
+{
+    Stats stats = _stats;
+    if (_firstLevelBitmap != 0) {
+        // the biggest regions are in the highest non empty class
+        const uint32_t firstLevel  = floorLog2(_firstLevelBitmap);
+        const uint32_t secondLevel = floorLog2(_secondLevelBitmaps[firstLevel]);
+        for (uint32_t node = _freeLists[firstLevel][secondLevel]; node != kInvalidNode; node = _nodes[node].nextFree) {
+            stats.largestFreeRegion = std::max(stats.largestFreeRegion, _nodes[node].size);
+        }
+    }
+    return stats;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+
+uint32_t
+TlsfAllocator::_NewNode(uint64_t offset, uint64_t size)
+{
+    uint32_t node;
+    if (!_unusedNodes.empty()) {
+        node = _unusedNodes.back();
+        _unusedNodes.pop_back();
+        _nodes[node] = Node();
+    } else {
+        node = static_cast<uint32_t>(_nodes.size());
+        _nodes.emplace_back();
+    }
+    _nodes[node].offset = offset;
+    _nodes[node].size   = size;
+    return node;
+}
+
+void
+TlsfAllocator::_DeleteNode(uint32_t node)
+{
+    _unusedNodes.push_back(node);
+}
+
+void
+TlsfAllocator::_InsertFree(uint32_t node)
+{
+    uint32_t firstLevel, secondLevel;
+    mapping(_nodes[node].size, firstLevel, secondLevel);
+
+    const uint32_t head   = _freeLists[firstLevel][secondLevel];
+    _nodes[node].prevFree = kInvalidNode;
+    _nodes[node].nextFree = head;
+    if (head != kInvalidNode) {
+        _nodes[head].prevFree = node;
+    }
+    _freeLists[firstLevel][secondLevel] = node;
+    _secondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+    _firstLevelBitmap |= uint64_t(1) << firstLevel;
+    ++_stats.freeRegionCount;
+}
+
+void
+TlsfAllocator::_RemoveFree(uint32_t node)
+{
+    const uint32_t prevFree = _nodes[node].prevFree;
+    const uint32_t nextFree = _nodes[node].nextFree;
+    if (nextFree != kInvalidNode) {
+        _nodes[nextFree].prevFree = prevFree;
+    }
+    if (prevFree != kInvalidNode) {
+        _nodes[prevFree].nextFree = nextFree;
+    } else {
+        uint32_t firstLevel, secondLevel;
+        mapping(_nodes[node].size, firstLevel, secondLevel);
+        _freeLists[firstLevel][secondLevel] = nextFree;
+        if (nextFree == kInvalidNode) {
+            _secondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+            if (_secondLevelBitmaps[firstLevel] == 0) {
+                _firstLevelBitmap &= ~(uint64_t(1) << firstLevel);
+            }
+        }
+    }
+    --_stats.freeRegionCount;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace core
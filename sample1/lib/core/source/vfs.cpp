@@ -0,0 +1,421 @@
+#include "core/vfs.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <new>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else   // #if defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif   // #else   // #if defined(_WIN32)
+
+namespace core {
+namespace vfs {
+/////////////////////////////////////////////////////////////////////////////////
+
+namespace detail {
+struct FileBlob {
+    enum class Storage { Empty, Mapped, Heap };
+
+    std::atomic<uint32_t> refCount {1};
+    Storage               storage = Storage::Empty;
+    void*                 memory  = nullptr;
+    size_t                size    = 0;
+#if defined(_WIN32)
+    HANDLE mappingHandle = nullptr;
+#endif   // #if defined(_WIN32)
+
+    ~FileBlob()
+    {
+        switch (storage) {
+        case Storage::Mapped:
+#if defined(_WIN32)
+            UnmapViewOfFile(memory);
+            CloseHandle(mappingHandle);
+#else    // #if defined(_WIN32)
+            munmap(memory, size);
+#endif   // #else    // #if defined(_WIN32)
+            break;
+        case Storage::Heap:
+            ::operator delete(memory, std::align_val_t(kFileDataAlignment));
+            break;
+        case Storage::Empty:
+            break;
+        }
+    }
+};
+}   // namespace detail
+
+/////////////////////////////////////////////////////////////////////////////////
+
+FileHandle::FileHandle(const FileHandle& other)
+    : _blob(other._blob)
+    , _data(other._data)
+    , _size(other._size)
+{
+    if (_blob != nullptr) {
+        _blob->refCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+FileHandle::FileHandle(FileHandle&& other) noexcept
+    : _blob(other._blob)
+    , _data(other._data)
+    , _size(other._size)
+{
+    other._blob = nullptr;
+    other._data = nullptr;
+    other._size = 0;
+}
+
+FileHandle&
+FileHandle::operator=(const FileHandle& other)
+{
+    if (this != &other) {
+        FileHandle copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+FileHandle&
+FileHandle::operator=(FileHandle&& other) noexcept
+{
+    if (this != &other) {
+        reset();
+        std::swap(_blob, other._blob);
+        std::swap(_data, other._data);
+        std::swap(_size, other._size);
+    }
+    return *this;
+}
+
+void
+FileHandle::reset()
+{
+    if (_blob != nullptr && _blob->refCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete _blob;
+    }
+    _blob = nullptr;
+    _data = nullptr;
+    _size = 0;
+}
+
+uint32_t
+FileHandle::useCount() const
+{
+    return _blob != nullptr ? _blob->refCount.load(std::memory_order_relaxed) : 0;
+}
+
+uint8_t*
+FileHandle::MutableData()
+{
+    ASSERT_MSG(_blob != nullptr && _blob->storage == detail::FileBlob::Storage::Heap && useCount() == 1,
+        "only a fresh Allocate() handle can be written to");
+    return const_cast<uint8_t*>(_data);
+}
+
+FileHandle
+FileHandle::SubView(size_t offset, size_t size) const
+{
+    ASSERT_MSG(offset <= _size && size <= _size - offset, "sub view out of the file range");
+    FileHandle view(*this);
+    view._data = _data + offset;
+    view._size = size;
+    return view;
+}
+
+FileHandle
+FileHandle::Allocate(size_t size)
+{
+    FileHandle handle;
+    handle._blob = new detail::FileBlob();
+    if (size > 0) {
+        handle._blob->storage = detail::FileBlob::Storage::Heap;
+        handle._blob->memory  = ::operator new(size, std::align_val_t(kFileDataAlignment));
+        handle._blob->size    = size;
+    }
+    handle._data = static_cast<const uint8_t*>(handle._blob->memory);
+    handle._size = size;
+    return handle;
+}
+
+FileHandle
+FileHandle::MapFile(const char* nativePath)
+{
+    FileHandle handle;
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(nativePath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return handle;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        return handle;
+    }
+    handle._blob = new detail::FileBlob();
+    if (fileSize.QuadPart > 0) {
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        void*  memory  = mapping != nullptr ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        if (memory == nullptr) {
+            LOG_ERROR("Couldn't map the file '%s'", nativePath);
+            if (mapping != nullptr) {
+                CloseHandle(mapping);
+            }
+            CloseHandle(file);
+            handle.reset();
+            return handle;
+        }
+        handle._blob->storage       = detail::FileBlob::Storage::Mapped;
+        handle._blob->memory        = memory;
+        handle._blob->size          = static_cast<size_t>(fileSize.QuadPart);
+        handle._blob->mappingHandle = mapping;
+    }
+    CloseHandle(file);
+#else    // #if defined(_WIN32)
+    const int fd = open(nativePath, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return handle;
+    }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || !S_ISREG(fileStat.st_mode)) {
+        close(fd);
+        return handle;
+    }
+    handle._blob = new detail::FileBlob();
+    if (fileStat.st_size > 0) {
+        const size_t size   = static_cast<size_t>(fileStat.st_size);
+        void*        memory = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (memory == MAP_FAILED) {
+            LOG_ERROR("Couldn't map the file '%s'", nativePath);
+            close(fd);
+            handle.reset();
+            return handle;
+        }
+        handle._blob->storage = detail::FileBlob::Storage::Mapped;
+        handle._blob->memory  = memory;
+        handle._blob->size    = size;
+    }
+    close(fd);   // the mapping keeps its own reference to the file
+#endif   // #else    // #if defined(_WIN32)
+    handle._data = static_cast<const uint8_t*>(handle._blob->memory);
+    handle._size = handle._blob->size;
+    return handle;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+
+DirectoryMount::DirectoryMount(std::string root)
+    : _root(std::move(root))
+{
+    if (!_root.empty() && _root.back() != '/' && _root.back() != '\\') {
+        _root.push_back('/');
+    }
+}
+
+std::string
+DirectoryMount::_NativePath(std::string_view path) const
+{
+    std::string nativePath = _root;
+    nativePath.append(path.data(), path.size());
+    return nativePath;
+}
+
+FileHandle
+DirectoryMount::Open(std::string_view path)
+{
+    return FileHandle::MapFile(_NativePath(path).c_str());
+}
+
+bool
+DirectoryMount::Exists(std::string_view path) const
+{
+#if defined(_WIN32)
+    const DWORD attributes = GetFileAttributesA(_NativePath(path).c_str());
+    return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY) == 0;
+#else    // #if defined(_WIN32)
+    struct stat fileStat;
+    return stat(_NativePath(path).c_str(), &fileStat) == 0 && S_ISREG(fileStat.st_mode);
+#endif   // #else    // #if defined(_WIN32)
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+//! prefix is a directory: it matches the whole path or up to a '/'
+bool
+stripPrefix(std::string_view path, std::string_view prefix, std::string_view& relativePath)
+{
+    if (prefix.empty()) {
+        relativePath = path;
+        return true;
+    }
+    if (path.compare(0, prefix.size(), prefix) != 0 || (path.size() != prefix.size() && path[prefix.size()] != '/')) {
+        return false;
+    }
+    relativePath = path.substr(std::min(prefix.size() + 1, path.size()));
+    return true;
+}
+}   // namespace
+
+void
+FileSystem::Mount(std::string_view prefix, std::unique_ptr<IMount> mount)
+{
+    ASSERT(mount != nullptr);
+    while (!prefix.empty() && prefix.back() == '/') {
+        prefix.remove_suffix(1);
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    _mounts.push_back(MountPoint {std::string(prefix), std::move(mount)});
+    ++_mountGeneration;
+    // files cached from an overridden mount would shadow the new one
+    _cache.clear();
+    _stats.cachedFiles = 0;
+    _stats.cachedBytes = 0;
+}
+
+void
+FileSystem::UnmountAll()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _cache.clear();
+    _mounts.clear();
+    ++_mountGeneration;
+    _stats.cachedFiles = 0;
+    _stats.cachedBytes = 0;
+}
+
+FileHandle
+FileSystem::Open(std::string_view path, CacheMode cacheMode)
+{
+    const StringId id(path);
+
+    MountMatches matches;
+    uint64_t     mountGeneration = 0;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        ++_stats.openCount;
+
+        auto cached = _cache.find(id);
+        if (cached != _cache.end()) {
+            ++_stats.cacheHitCount;
+            return cached->second;
+        }
+        _MatchMounts(path, matches);
+        mountGeneration = _mountGeneration;
+    }
+
+    // the mounts map or decompress the file: the other Open() calls go on
+    const auto start = std::chrono::steady_clock::now();
+    FileHandle file;
+    for (size_t i = 0; i < matches.size() && !file; ++i) {
+        file = matches[i].mount->Open(matches[i].relativePath);
+    }
+    const uint64_t loadTimeNs
+        = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stats.loadTimeNs += loadTimeNs;
+    _stats.maxLoadTimeNs = loadTimeNs > _stats.maxLoadTimeNs ? loadTimeNs : _stats.maxLoadTimeNs;
+
+    if (!file) {
+        ++_stats.failedOpenCount;
+        LOG_ERROR("Couldn't open the file '%.*s'", static_cast<int>(path.size()), path.data());
+        return file;
+    }
+
+    _stats.bytesLoaded += file.size();
+    if (cacheMode == CacheMode::Cached && mountGeneration == _mountGeneration) {
+        // another thread may have loaded it meanwhile: its handle wins
+        auto inserted = _cache.try_emplace(id, file);
+        if (!inserted.second) {
+            return inserted.first->second;
+        }
+        ++_stats.cachedFiles;
+        _stats.cachedBytes += file.size();
+    }
+    return file;
+}
+
+bool
+FileSystem::Exists(std::string_view path) const
+{
+    MountMatches matches;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_cache.contains(StringId(path))) {
+            return true;
+        }
+        _MatchMounts(path, matches);
+    }
+    for (const MountMatch& match : matches) {
+        if (match.mount->Exists(match.relativePath)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+FileSystem::Evict(std::string_view path)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto                        it = _cache.find(StringId(path));
+    if (it != _cache.end()) {
+        --_stats.cachedFiles;
+        _stats.cachedBytes -= it->second.size();
+        _cache.erase(it);
+    }
+}
+
+void
+FileSystem::ClearCache()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _cache.clear();
+    _stats.cachedFiles = 0;
+    _stats.cachedBytes = 0;
+}
+
+Stats
+FileSystem::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+}
+
+void
+FileSystem::ResetStats()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    const uint64_t              cachedFiles = _stats.cachedFiles;
+    const uint64_t              cachedBytes = _stats.cachedBytes;
+    _stats                                  = Stats {};
+    _stats.cachedFiles                      = cachedFiles;
+    _stats.cachedBytes                      = cachedBytes;
+}
+
+void
+FileSystem::_MatchMounts(std::string_view path, MountMatches& matches) const
+{
+    for (auto it = _mounts.rbegin(); it != _mounts.rend(); ++it) {
+        std::string_view relativePath;
+        if (stripPrefix(path, it->prefix, relativePath)) {
+            matches.push_back(MountMatch {it->mount, relativePath});
+        }
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace vfs
+}   // namespace core
@@ -0,0 +1,143 @@
+#include "core/ring_allocator.h"
+#include "core/tlsf.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace {
+/////////////////////////////////////////////////////////////////////////////////
+
+using Allocation = core::TlsfAllocator::Allocation;
+
+//! no two allocations overlap, all inside the range
+void
+expectDisjoint(std::vector<Allocation> allocations, uint64_t size)
+{
+    std::sort(allocations.begin(), allocations.end(),
+        [](const Allocation& a, const Allocation& b) { return a.offset < b.offset; });
+    for (size_t i = 0; i < allocations.size(); ++i) {
+        EXPECT_LE(allocations[i].offset + allocations[i].size, size);
+        if (i > 0) {
+            EXPECT_LE(allocations[i - 1].offset + allocations[i - 1].size, allocations[i].offset);
+        }
+    }
+}
+
+TEST(Tlsf, allocateAndCoalesce)
+{
+    core::TlsfAllocator tlsf(1 << 20);
+
+    const Allocation a = tlsf.Allocate(1000);
+    const Allocation b = tlsf.Allocate(3000, 256);
+    const Allocation c = tlsf.Allocate(10);
+    ASSERT_TRUE(a.isValid() && b.isValid() && c.isValid());
+    EXPECT_EQ(b.offset % 256, 0u);
+    expectDisjoint({a, b, c}, tlsf.size());
+    EXPECT_EQ(tlsf.GetStats().usedBytes, 4010u);
+    EXPECT_EQ(tlsf.GetStats().allocationCount, 3u);
+
+    tlsf.Free(b);
+    tlsf.Free(a);
+    tlsf.Free(c);
+    // everything merged back into one region
+    const core::TlsfAllocator::Stats stats = tlsf.GetStats();
+    EXPECT_TRUE(tlsf.empty());
+    EXPECT_EQ(stats.freeRegionCount, 1u);
+    EXPECT_EQ(stats.largestFreeRegion, tlsf.size());
+
+    const Allocation whole = tlsf.Allocate(tlsf.size());
+    EXPECT_TRUE(whole.isValid());
+    EXPECT_FALSE(tlsf.Allocate(1).isValid());
+    tlsf.Free(whole);
+
+    EXPECT_FALSE(tlsf.Allocate(0).isValid());
+    EXPECT_FALSE(tlsf.Allocate(tlsf.size() + 1).isValid());
+}
+
+TEST(Tlsf, randomWorkload)
+{
+    constexpr uint64_t      kSize = 64 << 20;
+    core::TlsfAllocator     tlsf(kSize);
+    std::vector<Allocation> allocations;
+    std::mt19937            random(5);
+    uint64_t                used = 0;
+
+    for (int i = 0; i < 20000; ++i) {
+        if (allocations.empty() || random() % 3 != 0) {
+            const uint64_t   size      = 1 + random() % (random() % 8 == 0 ? 1 << 20 : 4096);
+            const uint64_t   alignment = uint64_t(1) << (random() % 12);
+            const Allocation allocation = tlsf.Allocate(size, alignment);
+            if (allocation.isValid()) {
+                EXPECT_EQ(allocation.offset % alignment, 0u);
+                allocations.push_back(allocation);
+                used += size;
+            }
+        } else {
+            const size_t index = random() % allocations.size();
+            tlsf.Free(allocations[index]);
+            used -= allocations[index].size;
+            allocations[index] = allocations.back();
+            allocations.pop_back();
+        }
+        EXPECT_EQ(tlsf.GetStats().usedBytes, used);
+    }
+    expectDisjoint(allocations, kSize);
+
+    for (const Allocation& allocation : allocations) {
+        tlsf.Free(allocation);
+    }
+    EXPECT_EQ(tlsf.GetStats().freeRegionCount, 1u);
+    EXPECT_EQ(tlsf.GetStats().largestFreeRegion, kSize);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+
+TEST(Allocators, linear)
+{
+    core::LinearAllocator linear(100);
+    EXPECT_EQ(linear.Allocate(10), 0u);
+    EXPECT_EQ(linear.Allocate(10, 16), 16u);
+    EXPECT_EQ(linear.Allocate(80), core::LinearAllocator::kInvalidOffset);
+    EXPECT_EQ(linear.Allocate(74), 26u);
+    EXPECT_EQ(linear.usedBytes(), 100u);
+    linear.Reset();
+    EXPECT_EQ(linear.Allocate(100), 0u);
+}
+
+TEST(Allocators, ring)
+{
+    core::RingAllocator ring(256);
+
+    // frame 0
+    EXPECT_EQ(ring.Allocate(100), 0u);
+    EXPECT_EQ(ring.Allocate(50, 64), 128u);
+    const uint64_t frame0 = ring.head();
+    // frame 1: does not fit before the end, restarts at 0 which is still in use
+    EXPECT_EQ(ring.Allocate(100), core::RingAllocator::kInvalidOffset);
+    EXPECT_EQ(ring.Allocate(60), 178u);
+    const uint64_t frame1 = ring.head();
+
+    ring.Release(frame0);
+    EXPECT_EQ(ring.usedBytes(), 60u);
+    // frame 2: wraps around, the skipped end is accounted until frame 2 is released
+    EXPECT_EQ(ring.Allocate(100), 0u);
+    EXPECT_EQ(ring.usedBytes(), 256u - 238u + 60u + 100u);
+    // frame 1 still holds [178, 238)
+    EXPECT_EQ(ring.Allocate(100), core::RingAllocator::kInvalidOffset);
+    EXPECT_EQ(ring.Allocate(70), 100u);
+    const uint64_t frame2 = ring.head();
+
+    ring.Release(frame1);
+    ring.Release(frame2);
+    EXPECT_EQ(ring.usedBytes(), 0u);
+    EXPECT_EQ(ring.Allocate(256), 0u);
+    // an older marker is already released
+    ring.Release(frame2);
+    EXPECT_EQ(ring.usedBytes(), 256u);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace
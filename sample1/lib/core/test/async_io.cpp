@@ -0,0 +1,188 @@
+#include "core/async_io.h"
+#include "core/thread_pool.h"
+
+#include "core/test/temp_directory.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cerrno>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+/////////////////////////////////////////////////////////////////////////////////
+
+TEST(ThreadPool, runsEveryTask)
+{
+    std::atomic<int> total {0};
+    {
+        core::ThreadPool pool(3);
+        EXPECT_EQ(pool.threadCount(), 3u);
+        for (int i = 1; i <= 100; ++i) {
+            pool.Submit([&total, i]() { total.fetch_add(i); });
+        }
+        pool.WaitIdle();
+        EXPECT_EQ(total.load(), 5050);
+
+        pool.Submit([&total]() { total.fetch_add(1); });
+    }   // the destructor drains the queue
+    EXPECT_EQ(total.load(), 5051);
+}
+
+class AsyncIo
+    : public core::test::TempDirectoryTest
+    , public ::testing::WithParamInterface<core::io::Backend> {
+protected:
+    std::filesystem::path _path;
+    std::vector<uint8_t>  _content;
+
+    void SetUp() override
+    {
+        TempDirectoryTest::SetUp();
+        _path = _root / "data.bin";
+        // bigger than one read chunk so reads are split
+        _content.resize(9 * 1024 * 1024 + 123);
+        for (size_t i = 0; i < _content.size(); ++i) {
+            _content[i] = static_cast<uint8_t>((i * 2654435761u) >> 24);
+        }
+        std::ofstream file(_path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(_content.data()), _content.size());
+    }
+};
+
+TEST_P(AsyncIo, readWholeFile)
+{
+    core::io::Config config;
+    config.backend = GetParam();
+    core::io::IoService service(config);
+    if (GetParam() == core::io::Backend::IoUring && service.backend() != core::io::Backend::IoUring) {
+        GTEST_SKIP() << "io_uring is not available";
+    }
+
+    bool                  called = false;
+    core::io::ReadRequest request;
+    request.path       = _path.string();
+    request.onComplete = [&called](const core::io::ReadResult& result) {
+        called = result.status == core::io::Status::Completed;
+    };
+    const core::io::ReadHandle  read   = service.Read(std::move(request));
+    const core::io::ReadResult& result = read.Wait();
+    ASSERT_EQ(result.status, core::io::Status::Completed);
+    EXPECT_TRUE(called);
+    EXPECT_EQ(result.bytesRead, _content.size());
+    ASSERT_EQ(result.buffer.size(), _content.size());
+    EXPECT_TRUE(core::isAligned(result.buffer.data(), core::vfs::kFileDataAlignment));
+    EXPECT_EQ(memcmp(result.buffer.data(), _content.data(), _content.size()), 0);
+
+    const core::io::Stats stats = service.GetStats();
+    EXPECT_EQ(stats.completedCount, 1u);
+    EXPECT_EQ(stats.bytesRead, _content.size());
+    EXPECT_GT(stats.throughputMBps(), 0.0);
+}
+
+TEST_P(AsyncIo, readIntoCallerMemory)
+{
+    core::io::Config config;
+    config.backend    = GetParam();
+    config.queueDepth = 4;
+    core::io::IoService service(config);
+    if (GetParam() == core::io::Backend::IoUring && service.backend() != core::io::Backend::IoUring) {
+        GTEST_SKIP() << "io_uring is not available";
+    }
+
+    constexpr size_t                  kReadCount = 32;
+    constexpr size_t                  kReadSize  = 4096;
+    std::vector<uint8_t>              staging(kReadCount * kReadSize);
+    std::vector<core::io::ReadHandle> reads;
+    for (size_t i = 0; i < kReadCount; ++i) {
+        core::io::ReadRequest request;
+        request.path        = _path.string();
+        request.offset      = i * 100000;
+        request.size        = kReadSize;
+        request.destination = staging.data() + i * kReadSize;
+        request.priority    = static_cast<core::io::Priority>(i % 3);
+        reads.push_back(service.Read(std::move(request)));
+    }
+    service.WaitIdle();
+    for (size_t i = 0; i < kReadCount; ++i) {
+        ASSERT_TRUE(reads[i].isDone());
+        EXPECT_EQ(reads[i].Wait().status, core::io::Status::Completed);
+        EXPECT_EQ(reads[i].Wait().data, staging.data() + i * kReadSize);
+        EXPECT_EQ(memcmp(staging.data() + i * kReadSize, _content.data() + i * 100000, kReadSize), 0);
+    }
+    const core::io::Stats stats = service.GetStats();
+    EXPECT_EQ(stats.completedCount, kReadCount);
+    EXPECT_LE(stats.maxInFlightCount, 4u);
+    EXPECT_EQ(stats.inFlightCount, 0u);
+    EXPECT_EQ(stats.queuedCount, 0u);
+}
+
+TEST_P(AsyncIo, failuresAndCancellation)
+{
+    core::io::Config config;
+    config.backend     = GetParam();
+    config.queueDepth  = 1;
+    config.threadCount = 1;
+    core::io::IoService service(config);
+    if (GetParam() == core::io::Backend::IoUring && service.backend() != core::io::Backend::IoUring) {
+        GTEST_SKIP() << "io_uring is not available";
+    }
+
+    core::io::ReadRequest missing;
+    missing.path = _path.string() + ".missing";
+    const core::io::ReadHandle missingHandle = service.Read(std::move(missing));
+    EXPECT_EQ(missingHandle.Wait().status, core::io::Status::Failed);
+    EXPECT_EQ(missingHandle.Wait().error, ENOENT);   // not overwritten by the logging
+    EXPECT_TRUE(core::io::ReadHandle().isDone());
+
+    // past the end of the file: short read
+    std::vector<uint8_t>  tail(1000);
+    core::io::ReadRequest shortRead;
+    shortRead.path        = _path.string();
+    shortRead.offset      = _content.size() - 10;
+    shortRead.size        = tail.size();
+    shortRead.destination = tail.data();
+    const core::io::ReadHandle  shortHandle = service.Read(std::move(shortRead));
+    const core::io::ReadResult& shortResult = shortHandle.Wait();
+    EXPECT_EQ(shortResult.status, core::io::Status::Completed);
+    EXPECT_EQ(shortResult.bytesRead, 10u);
+
+    // one slot: most of these are still queued when cancelled
+    std::vector<core::io::ReadHandle> reads;
+    std::atomic<int>                  cancelledCallbacks {0};
+    for (int i = 0; i < 16; ++i) {
+        core::io::ReadRequest request;
+        request.path       = _path.string();
+        request.onComplete = [&cancelledCallbacks](const core::io::ReadResult& result) {
+            cancelledCallbacks += result.status == core::io::Status::Cancelled ? 1 : 0;
+        };
+        reads.push_back(service.Read(std::move(request)));
+    }
+    int cancelled = 0;
+    for (auto& read : reads) {
+        cancelled += service.Cancel(read) ? 1 : 0;
+    }
+    service.WaitIdle();
+    int reportedCancelled = 0;
+    for (auto& read : reads) {
+        const core::io::ReadResult& result = read.Wait();
+        EXPECT_TRUE(result.status == core::io::Status::Completed || result.status == core::io::Status::Cancelled);
+        reportedCancelled += result.status == core::io::Status::Cancelled ? 1 : 0;
+    }
+    EXPECT_GT(cancelled, 0);
+    EXPECT_EQ(reportedCancelled, cancelledCallbacks.load());
+    EXPECT_EQ(reportedCancelled, cancelled);
+    EXPECT_FALSE(service.Cancel(reads.front()));
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, AsyncIo,
+    ::testing::Values(core::io::Backend::IoUring, core::io::Backend::ThreadPool),
+    [](const ::testing::TestParamInfo<core::io::Backend>& info) {
+        return info.param == core::io::Backend::IoUring ? "ioUring" : "threadPool";
+    });
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace
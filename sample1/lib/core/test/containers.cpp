@@ -0,0 +1,182 @@
+#include "core/fixed_vector.h"
+#include "core/inplace_function.h"
+#include "core/memory.h"
+#include "core/small_vector.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+
+namespace {
+/////////////////////////////////////////////////////////////////////////////////
+
+TEST(Containers, smallVectorInline)
+{
+    core::memory::AllocationCounter counter;
+
+    core::SmallVector<int, 4> values;
+    for (int i = 0; i < 4; ++i) {
+        values.push_back(i);
+    }
+    EXPECT_TRUE(values.isInline());
+    EXPECT_EQ(values.size(), 4u);
+    EXPECT_EQ(values.back(), 3);
+#if USING(TRACK_ALLOCATIONS)
+    EXPECT_EQ(counter.Get().allocationCount, 0u);
+#endif   // #if USING(TRACK_ALLOCATIONS)
+
+    values.push_back(4);
+    EXPECT_FALSE(values.isInline());
+    EXPECT_GE(values.capacity(), 5u);
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_EQ(values[i], i);
+    }
+#if USING(TRACK_ALLOCATIONS)
+    EXPECT_EQ(counter.Get().allocationCount, 1u);
+#endif   // #if USING(TRACK_ALLOCATIONS)
+
+    values.resize(2);
+    values.shrink_to_fit();
+    EXPECT_TRUE(values.isInline());
+    EXPECT_EQ(values, (core::SmallVector<int, 4> {0, 1}));
+}
+
+TEST(Containers, smallVectorModifiers)
+{
+    core::SmallVector<std::string, 2> values {"b", "d"};
+    values.insert(values.begin(), "a");
+    values.insert(values.begin() + 2, "c");
+    ASSERT_EQ(values.size(), 4u);
+    EXPECT_EQ(values[0], "a");
+    EXPECT_EQ(values[1], "b");
+    EXPECT_EQ(values[2], "c");
+    EXPECT_EQ(values[3], "d");
+
+    values.erase(values.begin() + 1);
+    EXPECT_EQ(values.size(), 3u);
+    EXPECT_EQ(values[1], "c");
+
+    values.erase_unordered(0);
+    EXPECT_EQ(values.size(), 2u);
+    EXPECT_EQ(values[0], "d");
+
+    // aliasing push while growing
+    values.push_back(values[0]);
+    values.push_back(values[0]);
+    EXPECT_EQ(values.size(), 4u);
+    EXPECT_EQ(values[3], "d");
+
+    core::SmallVector<std::string, 2> moved(std::move(values));
+    EXPECT_TRUE(values.empty());
+    EXPECT_EQ(moved.size(), 4u);
+
+    core::SmallVector<std::string, 2> copied;
+    copied = moved;
+    EXPECT_EQ(copied, moved);
+}
+
+TEST(Containers, smallVectorDestroysElements)
+{
+    auto shared = std::make_shared<int>(0);
+    {
+        core::SmallVector<std::shared_ptr<int>, 2> values;
+        for (int i = 0; i < 8; ++i) {
+            values.push_back(shared);
+        }
+        EXPECT_EQ(shared.use_count(), 9);
+        values.pop_back();
+        EXPECT_EQ(shared.use_count(), 8);
+    }
+    EXPECT_EQ(shared.use_count(), 1);
+}
+
+TEST(Containers, fixedVector)
+{
+    core::memory::AllocationCounter counter;
+
+    core::FixedVector<int, 3> values;
+    EXPECT_TRUE(values.empty());
+    EXPECT_EQ(values.capacity(), 3u);
+    values.push_back(1);
+    values.emplace_back(2);
+    values.push_back(3);
+    EXPECT_TRUE(values.full());
+    EXPECT_EQ(values.back(), 3);
+
+    values.erase(values.begin());
+    EXPECT_EQ(values, (core::FixedVector<int, 3> {2, 3}));
+
+    core::FixedVector<int, 3> moved(std::move(values));
+    EXPECT_TRUE(values.empty());
+    EXPECT_EQ(moved.size(), 2u);
+
+    moved.resize(3, 7);
+    EXPECT_EQ(moved[2], 7);
+#if USING(TRACK_ALLOCATIONS)
+    EXPECT_EQ(counter.Get().allocationCount, 0u);
+#endif   // #if USING(TRACK_ALLOCATIONS)
+}
+
+TEST(Containers, fixedVectorOverflow)
+{
+    // release builds too: the element would be written past the storage
+    core::FixedVector<int, 2> values {1, 2};
+    EXPECT_DEATH(values.push_back(3), "FixedVector overflow");
+    EXPECT_DEATH(values.resize(3), "FixedVector overflow");
+    EXPECT_EQ(values.size(), 2u);
+}
+
+TEST(Containers, inplaceFunction)
+{
+    core::memory::AllocationCounter counter;
+
+    int                                     total = 0;
+    core::InplaceFunction<void(int)>        add   = [&total](int value) { total += value; };
+    core::InplaceFunction<int(int, int), 8> mul   = [](int a, int b) { return a * b; };
+    add(3);
+    add(mul(2, 5));
+    EXPECT_EQ(total, 13);
+
+    core::InplaceFunction<void(int)> copy = add;
+    copy(1);
+    EXPECT_EQ(total, 14);
+
+    core::InplaceFunction<void(int), 64> bigger = std::move(copy);
+    EXPECT_FALSE(copy);
+    bigger(1);
+    EXPECT_EQ(total, 15);
+
+    bigger = nullptr;
+    EXPECT_FALSE(bigger);
+#if USING(TRACK_ALLOCATIONS)
+    EXPECT_EQ(counter.Get().allocationCount, 0u);
+#endif   // #if USING(TRACK_ALLOCATIONS)
+
+    auto                            shared = std::make_shared<int>(5);
+    core::InplaceFunction<int(void)> getter = [shared]() { return *shared; };
+    EXPECT_EQ(shared.use_count(), 2);
+    EXPECT_EQ(getter(), 5);
+    getter.reset();
+    EXPECT_EQ(shared.use_count(), 1);
+}
+
+#if USING(TRACK_ALLOCATIONS)
+TEST(Containers, alignedAllocationsAreTracked)
+{
+    struct alignas(64) CacheLine {
+        uint8_t bytes[64];
+    };
+    core::memory::AllocationCounter counter;
+    {
+        std::unique_ptr<CacheLine> line(new CacheLine());
+        EXPECT_TRUE(core::isAligned(line.get(), 64));
+    }
+    EXPECT_EQ(counter.Get().allocationCount, 1u);
+    EXPECT_EQ(counter.Get().freeCount, 1u);
+    EXPECT_EQ(counter.Get().allocatedBytes, sizeof(CacheLine));
+}
+#endif   // #if USING(TRACK_ALLOCATIONS)
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace
@@ -0,0 +1,77 @@
+#include "core/file_watcher.h"
+
+#include "core/test/temp_directory.h"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+namespace {
+/////////////////////////////////////////////////////////////////////////////////
+
+class FileWatcherTest : public core::test::TempDirectoryTest {
+protected:
+    void SetUp() override
+    {
+        TempDirectoryTest::SetUp();
+        std::filesystem::create_directories(_root / "shaders");
+        writeFile("shaders/shader.vert", "#version 450");
+    }
+
+    void writeFile(const std::string& path, const std::string& content, bool replace = false)
+    {
+        const std::filesystem::path target = _root / path;
+        {
+            std::ofstream file(replace ? target.string() + ".tmp" : target.string(), std::ios::binary);
+            file << content;
+        }
+        if (replace) {
+            std::filesystem::rename(target.string() + ".tmp", target);
+        }
+    }
+
+    //! the polling fallback only notices changes every kPollInterval
+    bool poll(core::FileWatcher& watcher, std::vector<std::string>& changedPaths)
+    {
+#if !USING(INOTIFY)
+        std::this_thread::sleep_for(core::FileWatcher::kPollInterval * 2);
+#endif   // #if !USING(INOTIFY)
+        return watcher.Poll(changedPaths);
+    }
+};
+
+TEST_F(FileWatcherTest, reportsWrittenFiles)
+{
+    core::FileWatcher watcher;
+    EXPECT_TRUE(watcher.Watch(nativePath("shaders/shader.vert")));
+    EXPECT_TRUE(watcher.Watch(nativePath("shaders/shader.frag")));   // doesn't exist yet
+    EXPECT_FALSE(watcher.Watch(nativePath("missing/shader.vert")));
+    EXPECT_EQ(watcher.watchedCount(), 2u);
+
+    std::vector<std::string> changed;
+    EXPECT_FALSE(poll(watcher, changed));
+
+    // written in place twice: reported once
+    writeFile("shaders/shader.vert", "#version 450 // 1");
+    writeFile("shaders/shader.vert", "#version 450 // 2");
+    writeFile("shaders/unwatched.vert", "#version 450");
+    ASSERT_TRUE(poll(watcher, changed));
+    ASSERT_EQ(changed.size(), 1u);
+    EXPECT_EQ(changed[0], nativePath("shaders/shader.vert"));
+
+    // created / replaced through a rename
+    changed.clear();
+    writeFile("shaders/shader.frag", "#version 450", true);
+    writeFile("shaders/shader.vert", "#version 450 // 3", true);
+    ASSERT_TRUE(poll(watcher, changed));
+    EXPECT_EQ(changed.size(), 2u);
+
+    changed.clear();
+    EXPECT_FALSE(poll(watcher, changed));
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace
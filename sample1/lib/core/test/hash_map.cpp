@@ -0,0 +1,188 @@
+#include "core/flat_hash_map.h"
+#include "core/hash.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <unordered_map>
+
+namespace {
+/////////////////////////////////////////////////////////////////////////////////
+
+TEST(Hash, bytes)
+{
+    const char text[] = "the quick brown fox jumps over the lazy dog, many many times over and over again";
+    for (size_t size = 0; size < sizeof(text); ++size) {
+        EXPECT_EQ(core::hashBytes(text, size), core::hashBytes(std::string(text, size).data(), size));
+        if (size > 0) {
+            EXPECT_NE(core::hashBytes(text, size), core::hashBytes(text, size - 1));
+        }
+    }
+    EXPECT_NE(core::hashBytes(text, 8, 1), core::hashBytes(text, 8, 2));
+}
+
+TEST(Hash, bytesStable)
+{
+    // persisted in the file formats: these values must never change
+    const char     text[] = "the quick brown fox jumps over the lazy dog, many many times over and over again";
+    const uint64_t seed   = 0x70616b2d68617368ull;
+    EXPECT_EQ(core::hashBytesStable(text, 0, seed), 0x652c593c691bdf48ull);
+    EXPECT_EQ(core::hashBytesStable(text, 3, seed), 0xfb2a71592c097597ull);
+    EXPECT_EQ(core::hashBytesStable(text, 8, seed), 0x952b6abc0413ac3eull);
+    EXPECT_EQ(core::hashBytesStable(text, 16, seed), 0xafaab08e60bebc4bull);
+    EXPECT_EQ(core::hashBytesStable(text, 17, seed), 0x300ceb440a25b2f4ull);
+    EXPECT_EQ(core::hashBytesStable(text, 48, seed), 0x3ee5f80a683ce777ull);
+    EXPECT_EQ(core::hashBytesStable(text, sizeof(text) - 1, seed), 0xb8ee850dd1ba44e6ull);
+}
+
+TEST(Hash, pod)
+{
+    struct State {
+        uint32_t a;
+        float    b;
+        uint64_t c;
+    };
+    State first {};
+    first.a      = 1;
+    first.b      = 2.f;
+    first.c      = 3;
+    State second = first;
+    EXPECT_EQ(core::hashPod(first), core::hashPod(second));
+    second.c = 4;
+    EXPECT_NE(core::hashPod(first), core::hashPod(second));
+}
+
+TEST(FlatHashMap, basic)
+{
+    core::FlatHashMap<int, int> map;
+    EXPECT_TRUE(map.empty());
+    EXPECT_EQ(map.find(1), map.end());
+
+    for (int i = 0; i < 1000; ++i) {
+        EXPECT_TRUE(map.insert({i, i * 2}).second);
+    }
+    EXPECT_FALSE(map.insert({10, 0}).second);
+    EXPECT_EQ(map.size(), 1000u);
+    for (int i = 0; i < 1000; ++i) {
+        auto it = map.find(i);
+        ASSERT_NE(it, map.end());
+        EXPECT_EQ(it->first, i);
+        EXPECT_EQ(it->second, i * 2);
+    }
+    EXPECT_FALSE(map.contains(1000));
+
+    size_t visited = 0;
+    for (const auto& entry : map) {
+        EXPECT_EQ(entry.second, entry.first * 2);
+        ++visited;
+    }
+    EXPECT_EQ(visited, map.size());
+
+    for (int i = 0; i < 1000; i += 2) {
+        EXPECT_EQ(map.erase(i), 1u);
+    }
+    EXPECT_EQ(map.size(), 500u);
+    for (int i = 0; i < 1000; ++i) {
+        EXPECT_EQ(map.contains(i), (i % 2) == 1);
+    }
+
+    map[7] = 70;
+    map[2000] += 5;
+    EXPECT_EQ(map.at(7), 70);
+    EXPECT_EQ(map.at(2000), 5);
+
+    map.clear();
+    EXPECT_TRUE(map.empty());
+    EXPECT_FALSE(map.contains(7));
+}
+
+TEST(FlatHashMap, churn)
+{
+    // insert/erase cycles on a fixed key range must not grow the table forever
+    core::FlatHashMap<uint32_t, uint32_t> map;
+    std::unordered_map<uint32_t, uint32_t> reference;
+    uint32_t                               seed = 12345;
+    for (int i = 0; i < 100000; ++i) {
+        seed               = seed * 1664525u + 1013904223u;
+        const uint32_t key = (seed >> 8) % 512;
+        if (seed & 1) {
+            map[key]       = i;
+            reference[key] = i;
+        } else {
+            EXPECT_EQ(map.erase(key), reference.erase(key));
+        }
+    }
+    EXPECT_EQ(map.size(), reference.size());
+    EXPECT_LE(map.capacity(), 2048u);
+    for (const auto& entry : reference) {
+        ASSERT_TRUE(map.contains(entry.first));
+        EXPECT_EQ(map.at(entry.first), entry.second);
+    }
+}
+
+TEST(FlatHashMap, heterogeneousLookup)
+{
+    core::FlatHashMap<std::string, int> map;
+    map.try_emplace("pipeline", 1);
+    map["sampler"] = 2;
+
+    const std::string_view key = "sampler";
+    EXPECT_EQ(map.find(key)->second, 2);
+    EXPECT_TRUE(map.contains("pipeline"));
+    EXPECT_FALSE(map.contains(std::string_view("layout")));
+    EXPECT_EQ(map.erase(std::string_view("pipeline")), 1u);
+    EXPECT_EQ(map.size(), 1u);
+}
+
+TEST(FlatHashMap, copyAndMove)
+{
+    core::FlatHashMap<std::string, std::string> map;
+    for (int i = 0; i < 100; ++i) {
+        map[std::to_string(i)] = std::string(32, 'a' + i % 26);
+    }
+
+    core::FlatHashMap<std::string, std::string> copy = map;
+    EXPECT_EQ(copy.size(), map.size());
+    EXPECT_EQ(copy["42"], map["42"]);
+
+    core::FlatHashMap<std::string, std::string> moved = std::move(map);
+    EXPECT_TRUE(map.empty());
+    EXPECT_EQ(moved.size(), 100u);
+    map = moved;
+    EXPECT_EQ(map.size(), 100u);
+}
+
+TEST(FlatHashSet, basic)
+{
+    core::FlatHashSet<std::string> set;
+    EXPECT_TRUE(set.insert("a").second);
+    EXPECT_TRUE(set.emplace("b").second);
+    EXPECT_FALSE(set.insert("a").second);
+    EXPECT_TRUE(set.contains("b"));
+    EXPECT_EQ(set.size(), 2u);
+    set.erase(set.find("a"));
+    EXPECT_EQ(set.size(), 1u);
+    EXPECT_EQ(*set.begin(), "b");
+}
+
+TEST(NodeHashMap, stableReferences)
+{
+    core::NodeHashMap<int, std::string> map;
+    std::string*                        first = &map[0];
+    *first                                    = "first";
+    for (int i = 1; i < 10000; ++i) {
+        map[i] = std::to_string(i);
+    }
+    EXPECT_EQ(first, &map[0]);
+    EXPECT_EQ(*first, "first");
+
+    core::NodeHashSet<int> set;
+    const int*             value = &*set.insert(5).first;
+    for (int i = 0; i < 1000; ++i) {
+        set.insert(i + 10);
+    }
+    EXPECT_EQ(value, &*set.find(5));
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <system_error>
+
+namespace core {
+namespace test {
+////////////////////////////////////////////////////////////////////////////////
+
+//! Fixture owning an empty directory under the temp directory, removed after
+//! each test. The name ends with a random suffix: concurrent runs of the
+//! tests never share (nor delete) each other's directory.
+class TempDirectoryTest : public ::testing::Test {
+protected:
+    std::filesystem::path _root;
+
+    void SetUp() override
+    {
+        // parameterized tests have '/' in their names
+        std::string name = ::testing::UnitTest::GetInstance()->current_test_info()->test_suite_name();
+        std::replace(name.begin(), name.end(), '/', '_');
+
+        std::random_device random;
+        char               suffix[17];
+        snprintf(suffix, sizeof(suffix), "%08x%08x", random(), random());
+        _root = std::filesystem::temp_directory_path() / (name + "_test_" + suffix);
+        std::filesystem::create_directories(_root);
+    }
+    void TearDown() override
+    {
+        std::error_code error;
+        std::filesystem::remove_all(_root, error);
+    }
+
+    std::string nativePath(const char* path) const { return (_root / path).string(); }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace test
+}   // namespace core
@@ -0,0 +1,211 @@
+#include "core/lz4.h"
+#include "core/pak.h"
+
+#include "core/test/temp_directory.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+/////////////////////////////////////////////////////////////////////////////////
+
+std::vector<uint8_t>
+compressibleData(size_t size)
+{
+    const char* const    words[] = {"vertex ", "fragment ", "shader ", "pipeline ", "layout(location = 0) "};
+    std::mt19937         random(7);
+    std::vector<uint8_t> data;
+    while (data.size() < size) {
+        const char* word = words[random() % 5];
+        data.insert(data.end(), word, word + strlen(word));
+    }
+    data.resize(size);
+    return data;
+}
+
+std::vector<uint8_t>
+randomData(size_t size)
+{
+    std::mt19937         random(11);
+    std::vector<uint8_t> data(size);
+    for (uint8_t& byte : data) {
+        byte = static_cast<uint8_t>(random());
+    }
+    return data;
+}
+
+size_t
+roundTrip(const std::vector<uint8_t>& data)
+{
+    std::vector<uint8_t> compressed(core::lz4::compressBound(data.size()));
+    const size_t compressedSize = core::lz4::compress(data.data(), data.size(), compressed.data(), compressed.size());
+    EXPECT_NE(compressedSize, 0u);
+
+    std::vector<uint8_t> decompressed(data.size());
+    EXPECT_TRUE(core::lz4::decompress(compressed.data(), compressedSize, decompressed.data(), decompressed.size()));
+    EXPECT_EQ(decompressed, data);
+    return compressedSize;
+}
+
+core::vfs::FileHandle
+makeFile(const std::vector<uint8_t>& data)
+{
+    core::vfs::FileHandle file = core::vfs::FileHandle::Allocate(data.size());
+    if (!data.empty()) {
+        memcpy(file.MutableData(), data.data(), data.size());
+    }
+    return file;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+
+TEST(Lz4, roundTrip)
+{
+    for (size_t size : {0, 1, 12, 13, 100, 4096, 100000, 1 << 20}) {
+        SCOPED_TRACE(size);
+        const size_t compressedSize = roundTrip(compressibleData(size));
+        if (size >= 4096) {
+            EXPECT_LT(compressedSize, size / 2);
+        }
+        EXPECT_LE(roundTrip(randomData(size)), core::lz4::compressBound(size));
+    }
+    // long runs: overlapping matches and long length encodings
+    roundTrip(std::vector<uint8_t>(300000, 'a'));
+    // matches further away than the 64 KB window
+    std::vector<uint8_t> far = randomData(50000);
+    far.resize(200000);
+    memcpy(far.data() + 150000, far.data(), 50000);
+    roundTrip(far);
+}
+
+TEST(Lz4, malformedInput)
+{
+    const std::vector<uint8_t> data = compressibleData(10000);
+    std::vector<uint8_t>       compressed(core::lz4::compressBound(data.size()));
+    const size_t compressedSize = core::lz4::compress(data.data(), data.size(), compressed.data(), compressed.size());
+    compressed.resize(compressedSize);
+
+    // too small a destination fails instead of overflowing
+    std::vector<uint8_t> small(compressedSize / 2);
+    EXPECT_EQ(core::lz4::compress(data.data(), data.size(), small.data(), small.size()), 0u);
+
+    std::vector<uint8_t> output(data.size());
+    EXPECT_FALSE(core::lz4::decompress(compressed.data(), compressed.size(), output.data(), output.size() - 1));
+    EXPECT_FALSE(core::lz4::decompress(compressed.data(), compressed.size() / 2, output.data(), output.size()));
+
+    // garbage must be rejected (or decoded) without touching memory out of bounds
+    std::mt19937 random(3);
+    for (int i = 0; i < 1000; ++i) {
+        std::vector<uint8_t> corrupted = compressed;
+        corrupted[random() % corrupted.size()] ^= static_cast<uint8_t>(1 + random() % 255);
+        core::lz4::decompress(corrupted.data(), corrupted.size(), output.data(), output.size());
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+
+using Pak = core::test::TempDirectoryTest;
+
+TEST_F(Pak, writeAndMount)
+{
+    const std::vector<uint8_t> text   = compressibleData(50000);
+    const std::vector<uint8_t> binary = randomData(5000);
+    const std::vector<uint8_t> spirv  = compressibleData(3000);
+
+    core::pak::PakWriter writer;
+    writer.Add("res/text.txt", makeFile(text));
+    writer.Add("res/noise.bin", makeFile(binary));
+    writer.Add("shaders/shader.vert.spv", makeFile(spirv), false);
+    writer.Add("empty", makeFile({}));
+    core::pak::PakWriter::Summary summary;
+    ASSERT_TRUE(writer.Write(nativePath("data.pak").c_str(), &summary));
+    EXPECT_FALSE(std::filesystem::exists(nativePath("data.pak.tmp")));
+    EXPECT_EQ(summary.entryCount, 4u);
+    EXPECT_EQ(summary.compressedCount, 1u);   // random data doesn't compress
+    EXPECT_EQ(summary.uncompressedSize, text.size() + binary.size() + spirv.size());
+    EXPECT_EQ(summary.archiveSize, std::filesystem::file_size(nativePath("data.pak")));
+
+    std::unique_ptr<core::pak::ArchiveMount> mount = core::pak::ArchiveMount::Load(nativePath("data.pak").c_str());
+    ASSERT_TRUE(mount);
+    EXPECT_EQ(mount->entryCount(), 4u);
+    EXPECT_TRUE(mount->Verify());
+    for (uint32_t i = 1; i < mount->entryCount(); ++i) {
+        EXPECT_LE(mount->entry(i - 1).pathHash, mount->entry(i).pathHash);
+    }
+
+    core::vfs::FileSystem fs;
+    fs.Mount("", std::move(mount));
+    EXPECT_TRUE(fs.Exists("res/text.txt"));
+    EXPECT_FALSE(fs.Exists("res/text"));
+    EXPECT_FALSE(fs.Open("missing"));
+
+    core::vfs::FileHandle file = fs.Open("res/text.txt");
+    ASSERT_TRUE(file);
+    EXPECT_EQ(std::vector<uint8_t>(file.data(), file.data() + file.size()), text);
+
+    // uncompressed entries are page aligned views of the mapping
+    file = fs.Open("shaders/shader.vert.spv", core::vfs::CacheMode::Uncached);
+    ASSERT_TRUE(file);
+    EXPECT_TRUE(core::isAligned(file.data(), core::pak::kRawAlignment));
+    EXPECT_EQ(std::vector<uint8_t>(file.data(), file.data() + file.size()), spirv);
+
+    file = fs.Open("res/noise.bin");
+    ASSERT_TRUE(file);
+    EXPECT_EQ(std::vector<uint8_t>(file.data(), file.data() + file.size()), binary);
+
+    file = fs.Open("empty");
+    EXPECT_TRUE(file);
+    EXPECT_EQ(file.size(), 0u);
+
+    core::pak::PakWriter duplicated;
+    duplicated.Add("a", makeFile(text));
+    duplicated.Add("a", makeFile(text));
+    EXPECT_FALSE(duplicated.Write(nativePath("duplicated.pak").c_str()));
+}
+
+TEST_F(Pak, rejectsCorruption)
+{
+    core::pak::PakWriter writer;
+    writer.Add("a.txt", makeFile(compressibleData(20000)));
+    writer.Add("b.txt", makeFile(compressibleData(100)), false);
+    ASSERT_TRUE(writer.Write(nativePath("data.pak").c_str()));
+    const std::filesystem::path path = nativePath("data.pak");
+    const uintmax_t             size = std::filesystem::file_size(path);
+
+    const auto patch = [&](uint64_t offset) {
+        std::FILE* file = std::fopen(path.string().c_str(), "r+b");
+        std::fseek(file, static_cast<long>(offset), SEEK_SET);
+        const int byte = std::fgetc(file);
+        std::fseek(file, static_cast<long>(offset), SEEK_SET);
+        std::fputc(byte ^ 0x5a, file);
+        std::fclose(file);
+    };
+
+    EXPECT_FALSE(core::pak::ArchiveMount::Load(nativePath("missing.pak").c_str()));
+
+    // the last bytes are the names: the table of contents hash catches it
+    patch(size - 1);
+    EXPECT_FALSE(core::pak::ArchiveMount::Load(path.string().c_str()));
+    patch(size - 1);
+    ASSERT_TRUE(core::pak::ArchiveMount::Load(path.string().c_str()));
+
+    // entry data: caught by the content hashes
+    std::unique_ptr<core::pak::ArchiveMount> mount = core::pak::ArchiveMount::Load(path.string().c_str());
+    const uint64_t                           dataOffset = mount->Find("b.txt")->offset;
+    mount.reset();
+    patch(dataOffset);
+    mount = core::pak::ArchiveMount::Load(path.string().c_str());
+    ASSERT_TRUE(mount);
+    EXPECT_FALSE(mount->Verify());
+
+    patch(0);
+    EXPECT_FALSE(core::pak::ArchiveMount::Load(path.string().c_str()));
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace
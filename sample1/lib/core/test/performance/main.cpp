@@ -0,0 +1,106 @@
+#include "core/flat_hash_map.h"
+
+#include "abc/profiler.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+////////////////////////////////////////////////////////////////////////////////
+
+std::vector<uint64_t>
+makeKeys(size_t count, uint64_t seed)
+{
+    // splitmix64: unique, well spread keys
+    std::vector<uint64_t> keys(count);
+    for (auto& key : keys) {
+        seed += 0x9e3779b97f4a7c15ull;
+        uint64_t z = seed;
+        z          = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z          = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        key        = z ^ (z >> 31);
+    }
+    return keys;
+}
+
+struct Labels {
+    const char* insert;
+    const char* findHit;
+    const char* findMiss;
+    const char* erase;
+};
+
+template <typename MapT>
+uint64_t
+benchmarkMap(const Labels& labels, const std::vector<uint64_t>& keys, const std::vector<uint64_t>& missingKeys)
+{
+    uint64_t checksum = 0;
+    MapT     map;
+
+    ABC_PROFILE_BEGIN(labels.insert);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        map[keys[i]] = i;
+    }
+    ABC_PROFILE_END(labels.insert);
+
+    ABC_PROFILE_BEGIN(labels.findHit);
+    for (const uint64_t key : keys) {
+        checksum += map.find(key)->second;
+    }
+    ABC_PROFILE_END(labels.findHit);
+
+    ABC_PROFILE_BEGIN(labels.findMiss);
+    for (const uint64_t key : missingKeys) {
+        checksum += map.find(key) == map.end() ? 0 : 1;
+    }
+    ABC_PROFILE_END(labels.findMiss);
+
+    ABC_PROFILE_BEGIN(labels.erase);
+    for (const uint64_t key : keys) {
+        checksum += map.erase(key);
+    }
+    ABC_PROFILE_END(labels.erase);
+
+    return checksum;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace
+
+int
+main(int, char**)
+{
+    ABC_PROFILE_INIT();
+
+    static const size_t kCounts[] = {1000, 10000, 100000, 1000000};
+    static const Labels kFlatLabels[] = {
+        {"flat_1k_insert", "flat_1k_find_hit", "flat_1k_find_miss", "flat_1k_erase"},
+        {"flat_10k_insert", "flat_10k_find_hit", "flat_10k_find_miss", "flat_10k_erase"},
+        {"flat_100k_insert", "flat_100k_find_hit", "flat_100k_find_miss", "flat_100k_erase"},
+        {"flat_1M_insert", "flat_1M_find_hit", "flat_1M_find_miss", "flat_1M_erase"},
+    };
+    static const Labels kStdLabels[] = {
+        {"std_1k_insert", "std_1k_find_hit", "std_1k_find_miss", "std_1k_erase"},
+        {"std_10k_insert", "std_10k_find_hit", "std_10k_find_miss", "std_10k_erase"},
+        {"std_100k_insert", "std_100k_find_hit", "std_100k_find_miss", "std_100k_erase"},
+        {"std_1M_insert", "std_1M_find_hit", "std_1M_find_miss", "std_1M_erase"},
+    };
+
+    uint64_t checksum = 0;
+    for (size_t i = 0; i < sizeof(kCounts) / sizeof(kCounts[0]); ++i) {
+        const std::vector<uint64_t> keys        = makeKeys(kCounts[i], 1);
+        const std::vector<uint64_t> missingKeys = makeKeys(kCounts[i], 2);
+        // keep the total amount of work roughly constant across sizes
+        const size_t repeat = 2000000 / kCounts[i] + 1;
+        for (size_t r = 0; r < repeat; ++r) {
+            checksum += benchmarkMap<core::FlatHashMap<uint64_t, uint64_t>>(kFlatLabels[i], keys, missingKeys);
+            checksum += benchmarkMap<std::unordered_map<uint64_t, uint64_t>>(kStdLabels[i], keys, missingKeys);
+        }
+    }
+    ABC_PROFILE_SUMMARY();
+
+    printf("checksum %llu\n", static_cast<unsigned long long>(checksum));
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include "core/flat_hash_map.h"
+#include "core/string_id.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+namespace {
+/////////////////////////////////////////////////////////////////////////////////
+
+using namespace core::literals;
+
+constexpr core::StringId kVertexShader = "shaders/shader.vert.spv";
+static_assert(kVertexShader == "shaders/shader.vert.spv"_sid, "literal and UDL ids must match");
+static_assert(kVertexShader != "shaders/shader.frag.spv"_sid, "distinct literals must differ");
+static_assert(!core::StringId().isValid(), "default id is invalid");
+
+TEST(StringId, runtimeMatchesCompileTime)
+{
+    const std::string path = std::string("shaders/") + "shader.vert.spv";
+    EXPECT_EQ(core::StringId(path), kVertexShader);
+    EXPECT_EQ(core::StringId(std::string_view("")), core::StringId(""));
+    EXPECT_NE(core::StringId("a"), core::StringId("b"));
+}
+
+TEST(StringId, reverseLookup)
+{
+    const core::StringId id = core::StringId::Intern("vertex buffer");
+#if USING(STRING_ID_INTERN)
+    EXPECT_STREQ(id.c_str(), "vertex buffer");
+    // interning twice is fine
+    EXPECT_EQ(core::StringId::Intern("vertex buffer"), id);
+    EXPECT_STREQ(id.c_str(), "vertex buffer");
+#else    // #if USING(STRING_ID_INTERN)
+    EXPECT_EQ(strncmp(id.c_str(), "<sid:0x", 7), 0);
+#endif   // #else    // #if USING(STRING_ID_INTERN)
+}
+
+TEST(StringId, runtimeCharArray)
+{
+    // hashed up to the terminator, not over the whole buffer
+    char buffer[64];
+    memset(buffer, 'x', sizeof(buffer));
+    snprintf(buffer, sizeof(buffer), "%s", "vertex buffer");
+    EXPECT_EQ(core::StringId(buffer), core::StringId(std::string_view("vertex buffer")));
+    EXPECT_EQ(core::StringId(buffer), "vertex buffer");
+}
+
+TEST(StringId, compileTimeIds)
+{
+    constexpr core::StringId id = "index buffer";
+#if USING(STRING_ID_INTERN)
+    // no room for the literal in a constexpr id: printable once its string is interned
+    EXPECT_EQ(strncmp(id.c_str(), "<sid:0x", 7), 0);
+    EXPECT_EQ(core::StringId::Intern("index buffer"), id);
+    EXPECT_STREQ(id.c_str(), "index buffer");
+    // a literal hashed at runtime is interned
+    EXPECT_STREQ("pipeline cache"_sid.c_str(), "pipeline cache");
+#else    // #if USING(STRING_ID_INTERN)
+    EXPECT_EQ(strncmp(id.c_str(), "<sid:0x", 7), 0);
+#endif   // #else    // #if USING(STRING_ID_INTERN)
+}
+
+TEST(StringId, hashMapKey)
+{
+    core::FlatHashMap<core::StringId, int> resources;
+    resources["vertices"_sid] = 1;
+    resources["indices"_sid]  = 2;
+    EXPECT_EQ(resources.at(core::StringId(std::string("indices"))), 2);
+    EXPECT_FALSE(resources.contains("uniforms"_sid));
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace
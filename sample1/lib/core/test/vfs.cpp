@@ -0,0 +1,139 @@
+#include "core/vfs.h"
+
+#include "core/test/temp_directory.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+/////////////////////////////////////////////////////////////////////////////////
+
+class Vfs : public core::test::TempDirectoryTest {
+protected:
+    void SetUp() override
+    {
+        TempDirectoryTest::SetUp();
+        std::filesystem::create_directories(_root / "base" / "shaders");
+        std::filesystem::create_directories(_root / "patch" / "shaders");
+        writeFile("base/shaders/a.spv", std::string("\x03\x02\x23\x07 base a", 12));
+        writeFile("base/shaders/b.spv", "base b");
+        writeFile("base/empty.txt", "");
+        writeFile("patch/shaders/a.spv", "patched a");
+    }
+
+    //! write + rename, like editors do: mapped files must not be modified in place
+    void writeFile(const std::string& path, const std::string& content)
+    {
+        {
+            std::ofstream file(_root / (path + ".tmp"), std::ios::binary);
+            file << content;
+        }
+        std::filesystem::rename(_root / (path + ".tmp"), _root / path);
+    }
+};
+
+TEST_F(Vfs, fileHandle)
+{
+    core::vfs::FileHandle file = core::vfs::FileHandle::MapFile(nativePath("base/shaders/b.spv").c_str());
+    ASSERT_TRUE(file);
+    EXPECT_EQ(file.asString(), "base b");
+    EXPECT_TRUE(core::isAligned(file.data(), 4096));
+    EXPECT_EQ(file.useCount(), 1u);
+
+    core::vfs::FileHandle view = file.SubView(5, 1);
+    EXPECT_EQ(view.asString(), "b");
+    EXPECT_EQ(file.useCount(), 2u);
+    file.reset();
+    EXPECT_EQ(view.useCount(), 1u);
+    EXPECT_EQ(view.asString(), "b");
+
+    EXPECT_FALSE(core::vfs::FileHandle::MapFile(nativePath("missing").c_str()));
+    EXPECT_FALSE(core::vfs::FileHandle::MapFile(nativePath("base").c_str()));
+
+    core::vfs::FileHandle empty = core::vfs::FileHandle::MapFile(nativePath("base/empty.txt").c_str());
+    EXPECT_TRUE(empty);
+    EXPECT_EQ(empty.size(), 0u);
+
+    core::vfs::FileHandle buffer = core::vfs::FileHandle::Allocate(100);
+    EXPECT_TRUE(core::isAligned(buffer.data(), core::vfs::kFileDataAlignment));
+    buffer.MutableData()[99] = 42;
+    EXPECT_EQ(buffer.data()[99], 42);
+}
+
+TEST_F(Vfs, mountsAndCache)
+{
+    core::vfs::FileSystem fs;
+    fs.Mount("", std::make_unique<core::vfs::DirectoryMount>(nativePath("base")));
+
+    core::vfs::FileHandle a = fs.Open("shaders/a.spv");
+    ASSERT_TRUE(a);
+    EXPECT_EQ(a.size(), 12u);
+    EXPECT_EQ(a.dataAs<uint32_t>()[0], 0x07230203u);
+
+    // read-through cache: same mapping, no new load
+    core::vfs::FileHandle again = fs.Open("shaders/a.spv");
+    EXPECT_EQ(again.data(), a.data());
+    core::vfs::Stats stats = fs.GetStats();
+    EXPECT_EQ(stats.openCount, 2u);
+    EXPECT_EQ(stats.cacheHitCount, 1u);
+    EXPECT_EQ(stats.bytesLoaded, 12u);
+    EXPECT_EQ(stats.cachedFiles, 1u);
+
+    EXPECT_FALSE(fs.Open("shaders/missing.spv"));
+    EXPECT_EQ(fs.GetStats().failedOpenCount, 1u);
+
+    // later mounts override earlier ones
+    fs.Mount("", std::make_unique<core::vfs::DirectoryMount>(nativePath("patch")));
+    EXPECT_EQ(fs.Open("shaders/a.spv").asString(), "patched a");
+    EXPECT_EQ(fs.Open("shaders/b.spv").asString(), "base b");
+    // the old handle is still valid
+    EXPECT_EQ(a.size(), 12u);
+
+    fs.Mount("data/", std::make_unique<core::vfs::DirectoryMount>(nativePath("base")));
+    EXPECT_TRUE(fs.Exists("data/shaders/b.spv"));
+    EXPECT_FALSE(fs.Exists("data/shaders"));
+    EXPECT_EQ(fs.Open("data/shaders/a.spv", core::vfs::CacheMode::Uncached).size(), 12u);
+    // a prefix is a whole directory name
+    fs.Mount("base", std::make_unique<core::vfs::DirectoryMount>(nativePath("base")));
+    EXPECT_TRUE(fs.Exists("base/shaders/b.spv"));
+    EXPECT_FALSE(fs.Exists("baseline/shaders/b.spv"));
+    EXPECT_FALSE(fs.Open("databases/shaders/b.spv"));
+
+    fs.ClearCache();
+    EXPECT_EQ(fs.GetStats().cachedFiles, 0u);
+    fs.Open("shaders/b.spv");
+    writeFile("base/shaders/b.spv", "base b, edited");
+    EXPECT_EQ(fs.Open("shaders/b.spv").asString(), "base b");
+    fs.Evict("shaders/b.spv");
+    EXPECT_EQ(fs.Open("shaders/b.spv").asString(), "base b, edited");
+}
+
+TEST_F(Vfs, concurrentOpen)
+{
+    core::vfs::FileSystem fs;
+    fs.Mount("", std::make_unique<core::vfs::DirectoryMount>(nativePath("base")));
+
+    // the loads run outside of the lock: every thread gets the cached handle
+    std::vector<core::vfs::FileHandle> files(8);
+    std::vector<std::thread>           threads;
+    for (core::vfs::FileHandle& file : files) {
+        threads.emplace_back([&fs, &file]() { file = fs.Open("shaders/b.spv"); });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    const core::vfs::FileHandle cached = fs.Open("shaders/b.spv");
+    for (const core::vfs::FileHandle& file : files) {
+        EXPECT_EQ(file.data(), cached.data());
+    }
+    EXPECT_EQ(fs.GetStats().cachedFiles, 1u);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace
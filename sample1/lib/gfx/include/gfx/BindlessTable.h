@@ -0,0 +1,150 @@
+#pragma once
+
+#include "core/core.h"
+#include "gfx/vk_types.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace gfx {
+namespace vulkan {
+////////////////////////////////////////////////////////////////////////////////
+
+//! One descriptor set for every resource (VK_EXT_descriptor_indexing): large
+//! update-after-bind arrays of sampled images, samplers and storage buffers,
+//! bound once per frame. Shaders index them with values given through push
+//! constants:
+//!
+//!     layout(set = 0, binding = 0) uniform texture2D textures[];
+//!     layout(set = 0, binding = 1) uniform sampler samplers[];
+//!     layout(set = 0, binding = 2) buffer Buffers { uint data[]; } buffers[];
+//!     layout(push_constant) uniform Indices { uint texture; uint sampler; } indices;
+//!
+//!     texture(sampler2D(textures[nonuniformEXT(indices.texture)], samplers[indices.sampler]), uv);
+//!
+//! Pipeline layouts made with the set layout at set 0 and the push constant
+//! range below are compatible with pipelineLayout(): the set stays bound from
+//! one pipeline to the next (see PipelineLayoutCache::SetBindlessLayout()).
+//!
+//! Removed slots are reused once the frames in flight that may still read
+//! them are complete. Render thread only.
+class BindlessTable {
+public:
+    static constexpr uint32_t kInvalidIndex = UINT32_MAX;
+    //! the push constant range of every bindless pipeline: the guaranteed maxPushConstantsSize
+    static constexpr uint32_t kPushConstantSize = 128;
+
+    static constexpr uint32_t kSampledImageBinding  = 0;
+    static constexpr uint32_t kSamplerBinding       = 1;
+    static constexpr uint32_t kStorageBufferBinding = 2;
+
+    struct Config {
+        uint32_t sampledImageCount  = 16384;
+        uint32_t samplerCount       = 256;
+        uint32_t storageBufferCount = 16384;
+        //! BeginFrame() calls before a removed slot is reused
+        uint32_t framesInFlight = 2;
+    };
+
+    struct Stats {
+        uint32_t sampledImageCount  = 0;   //!< slots in use
+        uint32_t samplerCount       = 0;
+        uint32_t storageBufferCount = 0;
+        uint32_t retiredCount       = 0;   //!< removed, waiting for the frames in flight
+        uint32_t frameWriteCount    = 0;   //!< descriptors written by the last flush
+        uint32_t frameBindCount     = 0;   //!< vkCmdBindDescriptorSets since BeginFrame()
+    };
+
+    BindlessTable() = default;
+    ~BindlessTable() { ASSERT_MSG(_device == VK_NULL_HANDLE, "BindlessTable::Destroy() not called"); }
+
+    BindlessTable(const BindlessTable&)            = delete;
+    BindlessTable& operator=(const BindlessTable&) = delete;
+
+    //! The device has VK_EXT_descriptor_indexing with runtimeDescriptorArray,
+    //! descriptorBindingPartiallyBound and the update after bind of sampled
+    //! images and storage buffers, the instance has
+    //! VK_KHR_get_physical_device_properties2. The counts of the config are
+    //! clamped to the update after bind limits of the device (and logged).
+    //! False (and logs) on failure.
+    bool Init(VkInstance instance, VkPhysicalDevice physicalDevice, VkDevice device, const Config& config);
+    //! the GPU must be idle
+    void Destroy();
+
+    //! kInvalidIndex (and logs) when the array is full. The descriptor is
+    //! written at the next Bind().
+    uint32_t AddSampledImage(VkImageView view, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    uint32_t AddSampler(VkSampler sampler);
+    uint32_t AddStorageBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+
+    //! the resource may be destroyed once the frames in flight are complete
+    void RemoveSampledImage(uint32_t index);
+    void RemoveSampler(uint32_t index);
+    void RemoveStorageBuffer(uint32_t index);
+
+    //! the frame in flight about to be recorded is complete: recycles the
+    //! slots removed framesInFlight frames ago
+    void BeginFrame();
+    //! writes the pending descriptors and binds the set, once per frame and
+    //! bind point
+    void Bind(VkCommandBuffer cmd, VkPipelineBindPoint bindPoint);
+    //! Any thread, after Bind() in the frame: secondary command buffers
+    //! inherit no descriptor set. Not counted in the stats.
+    void BindSecondary(VkCommandBuffer cmd, VkPipelineBindPoint bindPoint) const;
+    //! size + offset <= kPushConstantSize
+    void PushConstants(VkCommandBuffer cmd, const void* data, uint32_t size, uint32_t offset = 0) const;
+
+    VkDescriptorSetLayout setLayout() const { return _setLayout; }
+    VkPipelineLayout      pipelineLayout() const { return _pipelineLayout; }
+    //! kPushConstantSize bytes for every stage
+    static VkPushConstantRange pushConstantRange();
+
+    Stats GetStats() const;
+
+private:
+    //! indices of one array
+    struct Slots {
+        struct Retired {
+            uint64_t frame = 0;
+            uint32_t index = kInvalidIndex;
+        };
+
+        uint32_t              capacity = 0;
+        uint32_t              end      = 0;   //!< never allocated from there
+        std::vector<uint32_t> free;
+        std::vector<Retired>  retired;
+
+        uint32_t Allocate();
+        void     Retire(uint32_t index, uint64_t frame);
+        void     Recycle(uint64_t completedFrame);
+        uint32_t usedCount() const { return end - static_cast<uint32_t>(free.size() + retired.size()); }
+    };
+
+    struct PendingWrite {
+        uint32_t               binding = 0;
+        uint32_t               index   = 0;
+        VkDescriptorImageInfo  image {};
+        VkDescriptorBufferInfo buffer {};
+    };
+
+    uint32_t _Add(Slots& slots, const char* name, uint32_t binding, const PendingWrite& write);
+    void     _Flush();
+
+    VkDevice              _device = VK_NULL_HANDLE;
+    Config                _config;
+    VkDescriptorPool      _pool           = VK_NULL_HANDLE;
+    VkDescriptorSetLayout _setLayout      = VK_NULL_HANDLE;
+    VkPipelineLayout      _pipelineLayout = VK_NULL_HANDLE;
+    VkDescriptorSet       _set            = VK_NULL_HANDLE;
+
+    Slots                     _sampledImages;
+    Slots                     _samplers;
+    Slots                     _storageBuffers;
+    std::vector<PendingWrite> _pendingWrites;
+    uint64_t                  _frame = 0;
+    Stats                     _stats;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace vulkan
+}   // namespace gfx
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "core/string_id.h"
+#include "gfx/vk_types.h"
+
+#include <cstdint>
+#include <string_view>
+
+namespace gfx {
+////////////////////////////////////////////////////////////////////////////////
+
+struct Handle {
+    uint32_t handle = UINT32_MAX;
+
+    bool isValid() const { return handle != UINT32_MAX; }
+    bool operator==(const Handle& other) const { return other.handle == handle; }
+    bool operator!=(const Handle& other) const { return other.handle != handle; }
+};
+
+struct BufferHandle {
+    Handle handle;
+
+    bool operator==(const BufferHandle& other) const { return other.handle == handle; }
+    bool operator!=(const BufferHandle& other) const { return other.handle != handle; }
+};
+
+namespace vulkan {
+
+struct Buffer {
+    VkBuffer           vkBuffer       = VK_NULL_HANDLE;
+    VkDeviceMemory     vkDeviceMemory = VK_NULL_HANDLE;
+    VkDeviceSize       vkDeviceSize   = 0;
+    VkBufferUsageFlags vkUsageFlags   = 0;
+    uint32_t           size           = 0;
+    uint32_t           globalOffset   = 0;
+    BufferHandle       handle;
+    BufferHandle       parentHandle;
+    //! lookups by name are integer compares, name.c_str() for debug output
+    core::StringId name;
+};
+
+}   // namespace vulkan
+
+enum class BufferUsageFlags { NONE = 0, READ, WRITE, COPY };
+
+struct BufferCreation {
+    uint32_t         size       = 0;
+    BufferUsageFlags usageFlags = BufferUsageFlags::NONE;
+    core::StringId   name;
+
+    BufferCreation& setSize(uint32_t newSize)
+    {
+        size = newSize;
+        return *this;
+    }
+    BufferCreation& setName(core::StringId newName)
+    {
+        name = newName;
+        return *this;
+    }
+    //! literals (or char buffers, hashed up to their terminator)
+    template <size_t N> BufferCreation& setName(const char (&newName)[N])
+    {
+        name = core::StringId(newName);
+        return *this;
+    }
+    //! runtime names are interned in debug builds, see core::StringId
+    BufferCreation& setName(std::string_view newName)
+    {
+        name = core::StringId(newName);
+        return *this;
+    }
+    BufferCreation& setUsageFlags(BufferUsageFlags newUsageFlags)
+    {
+        usageFlags = newUsageFlags;
+        return *this;
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace gfx
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "core/core.h"
+#include "core/inplace_function.h"
+#include "core/thread_pool.h"
+#include "gfx/vk_types.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace gfx {
+namespace vulkan {
+////////////////////////////////////////////////////////////////////////////////
+
+//! Records the draws of a render pass on several threads.
+//!
+//! The items (draws, objects, anything the record function understands) are
+//! split in contiguous chunks, one per thread at most; each chunk is recorded
+//! into a secondary command buffer, the calling thread taking the first one,
+//! and the secondary command buffers are executed into the primary one in
+//! chunk order: the result is the same as a recording on one thread.
+//!
+//! Every thread has a command pool per frame in flight, reset at once (never
+//! buffer by buffer) in BeginFrame(), so the threads never share a pool.
+//!
+//!     recorder.BeginFrame();   // the fence of the frame in flight signaled
+//!     vkCmdBeginRenderPass(cmd, &beginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+//!     recorder.Record(cmd, inheritance, drawCount, [&](VkCommandBuffer secondary, uint32_t first, uint32_t count) {
+//!         // viewport, scissor, pipeline and descriptor sets: secondaries inherit no state
+//!     });
+//!     vkCmdEndRenderPass(cmd);
+//!
+//! Render thread only; the record function runs on every thread at once.
+class CommandRecorder {
+public:
+    //! records items [first, first + count)
+    using RecordFunction = core::InplaceFunction<void(VkCommandBuffer, uint32_t, uint32_t), 64>;
+
+    struct Config {
+        uint32_t queueFamilyIndex = 0;   //!< of the primary command buffers
+        uint32_t framesInFlight   = 2;
+        //! worker threads, the calling thread records too; 0: one per hardware thread
+        uint32_t threadCount = 0;
+        //! smaller chunks are not worth a thread
+        uint32_t minItemsPerChunk = 64;
+    };
+
+    struct Stats {
+        uint32_t threadCount          = 0;   //!< recording, the calling thread included
+        uint32_t frameRecordCount     = 0;   //!< Record() since BeginFrame()
+        uint32_t frameChunkCount      = 0;   //!< secondary command buffers since BeginFrame()
+        uint32_t commandBufferCount   = 0;   //!< allocated, in every pool
+        float    frameParallelPercent = 0;   //!< items recorded on the workers
+    };
+
+    CommandRecorder() = default;
+    ~CommandRecorder() { ASSERT_MSG(_device == VK_NULL_HANDLE, "CommandRecorder::Destroy() not called"); }
+
+    CommandRecorder(const CommandRecorder&)            = delete;
+    CommandRecorder& operator=(const CommandRecorder&) = delete;
+
+    //! False (and logs) when a command pool can not be created.
+    bool Init(VkDevice device, const Config& config);
+    //! the GPU must be idle
+    void Destroy();
+
+    //! the frame in flight about to be recorded is complete: resets its pools
+    void BeginFrame();
+
+    //! Records itemCount items into secondary command buffers continuing the
+    //! render pass of inheritance, and executes them into primary. The render
+    //! pass was begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS.
+    void Record(VkCommandBuffer primary, const VkCommandBufferInheritanceInfo& inheritance, uint32_t itemCount,
+        const RecordFunction& record);
+
+    uint32_t threadCount() const { return _threadCount; }
+
+    Stats GetStats() const;
+
+private:
+    //! the command pool of a thread for a frame in flight
+    struct CommandPool {
+        VkCommandPool                pool = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> buffers;
+        uint32_t                     usedCount = 0;   //!< since the reset
+    };
+
+    //! what the threads record, on the stack of Record()
+    struct Job {
+        const VkCommandBufferInheritanceInfo* inheritance   = nullptr;
+        const RecordFunction*                 record        = nullptr;
+        uint32_t                              itemCount     = 0;
+        uint32_t                              itemsPerChunk = 0;
+        VkCommandBuffer*                      chunks        = nullptr;   //!< one per thread
+    };
+
+    //! the thread records the chunk of the same index
+    void            _RecordChunk(const Job& job, uint32_t thread);
+    VkCommandBuffer _GetCommandBuffer(CommandPool& commandPool);
+
+    VkDevice _device = VK_NULL_HANDLE;
+    Config   _config;
+    uint32_t _threadCount = 0;   //!< the workers and the calling thread
+    uint64_t _frame       = 0;
+
+    //! [frame in flight * _threadCount + thread], thread 0 is the calling one
+    std::vector<CommandPool>          _pools;
+    std::unique_ptr<core::ThreadPool> _workers;
+
+    Stats    _stats;
+    uint32_t _frameItemCount     = 0;
+    uint32_t _frameParallelCount = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace vulkan
+}   // namespace gfx
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "core/core.h"
+#include "core/flat_hash_map.h"
+#include "core/small_vector.h"
+#include "gfx/vk_types.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace gfx {
+namespace vulkan {
+////////////////////////////////////////////////////////////////////////////////
+
+//! One descriptor of a set: an image (sampler, view and layout) or a buffer
+//! range, depending on the type.
+struct DescriptorWrite {
+    uint32_t               binding      = 0;
+    uint32_t               arrayElement = 0;
+    VkDescriptorType       type         = VK_DESCRIPTOR_TYPE_MAX_ENUM;
+    VkDescriptorImageInfo  image {};
+    VkDescriptorBufferInfo buffer {};
+
+    static DescriptorWrite Image(uint32_t binding, VkDescriptorType type, VkImageView view,
+        VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VkSampler sampler = VK_NULL_HANDLE);
+    static DescriptorWrite Buffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset = 0,
+        VkDeviceSize range = VK_WHOLE_SIZE);
+};
+
+//! Descriptor sets living for one frame (materials that are not bindless).
+//!
+//! Every frame in flight has its chain of pools, sets are never freed one by
+//! one: the chain is reset at once with vkResetDescriptorPool() when the frame
+//! comes back, and its pools are reused. A pool running out of memory
+//! (VK_ERROR_OUT_OF_POOL_MEMORY) moves the frame to the next pool of the
+//! chain, created twice bigger when none is free.
+//!
+//! Get() caches the sets by content (layout and descriptors) for the frame:
+//! the same material drawn twice writes its descriptors once.
+//!
+//!     allocator.BeginFrame();   // the fence of the frame in flight signaled
+//!     const DescriptorWrite writes[] = {
+//!         DescriptorWrite::Image(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, view, layout, sampler),
+//!         DescriptorWrite::Buffer(1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, buffer, offset, size),
+//!     };
+//!     const VkDescriptorSet set = allocator.Get(setLayout, writes, 2);
+//!
+//! Render thread only.
+class DescriptorAllocator {
+public:
+    //! descriptors of a type per set, to size the pools
+    struct PoolRatio {
+        VkDescriptorType type  = VK_DESCRIPTOR_TYPE_MAX_ENUM;
+        float            ratio = 1.f;
+    };
+
+    struct Config {
+        uint32_t framesInFlight = 2;
+        //! sets of the first pool, the next ones double up to maxSetsPerPool
+        uint32_t setsPerPool    = 64;
+        uint32_t maxSetsPerPool = 4096;
+        //! empty: a typical material (uniform buffers and sampled images)
+        core::SmallVector<PoolRatio, 8> ratios;
+    };
+
+    struct Stats {
+        uint32_t poolCount          = 0;   //!< created
+        uint32_t frameAllocations   = 0;   //!< sets allocated since BeginFrame()
+        uint32_t frameCacheHits     = 0;   //!< Get() returning a set written earlier in the frame
+        uint32_t frameWrites        = 0;   //!< descriptors written since BeginFrame()
+        uint32_t outOfPoolCount     = 0;   //!< allocations moved to a new pool
+        uint32_t allocationFailures = 0;
+    };
+
+    DescriptorAllocator() = default;
+    ~DescriptorAllocator() { ASSERT_MSG(_device == VK_NULL_HANDLE, "DescriptorAllocator::Destroy() not called"); }
+
+    DescriptorAllocator(const DescriptorAllocator&)            = delete;
+    DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+
+    void Init(VkDevice device, const Config& config);
+    //! the GPU must be idle
+    void Destroy();
+
+    //! the frame in flight about to be recorded is complete: resets its pools
+    void BeginFrame();
+
+    //! A set for this frame, not written. VK_NULL_HANDLE (and logs) when the
+    //! device is out of memory.
+    VkDescriptorSet Allocate(VkDescriptorSetLayout layout);
+    //! The set of layout holding these descriptors, written at the first
+    //! request of the frame. Null as Allocate().
+    VkDescriptorSet Get(VkDescriptorSetLayout layout, const DescriptorWrite* writes, size_t writeCount);
+
+    Stats GetStats() const;
+
+private:
+    struct Frame {
+        std::vector<VkDescriptorPool>                pools;   //!< the last one allocates
+        core::FlatHashMap<uint64_t, VkDescriptorSet> sets;    //!< by content
+    };
+
+    VkDescriptorPool _GetPool();
+    VkDescriptorPool _CreatePool(uint32_t setCount);
+
+    VkDevice           _device = VK_NULL_HANDLE;
+    Config             _config;
+    std::vector<Frame> _frames;
+    uint64_t           _frame = 0;
+
+    //! reset, ready for another frame
+    std::vector<VkDescriptorPool> _freePools;
+    uint32_t                      _nextPoolSets = 0;
+
+    Stats _stats;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace vulkan
+}   // namespace gfx
@@ -0,0 +1,174 @@
+#pragma once
+
+#include "core/core.h"
+#include "core/tlsf.h"
+#include "gfx/vk_types.h"
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace gfx {
+namespace vulkan {
+////////////////////////////////////////////////////////////////////////////////
+
+//! Picks the memory type of an allocation.
+enum class MemoryUsage {
+    GpuOnly,    //!< device local: render targets, static buffers and textures
+    Upload,     //!< host visible, written by the CPU: staging, per frame data
+    Readback,   //!< host visible and preferably cached, read by the CPU
+};
+
+//! bufferImageGranularity: linear resources (buffers, linear images) and
+//! optimal images must not share a granularity page.
+enum class ResourceKind {
+    Linear,
+    Optimal,
+};
+
+//! A range of a VkDeviceMemory. Host visible memory is persistently mapped.
+struct MemoryAllocation {
+    VkDeviceMemory memory     = VK_NULL_HANDLE;
+    VkDeviceSize   offset     = 0;
+    VkDeviceSize   size       = 0;
+    VkDeviceSize   alignment  = 1;
+    void*          mapped     = nullptr;   //!< at offset, null when not host visible
+    uint32_t       memoryType = UINT32_MAX;
+    uint32_t       block      = UINT32_MAX;   //!< UINT32_MAX: dedicated VkDeviceMemory
+    uint32_t       node       = UINT32_MAX;
+
+    bool isValid() const { return memory != VK_NULL_HANDLE; }
+    bool isDedicated() const { return block == UINT32_MAX; }
+};
+
+//! Device memory sub-allocator.
+//!
+//! One vkAllocateMemory per resource hits maxMemoryAllocationCount (4096 on
+//! most drivers) long before running out of memory: resources are placed in
+//! large blocks (Config::blockSize, less for small heaps) sub-allocated with a
+//! core::TlsfAllocator. Large images get a dedicated VkDeviceMemory (drivers
+//! may compress them, and they would fragment the blocks).
+//! When bufferImageGranularity is bigger than 1, linear and optimal resources
+//! live in different blocks rather than padding every allocation.
+//!
+//! Transient data is sub-allocated further by its owner: one Upload buffer
+//! with a core::LinearAllocator or core::RingAllocator over it.
+//!
+//! Thread safe. Empty blocks are released, one per memory type and kind is
+//! kept to avoid allocating again on the next frame.
+class DeviceMemoryAllocator {
+public:
+    struct Config {
+        VkDeviceSize blockSize = 64 * 1024 * 1024;
+        //! images at least this big get a dedicated allocation
+        VkDeviceSize dedicatedThreshold = 16 * 1024 * 1024;
+    };
+
+    struct HeapStats {
+        VkDeviceSize heapSize        = 0;
+        bool         deviceLocal     = false;
+        uint32_t     blockCount      = 0;
+        VkDeviceSize blockBytes      = 0;
+        VkDeviceSize usedBytes       = 0;   //!< in blocks
+        uint32_t     allocationCount = 0;   //!< in blocks
+        uint32_t     dedicatedCount  = 0;
+        VkDeviceSize dedicatedBytes  = 0;
+        //! 0: the free bytes of every block are contiguous. 1 - sum(largest free region) / free bytes
+        float fragmentation = 0.f;
+    };
+
+    struct Stats {
+        HeapStats heaps[VK_MAX_MEMORY_HEAPS];
+        uint32_t  heapCount         = 0;
+        uint32_t  deviceMemoryCount = 0;   //!< against maxMemoryAllocationCount
+    };
+
+    //! A defragmentation step: the caller copies allocation's content to
+    //! destination and rebinds its resource.
+    struct Move {
+        MemoryAllocation* allocation = nullptr;
+        MemoryAllocation  destination;
+    };
+
+    DeviceMemoryAllocator() = default;
+    ~DeviceMemoryAllocator() { ASSERT_MSG(_device == VK_NULL_HANDLE, "DeviceMemoryAllocator::Destroy() not called"); }
+
+    DeviceMemoryAllocator(const DeviceMemoryAllocator&)            = delete;
+    DeviceMemoryAllocator& operator=(const DeviceMemoryAllocator&) = delete;
+
+    bool Init(VkPhysicalDevice physicalDevice, VkDevice device, const Config& config);
+    //! every allocation must have been freed
+    void Destroy();
+
+    //! False (and logs) when no memory type fits or the memory is exhausted.
+    bool Allocate(
+        const VkMemoryRequirements& requirements, MemoryUsage usage, ResourceKind kind, MemoryAllocation& allocation);
+    bool AllocateDedicated(const VkMemoryRequirements& requirements, MemoryUsage usage, MemoryAllocation& allocation);
+    void Free(MemoryAllocation& allocation);
+
+    //! allocate and bind
+    bool AllocateForBuffer(VkBuffer buffer, MemoryUsage usage, MemoryAllocation& allocation);
+    bool AllocateForImage(VkImage image, VkImageTiling tiling, MemoryUsage usage, MemoryAllocation& allocation);
+
+    //! CPU writes to memory that is not host coherent, before the submission
+    //! reading them. No-op on coherent memory.
+    void Flush(const MemoryAllocation& allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+    //! GPU writes to memory that is not host coherent, before reading them
+    void Invalidate(const MemoryAllocation& allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+
+    //! Plans moving allocations out of the emptiest blocks into the fuller
+    //! ones, up to maxBytes. The destinations are allocated; sources stay
+    //! valid until EndDefragmentation(), which the caller calls once the GPU
+    //! copies are complete and the resources are bound to the destinations.
+    //! Dedicated allocations never move.
+    void BeginDefragmentation(
+        MemoryAllocation* const* allocations, size_t allocationCount, VkDeviceSize maxBytes, std::vector<Move>& moves);
+    //! frees the sources and updates the allocations to their destination
+    void EndDefragmentation(std::vector<Move>& moves);
+
+    Stats GetStats() const;
+
+    VkDeviceSize bufferImageGranularity() const { return _bufferImageGranularity; }
+
+private:
+    struct Block {
+        VkDeviceMemory      memory     = VK_NULL_HANDLE;
+        void*               mapped     = nullptr;
+        uint32_t            memoryType = UINT32_MAX;
+        ResourceKind        kind       = ResourceKind::Linear;
+        core::TlsfAllocator tlsf;
+    };
+
+    //! UINT32_MAX when none: the best type of memoryTypeBits for usage
+    uint32_t     _FindMemoryType(uint32_t memoryTypeBits, MemoryUsage usage) const;
+    VkDeviceSize _BlockSize(uint32_t memoryType) const;
+    bool         _AllocateDeviceMemory(uint32_t memoryType, VkDeviceSize size, VkDeviceMemory& memory, void*& mapped);
+    void         _FreeDeviceMemory(VkDeviceMemory memory);
+
+    bool _Allocate(const VkMemoryRequirements& requirements, MemoryUsage usage, ResourceKind kind, bool dedicated,
+        MemoryAllocation& allocation);
+    //! sourceBlocks: defragmentation, these blocks are skipped and no block is created
+    bool _AllocateInBlocks(uint32_t memoryType, ResourceKind kind, const VkMemoryRequirements& requirements,
+        const std::vector<bool>* sourceBlocks, MemoryAllocation& allocation);
+    void _FreeInBlock(const MemoryAllocation& allocation);
+    //! whole atoms, as vkFlushMappedMemoryRanges wants them
+    VkMappedMemoryRange _MappedRange(const MemoryAllocation& allocation, VkDeviceSize offset, VkDeviceSize size) const;
+
+    VkDevice                         _device = VK_NULL_HANDLE;
+    Config                           _config;
+    VkPhysicalDeviceMemoryProperties _memoryProperties {};
+    VkDeviceSize                     _bufferImageGranularity   = 1;
+    VkDeviceSize                     _nonCoherentAtomSize      = 1;
+    uint32_t                         _maxMemoryAllocationCount = 4096;
+
+    mutable std::mutex    _mutex;
+    std::vector<Block>    _blocks;   //!< memory == VK_NULL_HANDLE: unused slot
+    std::vector<uint32_t> _unusedBlocks;
+    uint32_t              _deviceMemoryCount = 0;
+    uint32_t              _dedicatedCount[VK_MAX_MEMORY_HEAPS] {};
+    VkDeviceSize          _dedicatedBytes[VK_MAX_MEMORY_HEAPS] {};
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace vulkan
+}   // namespace gfx
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "core/core.h"
+#include "core/inplace_function.h"
+#include "gfx/DeviceMemory.h"
+#include "gfx/vk_types.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace gfx {
+namespace vulkan {
+////////////////////////////////////////////////////////////////////////////////
+
+//! Reads rendered images back to the CPU without waiting for the GPU.
+//!
+//! Every frame in flight copies into its own host visible buffer; the pixels
+//! of a frame are handed to the callback in BeginFrame() of the same frame in
+//! flight, framesInFlight frames later: its fence signaled, the copy is done.
+//!
+//!     readback.BeginFrame();   // the fence of the frame in flight signaled
+//!     // in a transfer pass reading the image as RenderUsage::TransferSrc
+//!     readback.Copy(cmd, image, format, extent);
+//!     ...
+//!     readback.Flush();        // the GPU idle: the frames still in flight
+//!
+//! Formats of 4 bytes per texel only (the RGBA8 and BGRA8 ones, as the
+//! swapchains use). Render thread only, the callback included.
+class FrameReadback {
+public:
+    struct Image {
+        uint64_t       frame  = 0;   //!< BeginFrame() calls when copied
+        const uint8_t* pixels = nullptr;   //!< tightly packed rows, valid during the callback
+        uint32_t       width  = 0;
+        uint32_t       height = 0;
+        VkFormat       format = VK_FORMAT_UNDEFINED;
+    };
+
+    using Callback = core::InplaceFunction<void(const Image&), 32>;
+
+    struct Config {
+        uint32_t framesInFlight = 2;
+    };
+
+    struct Stats {
+        uint64_t     copyCount      = 0;
+        uint64_t     deliveredCount = 0;
+        VkDeviceSize bufferBytes    = 0;   //!< every frame in flight
+    };
+
+    FrameReadback() = default;
+    ~FrameReadback() { ASSERT_MSG(_device == VK_NULL_HANDLE, "FrameReadback::Destroy() not called"); }
+
+    FrameReadback(const FrameReadback&)            = delete;
+    FrameReadback& operator=(const FrameReadback&) = delete;
+
+    //! the buffers are created on the first copies
+    void Init(VkDevice device, DeviceMemoryAllocator& memory, const Config& config, Callback&& callback);
+    //! the GPU must be idle, the frames not delivered are dropped
+    void Destroy();
+
+    //! delivers the copy of the frame in flight, before it is recorded again
+    void BeginFrame();
+    //! image in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, once per frame at most;
+    //! logs and skips the unsupported formats
+    void Copy(VkCommandBuffer cmd, VkImage image, VkFormat format, VkExtent2D extent);
+    //! the GPU must be idle: delivers the copies still in flight, oldest first
+    void Flush();
+
+    Stats GetStats() const { return _stats; }
+
+private:
+    struct Slot {
+        VkBuffer         buffer = VK_NULL_HANDLE;
+        MemoryAllocation memory;
+        VkDeviceSize     size    = 0;
+        bool             pending = false;   //!< copied, not delivered
+        Image            image;
+    };
+
+    void _Deliver(Slot& slot);
+    void _DestroyBuffer(Slot& slot);
+
+    VkDevice               _device = VK_NULL_HANDLE;
+    DeviceMemoryAllocator* _memory = nullptr;
+    Config                 _config;
+    Callback               _callback;
+    uint64_t               _frame = 0;
+    std::vector<Slot>      _slots;   //!< [frame in flight]
+
+    Stats _stats;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace vulkan
+}   // namespace gfx
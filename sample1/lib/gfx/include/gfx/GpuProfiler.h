@@ -0,0 +1,185 @@
+#pragma once
+
+#include "core/core.h"
+#include "core/flat_hash_map.h"
+#include "gfx/vk_types.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace gfx {
+namespace vulkan {
+////////////////////////////////////////////////////////////////////////////////
+
+//! Where the GPU time of the frames goes: timestamp queries around named
+//! zones written into the command buffers, and optionally the pipeline
+//! statistics of the whole frame.
+//!
+//! Every frame in flight has its range of queries. The results of a frame are
+//! read in BeginFrame() of the same frame in flight, framesInFlight frames
+//! later: its fence signaled, they are available and the read never waits.
+//!
+//!     profiler.BeginFrame(cmd);   // first command, the fence of the frame in flight signaled
+//!     {
+//!         GpuProfiler::Scope zone(profiler, cmd, "shadows");
+//!         ...
+//!     }
+//!     profiler.EndFrame(cmd);     // last command
+//!
+//! CPU zones are kept with the frames too, so ExportTrace() writes both on
+//! the same timeline. Render thread only, zones in primary command buffers.
+//! Every call does nothing when Init() failed.
+class GpuProfiler {
+public:
+    static constexpr uint32_t kInvalidZone = UINT32_MAX;
+
+    struct Config {
+        uint32_t framesInFlight = 2;
+        //! per frame, the next ones are dropped
+        uint32_t maxZones = 128;
+        //! VK_QUERY_TYPE_PIPELINE_STATISTICS over the frame: the device has
+        //! pipelineStatisticsQuery, and inheritedQueries for the secondary
+        //! command buffers (their inheritance takes statisticsFlags())
+        bool pipelineStatistics = false;
+        //! complete frames kept for ExportTrace(), more than framesInFlight
+        uint32_t historySize = 240;
+    };
+
+    struct Zone {
+        uint32_t name       = 0;   //!< zoneName()
+        uint32_t depth      = 0;   //!< nesting
+        float    startMs    = 0;   //!< since the start of the frame
+        float    durationMs = 0;
+    };
+
+    struct PipelineStatistics {
+        uint64_t inputAssemblyVertices     = 0;
+        uint64_t inputAssemblyPrimitives   = 0;
+        uint64_t vertexShaderInvocations   = 0;
+        uint64_t clippingInvocations       = 0;
+        uint64_t clippingPrimitives        = 0;
+        uint64_t fragmentShaderInvocations = 0;
+        uint64_t computeShaderInvocations  = 0;
+    };
+
+    struct CpuZone {
+        uint32_t name    = 0;   //!< zoneName()
+        uint32_t depth   = 0;
+        uint64_t startNs = 0;   //!< steady clock
+        uint64_t endNs   = 0;   //!< 0: open
+    };
+
+    struct Frame {
+        uint64_t frame    = 0;
+        bool     complete = false;   //!< the GPU results are in
+        float    gpuMs    = 0;
+        //! the command buffer was recorded: the GPU zones are placed from there
+        uint64_t             endNs = 0;
+        std::vector<Zone>    zones;
+        PipelineStatistics   statistics;
+        std::vector<CpuZone> cpuZones;
+    };
+
+    struct Stats {
+        uint32_t droppedZones  = 0;   //!< over maxZones
+        uint32_t droppedFrames = 0;   //!< results not available in time
+    };
+
+    //! RAII zone
+    class Scope {
+    public:
+        Scope(GpuProfiler& profiler, VkCommandBuffer cmd, const char* name)
+            : _profiler(profiler)
+            , _cmd(cmd)
+            , _zone(profiler.BeginZone(cmd, name))
+        {
+        }
+        ~Scope() { _profiler.EndZone(_cmd, _zone); }
+
+        Scope(const Scope&)            = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        GpuProfiler&    _profiler;
+        VkCommandBuffer _cmd;
+        uint32_t        _zone;
+    };
+
+    GpuProfiler() = default;
+    ~GpuProfiler() { ASSERT_MSG(_device == VK_NULL_HANDLE, "GpuProfiler::Destroy() not called"); }
+
+    GpuProfiler(const GpuProfiler&)            = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+    //! False (and logs) when the queue family has no timestamps.
+    bool Init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamilyIndex, const Config& config);
+    //! the GPU must be idle
+    void Destroy();
+
+    //! Reads the results of the frame in flight, then resets its queries: out
+    //! of a render pass.
+    void BeginFrame(VkCommandBuffer cmd);
+    //! every zone ended, out of a render pass
+    void EndFrame(VkCommandBuffer cmd);
+
+    //! kInvalidZone when there are too many zones in the frame
+    uint32_t BeginZone(VkCommandBuffer cmd, const char* name);
+    void     EndZone(VkCommandBuffer cmd, uint32_t zone);
+
+    //! steady clock, until the next EndFrame()
+    void BeginCpuZone(const char* name);
+    void EndCpuZone();
+
+    //! the newest complete frame, null before the first one
+    const Frame* lastFrame() const;
+    const char*  zoneName(uint32_t name) const { return _names[name].c_str(); }
+    //! for the inheritance of secondary command buffers, 0 without statistics
+    VkQueryPipelineStatisticFlags statisticsFlags() const;
+
+    //! Chrome trace event format (chrome://tracing, Perfetto): the complete
+    //! frames kept, the CPU zones and the GPU ones on two tracks. False (and
+    //! logs) when the file can not be written.
+    bool ExportTrace(const char* path) const;
+
+    Stats GetStats() const { return _stats; }
+
+private:
+    //! queries of a frame in flight: the frame, then begin and end of every zone
+    struct FrameQueries {
+        uint64_t              frame     = 0;   //!< 0: never recorded
+        uint32_t              zoneCount = 0;
+        std::vector<uint32_t> names;
+        std::vector<uint32_t> depths;
+    };
+
+    uint32_t _GetName(const char* name);
+    void     _ReadResults(uint32_t slot);
+    Frame&   _HistoryFrame(uint64_t frame) { return _history[frame % _history.size()]; }
+
+    VkDevice    _device = VK_NULL_HANDLE;
+    Config      _config;
+    VkQueryPool _timestamps      = VK_NULL_HANDLE;
+    VkQueryPool _statistics      = VK_NULL_HANDLE;
+    float       _periodNs        = 1.f;   //!< of a timestamp tick
+    uint64_t    _timestampMask   = ~0ull;
+    uint32_t    _queriesPerFrame = 0;
+
+    uint64_t                  _frame = 0;
+    std::vector<FrameQueries> _frameQueries;   //!< [frame in flight]
+    uint32_t                  _openZones = 0;
+    std::vector<uint64_t>     _results;   //!< readback
+
+    std::vector<Frame>                    _history;   //!< [frame % historySize]
+    uint64_t                              _lastComplete = 0;
+    std::vector<CpuZone>                  _cpuZones;   //!< since the last EndFrame()
+    std::vector<uint32_t>                 _cpuStack;   //!< open CPU zones, in _cpuZones
+    std::vector<std::string>              _names;
+    core::FlatHashMap<uint64_t, uint32_t> _nameIndices;
+
+    Stats _stats;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace vulkan
+}   // namespace gfx
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "core/core.h"
+#include "gfx/DeviceMemory.h"
+#include "gfx/UploadManager.h"
+#include "gfx/VertexLayout.h"
+#include "gfx/vk_types.h"
+#include "mesh/mesh_file.h"
+
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+namespace gfx {
+namespace vulkan {
+////////////////////////////////////////////////////////////////////////////////
+
+struct MeshHandle {
+    uint32_t index = UINT32_MAX;
+
+    bool isValid() const { return index != UINT32_MAX; }
+    bool operator==(const MeshHandle& other) const { return other.index == index; }
+    bool operator!=(const MeshHandle& other) const { return other.index != index; }
+};
+
+//! Indexed meshes in device local memory.
+//!
+//!     mesh = meshes.Create(vertices, vertexCount, indices, indexCount);   // staged, returns right away
+//!     mesh = meshes.Create<Vertex>(meshFile, 0);   // or the streams of a mesh file, as they are
+//!     ...
+//!     meshes.Update();   // once per frame: the meshes whose upload completed can draw
+//!     ...
+//!     meshes.Draw(cmd, mesh);   // bound with a pipeline of the vertex layout of the mesh
+//!
+//! The vertices and the indices of a mesh share one buffer (indices after the
+//! vertices), uploaded through the staging ring of the UploadManager; a mesh
+//! draws nothing until its upload completed. The vertex type has a compile
+//! time layout (see VertexLayout), the pipelines drawing the mesh are created
+//! with GraphicsPipelineDesc::SetVertexLayout() of the same type.
+//! Create(), Destroy() and Update(): render thread, outside of the recording.
+//! Draw(): any thread, the recorder workers included.
+class MeshManager {
+public:
+    struct Config {
+        //! Update() calls before destroyed meshes are no longer in use
+        uint32_t framesInFlight = 2;
+    };
+
+    struct Stats {
+        uint32_t     meshCount     = 0;
+        uint32_t     residentCount = 0;   //!< uploaded, can draw
+        VkDeviceSize vertexBytes   = 0;
+        VkDeviceSize indexBytes    = 0;
+    };
+
+    MeshManager() = default;
+    ~MeshManager() { ASSERT_MSG(_device == VK_NULL_HANDLE, "MeshManager::Destroy() not called"); }
+
+    MeshManager(const MeshManager&)            = delete;
+    MeshManager& operator=(const MeshManager&) = delete;
+
+    void Init(VkDevice device, DeviceMemoryAllocator& memory, UploadManager& uploads, const Config& config);
+    //! the GPU must be idle
+    void Destroy();
+
+    //! IndexT: uint16_t or uint32_t. The data is copied, invalid handle (and
+    //! logs) when the buffer can not be created.
+    template <typename VertexT, typename IndexT>
+    MeshHandle Create(const VertexT* vertices, uint32_t vertexCount, const IndexT* indices, uint32_t indexCount)
+    {
+        static_assert(std::is_same_v<IndexT, uint16_t> || std::is_same_v<IndexT, uint32_t>, "16 or 32 bit indices");
+        // checks the layout of the vertex type at compile time
+        constexpr uint32_t stride = vertexLayout<VertexT>().binding.stride;
+        return _Create(vertices, vertexCount, stride, indices, indexCount,
+            sizeof(IndexT) == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32);
+    }
+    //! A mesh of a mesh file: its streams are the GPU data, they go to the
+    //! staging ring without conversion. Invalid handle (and logs) when the
+    //! vertex layout of the mesh is not the one of VertexT.
+    template <typename VertexT> MeshHandle Create(const mesh::MeshFile& file, uint32_t meshIndex)
+    {
+        constexpr const auto& layout = vertexLayout<VertexT>();
+        return _Create(file, meshIndex, layout.binding.stride, layout.attributes.data(),
+            static_cast<uint32_t>(layout.attributes.size()));
+    }
+    //! destroyed once its upload completed and the frames in flight are done
+    void Destroy(MeshHandle mesh);
+
+    //! Once per frame, before the recording: the meshes whose upload
+    //! completed draw from now on.
+    void Update();
+
+    //! false (nothing drawn) while the mesh uploads
+    bool IsResident(MeshHandle mesh) const;
+    //! binds the buffers of the mesh and draws all its indices
+    void Draw(VkCommandBuffer cmd, MeshHandle mesh, uint32_t instanceCount = 1) const;
+
+    Stats GetStats() const { return _stats; }
+
+private:
+    struct Mesh {
+        VkBuffer         buffer = VK_NULL_HANDLE;
+        MemoryAllocation memory;
+        VkDeviceSize     indexOffset = 0;
+        VkIndexType      indexType   = VK_INDEX_TYPE_UINT32;
+        uint32_t         indexCount  = 0;
+        uint32_t         vertexCount = 0;
+        uint32_t         stride      = 0;
+        UploadToken      upload;
+        bool             resident = false;
+        bool             alive    = false;
+    };
+
+    //! destroyed meshes, waiting for the GPU
+    struct Retired {
+        //! the frame count starts once the upload completed, until then the
+        //! staging copies and ownership transfers still use the buffer
+        UploadToken      upload;
+        uint64_t         frame  = 0;
+        VkBuffer         buffer = VK_NULL_HANDLE;
+        MemoryAllocation memory;
+    };
+
+    MeshHandle _Create(const void* vertices, uint32_t vertexCount, uint32_t stride, const void* indices,
+        uint32_t indexCount, VkIndexType indexType);
+    MeshHandle _Create(const mesh::MeshFile& file, uint32_t meshIndex, uint32_t stride,
+        const VkVertexInputAttributeDescription* attributes, uint32_t attributeCount);
+    void _DestroyRetired(bool all);
+
+    VkDevice               _device  = VK_NULL_HANDLE;
+    DeviceMemoryAllocator* _memory  = nullptr;
+    UploadManager*         _uploads = nullptr;
+    Config                 _config;
+
+    std::vector<Mesh>     _meshes;
+    std::vector<uint32_t> _freeMeshes;
+    std::vector<uint32_t> _uploading;   //!< meshes not resident yet
+
+    uint64_t             _frame = 0;
+    std::vector<Retired> _retired;
+
+    Stats _stats;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace vulkan
+}   // namespace gfx
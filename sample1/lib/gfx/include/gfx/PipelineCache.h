@@ -0,0 +1,76 @@
+#pragma once
+
+#include "core/core.h"
+#include "core/small_vector.h"
+#include "gfx/vk_types.h"
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace gfx {
+namespace vulkan {
+////////////////////////////////////////////////////////////////////////////////
+
+//! VkPipelineCache persisted across runs.
+//!
+//! The file is the driver blob behind a small header (driver version, size,
+//! hash): blobs written by another device/driver, truncated or corrupted are
+//! dropped at load instead of being handed to the driver.
+//! Every thread creating pipelines gets its own cache (no lock contention in
+//! the driver); they are merged into the first one when saving.
+class PipelineCache {
+public:
+    struct Stats {
+        uint64_t loadedBytes = 0;   //!< 0: cold start
+        uint64_t savedBytes  = 0;
+        //! from VK_EXT_pipeline_creation_feedback, "unknown" without it
+        uint32_t hitCount      = 0;
+        uint32_t missCount     = 0;
+        uint32_t unknownCount  = 0;
+        uint64_t hitTimeNs     = 0;
+        uint64_t missTimeNs    = 0;
+        uint64_t unknownTimeNs = 0;
+
+        uint32_t pipelineCount() const { return hitCount + missCount + unknownCount; }
+        uint64_t totalTimeNs() const { return hitTimeNs + missTimeNs + unknownTimeNs; }
+    };
+
+    PipelineCache() = default;
+    ~PipelineCache() { ASSERT_MSG(_caches.empty(), "PipelineCache::Destroy() not called"); }
+
+    PipelineCache(const PipelineCache&)            = delete;
+    PipelineCache& operator=(const PipelineCache&) = delete;
+
+    //! threadCount: number of threads creating pipelines (see get())
+    //! creationFeedback: VK_EXT_pipeline_creation_feedback is enabled on the device
+    bool Init(VkDevice device, VkPhysicalDevice physicalDevice, std::string nativePath, uint32_t threadCount = 1,
+        bool creationFeedback = false);
+    //! merges the thread caches and writes the file (temporary file + rename)
+    bool Save();
+    void Destroy();
+
+    //! the cache of threadIndex, only ever used by that thread
+    VkPipelineCache get(uint32_t threadIndex = 0) const { return _caches[threadIndex]; }
+
+    //! vkCreateGraphicsPipelines through the cache of threadIndex, timed
+    VkPipeline CreateGraphicsPipeline(const VkGraphicsPipelineCreateInfo& createInfo, uint32_t threadIndex = 0);
+
+    Stats GetStats() const;
+
+private:
+    bool _IsCompatible(const uint8_t* data, size_t size) const;
+
+    VkDevice                              _device = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties            _properties {};
+    std::string                           _path;
+    core::SmallVector<VkPipelineCache, 4> _caches;
+    bool                                  _creationFeedback = false;
+
+    mutable std::mutex _statsMutex;
+    Stats              _stats;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace vulkan
+}   // namespace gfx
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "core/core.h"
+#include "core/fixed_vector.h"
+#include "core/flat_hash_map.h"
+#include "gfx/ShaderReflection.h"
+#include "gfx/vk_types.h"
+
+#include <cstdint>
+#include <mutex>
+
+namespace gfx {
+namespace vulkan {
+////////////////////////////////////////////////////////////////////////////////
+
+static constexpr uint32_t kMaxDescriptorSets = 4;
+
+//! The layouts of a pipeline: what descriptor sets get bound with.
+struct PipelineLayoutInfo {
+    VkPipelineLayout                                             layout = VK_NULL_HANDLE;
+    core::FixedVector<VkDescriptorSetLayout, kMaxDescriptorSets> setLayouts;
+};
+
+//! Descriptor set and pipeline layouts built from shader reflection.
+//!
+//! The stages are merged (a binding used by the vertex and the fragment
+//! shaders is visible to both) and every layout is deduplicated by content:
+//! pipelines whose shaders declare the same resources share their
+//! VkPipelineLayout, so binding one after the other keeps the descriptor sets
+//! bound. Layouts live until Destroy().
+class PipelineLayoutCache {
+public:
+    struct Stats {
+        uint32_t requestCount        = 0;
+        uint32_t pipelineLayoutCount = 0;
+        uint32_t setLayoutCount      = 0;
+    };
+
+    PipelineLayoutCache() = default;
+    ~PipelineLayoutCache() { ASSERT_MSG(_device == VK_NULL_HANDLE, "PipelineLayoutCache::Destroy() not called"); }
+
+    PipelineLayoutCache(const PipelineLayoutCache&)            = delete;
+    PipelineLayoutCache& operator=(const PipelineLayoutCache&) = delete;
+
+    void Init(VkDevice device);
+    void Destroy();
+
+    //! Set 0 of every pipeline layout is the bindless table (its bindings in
+    //! the shaders are not reflected, runtime arrays included) and the push
+    //! constants of the shaders are replaced by the range given: all the
+    //! layouts are compatible for set 0. Before the first Get().
+    void SetBindlessLayout(VkDescriptorSetLayout setLayout, const VkPushConstantRange& pushConstants);
+
+    //! Any thread. False (and logs) when the stages disagree on a binding or
+    //! use more than kMaxDescriptorSets sets.
+    bool Get(const ShaderReflection* const* stages, size_t stageCount, PipelineLayoutInfo& info);
+
+    //! bindings of one set, sorted by binding number
+    VkDescriptorSetLayout GetSetLayout(const DescriptorBinding* bindings, size_t bindingCount);
+
+    Stats GetStats() const;
+
+private:
+    VkDescriptorSetLayout _GetSetLayout(const DescriptorBinding* bindings, size_t bindingCount);
+
+    VkDevice _device = VK_NULL_HANDLE;
+
+    mutable std::mutex                                 _mutex;
+    core::FlatHashMap<uint64_t, VkDescriptorSetLayout> _setLayouts;
+    core::FlatHashMap<uint64_t, VkPipelineLayout>      _pipelineLayouts;
+    Stats                                              _stats;
+
+    VkDescriptorSetLayout _bindlessSetLayout = VK_NULL_HANDLE;
+    VkPushConstantRange   _bindlessPushConstants {};
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace vulkan
+}   // namespace gfx
@@ -0,0 +1,187 @@
+#pragma once
+
+#include "core/core.h"
+#include "core/fixed_vector.h"
+#include "core/flat_hash_map.h"
+#include "core/small_vector.h"
+#include "core/thread_pool.h"
+#include "core/vfs.h"
+#include "gfx/PipelineCache.h"
+#include "gfx/VertexLayout.h"
+#include "gfx/vk_types.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace gfx {
+namespace vulkan {
+////////////////////////////////////////////////////////////////////////////////
+
+static constexpr size_t kMaxColorAttachments = 4;
+static constexpr size_t kMaxVertexBindings   = 4;
+static constexpr size_t kMaxVertexAttributes = 16;
+
+//! What makes two render passes compatible (formats and sample counts): a
+//! pipeline built for one can be used with the other.
+struct RenderPassLayout {
+    core::FixedVector<VkFormat, kMaxColorAttachments> colorFormats;
+    VkFormat                                          depthFormat = VK_FORMAT_UNDEFINED;
+    VkSampleCountFlagBits                             samples     = VK_SAMPLE_COUNT_1_BIT;
+};
+
+struct BlendState {
+    bool                  enable         = false;
+    VkBlendFactor         srcColorFactor = VK_BLEND_FACTOR_ONE;
+    VkBlendFactor         dstColorFactor = VK_BLEND_FACTOR_ZERO;
+    VkBlendOp             colorOp        = VK_BLEND_OP_ADD;
+    VkBlendFactor         srcAlphaFactor = VK_BLEND_FACTOR_ONE;
+    VkBlendFactor         dstAlphaFactor = VK_BLEND_FACTOR_ZERO;
+    VkBlendOp             alphaOp        = VK_BLEND_OP_ADD;
+    VkColorComponentFlags writeMask      = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT
+                                    | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+};
+
+//! The full state of a graphics pipeline. Viewport and scissor are dynamic.
+struct GraphicsPipelineDesc {
+    core::vfs::FileHandle vertexShader;     //!< SPIR-V, entry point "main"
+    core::vfs::FileHandle fragmentShader;   //!< SPIR-V, entry point "main"
+
+    core::FixedVector<VkVertexInputBindingDescription, kMaxVertexBindings>     vertexBindings;
+    core::FixedVector<VkVertexInputAttributeDescription, kMaxVertexAttributes> vertexAttributes;
+
+    VkPrimitiveTopology topology     = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    VkPolygonMode       polygonMode  = VK_POLYGON_MODE_FILL;
+    VkCullModeFlags     cullMode     = VK_CULL_MODE_BACK_BIT;
+    VkFrontFace         frontFace    = VK_FRONT_FACE_CLOCKWISE;
+    bool                depthTest    = false;
+    bool                depthWrite   = false;
+    VkCompareOp         depthCompare = VK_COMPARE_OP_LESS_OR_EQUAL;
+
+    //! one per color attachment
+    core::FixedVector<BlendState, kMaxColorAttachments> blendStates;
+    RenderPassLayout                                    renderPassLayout;
+
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+
+    //! a render pass compatible with renderPassLayout, VK_NULL_HANDLE: dynamic
+    //! rendering (VK_KHR_dynamic_rendering) with the formats of renderPassLayout
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    uint32_t     subpass    = 0;
+
+    //! identifies the pipeline: shader code (not the file names), states,
+    //! layout, render pass and attachment formats
+    uint64_t Hash() const;
+    //! what Hash() covers, compared in full
+    bool operator==(const GraphicsPipelineDesc& other) const;
+    bool operator!=(const GraphicsPipelineDesc& other) const { return !(*this == other); }
+
+    //! binding 0 and its attributes, copied from the compile time layout of
+    //! VertexT (see VertexLayout)
+    template <typename VertexT> void SetVertexLayout()
+    {
+        constexpr const auto& layout = vertexLayout<VertexT>();
+        static_assert(layout.attributes.size() <= kMaxVertexAttributes, "too many vertex attributes");
+        vertexBindings.clear();
+        vertexBindings.push_back(layout.binding);
+        vertexAttributes.assign(layout.attributes.begin(), layout.attributes.end());
+    }
+};
+
+struct PipelineHandle {
+    uint32_t index = UINT32_MAX;
+
+    bool isValid() const { return index != UINT32_MAX; }
+    bool operator==(const PipelineHandle& other) const { return other.index == index; }
+    bool operator!=(const PipelineHandle& other) const { return other.index != index; }
+};
+
+enum class PipelineStatus : uint8_t { Pending, Ready, Failed };
+
+//! Compiles pipelines on worker threads.
+//!
+//!     handle = pipelineService.Request(std::move(desc));   // returns right away
+//!     ...
+//!     VkPipeline pipeline = pipelineService.Get(handle, fallbackPipeline);
+//!
+//! Requests are keyed by GraphicsPipelineDesc::Hash(), the descriptions are
+//! compared on a hash hit: asking again for a pipeline already requested (same
+//! shaders, states and render pass) returns the same handle. Pipelines live
+//! until Shutdown().
+class PipelineService {
+public:
+    struct Config {
+        uint32_t threadCount = 2;
+        //! worker i creates its pipelines through pipelineCache.get(firstCacheThread + i)
+        uint32_t firstCacheThread = 0;
+    };
+
+    struct Stats {
+        uint32_t requestCount   = 0;
+        uint32_t dedupCount     = 0;   //!< requests answered with an existing handle
+        uint32_t compiledCount  = 0;
+        uint32_t failedCount    = 0;
+        uint32_t queuedCount    = 0;   //!< waiting for a worker
+        uint32_t compilingCount = 0;
+        uint32_t maxQueuedCount = 0;
+        uint64_t latencyNs      = 0;   //!< request to ready, summed
+        uint64_t maxLatencyNs   = 0;
+
+        double averageLatencyMs() const
+        {
+            const uint32_t count = compiledCount + failedCount;
+            return count != 0 ? latencyNs * 1e-6 / count : 0.0;
+        }
+    };
+
+    PipelineService() = default;
+    ~PipelineService() { ASSERT_MSG(!_workers, "PipelineService::Shutdown() not called"); }
+
+    PipelineService(const PipelineService&)            = delete;
+    PipelineService& operator=(const PipelineService&) = delete;
+
+    bool Init(VkDevice device, PipelineCache& pipelineCache, const Config& config);
+    //! waits for the compilations in progress and destroys every pipeline
+    void Shutdown();
+
+    //! any thread
+    PipelineHandle Request(GraphicsPipelineDesc&& desc);
+
+    PipelineStatus status(PipelineHandle handle) const;
+    //! the pipeline when ready, fallback otherwise (pending or failed)
+    VkPipeline Get(PipelineHandle handle, VkPipeline fallback = VK_NULL_HANDLE) const;
+    //! blocks until compiled, VK_NULL_HANDLE on failure (do not call from a worker)
+    VkPipeline Wait(PipelineHandle handle) const;
+
+    Stats GetStats() const;
+
+private:
+    struct Entry {
+        GraphicsPipelineDesc desc;   //!< kept for the comparison of later requests
+        VkPipeline           pipeline     = VK_NULL_HANDLE;
+        PipelineStatus       status       = PipelineStatus::Pending;
+        uint64_t             requestNs    = 0;
+        uint32_t             nextSameHash = UINT32_MAX;   //!< another desc with the same Hash()
+    };
+
+    void       _Compile(Entry& entry);
+    VkPipeline _Create(const GraphicsPipelineDesc& desc, uint32_t cacheThread) const;
+
+    VkDevice       _device        = VK_NULL_HANDLE;
+    PipelineCache* _pipelineCache = nullptr;
+
+    mutable std::mutex                    _mutex;
+    mutable std::condition_variable       _compiled;
+    std::vector<std::unique_ptr<Entry>>   _entries;
+    core::FlatHashMap<uint64_t, uint32_t> _entryByKey;   //!< the first entry of each Hash()
+    core::SmallVector<uint32_t, 8>        _freeCacheThreads;
+    Stats                                 _stats;
+
+    std::unique_ptr<core::ThreadPool> _workers;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace vulkan
+}   // namespace gfx
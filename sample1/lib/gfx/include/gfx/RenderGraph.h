@@ -0,0 +1,324 @@
+#pragma once
+
+#include "core/core.h"
+#include "core/flat_hash_map.h"
+#include "core/inplace_function.h"
+#include "core/small_vector.h"
+#include "gfx/DeviceMemory.h"
+#include "gfx/vk_types.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace gfx {
+namespace vulkan {
+////////////////////////////////////////////////////////////////////////////////
+
+class GpuProfiler;
+
+//! An image of the render graph, valid until the next RenderGraph::Reset().
+struct RenderResource {
+    uint32_t index = UINT32_MAX;
+
+    bool isValid() const { return index != UINT32_MAX; }
+};
+
+//! How a pass uses an image: gives the layout, the stages and the accesses.
+enum class RenderUsage : uint8_t {
+    ColorAttachment,   //!< write
+    DepthAttachment,   //!< write, the depth test reads too
+    DepthRead,         //!< read only depth test
+    Sampled,           //!< read by the shaders
+    StorageRead,
+    StorageWrite,
+    TransferSrc,
+    TransferDst,
+};
+
+enum class RenderPassType : uint8_t {
+    Graphics,   //!< runs in a render pass made of its attachments
+    Compute,
+    Transfer,
+};
+
+//! What a write does with the previous content
+enum class LoadOp : uint8_t {
+    Load,       //!< kept (partial write): the passes writing it before are needed
+    Clear,      //!< attachments only
+    DontCare,   //!< the pass overwrites everything
+};
+
+//! Transient image: created by the graph, its memory is shared with the
+//! transient images whose lifetime does not overlap its own.
+struct RenderTextureDesc {
+    VkFormat              format  = VK_FORMAT_UNDEFINED;
+    uint32_t              width   = 0;
+    uint32_t              height  = 0;
+    VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+};
+
+//! Image living outside of the graph (swapchain image, persistent target).
+//! Imported images are outputs: the passes writing them are never culled.
+struct RenderImport {
+    VkImage               image   = VK_NULL_HANDLE;
+    VkImageView           view    = VK_NULL_HANDLE;
+    VkFormat              format  = VK_FORMAT_UNDEFINED;
+    uint32_t              width   = 0;
+    uint32_t              height  = 0;
+    VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+    //! state before the graph, the stages chain with a semaphore wait
+    VkImageLayout        initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkPipelineStageFlags initialStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    VkAccessFlags        initialAccess = 0;
+    //! state after the graph, VK_IMAGE_LAYOUT_UNDEFINED keeps the last layout
+    VkImageLayout        finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkPipelineStageFlags finalStages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+    VkAccessFlags        finalAccess = 0;
+};
+
+//! Frame graph: rebuilt every frame, passes declare the images they read and
+//! write and the graph
+//! - culls the passes whose results are not used,
+//! - records the pipeline barriers and layout transitions between them, one
+//!   vkCmdPipelineBarrier per pass at most,
+//! - creates the transient images, placed in one allocation where images
+//!   whose lifetimes do not overlap share memory,
+//! - creates the render passes and framebuffers of the graphics passes, or
+//!   begins them with vkCmdBeginRenderingKHR (Config::dynamicRendering): no
+//!   render pass nor framebuffer object, the views are given directly.
+//!
+//!     graph.Reset();
+//!     const RenderResource backBuffer = graph.Import("back buffer", import);
+//!     RenderGraph::PassBuilder pass   = graph.AddPass("main", RenderPassType::Graphics, [](VkCommandBuffer cmd) {});
+//!     pass.Write(backBuffer, RenderUsage::ColorAttachment, LoadOp::Clear, clearValue);
+//!     graph.Compile();
+//!     graph.Execute(cmd);
+//!
+//! Passes execute in declaration order. The transient images and the
+//! framebuffers are kept from one frame to the next while the graph keeps its
+//! shape, replaced ones are destroyed once the frames in flight are done.
+//! Render thread only.
+class RenderGraph {
+public:
+    using ExecuteFunction = core::InplaceFunction<void(VkCommandBuffer), 64>;
+
+    struct Config {
+        //! Compile() calls before retired resources are no longer in use
+        uint32_t framesInFlight = 2;
+        //! VK_KHR_dynamic_rendering enabled on the device: the pipelines of
+        //! the graphics passes are created with the formats of their
+        //! attachments (VkPipelineRenderingCreateInfoKHR), no render pass
+        bool dynamicRendering = false;
+    };
+
+    struct Stats {
+        uint32_t     passCount         = 0;
+        uint32_t     culledPassCount   = 0;
+        uint32_t     barrierCount      = 0;   //!< image barriers
+        uint32_t     barrierBatchCount = 0;   //!< vkCmdPipelineBarrier
+        uint32_t     transientCount    = 0;
+        VkDeviceSize transientBytes    = 0;   //!< memory of the transient images, aliased
+        VkDeviceSize unaliasedBytes    = 0;   //!< memory they would need without aliasing
+        uint32_t     rebuildCount      = 0;   //!< times the transient images were created again
+        uint32_t     framebufferCount  = 0;   //!< kept, none with dynamic rendering
+    };
+
+    //! Declares what a pass uses, in the order it uses it.
+    class PassBuilder {
+    public:
+        RenderResource CreateTexture(const char* name, const RenderTextureDesc& desc);
+        //! clear: for LoadOp::Clear
+        void Write(
+            RenderResource resource, RenderUsage usage, LoadOp loadOp = LoadOp::Load, const VkClearValue& clear = {});
+        void Read(RenderResource resource, RenderUsage usage);
+        //! never culled: writes something outside of the graph
+        void SideEffect();
+        //! Graphics pass recorded in secondary command buffers (see
+        //! CommandRecorder): its render pass is begun with
+        //! VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS, the execute function
+        //! only calls vkCmdExecuteCommands() with buffers inheriting
+        //! inheritanceInfo().
+        void SecondaryCommandBuffers();
+        //! Graphics pass begun with a render pass and a framebuffer even with
+        //! Config::dynamicRendering: its pipelines were created against a
+        //! render pass compatible with its attachments (a library's).
+        void UseRenderPass();
+
+    private:
+        friend class RenderGraph;
+        PassBuilder(RenderGraph& graph, uint32_t pass)
+            : _graph(graph)
+            , _pass(pass)
+        {
+        }
+
+        RenderGraph& _graph;
+        uint32_t     _pass;
+    };
+
+    RenderGraph() = default;
+    ~RenderGraph() { ASSERT_MSG(_device == VK_NULL_HANDLE, "RenderGraph::Destroy() not called"); }
+
+    RenderGraph(const RenderGraph&)            = delete;
+    RenderGraph& operator=(const RenderGraph&) = delete;
+
+    void Init(VkDevice device, DeviceMemoryAllocator& memory, const Config& config);
+    //! the GPU must be idle
+    void Destroy();
+
+    //! starts the graph of a new frame
+    void Reset();
+    RenderResource Import(const char* name, const RenderImport& image);
+    PassBuilder    AddPass(const char* name, RenderPassType type, ExecuteFunction&& execute);
+
+    //! False (and logs) when the transient images can not be created.
+    bool Compile();
+    //! the execute functions of the passes, with their barriers; profiler: a
+    //! zone per pass, named after it
+    void Execute(VkCommandBuffer cmd, GpuProfiler* profiler = nullptr);
+
+    //! for the execute functions, null for a culled resource
+    VkImage     GetImage(RenderResource resource) const;
+    VkImageView GetView(RenderResource resource) const;
+    //! for the execute function of a graphics pass: its render pass and
+    //! framebuffer, or the formats of its attachments in pNext with dynamic
+    //! rendering (VkCommandBufferInheritanceRenderingInfoKHR)
+    const VkCommandBufferInheritanceInfo& inheritanceInfo() const { return _inheritance; }
+
+    //! The views of imported images were destroyed (swapchain recreation):
+    //! a new view may reuse a handle, the framebuffers are created again.
+    //! Nothing to do with dynamic rendering but for the UseRenderPass() passes.
+    void InvalidateFramebuffers();
+
+    //! Graphviz graph of the last Compile(): passes, images, lifetimes and
+    //! memory placement, with the aliasing savings.
+    std::string Dump() const;
+
+    Stats GetStats() const { return _stats; }
+
+private:
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    struct Access {
+        uint32_t     resource = kNone;
+        RenderUsage  usage    = RenderUsage::Sampled;
+        LoadOp       loadOp   = LoadOp::Load;
+        bool         write    = false;
+        VkClearValue clear    = {};
+    };
+
+    struct Pass {
+        std::string                  name;
+        RenderPassType               type = RenderPassType::Graphics;
+        ExecuteFunction              execute;
+        core::SmallVector<Access, 8> accesses;
+        bool                         sideEffect    = false;
+        bool                         secondary     = false;
+        bool                         useRenderPass = false;
+        bool                         alive         = false;
+        // compiled
+        uint32_t             firstBarrier = 0;
+        uint32_t             barrierCount = 0;
+        VkPipelineStageFlags srcStages    = 0;
+        VkPipelineStageFlags dstStages    = 0;
+        bool                 rendering    = false;            //!< has attachments
+        VkRenderPass         renderPass   = VK_NULL_HANDLE;   //!< null with dynamic rendering
+        VkFramebuffer        framebuffer  = VK_NULL_HANDLE;
+        VkExtent2D           extent       = {};
+    };
+
+    struct Resource {
+        std::string       name;
+        RenderTextureDesc desc;
+        bool              imported = false;
+        RenderImport      import;
+        // compiled
+        VkImageUsageFlags usage     = 0;
+        uint32_t          firstPass = kNone;   //!< lifetime, in passes alive
+        uint32_t          lastPass  = kNone;
+        uint32_t          transient = kNone;   //!< in _transients
+        VkImage           image     = VK_NULL_HANDLE;
+        VkImageView       view      = VK_NULL_HANDLE;
+    };
+
+    struct Transient {
+        VkImage      image  = VK_NULL_HANDLE;
+        VkImageView  view   = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;   //!< in _transientMemory
+        VkDeviceSize size   = 0;
+    };
+
+    //! resources no longer used by the graph, waiting for the GPU
+    struct Retired {
+        uint64_t                   frame = 0;
+        std::vector<VkImage>       images;
+        std::vector<VkImageView>   views;
+        std::vector<VkFramebuffer> framebuffers;
+        MemoryAllocation           memory;
+    };
+
+    void _Cull();
+    void _ComputeLifetimes();
+    bool _CreateTransients();
+    //! transients: resource of each transient
+    void _PlaceTransients(const std::vector<uint32_t>& transients,
+        const std::vector<VkMemoryRequirements>& requirements, VkDeviceSize& heapSize);
+    void _ComputeBarriers();
+    bool _CreateRenderPasses();
+    //! position: in the passes alive
+    VkRenderPass  _GetRenderPass(const Pass& pass, uint32_t position);
+    VkFramebuffer _GetFramebuffer(Pass& pass, VkRenderPass renderPass);
+    //! the content of the attachment is kept after the pass
+    bool _Store(const Resource& resource, uint32_t position) const;
+    void _BeginRenderPass(VkCommandBuffer cmd, const Pass& pass);
+    void _BeginRendering(VkCommandBuffer cmd, const Pass& pass, uint32_t position);
+    void _RetireTransients(Retired& retired);
+    void _DestroyRetired(bool all);
+
+    VkDevice               _device = VK_NULL_HANDLE;
+    DeviceMemoryAllocator* _memory = nullptr;
+    Config                 _config;
+
+    std::vector<Pass>     _passes;
+    std::vector<Resource> _resources;
+    std::vector<uint32_t> _alivePasses;
+    bool                  _compiled = false;
+
+    std::vector<VkImageMemoryBarrier> _barriers;
+    //! transitions of the imported images to their final layout
+    uint32_t             _finalBarrierCount = 0;
+    VkPipelineStageFlags _finalSrcStages    = 0;
+    VkPipelineStageFlags _finalDstStages    = 0;
+
+    //! last uses of the transient memory by the previous frame, the first
+    //! uses of the next frame wait for them
+    VkPipelineStageFlags _transientLastStages = 0;
+    VkAccessFlags        _transientLastAccess = 0;
+
+    //! transient images, kept while the graph keeps its shape
+    uint64_t               _transientHash = 0;
+    std::vector<Transient> _transients;
+    MemoryAllocation       _transientMemory;
+    VkDeviceSize           _transientHeapSize = 0;
+
+    core::FlatHashMap<uint64_t, VkRenderPass>  _renderPasses;
+    core::FlatHashMap<uint64_t, VkFramebuffer> _framebuffers;
+    //! of the graphics pass executing
+    VkCommandBufferInheritanceInfo             _inheritance {};
+    VkCommandBufferInheritanceRenderingInfoKHR _inheritanceRendering {};
+    core::SmallVector<VkFormat, 8>             _inheritanceFormats;
+
+    //! VK_KHR_dynamic_rendering, loaded by Init()
+    PFN_vkCmdBeginRenderingKHR _cmdBeginRendering = nullptr;
+    PFN_vkCmdEndRenderingKHR   _cmdEndRendering   = nullptr;
+
+    uint64_t             _frame = 0;
+    std::vector<Retired> _retired;
+
+    Stats _stats;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace vulkan
+}   // namespace gfx
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "core/core.h"
+#include "core/vfs.h"
+#include "gfx/vk_types.h"
+
+namespace gfx {
+namespace vulkan {
+////////////////////////////////////////////////////////////////////////////////
+
+//! code is read in place: vfs files are at least 4 bytes aligned as SPIR-V requires
+inline VkShaderModule
+createShaderModule(VkDevice device, const core::vfs::FileHandle& code)
+{
+    if (code.size() == 0 || code.size() % sizeof(uint32_t) != 0) {
+        LOG_ERROR("Invalid SPIR-V size: %zu bytes", code.size());
+        return VK_NULL_HANDLE;
+    }
+
+    VkShaderModuleCreateInfo createInfo {};
+    createInfo.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = code.size();
+    createInfo.pCode    = code.dataAs<uint32_t>();
+
+    VkShaderModule shaderModule = VK_NULL_HANDLE;
+    if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+        LOG_ERROR("Failed to create shader module");
+        return VK_NULL_HANDLE;
+    }
+
+    return shaderModule;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace vulkan
+}   // namespace gfx
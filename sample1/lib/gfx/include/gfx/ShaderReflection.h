@@ -0,0 +1,53 @@
+#pragma once
+
+#include "core/core.h"
+#include "core/small_vector.h"
+#include "core/vfs.h"
+#include "gfx/vk_types.h"
+
+#include <cstdint>
+
+namespace gfx {
+namespace vulkan {
+////////////////////////////////////////////////////////////////////////////////
+
+struct DescriptorBinding {
+    uint32_t           set     = 0;
+    uint32_t           binding = 0;
+    VkDescriptorType   type    = VK_DESCRIPTOR_TYPE_MAX_ENUM;
+    uint32_t           count   = 1;   //!< array size, 0 for runtime arrays
+    VkShaderStageFlags stages  = 0;
+};
+
+struct VertexInput {
+    uint32_t location = 0;
+    VkFormat format   = VK_FORMAT_UNDEFINED;
+};
+
+struct SpecializationConstant {
+    uint32_t id   = 0;   //!< constant_id
+    uint32_t size = 0;   //!< bytes: 4 (bools are VkBool32) or 8
+};
+
+//! What a pipeline needs to know about one shader stage.
+struct ShaderReflection {
+    VkShaderStageFlagBits stage = VK_SHADER_STAGE_ALL;
+
+    //! sorted by set then binding, stages is the stage above
+    core::SmallVector<DescriptorBinding, 16> descriptorBindings;
+    //! size 0 when the stage has no push constants
+    VkPushConstantRange pushConstants {};
+    //! vertex stage only, built-ins excluded, sorted by location (a matrix takes one per column)
+    core::SmallVector<VertexInput, 16> vertexInputs;
+    //! sorted by id
+    core::SmallVector<SpecializationConstant, 8> specializationConstants;
+};
+
+//! Parses SPIR-V as given to createShaderModule() (no external tooling): the
+//! "main" entry point and every resource declared by the module. False and
+//! logs on malformed code or unsupported declarations.
+bool reflectShader(const core::vfs::FileHandle& code, ShaderReflection& reflection);
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace vulkan
+}   // namespace gfx
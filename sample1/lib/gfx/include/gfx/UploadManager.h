@@ -0,0 +1,228 @@
+#pragma once
+
+#include "core/core.h"
+#include "core/fixed_vector.h"
+#include "core/inplace_function.h"
+#include "core/ring_allocator.h"
+#include "gfx/DeviceMemory.h"
+#include "gfx/vk_types.h"
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace gfx {
+namespace vulkan {
+////////////////////////////////////////////////////////////////////////////////
+
+//! Identifies an upload: complete once the GPU has executed its copies.
+//! Uploads complete in order, a token covers every upload made before it.
+struct UploadToken {
+    uint64_t value = 0;
+
+    bool isValid() const { return value != 0; }
+};
+
+//! Destination of an image upload: one 2D subresource, tightly packed rows.
+struct ImageUpload {
+    VkImage            image         = VK_NULL_HANDLE;
+    VkImageAspectFlags aspect        = VK_IMAGE_ASPECT_COLOR_BIT;
+    uint32_t           mipLevel      = 0;
+    uint32_t           arrayLayer    = 0;
+    uint32_t           width         = 0;
+    uint32_t           height        = 0;
+    uint32_t           bytesPerTexel = 4;
+    //! the image is in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL until the upload completes
+    VkImageLayout finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+};
+
+//! Asynchronous uploads through a persistently mapped staging ring.
+//!
+//! Data is copied into the ring right away when it fits the frame budget,
+//! the copy commands are batched and submitted once per frame by Flush(),
+//! and the ring space of a batch is reclaimed when it completes: the CPU
+//! never waits for the GPU, unless all the batches are in flight.
+//! Uploads bigger than the frame budget (Config::frameBudget) are split
+//! across frames; what waits for a later frame is copied aside, so the
+//! caller's data never has to outlive the call.
+//!
+//! On the graphics queue, the queue executes the batches before anything
+//! submitted after Flush(): the batches end with a transfer to all commands
+//! barrier.
+//! On a dedicated transfer queue, the copies overlap with rendering. The
+//! batches signal a timeline semaphore and release the ownership of the
+//! resources they write; every frame, the graphics queue waits for the
+//! semaphore (GetQueueWait()) and acquires them (RecordAcquireBarriers()).
+//! Resources are expected to be VK_SHARING_MODE_EXCLUSIVE.
+//! Render thread only.
+class UploadManager {
+public:
+    struct Config {
+        VkDeviceSize ringSize    = 32 * 1024 * 1024;
+        VkDeviceSize frameBudget = 8 * 1024 * 1024;
+    };
+
+    struct Queues {
+        //! executes the uploads
+        VkQueue  transfer       = VK_NULL_HANDLE;
+        uint32_t transferFamily = 0;
+        //! uses the uploaded resources, the same family for a single queue
+        uint32_t graphicsFamily = 0;
+        //! VK_KHR_timeline_semaphore is enabled, required by a dedicated
+        //! transfer family
+        bool timelineSemaphore = false;
+        //! minImageTransferGranularity of the transfer family: images are
+        //! split by rows, it must be (1, 1, 1) as on the graphics families
+        VkExtent3D imageGranularity = {1, 1, 1};
+
+        bool isDedicated() const { return transferFamily != graphicsFamily; }
+    };
+
+    //! what the graphics queue submission waits for, no semaphore when the
+    //! uploads run on the graphics queue
+    struct QueueWait {
+        VkSemaphore          semaphore = VK_NULL_HANDLE;
+        uint64_t             value     = 0;
+        VkPipelineStageFlags stages    = 0;
+    };
+
+    struct Stats {
+        uint64_t     uploadCount     = 0;
+        uint64_t     completedCount  = 0;
+        VkDeviceSize frameBytes      = 0;   //!< staged by the last Flush()
+        VkDeviceSize pendingBytes    = 0;   //!< waiting for a later frame
+        VkDeviceSize ringUsedBytes   = 0;
+        uint32_t     batchesInFlight = 0;
+        uint32_t     stallCount      = 0;   //!< had to wait for a batch to record
+        bool         dedicatedQueue  = false;
+    };
+
+    //! staging space offset, aligned for any texel size up to 16 bytes
+    static constexpr VkDeviceSize kStagingAlignment = 16;
+    static constexpr uint32_t     kMaxBatches       = 8;
+    //! graphics stages that read uploaded resources: they wait for the
+    //! transfer queue, the rest of the frame overlaps with it
+    static constexpr VkPipelineStageFlags kConsumerStages = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT
+        | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT
+        | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+    UploadManager() = default;
+    ~UploadManager() { ASSERT_MSG(_device == VK_NULL_HANDLE, "UploadManager::Destroy() not called"); }
+
+    UploadManager(const UploadManager&)            = delete;
+    UploadManager& operator=(const UploadManager&) = delete;
+
+    bool Init(VkDevice device, DeviceMemoryAllocator& memory, const Queues& queues, const Config& config);
+    //! waits for the batches in flight
+    void Destroy();
+
+    UploadToken UploadBuffer(VkBuffer buffer, VkDeviceSize offset, const void* data, VkDeviceSize size);
+    //! data: height rows of width * bytesPerTexel bytes
+    UploadToken UploadImage(const ImageUpload& image, const void* data);
+    //! any transfer commands, ordered with the uploads: recorded once every
+    //! upload made before has been. On a dedicated transfer queue, only
+    //! transfer stages are available and the commands own their barriers.
+    UploadToken Record(core::InplaceFunction<void(VkCommandBuffer)>&& commands);
+
+    //! Once per frame, before the frame's submission: submits the copies
+    //! recorded since the last call, staging pending uploads up to the
+    //! frame budget.
+    void Flush();
+
+    //! Dedicated transfer queue: the wait of the next graphics submission,
+    //! covers every batch submitted
+    QueueWait GetQueueWait() const;
+    //! Dedicated transfer queue: acquires the resources released by the
+    //! batches submitted, outside of a render pass, in a command buffer of the
+    //! submission waiting for GetQueueWait(). Once per frame, after Flush().
+    void RecordAcquireBarriers(VkCommandBuffer cmd);
+
+    bool IsComplete(UploadToken token);
+    //! flushes if needed: blocks until the upload has been executed
+    void Wait(UploadToken token);
+
+    Stats GetStats() const;
+
+private:
+    struct Batch {
+        VkCommandPool   commandPool   = VK_NULL_HANDLE;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkFence         fence         = VK_NULL_HANDLE;   //!< without timeline semaphore
+        uint64_t        timelineValue = 0;   //!< signaled on completion
+        uint64_t        ringMarker    = 0;   //!< ring head at submission
+        uint64_t        lastUpload    = 0;   //!< complete when the fence signals
+        bool            inFlight      = false;
+    };
+
+    //! what is left of an upload, waiting for a later frame
+    struct PendingUpload {
+        uint64_t token = 0;
+        //! buffer upload: data goes to offset
+        VkBuffer     buffer = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize done   = 0;
+        //! image upload: data starts at firstRow
+        ImageUpload image;
+        uint32_t    firstRow = 0;
+        uint32_t    row      = 0;
+        //! Record()
+        core::InplaceFunction<void(VkCommandBuffer)> commands;
+
+        std::vector<uint8_t> data;
+    };
+
+    VkCommandBuffer _CommandBuffer();
+    //! Stage as much as the frame budget and the ring allow, true once done.
+    //! done: bytes of data staged.
+    bool _StageBuffer(VkBuffer buffer, VkDeviceSize offset, const uint8_t* data, VkDeviceSize size, VkDeviceSize& done);
+    //! row: next row to stage, data starts at firstRow
+    bool _StageImage(const ImageUpload& image, const uint8_t* data, uint32_t firstRow, uint32_t& row);
+    void _ProcessPending();
+    //! dedicated transfer queue: hands the written range over to the graphics family
+    void _ReleaseBuffer(VkCommandBuffer cmd, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size);
+    void _ReleaseImage(VkCommandBuffer cmd, const VkImageMemoryBarrier& barrier);
+    void _Submit();
+    void _Reclaim();
+    //! waits for the oldest batch in flight, false when none is
+    bool _WaitOldestBatch();
+    void _CompleteBatch(Batch& batch);
+
+    VkDevice               _device = VK_NULL_HANDLE;
+    DeviceMemoryAllocator* _memory = nullptr;
+    Queues                 _queues;
+    Config                 _config;
+
+    //! VK_KHR_timeline_semaphore: one value per batch submitted
+    VkSemaphore                       _timeline                 = VK_NULL_HANDLE;
+    uint64_t                          _timelineValue            = 0;
+    PFN_vkGetSemaphoreCounterValueKHR _getSemaphoreCounterValue = nullptr;
+    PFN_vkWaitSemaphoresKHR           _waitSemaphores           = nullptr;
+
+    //! ownership transfers: released by the batch being recorded, then to be
+    //! acquired by the graphics queue once it is submitted
+    std::vector<VkBufferMemoryBarrier> _releasedBuffers;
+    std::vector<VkImageMemoryBarrier>  _releasedImages;
+    std::vector<VkBufferMemoryBarrier> _acquireBuffers;
+    std::vector<VkImageMemoryBarrier>  _acquireImages;
+
+    VkBuffer            _stagingBuffer = VK_NULL_HANDLE;
+    MemoryAllocation    _stagingMemory;
+    core::RingAllocator _ring;
+
+    core::FixedVector<Batch, kMaxBatches> _batches;
+    uint32_t                              _currentBatch = 0;
+    bool                                  _recording    = false;
+
+    std::deque<PendingUpload> _pending;
+    uint64_t                  _uploadCount     = 0;
+    uint64_t                  _recordedUpload  = 0;   //!< last upload fully recorded
+    uint64_t                  _submittedUpload = 0;
+    uint64_t                  _completedUpload = 0;
+    VkDeviceSize              _frameBytes      = 0;
+    VkDeviceSize              _lastFrameBytes  = 0;
+    uint32_t                  _stallCount      = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace vulkan
+}   // namespace gfx
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "gfx/vk_types.h"
+#include "math/vec.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace gfx {
+namespace vulkan {
+////////////////////////////////////////////////////////////////////////////////
+
+//! The vertex attribute format of a field type: a field type without one does
+//! not compile.
+template <typename T> struct VertexFormat {
+    static_assert(sizeof(T) == 0, "no vertex attribute format for this field type");
+};
+
+#define GFX_VERTEX_FORMAT(TYPE, FORMAT)            \
+    template <> struct VertexFormat<TYPE> {        \
+        static constexpr VkFormat format = FORMAT; \
+    };
+GFX_VERTEX_FORMAT(float, VK_FORMAT_R32_SFLOAT)
+GFX_VERTEX_FORMAT(math::vec2f, VK_FORMAT_R32G32_SFLOAT)
+GFX_VERTEX_FORMAT(math::vec3f, VK_FORMAT_R32G32B32_SFLOAT)
+GFX_VERTEX_FORMAT(math::vec4f, VK_FORMAT_R32G32B32A32_SFLOAT)
+GFX_VERTEX_FORMAT(int32_t, VK_FORMAT_R32_SINT)
+GFX_VERTEX_FORMAT(uint32_t, VK_FORMAT_R32_UINT)
+GFX_VERTEX_FORMAT(math::vec4u8, VK_FORMAT_R8G8B8A8_UNORM)   // colors
+#undef GFX_VERTEX_FORMAT
+
+//! A field of a vertex struct, see VertexLayout
+struct VertexField {
+    uint32_t offset = 0;
+    uint32_t size   = 0;
+    VkFormat format = VK_FORMAT_UNDEFINED;
+};
+
+//! the field of VERTEX, its format from its type
+#define GFX_VERTEX_FIELD(VERTEX, FIELD)                                                 \
+    ::gfx::vulkan::VertexField {                                                        \
+        static_cast<uint32_t>(offsetof(VERTEX, FIELD)),                                 \
+        static_cast<uint32_t>(sizeof(VERTEX::FIELD)),                                   \
+        ::gfx::vulkan::VertexFormat<std::remove_cv_t<decltype(VERTEX::FIELD)>>::format, \
+    }
+
+//! The vertex input state of one binding, made at compile time from a vertex
+//! struct: the attribute locations are the field order.
+//!
+//!     struct Vertex {
+//!         math::vec3f position;   // layout(location = 0) in vec3
+//!         math::vec4u8 color;     // layout(location = 1) in vec4
+//!
+//!         static constexpr auto Layout()
+//!         {
+//!             return vulkan::makeVertexLayout<Vertex>(GFX_VERTEX_FIELD(Vertex, position),
+//!                 GFX_VERTEX_FIELD(Vertex, color));
+//!         }
+//!     };
+//!
+//!     const auto& layout = vulkan::vertexLayout<Vertex>();   // a constant
+//!
+//! A member function body sees the complete struct: offsetof() works there.
+template <size_t N> struct VertexLayout {
+    VkVertexInputBindingDescription                  binding {};
+    std::array<VkVertexInputAttributeDescription, N> attributes {};
+
+    //! the fields are inside the stride and do not overlap
+    constexpr bool IsValid() const
+    {
+        for (size_t i = 0; i < N; ++i) {
+            if (attributes[i].format == VK_FORMAT_UNDEFINED || fieldSizes[i] == 0
+                || attributes[i].offset + fieldSizes[i] > binding.stride) {
+                return false;
+            }
+            for (size_t j = 0; j < i; ++j) {
+                if (attributes[i].offset < attributes[j].offset + fieldSizes[j]
+                    && attributes[j].offset < attributes[i].offset + fieldSizes[i]) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    //! bytes, for IsValid()
+    std::array<uint32_t, N> fieldSizes {};
+};
+
+template <typename VertexT, typename... FieldsT>
+constexpr VertexLayout<sizeof...(FieldsT)>
+makeVertexLayout(FieldsT... fields)
+{
+    static_assert(sizeof...(FieldsT) != 0, "a vertex without fields");
+    static_assert((std::is_same_v<FieldsT, VertexField> && ...), "GFX_VERTEX_FIELD() expected");
+    static_assert(std::is_standard_layout_v<VertexT>, "offsetof() needs a standard layout");
+    static_assert(std::is_trivially_copyable_v<VertexT>, "vertices are copied to the GPU as bytes");
+
+    const VertexField                list[] = {fields...};
+    VertexLayout<sizeof...(FieldsT)> layout;
+    layout.binding.binding   = 0;
+    layout.binding.stride    = static_cast<uint32_t>(sizeof(VertexT));
+    layout.binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    for (size_t i = 0; i < sizeof...(FieldsT); ++i) {
+        layout.attributes[i].location = static_cast<uint32_t>(i);
+        layout.attributes[i].binding  = 0;
+        layout.attributes[i].format   = list[i].format;
+        layout.attributes[i].offset   = list[i].offset;
+        layout.fieldSizes[i]          = list[i].size;
+    }
+    return layout;
+}
+
+namespace detail {
+template <typename VertexT> inline constexpr auto kVertexLayout = VertexT::Layout();
+}   // namespace detail
+
+//! the layout of VertexT, evaluated (and checked) by the compiler
+template <typename VertexT>
+constexpr const auto&
+vertexLayout()
+{
+    static_assert(detail::kVertexLayout<VertexT>.IsValid(), "overlapping fields or fields outside of the vertex");
+    return detail::kVertexLayout<VertexT>;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace vulkan
+}   // namespace gfx
@@ -0,0 +1,389 @@
+#include "gfx/BindlessTable.h"
+
+#include "core/small_vector.h"
+
+#include <algorithm>
+
+namespace gfx {
+namespace vulkan {
+/////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+constexpr VkShaderStageFlags kBindlessStages = VK_SHADER_STAGE_ALL_GRAPHICS | VK_SHADER_STAGE_COMPUTE_BIT;
+
+VkDescriptorType
+bindingType(uint32_t binding)
+{
+    switch (binding) {
+    case BindlessTable::kSampledImageBinding:
+        return VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    case BindlessTable::kSamplerBinding:
+        return VK_DESCRIPTOR_TYPE_SAMPLER;
+    default:
+        return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    }
+}
+
+void
+clampCount(const char* name, uint32_t& count, uint32_t limit)
+{
+    if (count > limit) {
+        LOG_WARN("Bindless %s count clamped from %u to %u by the device limits", name, count, limit);
+        count = limit;
+    }
+}
+}   // namespace
+
+/////////////////////////////////////////////////////////////////////////////////
+
+uint32_t
+BindlessTable::Slots::Allocate()
+{
+    if (!free.empty()) {
+        const uint32_t index = free.back();
+        free.pop_back();
+        return index;
+    }
+    return end < capacity ? end++ : kInvalidIndex;
+}
+
+void
+BindlessTable::Slots::Retire(uint32_t index, uint64_t frame)
+{
+    ASSERT_MSG(index < end, "unknown bindless index %u", index);
+    retired.push_back({frame, index});
+}
+
+void
+BindlessTable::Slots::Recycle(uint64_t completedFrame)
+{
+    // retired in frame order
+    size_t count = 0;
+    while (count < retired.size() && retired[count].frame <= completedFrame) {
+        free.push_back(retired[count++].index);
+    }
+    retired.erase(retired.begin(), retired.begin() + count);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+
+bool
+BindlessTable::Init(VkInstance instance, VkPhysicalDevice physicalDevice, VkDevice device, const Config& config)
+{
+    ASSERT(_device == VK_NULL_HANDLE);
+    ASSERT(config.framesInFlight != 0);
+    _device = device;
+    _config = config;
+
+    const auto getProperties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceProperties2KHR>(
+        vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceProperties2KHR"));
+    if (getProperties2 == nullptr) {
+        LOG_ERROR("vkGetPhysicalDeviceProperties2KHR is not available");
+        Destroy();
+        return false;
+    }
+    VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexing {};
+    indexing.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+    VkPhysicalDeviceProperties2KHR properties {};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR;
+    properties.pNext = &indexing;
+    getProperties2(physicalDevice, &properties);
+
+    // every binding is visible to several stages: both the stage and the set
+    // limits apply
+    clampCount("sampled image", _config.sampledImageCount,
+        std::min(indexing.maxPerStageDescriptorUpdateAfterBindSampledImages,
+            indexing.maxDescriptorSetUpdateAfterBindSampledImages));
+    clampCount("sampler", _config.samplerCount,
+        std::min(indexing.maxPerStageDescriptorUpdateAfterBindSamplers,
+            indexing.maxDescriptorSetUpdateAfterBindSamplers));
+    clampCount("storage buffer", _config.storageBufferCount,
+        std::min(indexing.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+            indexing.maxDescriptorSetUpdateAfterBindStorageBuffers));
+    // the images and the buffers of a stage share a limit too, not the samplers
+    const uint32_t resourceLimit = indexing.maxPerStageUpdateAfterBindResources;
+    if (uint64_t(_config.sampledImageCount) + _config.storageBufferCount > resourceLimit) {
+        const uint32_t sampledImageCount = std::min(_config.sampledImageCount, resourceLimit);
+        clampCount("storage buffer", _config.storageBufferCount,
+            std::max(resourceLimit / 2, resourceLimit - sampledImageCount));
+        clampCount("sampled image", _config.sampledImageCount, resourceLimit - _config.storageBufferCount);
+    }
+    _sampledImages.capacity  = _config.sampledImageCount;
+    _samplers.capacity       = _config.samplerCount;
+    _storageBuffers.capacity = _config.storageBufferCount;
+
+    VkDescriptorSetLayoutBinding bindings[3] {};
+    bindings[0].binding         = kSampledImageBinding;
+    bindings[0].descriptorType  = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    bindings[0].descriptorCount = _config.sampledImageCount;
+    bindings[1].binding         = kSamplerBinding;
+    bindings[1].descriptorType  = VK_DESCRIPTOR_TYPE_SAMPLER;
+    bindings[1].descriptorCount = _config.samplerCount;
+    bindings[2].binding         = kStorageBufferBinding;
+    bindings[2].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[2].descriptorCount = _config.storageBufferCount;
+    for (VkDescriptorSetLayoutBinding& binding : bindings) {
+        binding.stageFlags = kBindlessStages;
+    }
+
+    // unused slots are never written, new ones are written while previous
+    // frames using the set are still in flight
+    const VkDescriptorBindingFlagsEXT flags
+        = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT;
+    const VkDescriptorBindingFlagsEXT bindingFlags[3] = {flags, flags, flags};
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfoEXT flagsInfo {};
+    flagsInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+    flagsInfo.bindingCount  = 3;
+    flagsInfo.pBindingFlags = bindingFlags;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo {};
+    layoutInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext        = &flagsInfo;
+    layoutInfo.flags        = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+    layoutInfo.bindingCount = 3;
+    layoutInfo.pBindings    = bindings;
+    if (vkCreateDescriptorSetLayout(_device, &layoutInfo, nullptr, &_setLayout) != VK_SUCCESS) {
+        LOG_ERROR("Failed to create the bindless descriptor set layout");
+        Destroy();
+        return false;
+    }
+
+    const VkPushConstantRange pushConstants = pushConstantRange();
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo {};
+    pipelineLayoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount         = 1;
+    pipelineLayoutInfo.pSetLayouts            = &_setLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges    = &pushConstants;
+    if (vkCreatePipelineLayout(_device, &pipelineLayoutInfo, nullptr, &_pipelineLayout) != VK_SUCCESS) {
+        LOG_ERROR("Failed to create the bindless pipeline layout");
+        Destroy();
+        return false;
+    }
+
+    VkDescriptorPoolSize poolSizes[3];
+    for (uint32_t i = 0; i < 3; ++i) {
+        poolSizes[i].type            = bindings[i].descriptorType;
+        poolSizes[i].descriptorCount = bindings[i].descriptorCount;
+    }
+    VkDescriptorPoolCreateInfo poolInfo {};
+    poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags         = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+    poolInfo.maxSets       = 1;
+    poolInfo.poolSizeCount = 3;
+    poolInfo.pPoolSizes    = poolSizes;
+    if (vkCreateDescriptorPool(_device, &poolInfo, nullptr, &_pool) != VK_SUCCESS) {
+        LOG_ERROR("Failed to create the bindless descriptor pool");
+        Destroy();
+        return false;
+    }
+
+    VkDescriptorSetAllocateInfo allocateInfo {};
+    allocateInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocateInfo.descriptorPool     = _pool;
+    allocateInfo.descriptorSetCount = 1;
+    allocateInfo.pSetLayouts        = &_setLayout;
+    if (vkAllocateDescriptorSets(_device, &allocateInfo, &_set) != VK_SUCCESS) {
+        LOG_ERROR("Failed to allocate the bindless descriptor set");
+        Destroy();
+        return false;
+    }
+    return true;
+}
+
+void
+BindlessTable::Destroy()
+{
+    if (_device == VK_NULL_HANDLE) {
+        return;
+    }
+    // frees the set
+    VK_DESTROY_WITH_DEVICE(vkDestroyDescriptorPool, _device, _pool, nullptr);
+    VK_DESTROY_WITH_DEVICE(vkDestroyPipelineLayout, _device, _pipelineLayout, nullptr);
+    VK_DESTROY_WITH_DEVICE(vkDestroyDescriptorSetLayout, _device, _setLayout, nullptr);
+    _set            = VK_NULL_HANDLE;
+    _sampledImages  = Slots();
+    _samplers       = Slots();
+    _storageBuffers = Slots();
+    _pendingWrites.clear();
+    _device = VK_NULL_HANDLE;
+}
+
+uint32_t
+BindlessTable::AddSampledImage(VkImageView view, VkImageLayout layout)
+{
+    ASSERT(view != VK_NULL_HANDLE);
+    PendingWrite write;
+    write.image.imageView   = view;
+    write.image.imageLayout = layout;
+    return _Add(_sampledImages, "sampled image", kSampledImageBinding, write);
+}
+
+uint32_t
+BindlessTable::AddSampler(VkSampler sampler)
+{
+    ASSERT(sampler != VK_NULL_HANDLE);
+    PendingWrite write;
+    write.image.sampler = sampler;
+    return _Add(_samplers, "sampler", kSamplerBinding, write);
+}
+
+uint32_t
+BindlessTable::AddStorageBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+    ASSERT(buffer != VK_NULL_HANDLE);
+    PendingWrite write;
+    write.buffer.buffer = buffer;
+    write.buffer.offset = offset;
+    write.buffer.range  = range;
+    return _Add(_storageBuffers, "storage buffer", kStorageBufferBinding, write);
+}
+
+void
+BindlessTable::RemoveSampledImage(uint32_t index)
+{
+    _sampledImages.Retire(index, _frame);
+}
+
+void
+BindlessTable::RemoveSampler(uint32_t index)
+{
+    _samplers.Retire(index, _frame);
+}
+
+void
+BindlessTable::RemoveStorageBuffer(uint32_t index)
+{
+    _storageBuffers.Retire(index, _frame);
+}
+
+void
+BindlessTable::BeginFrame()
+{
+    ASSERT(_device != VK_NULL_HANDLE);
+    ++_frame;
+    // slots removed while recording frame n are free once frame n is complete
+    if (_frame >= _config.framesInFlight) {
+        const uint64_t completedFrame = _frame - _config.framesInFlight;
+        _sampledImages.Recycle(completedFrame);
+        _samplers.Recycle(completedFrame);
+        _storageBuffers.Recycle(completedFrame);
+    }
+    _stats.frameBindCount = 0;
+}
+
+void
+BindlessTable::Bind(VkCommandBuffer cmd, VkPipelineBindPoint bindPoint)
+{
+    ASSERT(_device != VK_NULL_HANDLE);
+    _Flush();
+    vkCmdBindDescriptorSets(cmd, bindPoint, _pipelineLayout, 0, 1, &_set, 0, nullptr);
+    ++_stats.frameBindCount;
+}
+
+void
+BindlessTable::BindSecondary(VkCommandBuffer cmd, VkPipelineBindPoint bindPoint) const
+{
+    ASSERT_MSG(_pendingWrites.empty(), "BindlessTable::Bind() first");
+    vkCmdBindDescriptorSets(cmd, bindPoint, _pipelineLayout, 0, 1, &_set, 0, nullptr);
+}
+
+void
+BindlessTable::PushConstants(VkCommandBuffer cmd, const void* data, uint32_t size, uint32_t offset) const
+{
+    ASSERT_MSG(offset + size <= kPushConstantSize, "push constants [%u, %u) over the %u bytes of the bindless range",
+        offset, offset + size, kPushConstantSize);
+    vkCmdPushConstants(cmd, _pipelineLayout, kBindlessStages, offset, size, data);
+}
+
+VkPushConstantRange
+BindlessTable::pushConstantRange()
+{
+    VkPushConstantRange range {};
+    range.stageFlags = kBindlessStages;
+    range.offset     = 0;
+    range.size       = kPushConstantSize;
+    return range;
+}
+
+BindlessTable::Stats
+BindlessTable::GetStats() const
+{
+    Stats stats              = _stats;
+    stats.sampledImageCount  = _sampledImages.usedCount();
+    stats.samplerCount       = _samplers.usedCount();
+    stats.storageBufferCount = _storageBuffers.usedCount();
+    stats.retiredCount       = static_cast<uint32_t>(
+        _sampledImages.retired.size() + _samplers.retired.size() + _storageBuffers.retired.size());
+    return stats;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+
+uint32_t
+BindlessTable::_Add(Slots& slots, const char* name, uint32_t binding, const PendingWrite& write)
+{
+    ASSERT(_device != VK_NULL_HANDLE);
+    const uint32_t index = slots.Allocate();
+    if (index == kInvalidIndex) {
+        LOG_ERROR("The %u bindless %s slots are in use", slots.capacity, name);
+        return kInvalidIndex;
+    }
+    PendingWrite& pending = _pendingWrites.emplace_back(write);
+    pending.binding       = binding;
+    pending.index         = index;
+    return index;
+}
+
+void
+BindlessTable::_Flush()
+{
+    _stats.frameWriteCount = static_cast<uint32_t>(_pendingWrites.size());
+    if (_pendingWrites.empty()) {
+        return;
+    }
+    // consecutive slots of a binding in one write
+    std::sort(_pendingWrites.begin(), _pendingWrites.end(), [](const PendingWrite& a, const PendingWrite& b) {
+        return a.binding != b.binding ? a.binding < b.binding : a.index < b.index;
+    });
+    core::SmallVector<VkDescriptorImageInfo, 64>  imageInfos;
+    core::SmallVector<VkDescriptorBufferInfo, 64> bufferInfos;
+    core::SmallVector<VkWriteDescriptorSet, 16>   writes;
+    imageInfos.reserve(_pendingWrites.size());
+    bufferInfos.reserve(_pendingWrites.size());
+    for (size_t i = 0; i < _pendingWrites.size(); ++i) {
+        const PendingWrite& pending = _pendingWrites[i];
+        const bool          isImage = pending.binding != kStorageBufferBinding;
+        const bool          extends = i > 0 && _pendingWrites[i - 1].binding == pending.binding
+                             && _pendingWrites[i - 1].index + 1 == pending.index;
+        if (!extends) {
+            VkWriteDescriptorSet& write = writes.emplace_back();
+            write                       = {};
+            write.sType                 = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write.dstSet                = _set;
+            write.dstBinding            = pending.binding;
+            write.dstArrayElement       = pending.index;
+            write.descriptorType        = bindingType(pending.binding);
+            // the arrays were reserved: the pointers stay valid
+            if (isImage) {
+                write.pImageInfo = imageInfos.data() + imageInfos.size();
+            } else {
+                write.pBufferInfo = bufferInfos.data() + bufferInfos.size();
+            }
+        }
+        ++writes.back().descriptorCount;
+        if (isImage) {
+            imageInfos.push_back(pending.image);
+        } else {
+            bufferInfos.push_back(pending.buffer);
+        }
+    }
+    vkUpdateDescriptorSets(_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    _pendingWrites.clear();
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace vulkan
+}   // namespace gfx
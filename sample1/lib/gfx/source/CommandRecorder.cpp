@@ -0,0 +1,165 @@
+#include "gfx/CommandRecorder.h"
+
+#include "core/small_vector.h"
+
+#include <algorithm>
+
+namespace gfx {
+namespace vulkan {
+/////////////////////////////////////////////////////////////////////////////////
+
+bool
+CommandRecorder::Init(VkDevice device, const Config& config)
+{
+    ASSERT(_device == VK_NULL_HANDLE && !_workers);
+    ASSERT(config.framesInFlight != 0);
+    _device      = device;
+    _config      = config;
+    _workers     = std::make_unique<core::ThreadPool>(config.threadCount);
+    _threadCount = _workers->threadCount() + 1;
+
+    // transient: the buffers are recorded once, then the whole pool is reset
+    VkCommandPoolCreateInfo poolInfo {};
+    poolInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = config.queueFamilyIndex;
+
+    _pools.resize(static_cast<size_t>(config.framesInFlight) * _threadCount);
+    for (CommandPool& commandPool : _pools) {
+        if (vkCreateCommandPool(_device, &poolInfo, nullptr, &commandPool.pool) != VK_SUCCESS) {
+            LOG_ERROR("Failed to create the command pools of the recording threads");
+            Destroy();
+            return false;
+        }
+    }
+    _stats.threadCount = _threadCount;
+    return true;
+}
+
+void
+CommandRecorder::Destroy()
+{
+    if (_device == VK_NULL_HANDLE) {
+        return;
+    }
+    _workers.reset();
+    // destroying a pool frees its command buffers
+    for (CommandPool& commandPool : _pools) {
+        VK_DESTROY_WITH_DEVICE(vkDestroyCommandPool, _device, commandPool.pool, nullptr);
+    }
+    _pools.clear();
+    _threadCount = 0;
+    _device      = VK_NULL_HANDLE;
+}
+
+void
+CommandRecorder::BeginFrame()
+{
+    ASSERT(_device != VK_NULL_HANDLE);
+    ++_frame;
+    const size_t firstPool = static_cast<size_t>(_frame % _config.framesInFlight) * _threadCount;
+    for (uint32_t thread = 0; thread < _threadCount; ++thread) {
+        CommandPool& commandPool = _pools[firstPool + thread];
+        if (commandPool.usedCount != 0) {
+            VK_CHECK(vkResetCommandPool(_device, commandPool.pool, 0));
+            commandPool.usedCount = 0;
+        }
+    }
+
+    _stats.frameRecordCount = 0;
+    _stats.frameChunkCount  = 0;
+    _frameItemCount         = 0;
+    _frameParallelCount     = 0;
+}
+
+void
+CommandRecorder::Record(VkCommandBuffer primary, const VkCommandBufferInheritanceInfo& inheritance,
+    uint32_t itemCount, const RecordFunction& record)
+{
+    ASSERT(_device != VK_NULL_HANDLE && record);
+    ++_stats.frameRecordCount;
+    if (itemCount == 0) {
+        return;
+    }
+
+    const uint32_t minItemsPerChunk = std::max(_config.minItemsPerChunk, 1u);
+    uint32_t       chunkCount       = std::min(_threadCount, (itemCount + minItemsPerChunk - 1) / minItemsPerChunk);
+    const uint32_t itemsPerChunk    = (itemCount + chunkCount - 1) / chunkCount;
+    chunkCount                      = (itemCount + itemsPerChunk - 1) / itemsPerChunk;   // none empty
+
+    core::SmallVector<VkCommandBuffer, 16> chunks(chunkCount);
+    Job                                    job;
+    job.inheritance   = &inheritance;
+    job.record        = &record;
+    job.itemCount     = itemCount;
+    job.itemsPerChunk = itemsPerChunk;
+    job.chunks        = chunks.data();
+
+    // every chunk has its own pool: no locking while recording
+    for (uint32_t chunk = 1; chunk < chunkCount; ++chunk) {
+        _workers->Submit([this, &job, chunk]() { _RecordChunk(job, chunk); });
+    }
+    _RecordChunk(job, 0);
+    if (chunkCount > 1) {
+        _workers->WaitIdle();
+    }
+
+    vkCmdExecuteCommands(primary, chunkCount, chunks.data());
+    _stats.frameChunkCount += chunkCount;
+    _frameItemCount += itemCount;
+    _frameParallelCount += itemCount - std::min(itemCount, itemsPerChunk);
+}
+
+CommandRecorder::Stats
+CommandRecorder::GetStats() const
+{
+    Stats stats              = _stats;
+    stats.commandBufferCount = 0;
+    for (const CommandPool& commandPool : _pools) {
+        stats.commandBufferCount += static_cast<uint32_t>(commandPool.buffers.size());
+    }
+    stats.frameParallelPercent = _frameItemCount != 0 ? 100.f * _frameParallelCount / _frameItemCount : 0.f;
+    return stats;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+
+void
+CommandRecorder::_RecordChunk(const Job& job, uint32_t thread)
+{
+    const size_t   firstPool = static_cast<size_t>(_frame % _config.framesInFlight) * _threadCount;
+    const uint32_t first     = thread * job.itemsPerChunk;
+    const uint32_t count     = std::min(job.itemsPerChunk, job.itemCount - first);
+
+    const VkCommandBuffer cmd = _GetCommandBuffer(_pools[firstPool + thread]);
+    job.chunks[thread]        = cmd;
+
+    VkCommandBufferBeginInfo beginInfo {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = job.inheritance;
+    VK_CHECK(vkBeginCommandBuffer(cmd, &beginInfo));
+    (*job.record)(cmd, first, count);
+    VK_CHECK(vkEndCommandBuffer(cmd));
+}
+
+VkCommandBuffer
+CommandRecorder::_GetCommandBuffer(CommandPool& commandPool)
+{
+    if (commandPool.usedCount == commandPool.buffers.size()) {
+        VkCommandBufferAllocateInfo allocInfo {};
+        allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool        = commandPool.pool;
+        allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer cmd = VK_NULL_HANDLE;
+        VK_CHECK(vkAllocateCommandBuffers(_device, &allocInfo, &cmd));
+        commandPool.buffers.push_back(cmd);
+    }
+    return commandPool.buffers[commandPool.usedCount++];
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace vulkan
+}   // namespace gfx
@@ -0,0 +1,254 @@
+#include "gfx/DescriptorAllocator.h"
+
+#include "core/hash.h"
+
+#include <algorithm>
+
+namespace gfx {
+namespace vulkan {
+/////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+const DescriptorAllocator::PoolRatio kDefaultRatios[] = {
+    {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.f},
+    {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.f},
+    {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1.f},
+    {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.f},
+    {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1.f},
+    {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.f},
+    {VK_DESCRIPTOR_TYPE_SAMPLER, 1.f},
+};
+
+bool
+isImageDescriptor(VkDescriptorType type)
+{
+    return type == VK_DESCRIPTOR_TYPE_SAMPLER || type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER
+        || type == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE || type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE
+        || type == VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+}
+}   // namespace
+
+/////////////////////////////////////////////////////////////////////////////////
+
+DescriptorWrite
+DescriptorWrite::Image(
+    uint32_t binding, VkDescriptorType type, VkImageView view, VkImageLayout layout, VkSampler sampler)
+{
+    ASSERT(isImageDescriptor(type));
+    DescriptorWrite write;
+    write.binding           = binding;
+    write.type              = type;
+    write.image.sampler     = sampler;
+    write.image.imageView   = view;
+    write.image.imageLayout = layout;
+    return write;
+}
+
+DescriptorWrite
+DescriptorWrite::Buffer(
+    uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+    ASSERT(!isImageDescriptor(type));
+    DescriptorWrite write;
+    write.binding       = binding;
+    write.type          = type;
+    write.buffer.buffer = buffer;
+    write.buffer.offset = offset;
+    write.buffer.range  = range;
+    return write;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+
+void
+DescriptorAllocator::Init(VkDevice device, const Config& config)
+{
+    ASSERT(_device == VK_NULL_HANDLE);
+    ASSERT(config.framesInFlight != 0 && config.setsPerPool != 0);
+    _device = device;
+    _config = config;
+    if (_config.ratios.empty()) {
+        _config.ratios.assign(std::begin(kDefaultRatios), std::end(kDefaultRatios));
+    }
+    _frames.resize(config.framesInFlight);
+    _nextPoolSets = config.setsPerPool;
+}
+
+void
+DescriptorAllocator::Destroy()
+{
+    if (_device == VK_NULL_HANDLE) {
+        return;
+    }
+    for (Frame& frame : _frames) {
+        _freePools.insert(_freePools.end(), frame.pools.begin(), frame.pools.end());
+    }
+    for (VkDescriptorPool pool : _freePools) {
+        vkDestroyDescriptorPool(_device, pool, nullptr);
+    }
+    _freePools.clear();
+    _frames.clear();
+    _device = VK_NULL_HANDLE;
+}
+
+void
+DescriptorAllocator::BeginFrame()
+{
+    ASSERT(_device != VK_NULL_HANDLE);
+    ++_frame;
+    // the sets of this frame in flight are no longer in use: reset at once
+    Frame& frame = _frames[_frame % _frames.size()];
+    for (VkDescriptorPool pool : frame.pools) {
+        VK_CHECK(vkResetDescriptorPool(_device, pool, 0));
+        _freePools.push_back(pool);
+    }
+    frame.pools.clear();
+    frame.sets.clear();
+
+    _stats.frameAllocations = 0;
+    _stats.frameCacheHits   = 0;
+    _stats.frameWrites      = 0;
+}
+
+VkDescriptorSet
+DescriptorAllocator::Allocate(VkDescriptorSetLayout layout)
+{
+    ASSERT(_device != VK_NULL_HANDLE);
+    Frame& frame = _frames[_frame % _frames.size()];
+
+    VkDescriptorSetAllocateInfo allocateInfo {};
+    allocateInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocateInfo.descriptorSetCount = 1;
+    allocateInfo.pSetLayouts        = &layout;
+
+    // the current pool, then a new one when it is full
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        if (frame.pools.empty() || attempt == 1) {
+            const VkDescriptorPool pool = _GetPool();
+            if (pool == VK_NULL_HANDLE) {
+                break;
+            }
+            frame.pools.push_back(pool);
+        }
+        allocateInfo.descriptorPool = frame.pools.back();
+
+        VkDescriptorSet set    = VK_NULL_HANDLE;
+        const VkResult  result = vkAllocateDescriptorSets(_device, &allocateInfo, &set);
+        if (result == VK_SUCCESS) {
+            ++_stats.frameAllocations;
+            return set;
+        }
+        if (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL) {
+            LOG_ERROR("Failed to allocate a descriptor set: %d", result);
+            break;
+        }
+        ++_stats.outOfPoolCount;
+    }
+    ++_stats.allocationFailures;
+    return VK_NULL_HANDLE;
+}
+
+VkDescriptorSet
+DescriptorAllocator::Get(VkDescriptorSetLayout layout, const DescriptorWrite* writes, size_t writeCount)
+{
+    ASSERT(_device != VK_NULL_HANDLE);
+    uint64_t key = core::hashValue(reinterpret_cast<uint64_t>(layout));
+    for (size_t i = 0; i < writeCount; ++i) {
+        const DescriptorWrite& write = writes[i];
+        key = core::hashCombine(key, (uint64_t(write.binding) << 32) | write.arrayElement);
+        key = core::hashCombine(key, write.type);
+        if (isImageDescriptor(write.type)) {
+            key = core::hashCombine(key, reinterpret_cast<uint64_t>(write.image.sampler));
+            key = core::hashCombine(key, reinterpret_cast<uint64_t>(write.image.imageView));
+            key = core::hashCombine(key, write.image.imageLayout);
+        } else {
+            key = core::hashCombine(key, reinterpret_cast<uint64_t>(write.buffer.buffer));
+            key = core::hashCombine(key, write.buffer.offset);
+            key = core::hashCombine(key, write.buffer.range);
+        }
+    }
+
+    Frame& frame = _frames[_frame % _frames.size()];
+    auto   it    = frame.sets.find(key);
+    if (it != frame.sets.end()) {
+        ++_stats.frameCacheHits;
+        return it->second;
+    }
+
+    const VkDescriptorSet set = Allocate(layout);
+    if (set == VK_NULL_HANDLE) {
+        return VK_NULL_HANDLE;
+    }
+    core::SmallVector<VkWriteDescriptorSet, 16> setWrites(writeCount);
+    for (size_t i = 0; i < writeCount; ++i) {
+        VkWriteDescriptorSet& setWrite = setWrites[i];
+        setWrite                       = VkWriteDescriptorSet {};
+        setWrite.sType                 = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        setWrite.dstSet                = set;
+        setWrite.dstBinding            = writes[i].binding;
+        setWrite.dstArrayElement       = writes[i].arrayElement;
+        setWrite.descriptorCount       = 1;
+        setWrite.descriptorType        = writes[i].type;
+        if (isImageDescriptor(writes[i].type)) {
+            setWrite.pImageInfo = &writes[i].image;
+        } else {
+            setWrite.pBufferInfo = &writes[i].buffer;
+        }
+    }
+    vkUpdateDescriptorSets(_device, static_cast<uint32_t>(writeCount), setWrites.data(), 0, nullptr);
+    _stats.frameWrites += static_cast<uint32_t>(writeCount);
+    frame.sets.try_emplace(key, set);
+    return set;
+}
+
+DescriptorAllocator::Stats
+DescriptorAllocator::GetStats() const
+{
+    return _stats;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+
+VkDescriptorPool
+DescriptorAllocator::_GetPool()
+{
+    if (!_freePools.empty()) {
+        const VkDescriptorPool pool = _freePools.back();
+        _freePools.pop_back();
+        return pool;
+    }
+    const VkDescriptorPool pool = _CreatePool(_nextPoolSets);
+    _nextPoolSets               = std::min(_nextPoolSets * 2, std::max(_config.maxSetsPerPool, _config.setsPerPool));
+    return pool;
+}
+
+VkDescriptorPool
+DescriptorAllocator::_CreatePool(uint32_t setCount)
+{
+    core::SmallVector<VkDescriptorPoolSize, 8> poolSizes;
+    for (const PoolRatio& ratio : _config.ratios) {
+        VkDescriptorPoolSize& poolSize = poolSizes.emplace_back();
+        poolSize.type                  = ratio.type;
+        poolSize.descriptorCount       = std::max(1u, static_cast<uint32_t>(ratio.ratio * setCount));
+    }
+
+    // no VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT: reset only
+    VkDescriptorPoolCreateInfo poolInfo {};
+    poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags         = 0;
+    poolInfo.maxSets       = setCount;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes    = poolSizes.data();
+
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+    if (vkCreateDescriptorPool(_device, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+        LOG_ERROR("Failed to create a descriptor pool of %u sets", setCount);
+        return VK_NULL_HANDLE;
+    }
+    ++_stats.poolCount;
+    return pool;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace vulkan
+}   // namespace gfx
@@ -0,0 +1,521 @@
+#include "gfx/DeviceMemory.h"
+
+#include "core/memory.h"
+#include "core/small_vector.h"
+
+#include <algorithm>
+
+namespace gfx {
+namespace vulkan {
+/////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+inline uint32_t
+countBits(uint32_t value)
+{
+    uint32_t count = 0;
+    for (; value != 0; value &= value - 1) {
+        ++count;
+    }
+    return count;
+}
+
+inline core::TlsfAllocator::Allocation
+tlsfAllocation(const MemoryAllocation& allocation)
+{
+    core::TlsfAllocator::Allocation tlsfAllocation;
+    tlsfAllocation.offset = allocation.offset;
+    tlsfAllocation.size   = allocation.size;
+    tlsfAllocation.node   = allocation.node;
+    return tlsfAllocation;
+}
+}   // namespace
+
+/////////////////////////////////////////////////////////////////////////////////
+
+bool
+DeviceMemoryAllocator::Init(VkPhysicalDevice physicalDevice, VkDevice device, const Config& config)
+{
+    ASSERT(_device == VK_NULL_HANDLE);
+    ASSERT(config.blockSize != 0);
+
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &_memoryProperties);
+    if (_memoryProperties.memoryTypeCount == 0) {
+        LOG_ERROR("The device exposes no memory type");
+        return false;
+    }
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    _bufferImageGranularity   = std::max<VkDeviceSize>(properties.limits.bufferImageGranularity, 1);
+    _nonCoherentAtomSize      = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+    _maxMemoryAllocationCount = properties.limits.maxMemoryAllocationCount;
+
+    _device = device;
+    _config = config;
+    return true;
+}
+
+void
+DeviceMemoryAllocator::Destroy()
+{
+    if (_device == VK_NULL_HANDLE) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (Block& block : _blocks) {
+        if (block.memory != VK_NULL_HANDLE) {
+            ASSERT_MSG(
+                block.tlsf.empty(), "%u device memory allocations leaked", block.tlsf.GetStats().allocationCount);
+            _FreeDeviceMemory(block.memory);
+        }
+    }
+    ASSERT_MSG(_deviceMemoryCount == 0, "%u dedicated device memory allocations leaked", _deviceMemoryCount);
+    _blocks.clear();
+    _unusedBlocks.clear();
+    _device = VK_NULL_HANDLE;
+}
+
+bool
+DeviceMemoryAllocator::Allocate(
+    const VkMemoryRequirements& requirements, MemoryUsage usage, ResourceKind kind, MemoryAllocation& allocation)
+{
+    ASSERT(_device != VK_NULL_HANDLE);
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _Allocate(requirements, usage, kind, false, allocation);
+}
+
+bool
+DeviceMemoryAllocator::AllocateDedicated(
+    const VkMemoryRequirements& requirements, MemoryUsage usage, MemoryAllocation& allocation)
+{
+    ASSERT(_device != VK_NULL_HANDLE);
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _Allocate(requirements, usage, ResourceKind::Linear, true, allocation);
+}
+
+void
+DeviceMemoryAllocator::Free(MemoryAllocation& allocation)
+{
+    if (!allocation.isValid()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (allocation.isDedicated()) {
+        const uint32_t heap = _memoryProperties.memoryTypes[allocation.memoryType].heapIndex;
+        --_dedicatedCount[heap];
+        _dedicatedBytes[heap] -= allocation.size;
+        _FreeDeviceMemory(allocation.memory);
+    } else {
+        _FreeInBlock(allocation);
+    }
+    allocation = MemoryAllocation();
+}
+
+bool
+DeviceMemoryAllocator::AllocateForBuffer(VkBuffer buffer, MemoryUsage usage, MemoryAllocation& allocation)
+{
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(_device, buffer, &requirements);
+    if (!Allocate(requirements, usage, ResourceKind::Linear, allocation)) {
+        return false;
+    }
+    if (vkBindBufferMemory(_device, buffer, allocation.memory, allocation.offset) != VK_SUCCESS) {
+        LOG_ERROR("Failed to bind buffer memory");
+        Free(allocation);
+        return false;
+    }
+    return true;
+}
+
+bool
+DeviceMemoryAllocator::AllocateForImage(
+    VkImage image, VkImageTiling tiling, MemoryUsage usage, MemoryAllocation& allocation)
+{
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(_device, image, &requirements);
+    const bool allocated = requirements.size >= _config.dedicatedThreshold
+        ? AllocateDedicated(requirements, usage, allocation)
+        : Allocate(requirements, usage,
+            tiling == VK_IMAGE_TILING_OPTIMAL ? ResourceKind::Optimal : ResourceKind::Linear, allocation);
+    if (!allocated) {
+        return false;
+    }
+    if (vkBindImageMemory(_device, image, allocation.memory, allocation.offset) != VK_SUCCESS) {
+        LOG_ERROR("Failed to bind image memory");
+        Free(allocation);
+        return false;
+    }
+    return true;
+}
+
+void
+DeviceMemoryAllocator::Flush(const MemoryAllocation& allocation, VkDeviceSize offset, VkDeviceSize size)
+{
+    ASSERT(allocation.mapped != nullptr);
+    const VkMemoryPropertyFlags flags = _memoryProperties.memoryTypes[allocation.memoryType].propertyFlags;
+    if ((flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) == 0) {
+        const VkMappedMemoryRange range = _MappedRange(allocation, offset, size);
+        vkFlushMappedMemoryRanges(_device, 1, &range);
+    }
+}
+
+void
+DeviceMemoryAllocator::Invalidate(const MemoryAllocation& allocation, VkDeviceSize offset, VkDeviceSize size)
+{
+    ASSERT(allocation.mapped != nullptr);
+    const VkMemoryPropertyFlags flags = _memoryProperties.memoryTypes[allocation.memoryType].propertyFlags;
+    if ((flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) == 0) {
+        const VkMappedMemoryRange range = _MappedRange(allocation, offset, size);
+        vkInvalidateMappedMemoryRanges(_device, 1, &range);
+    }
+}
+
+void
+DeviceMemoryAllocator::BeginDefragmentation(
+    MemoryAllocation* const* allocations, size_t allocationCount, VkDeviceSize maxBytes, std::vector<Move>& moves)
+{
+    moves.clear();
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // the emptiest blocks are the cheapest to empty
+    core::SmallVector<uint32_t, 32> blocks;
+    for (uint32_t i = 0; i < _blocks.size(); ++i) {
+        if (_blocks[i].memory != VK_NULL_HANDLE && !_blocks[i].tlsf.empty()) {
+            blocks.push_back(i);
+        }
+    }
+    std::sort(blocks.begin(), blocks.end(), [this](uint32_t a, uint32_t b) {
+        return _blocks[a].tlsf.GetStats().usedBytes < _blocks[b].tlsf.GetStats().usedBytes;
+    });
+
+    std::vector<bool>                        sourceBlocks(_blocks.size(), false);
+    core::SmallVector<MemoryAllocation*, 64> blockAllocations;
+    VkDeviceSize                             movedBytes = 0;
+    for (const uint32_t block : blocks) {
+        // only worth it when the block ends up empty: all of its allocations must be movable
+        blockAllocations.clear();
+        VkDeviceSize blockBytes = 0;
+        for (size_t i = 0; i < allocationCount; ++i) {
+            if (allocations[i]->isValid() && allocations[i]->block == block) {
+                blockAllocations.push_back(allocations[i]);
+                blockBytes += allocations[i]->size;
+            }
+        }
+        if (blockAllocations.size() != _blocks[block].tlsf.GetStats().allocationCount) {
+            continue;
+        }
+        if (movedBytes + blockBytes > maxBytes) {
+            break;
+        }
+
+        sourceBlocks[block]    = true;
+        const size_t firstMove = moves.size();
+        bool         moved     = true;
+        for (MemoryAllocation* allocation : blockAllocations) {
+            VkMemoryRequirements requirements {};
+            requirements.size      = allocation->size;
+            requirements.alignment = allocation->alignment;
+            Move move;
+            move.allocation = allocation;
+            if (!_AllocateInBlocks(
+                    allocation->memoryType, _blocks[block].kind, requirements, &sourceBlocks, move.destination)) {
+                moved = false;
+                break;
+            }
+            moves.push_back(move);
+        }
+        if (!moved) {
+            // the other blocks are full: stop there
+            for (size_t i = firstMove; i < moves.size(); ++i) {
+                _FreeInBlock(moves[i].destination);
+            }
+            moves.resize(firstMove);
+            break;
+        }
+        movedBytes += blockBytes;
+    }
+}
+
+void
+DeviceMemoryAllocator::EndDefragmentation(std::vector<Move>& moves)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (Move& move : moves) {
+        _FreeInBlock(*move.allocation);
+        *move.allocation = move.destination;
+    }
+    moves.clear();
+}
+
+DeviceMemoryAllocator::Stats
+DeviceMemoryAllocator::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    Stats stats;
+    stats.heapCount         = _memoryProperties.memoryHeapCount;
+    stats.deviceMemoryCount = _deviceMemoryCount;
+
+    VkDeviceSize freeBytes[VK_MAX_MEMORY_HEAPS] {};
+    VkDeviceSize largestFreeRegions[VK_MAX_MEMORY_HEAPS] {};
+    for (const Block& block : _blocks) {
+        if (block.memory == VK_NULL_HANDLE) {
+            continue;
+        }
+        const uint32_t                   heap      = _memoryProperties.memoryTypes[block.memoryType].heapIndex;
+        const core::TlsfAllocator::Stats blockStats = block.tlsf.GetStats();
+        HeapStats&                       heapStats  = stats.heaps[heap];
+        ++heapStats.blockCount;
+        heapStats.blockBytes += blockStats.size;
+        heapStats.usedBytes += blockStats.usedBytes;
+        heapStats.allocationCount += blockStats.allocationCount;
+        freeBytes[heap] += blockStats.freeBytes();
+        largestFreeRegions[heap] += blockStats.largestFreeRegion;
+    }
+    for (uint32_t heap = 0; heap < stats.heapCount; ++heap) {
+        HeapStats& heapStats     = stats.heaps[heap];
+        heapStats.heapSize       = _memoryProperties.memoryHeaps[heap].size;
+        heapStats.deviceLocal    = (_memoryProperties.memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+        heapStats.dedicatedCount = _dedicatedCount[heap];
+        heapStats.dedicatedBytes = _dedicatedBytes[heap];
+        if (freeBytes[heap] != 0) {
+            heapStats.fragmentation = 1.f - float(largestFreeRegions[heap]) / float(freeBytes[heap]);
+        }
+    }
+    return stats;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+
+uint32_t
+DeviceMemoryAllocator::_FindMemoryType(uint32_t memoryTypeBits, MemoryUsage usage) const
+{
+    VkMemoryPropertyFlags required  = 0;
+    VkMemoryPropertyFlags preferred = 0;
+    VkMemoryPropertyFlags unwanted  = VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+    switch (usage) {
+    case MemoryUsage::GpuOnly:
+        preferred = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        unwanted |= VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+        break;
+    case MemoryUsage::Upload:
+        required  = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+        preferred = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        unwanted |= VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+        break;
+    case MemoryUsage::Readback:
+        required  = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+        preferred = VK_MEMORY_PROPERTY_HOST_CACHED_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        break;
+    }
+
+    // fewest missing preferred and present unwanted properties
+    uint32_t best     = UINT32_MAX;
+    uint32_t bestCost = UINT32_MAX;
+    for (uint32_t type = 0; type < _memoryProperties.memoryTypeCount; ++type) {
+        const VkMemoryPropertyFlags flags = _memoryProperties.memoryTypes[type].propertyFlags;
+        if ((memoryTypeBits & (1u << type)) == 0 || (flags & required) != required
+            || (flags & VK_MEMORY_PROPERTY_PROTECTED_BIT) != 0) {
+            continue;
+        }
+        const uint32_t cost = countBits(preferred & ~flags) + countBits(flags & unwanted);
+        if (cost < bestCost) {
+            best     = type;
+            bestCost = cost;
+        }
+    }
+    return best;
+}
+
+VkDeviceSize
+DeviceMemoryAllocator::_BlockSize(uint32_t memoryType) const
+{
+    // small heaps (the 256MB device local and host visible heap of some GPUs) get smaller blocks
+    const uint32_t     heap     = _memoryProperties.memoryTypes[memoryType].heapIndex;
+    const VkDeviceSize heapSize = _memoryProperties.memoryHeaps[heap].size;
+    return std::min(_config.blockSize, core::alignUp(heapSize / 8, 1024 * 1024));
+}
+
+bool
+DeviceMemoryAllocator::_AllocateDeviceMemory(
+    uint32_t memoryType, VkDeviceSize size, VkDeviceMemory& memory, void*& mapped)
+{
+    if (_deviceMemoryCount >= _maxMemoryAllocationCount) {
+        LOG_ERROR("maxMemoryAllocationCount (%u) reached", _maxMemoryAllocationCount);
+        return false;
+    }
+    VkMemoryAllocateInfo allocateInfo {};
+    allocateInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocateInfo.allocationSize  = size;
+    allocateInfo.memoryTypeIndex = memoryType;
+    // out of memory is not an error yet: the caller tries the next memory type
+    if (vkAllocateMemory(_device, &allocateInfo, nullptr, &memory) != VK_SUCCESS) {
+        memory = VK_NULL_HANDLE;
+        return false;
+    }
+
+    mapped = nullptr;
+    if ((_memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0
+        && vkMapMemory(_device, memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS) {
+        vkFreeMemory(_device, memory, nullptr);
+        memory = VK_NULL_HANDLE;
+        return false;
+    }
+    ++_deviceMemoryCount;
+    return true;
+}
+
+void
+DeviceMemoryAllocator::_FreeDeviceMemory(VkDeviceMemory memory)
+{
+    // implicitly unmapped
+    vkFreeMemory(_device, memory, nullptr);
+    --_deviceMemoryCount;
+}
+
+bool
+DeviceMemoryAllocator::_Allocate(const VkMemoryRequirements& requirements, MemoryUsage usage, ResourceKind kind,
+    bool dedicated, MemoryAllocation& allocation)
+{
+    allocation = MemoryAllocation();
+
+    // when a heap is exhausted, the next best memory type is tried
+    uint32_t memoryTypeBits = requirements.memoryTypeBits;
+    for (;;) {
+        const uint32_t memoryType = _FindMemoryType(memoryTypeBits, usage);
+        if (memoryType == UINT32_MAX) {
+            break;
+        }
+        memoryTypeBits &= ~(1u << memoryType);
+
+        // half a block or more would waste most of a block
+        if (!dedicated && requirements.size <= _BlockSize(memoryType) / 2) {
+            if (_AllocateInBlocks(memoryType, kind, requirements, nullptr, allocation)) {
+                return true;
+            }
+            continue;
+        }
+        if (_AllocateDeviceMemory(memoryType, requirements.size, allocation.memory, allocation.mapped)) {
+            const uint32_t heap = _memoryProperties.memoryTypes[memoryType].heapIndex;
+            ++_dedicatedCount[heap];
+            _dedicatedBytes[heap] += requirements.size;
+            allocation.size       = requirements.size;
+            allocation.alignment  = requirements.alignment;
+            allocation.memoryType = memoryType;
+            return true;
+        }
+    }
+    LOG_ERROR("Failed to allocate %llu bytes of device memory (memory types 0x%x)",
+        static_cast<unsigned long long>(requirements.size), requirements.memoryTypeBits);
+    return false;
+}
+
+bool
+DeviceMemoryAllocator::_AllocateInBlocks(uint32_t memoryType, ResourceKind kind,
+    const VkMemoryRequirements& requirements, const std::vector<bool>* sourceBlocks, MemoryAllocation& allocation)
+{
+    // a granularity of 1 lets every kind share the blocks
+    if (_bufferImageGranularity == 1) {
+        kind = ResourceKind::Linear;
+    }
+
+    auto allocateInBlock = [&](uint32_t index) {
+        Block&                                block = _blocks[index];
+        const core::TlsfAllocator::Allocation range = block.tlsf.Allocate(requirements.size, requirements.alignment);
+        if (!range.isValid()) {
+            return false;
+        }
+        allocation.memory     = block.memory;
+        allocation.offset     = range.offset;
+        allocation.size       = range.size;
+        allocation.alignment  = requirements.alignment;
+        allocation.mapped     = nullptr;
+        allocation.memoryType = memoryType;
+        allocation.block      = index;
+        allocation.node       = range.node;
+        if (block.mapped != nullptr) {
+            allocation.mapped = static_cast<char*>(block.mapped) + range.offset;
+        }
+        return true;
+    };
+
+    for (uint32_t index = 0; index < _blocks.size(); ++index) {
+        const Block& block = _blocks[index];
+        if (block.memory == VK_NULL_HANDLE || block.memoryType != memoryType || block.kind != kind
+            || (sourceBlocks != nullptr && index < sourceBlocks->size() && (*sourceBlocks)[index])) {
+            continue;
+        }
+        if (allocateInBlock(index)) {
+            return true;
+        }
+    }
+    if (sourceBlocks != nullptr) {
+        return false;
+    }
+
+    Block block;
+    if (!_AllocateDeviceMemory(memoryType, _BlockSize(memoryType), block.memory, block.mapped)) {
+        return false;
+    }
+    block.memoryType = memoryType;
+    block.kind       = kind;
+    block.tlsf.Reset(_BlockSize(memoryType));
+
+    uint32_t index;
+    if (!_unusedBlocks.empty()) {
+        index = _unusedBlocks.back();
+        _unusedBlocks.pop_back();
+        _blocks[index] = std::move(block);
+    } else {
+        index = static_cast<uint32_t>(_blocks.size());
+        _blocks.push_back(std::move(block));
+    }
+    return allocateInBlock(index);
+}
+
+void
+DeviceMemoryAllocator::_FreeInBlock(const MemoryAllocation& allocation)
+{
+    ASSERT(allocation.block < _blocks.size() && _blocks[allocation.block].memory == allocation.memory);
+    Block& block = _blocks[allocation.block];
+    block.tlsf.Free(tlsfAllocation(allocation));
+    if (!block.tlsf.empty()) {
+        return;
+    }
+
+    // keep one empty block per memory type and kind
+    for (uint32_t index = 0; index < _blocks.size(); ++index) {
+        const Block& other = _blocks[index];
+        if (index != allocation.block && other.memory != VK_NULL_HANDLE && other.memoryType == block.memoryType
+            && other.kind == block.kind && other.tlsf.empty()) {
+            _FreeDeviceMemory(block.memory);
+            block = Block();
+            _unusedBlocks.push_back(allocation.block);
+            return;
+        }
+    }
+}
+
+VkMappedMemoryRange
+DeviceMemoryAllocator::_MappedRange(const MemoryAllocation& allocation, VkDeviceSize offset, VkDeviceSize size) const
+{
+    VkDeviceSize memorySize;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        memorySize = allocation.isDedicated() ? allocation.size : _blocks[allocation.block].tlsf.size();
+    }
+    const VkDeviceSize begin = allocation.offset + offset;
+    const VkDeviceSize end   = allocation.offset + (size == VK_WHOLE_SIZE ? allocation.size : offset + size);
+
+    VkMappedMemoryRange range {};
+    range.sType  = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    range.memory = allocation.memory;
+    range.offset = begin - begin % _nonCoherentAtomSize;
+    range.size   = core::alignUp(end, static_cast<size_t>(_nonCoherentAtomSize)) >= memorySize
+          ? VK_WHOLE_SIZE
+          : core::alignUp(end, static_cast<size_t>(_nonCoherentAtomSize)) - range.offset;
+    return range;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace vulkan
+}   // namespace gfx
@@ -0,0 +1,161 @@
+#include "gfx/FrameReadback.h"
+
+namespace gfx {
+namespace vulkan {
+/////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+bool
+isFourBytesPerTexel(VkFormat format)
+{
+    switch (format) {
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+        return true;
+    default:
+        return false;
+    }
+}
+}   // namespace
+
+/////////////////////////////////////////////////////////////////////////////////
+
+void
+FrameReadback::Init(VkDevice device, DeviceMemoryAllocator& memory, const Config& config, Callback&& callback)
+{
+    ASSERT(_device == VK_NULL_HANDLE);
+    ASSERT(config.framesInFlight != 0 && callback);
+    _device   = device;
+    _memory   = &memory;
+    _config   = config;
+    _callback = std::move(callback);
+    _slots.resize(config.framesInFlight);
+}
+
+void
+FrameReadback::Destroy()
+{
+    if (_device == VK_NULL_HANDLE) {
+        return;
+    }
+    for (Slot& slot : _slots) {
+        _DestroyBuffer(slot);
+    }
+    _slots.clear();
+    _callback = nullptr;
+    _memory   = nullptr;
+    _device   = VK_NULL_HANDLE;
+}
+
+void
+FrameReadback::BeginFrame()
+{
+    ASSERT(_device != VK_NULL_HANDLE);
+    ++_frame;
+    Slot& slot = _slots[_frame % _slots.size()];
+    if (slot.pending) {
+        _Deliver(slot);
+    }
+}
+
+void
+FrameReadback::Copy(VkCommandBuffer cmd, VkImage image, VkFormat format, VkExtent2D extent)
+{
+    ASSERT(_device != VK_NULL_HANDLE);
+    if (!isFourBytesPerTexel(format)) {
+        LOG_ERROR("FrameReadback: unsupported format %d", static_cast<int>(format));
+        return;
+    }
+    Slot& slot = _slots[_frame % _slots.size()];
+    ASSERT_MSG(!slot.pending, "FrameReadback::Copy() called twice in a frame");
+
+    // the slot was delivered in BeginFrame(): its buffer is no longer in use
+    const VkDeviceSize size = static_cast<VkDeviceSize>(extent.width) * extent.height * 4;
+    if (slot.size < size) {
+        _DestroyBuffer(slot);
+
+        VkBufferCreateInfo bufferInfo {};
+        bufferInfo.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size        = size;
+        bufferInfo.usage       = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        if (vkCreateBuffer(_device, &bufferInfo, nullptr, &slot.buffer) != VK_SUCCESS
+            || !_memory->AllocateForBuffer(slot.buffer, MemoryUsage::Readback, slot.memory)) {
+            LOG_ERROR("Failed to create the %llu bytes readback buffer", static_cast<unsigned long long>(size));
+            _DestroyBuffer(slot);
+            return;
+        }
+        slot.size = size;
+        _stats.bufferBytes += size;
+    }
+
+    VkBufferImageCopy region {};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent                 = {extent.width, extent.height, 1};
+    vkCmdCopyImageToBuffer(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.buffer, 1, &region);
+
+    // the fence makes the copy available, the host read still needs it visible
+    VkBufferMemoryBarrier barrier {};
+    barrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask       = VK_ACCESS_HOST_READ_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer              = slot.buffer;
+    barrier.offset              = 0;
+    barrier.size                = size;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier,
+        0, nullptr);
+
+    slot.pending      = true;
+    slot.image.frame  = _frame;
+    slot.image.width  = extent.width;
+    slot.image.height = extent.height;
+    slot.image.format = format;
+    ++_stats.copyCount;
+}
+
+void
+FrameReadback::Flush()
+{
+    ASSERT(_device != VK_NULL_HANDLE);
+    // the slots after the current one hold the oldest frames
+    for (size_t i = 1; i <= _slots.size(); ++i) {
+        Slot& slot = _slots[(_frame + i) % _slots.size()];
+        if (slot.pending) {
+            _Deliver(slot);
+        }
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+
+void
+FrameReadback::_Deliver(Slot& slot)
+{
+    _memory->Invalidate(slot.memory, 0, VK_WHOLE_SIZE);
+    slot.image.pixels = static_cast<const uint8_t*>(slot.memory.mapped);
+    _callback(slot.image);
+    slot.image.pixels = nullptr;
+    slot.pending      = false;
+    ++_stats.deliveredCount;
+}
+
+void
+FrameReadback::_DestroyBuffer(Slot& slot)
+{
+    VK_DESTROY_WITH_DEVICE(vkDestroyBuffer, _device, slot.buffer, nullptr);
+    if (slot.memory.isValid()) {
+        _memory->Free(slot.memory);
+    }
+    _stats.bufferBytes -= slot.size;
+    slot.size    = 0;
+    slot.pending = false;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace vulkan
+}   // namespace gfx
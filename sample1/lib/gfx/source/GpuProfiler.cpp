@@ -0,0 +1,388 @@
+#include "gfx/GpuProfiler.h"
+
+#include "core/hash.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+namespace gfx {
+namespace vulkan {
+/////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+//! in the order of the results
+constexpr VkQueryPipelineStatisticFlags kStatisticsFlags = VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT
+    | VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT
+    | VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT | VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT
+    | VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT | VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT
+    | VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+constexpr uint32_t kStatisticsCount = 7;
+
+uint64_t
+nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+template <typename... ArgsT>
+void
+appendFormat(std::string& out, const char* format, ArgsT... args)
+{
+    char buffer[256];
+    const int length = snprintf(buffer, sizeof(buffer), format, args...);
+    out.append(buffer, std::min<size_t>(std::max(length, 0), sizeof(buffer) - 1));
+}
+
+void
+appendJsonString(std::string& out, const char* string)
+{
+    out += '"';
+    for (const char* c = string; *c != '\0'; ++c) {
+        if (*c == '"' || *c == '\\') {
+            out += '\\';
+            out += *c;
+        } else if (static_cast<unsigned char>(*c) < 0x20) {
+            appendFormat(out, "\\u%04x", *c);
+        } else {
+            out += *c;
+        }
+    }
+    out += '"';
+}
+
+//! complete event ("X"), microseconds
+void
+appendEvent(std::string& out, const char* name, uint32_t thread, double startUs, double durationUs)
+{
+    out += out.back() == '[' ? "\n" : ",\n";
+    out += "{\"name\":";
+    appendJsonString(out, name);
+    appendFormat(out, ",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", thread, startUs, durationUs);
+}
+}   // namespace
+
+/////////////////////////////////////////////////////////////////////////////////
+
+bool
+GpuProfiler::Init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamilyIndex, const Config& config)
+{
+    ASSERT(_device == VK_NULL_HANDLE);
+    ASSERT(config.framesInFlight != 0 && config.maxZones != 0);
+
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+    const uint32_t validBits = queueFamilyIndex < familyCount ? families[queueFamilyIndex].timestampValidBits : 0;
+    if (validBits == 0) {
+        LOG_WARN("Queue family %u has no timestamps: no GPU profiling", queueFamilyIndex);
+        return false;
+    }
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    _config          = config;
+    _periodNs        = properties.limits.timestampPeriod;
+    _timestampMask   = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+    _queriesPerFrame = 2 + 2 * config.maxZones;
+
+    VkQueryPoolCreateInfo poolInfo {};
+    poolInfo.sType      = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType  = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = config.framesInFlight * _queriesPerFrame;
+    if (vkCreateQueryPool(device, &poolInfo, nullptr, &_timestamps) != VK_SUCCESS) {
+        LOG_ERROR("Failed to create the timestamp query pool");
+        return false;
+    }
+    if (config.pipelineStatistics) {
+        poolInfo.queryType          = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+        poolInfo.queryCount         = config.framesInFlight;
+        poolInfo.pipelineStatistics = kStatisticsFlags;
+        if (vkCreateQueryPool(device, &poolInfo, nullptr, &_statistics) != VK_SUCCESS) {
+            LOG_ERROR("Failed to create the pipeline statistics query pool");
+            VK_DESTROY_WITH_DEVICE(vkDestroyQueryPool, device, _timestamps, nullptr);
+            return false;
+        }
+    }
+
+    _frameQueries.resize(config.framesInFlight);
+    for (FrameQueries& queries : _frameQueries) {
+        queries.names.reserve(config.maxZones);
+        queries.depths.reserve(config.maxZones);
+    }
+    _results.resize(_queriesPerFrame);
+    _history.resize(std::max(config.historySize, config.framesInFlight + 1));
+    _device = device;
+    return true;
+}
+
+void
+GpuProfiler::Destroy()
+{
+    if (_device == VK_NULL_HANDLE) {
+        return;
+    }
+    VK_DESTROY_WITH_DEVICE(vkDestroyQueryPool, _device, _timestamps, nullptr);
+    if (_statistics != VK_NULL_HANDLE) {
+        VK_DESTROY_WITH_DEVICE(vkDestroyQueryPool, _device, _statistics, nullptr);
+    }
+    _frameQueries.clear();
+    _history.clear();
+    _lastComplete = 0;
+    _device       = VK_NULL_HANDLE;
+}
+
+void
+GpuProfiler::BeginFrame(VkCommandBuffer cmd)
+{
+    if (_device == VK_NULL_HANDLE) {
+        return;
+    }
+    ++_frame;
+    const uint32_t slot = static_cast<uint32_t>(_frame % _config.framesInFlight);
+    _ReadResults(slot);
+
+    FrameQueries& queries = _frameQueries[slot];
+    queries.frame         = _frame;
+    queries.zoneCount     = 0;
+    queries.names.clear();
+    queries.depths.clear();
+
+    const uint32_t firstQuery = slot * _queriesPerFrame;
+    vkCmdResetQueryPool(cmd, _timestamps, firstQuery, _queriesPerFrame);
+    if (_statistics != VK_NULL_HANDLE) {
+        vkCmdResetQueryPool(cmd, _statistics, slot, 1);
+        vkCmdBeginQuery(cmd, _statistics, slot, 0);
+    }
+    vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _timestamps, firstQuery);
+}
+
+void
+GpuProfiler::EndFrame(VkCommandBuffer cmd)
+{
+    if (_device == VK_NULL_HANDLE) {
+        return;
+    }
+    ASSERT_MSG(_openZones == 0, "%u GPU zones not ended", _openZones);
+    const uint32_t slot = static_cast<uint32_t>(_frame % _config.framesInFlight);
+    if (_statistics != VK_NULL_HANDLE) {
+        vkCmdEndQuery(cmd, _statistics, slot);
+    }
+    vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _timestamps, slot * _queriesPerFrame + 1);
+
+    Frame& frame   = _HistoryFrame(_frame);
+    frame.frame    = _frame;
+    frame.complete = false;
+    frame.endNs    = nowNs();
+    frame.zones.clear();
+    frame.cpuZones.clear();
+
+    // the closed CPU zones go with the frame, the open ones wait for the next
+    size_t kept = 0;
+    for (size_t i = 0; i < _cpuZones.size(); ++i) {
+        if (_cpuZones[i].endNs != 0) {
+            frame.cpuZones.push_back(_cpuZones[i]);
+            continue;
+        }
+        for (uint32_t& open : _cpuStack) {
+            open = open == i ? static_cast<uint32_t>(kept) : open;
+        }
+        _cpuZones[kept++] = _cpuZones[i];
+    }
+    _cpuZones.resize(kept);
+}
+
+uint32_t
+GpuProfiler::BeginZone(VkCommandBuffer cmd, const char* name)
+{
+    if (_device == VK_NULL_HANDLE) {
+        return kInvalidZone;
+    }
+    const uint32_t slot    = static_cast<uint32_t>(_frame % _config.framesInFlight);
+    FrameQueries&  queries = _frameQueries[slot];
+    if (queries.zoneCount == _config.maxZones) {
+        ++_stats.droppedZones;
+        return kInvalidZone;
+    }
+    const uint32_t zone = queries.zoneCount++;
+    queries.names.push_back(_GetName(name));
+    queries.depths.push_back(_openZones++);
+    vkCmdWriteTimestamp(
+        cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _timestamps, slot * _queriesPerFrame + 2 + 2 * zone);
+    return zone;
+}
+
+void
+GpuProfiler::EndZone(VkCommandBuffer cmd, uint32_t zone)
+{
+    if (zone == kInvalidZone) {
+        return;
+    }
+    ASSERT(_openZones != 0);
+    --_openZones;
+    const uint32_t slot = static_cast<uint32_t>(_frame % _config.framesInFlight);
+    vkCmdWriteTimestamp(
+        cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _timestamps, slot * _queriesPerFrame + 3 + 2 * zone);
+}
+
+void
+GpuProfiler::BeginCpuZone(const char* name)
+{
+    if (_device == VK_NULL_HANDLE) {
+        return;
+    }
+    _cpuStack.push_back(static_cast<uint32_t>(_cpuZones.size()));
+    CpuZone& zone = _cpuZones.emplace_back();
+    zone.name     = _GetName(name);
+    zone.depth    = static_cast<uint32_t>(_cpuStack.size() - 1);
+    zone.startNs  = nowNs();
+}
+
+void
+GpuProfiler::EndCpuZone()
+{
+    if (_device == VK_NULL_HANDLE) {
+        return;
+    }
+    ASSERT_MSG(!_cpuStack.empty(), "no CPU zone to end");
+    _cpuZones[_cpuStack.back()].endNs = nowNs();
+    _cpuStack.pop_back();
+}
+
+const GpuProfiler::Frame*
+GpuProfiler::lastFrame() const
+{
+    if (_lastComplete == 0) {
+        return nullptr;
+    }
+    const Frame& frame = _history[_lastComplete % _history.size()];
+    return frame.frame == _lastComplete && frame.complete ? &frame : nullptr;
+}
+
+VkQueryPipelineStatisticFlags
+GpuProfiler::statisticsFlags() const
+{
+    return _statistics != VK_NULL_HANDLE ? kStatisticsFlags : 0;
+}
+
+bool
+GpuProfiler::ExportTrace(const char* path) const
+{
+    if (_device == VK_NULL_HANDLE) {
+        return false;
+    }
+    enum : uint32_t { kCpuThread = 1, kGpuThread = 2 };
+    std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    out += "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":1,\"args\":{\"name\":\"CPU\"}}";
+    out += ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+
+    // oldest first
+    uint32_t frameCount = 0;
+    char     frameName[32];
+    for (size_t i = 1; i <= _history.size(); ++i) {
+        const Frame& frame = _history[(_lastComplete + i) % _history.size()];
+        if (!frame.complete || frame.frame > _lastComplete) {
+            continue;
+        }
+        ++frameCount;
+        for (const CpuZone& zone : frame.cpuZones) {
+            appendEvent(out, zoneName(zone.name), kCpuThread, zone.startNs * 1e-3, (zone.endNs - zone.startNs) * 1e-3);
+        }
+        // no calibrated timestamps: the GPU starts when the recording ends
+        const double gpuStartUs = frame.endNs * 1e-3;
+        snprintf(frameName, sizeof(frameName), "frame %llu", static_cast<unsigned long long>(frame.frame));
+        appendEvent(out, frameName, kGpuThread, gpuStartUs, frame.gpuMs * 1e3);
+        for (const Zone& zone : frame.zones) {
+            appendEvent(out, zoneName(zone.name), kGpuThread, gpuStartUs + zone.startMs * 1e3, zone.durationMs * 1e3);
+        }
+    }
+    out += "\n]}\n";
+
+    FILE* file   = fopen(path, "wb");
+    bool  result = file != nullptr && fwrite(out.data(), 1, out.size(), file) == out.size();
+    result       = (file != nullptr && fclose(file) == 0) && result;
+    if (!result) {
+        LOG_ERROR("failed to write the trace '%s'", path);
+        return false;
+    }
+    LOG_INFO("trace of %u frames written to '%s'", frameCount, path);
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+
+uint32_t
+GpuProfiler::_GetName(const char* name)
+{
+    const uint64_t hash = core::hashFnv1a(name, strlen(name));
+    auto           it   = _nameIndices.find(hash);
+    if (it != _nameIndices.end()) {
+        return it->second;
+    }
+    _names.emplace_back(name);
+    const uint32_t index = static_cast<uint32_t>(_names.size() - 1);
+    _nameIndices.try_emplace(hash, index);
+    return index;
+}
+
+void
+GpuProfiler::_ReadResults(uint32_t slot)
+{
+    const FrameQueries& queries = _frameQueries[slot];
+    if (queries.frame == 0) {
+        return;   // never recorded
+    }
+    Frame& frame = _HistoryFrame(queries.frame);
+    if (frame.frame != queries.frame) {
+        ++_stats.droppedFrames;   // EndFrame() not called
+        return;
+    }
+
+    // the fence of the frame signaled: available, no wait
+    const uint32_t queryCount = 2 + 2 * queries.zoneCount;
+    const VkResult result     = vkGetQueryPoolResults(_device, _timestamps, slot * _queriesPerFrame, queryCount,
+        queryCount * sizeof(uint64_t), _results.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (result != VK_SUCCESS) {
+        ++_stats.droppedFrames;
+        return;
+    }
+    const uint64_t start = _results[0];
+    const auto     toMs  = [this](uint64_t from, uint64_t to) {
+        return static_cast<float>(((to - from) & _timestampMask) * _periodNs * 1e-6);
+    };
+    frame.gpuMs = toMs(start, _results[1]);
+    frame.zones.resize(queries.zoneCount);
+    for (uint32_t i = 0; i < queries.zoneCount; ++i) {
+        Zone& zone      = frame.zones[i];
+        zone.name       = queries.names[i];
+        zone.depth      = queries.depths[i];
+        zone.startMs    = toMs(start, _results[2 + 2 * i]);
+        zone.durationMs = toMs(_results[2 + 2 * i], _results[3 + 2 * i]);
+    }
+
+    frame.statistics = PipelineStatistics();
+    if (_statistics != VK_NULL_HANDLE) {
+        uint64_t values[kStatisticsCount] = {};
+        if (vkGetQueryPoolResults(_device, _statistics, slot, 1, sizeof(values), values, sizeof(values),
+                VK_QUERY_RESULT_64_BIT)
+            == VK_SUCCESS) {
+            frame.statistics.inputAssemblyVertices     = values[0];
+            frame.statistics.inputAssemblyPrimitives   = values[1];
+            frame.statistics.vertexShaderInvocations   = values[2];
+            frame.statistics.clippingInvocations       = values[3];
+            frame.statistics.clippingPrimitives        = values[4];
+            frame.statistics.fragmentShaderInvocations = values[5];
+            frame.statistics.computeShaderInvocations  = values[6];
+        }
+    }
+    frame.complete = true;
+    _lastComplete  = queries.frame;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace vulkan
+}   // namespace gfx
@@ -0,0 +1,211 @@
+#include "gfx/MeshManager.h"
+
+#include <algorithm>
+
+namespace gfx {
+namespace vulkan {
+/////////////////////////////////////////////////////////////////////////////////
+
+void
+MeshManager::Init(VkDevice device, DeviceMemoryAllocator& memory, UploadManager& uploads, const Config& config)
+{
+    ASSERT(_device == VK_NULL_HANDLE);
+    ASSERT(config.framesInFlight != 0);
+    _device  = device;
+    _memory  = &memory;
+    _uploads = &uploads;
+    _config  = config;
+}
+
+void
+MeshManager::Destroy()
+{
+    if (_device == VK_NULL_HANDLE) {
+        return;
+    }
+    for (uint32_t i = 0; i < _meshes.size(); ++i) {
+        if (_meshes[i].alive) {
+            Destroy(MeshHandle {i});
+        }
+    }
+    _DestroyRetired(true);
+    _meshes.clear();
+    _freeMeshes.clear();
+    _uploading.clear();
+    _stats   = Stats();
+    _uploads = nullptr;
+    _memory  = nullptr;
+    _device  = VK_NULL_HANDLE;
+}
+
+void
+MeshManager::Destroy(MeshHandle mesh)
+{
+    ASSERT(mesh.index < _meshes.size() && _meshes[mesh.index].alive);
+    Mesh& entry = _meshes[mesh.index];
+
+    Retired& retired = _retired.emplace_back();
+    retired.upload   = entry.resident ? UploadToken() : entry.upload;
+    retired.frame    = _frame;
+    retired.buffer   = entry.buffer;
+    retired.memory   = entry.memory;
+
+    _stats.meshCount -= 1;
+    _stats.residentCount -= entry.resident ? 1 : 0;
+    _stats.vertexBytes -= static_cast<VkDeviceSize>(entry.vertexCount) * entry.stride;
+    const VkDeviceSize indexSize = entry.indexType == VK_INDEX_TYPE_UINT16 ? 2 : 4;
+    _stats.indexBytes -= static_cast<VkDeviceSize>(entry.indexCount) * indexSize;
+
+    _uploading.erase(std::remove(_uploading.begin(), _uploading.end(), mesh.index), _uploading.end());
+    entry = Mesh();
+    _freeMeshes.push_back(mesh.index);
+}
+
+void
+MeshManager::Update()
+{
+    ASSERT(_device != VK_NULL_HANDLE);
+    ++_frame;
+    _DestroyRetired(false);
+
+    // uploads complete in order: the oldest first
+    size_t done = 0;
+    for (; done < _uploading.size(); ++done) {
+        Mesh& mesh = _meshes[_uploading[done]];
+        if (!_uploads->IsComplete(mesh.upload)) {
+            break;
+        }
+        mesh.resident = true;
+        ++_stats.residentCount;
+    }
+    _uploading.erase(_uploading.begin(), _uploading.begin() + done);
+}
+
+bool
+MeshManager::IsResident(MeshHandle mesh) const
+{
+    return mesh.index < _meshes.size() && _meshes[mesh.index].resident;
+}
+
+void
+MeshManager::Draw(VkCommandBuffer cmd, MeshHandle mesh, uint32_t instanceCount) const
+{
+    if (!IsResident(mesh)) {
+        return;
+    }
+    const Mesh&        entry  = _meshes[mesh.index];
+    const VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(cmd, 0, 1, &entry.buffer, &offset);
+    vkCmdBindIndexBuffer(cmd, entry.buffer, entry.indexOffset, entry.indexType);
+    vkCmdDrawIndexed(cmd, entry.indexCount, instanceCount, 0, 0, 0);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+
+MeshHandle
+MeshManager::_Create(const void* vertices, uint32_t vertexCount, uint32_t stride, const void* indices,
+    uint32_t indexCount, VkIndexType indexType)
+{
+    ASSERT(_device != VK_NULL_HANDLE);
+    ASSERT(vertices != nullptr && vertexCount != 0 && indices != nullptr && indexCount != 0);
+
+    // the index buffer offset is a multiple of the index size
+    const VkDeviceSize vertexBytes = static_cast<VkDeviceSize>(vertexCount) * stride;
+    const VkDeviceSize indexSize   = indexType == VK_INDEX_TYPE_UINT16 ? 2 : 4;
+    const VkDeviceSize indexOffset = (vertexBytes + indexSize - 1) / indexSize * indexSize;
+    const VkDeviceSize indexBytes  = indexCount * indexSize;
+
+    Mesh mesh;
+    mesh.indexOffset = indexOffset;
+    mesh.indexType   = indexType;
+    mesh.indexCount  = indexCount;
+    mesh.vertexCount = vertexCount;
+    mesh.stride      = stride;
+
+    VkBufferCreateInfo bufferInfo {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size  = indexOffset + indexBytes;
+    bufferInfo.usage
+        = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (vkCreateBuffer(_device, &bufferInfo, nullptr, &mesh.buffer) != VK_SUCCESS
+        || !_memory->AllocateForBuffer(mesh.buffer, MemoryUsage::GpuOnly, mesh.memory)) {
+        LOG_ERROR("Failed to create the %llu bytes mesh buffer", static_cast<unsigned long long>(bufferInfo.size));
+        VK_DESTROY_WITH_DEVICE(vkDestroyBuffer, _device, mesh.buffer, nullptr);
+        return MeshHandle();
+    }
+
+    // the staging ring keeps the uploads in order: the index upload completes last
+    _uploads->UploadBuffer(mesh.buffer, 0, vertices, vertexBytes);
+    mesh.upload = _uploads->UploadBuffer(mesh.buffer, indexOffset, indices, indexBytes);
+    mesh.alive  = true;
+
+    MeshHandle handle;
+    if (!_freeMeshes.empty()) {
+        handle.index = _freeMeshes.back();
+        _freeMeshes.pop_back();
+        _meshes[handle.index] = mesh;
+    } else {
+        handle.index = static_cast<uint32_t>(_meshes.size());
+        _meshes.push_back(mesh);
+    }
+    _uploading.push_back(handle.index);
+
+    _stats.meshCount += 1;
+    _stats.vertexBytes += vertexBytes;
+    _stats.indexBytes += indexBytes;
+    return handle;
+}
+
+MeshHandle
+MeshManager::_Create(const mesh::MeshFile& file, uint32_t meshIndex, uint32_t stride,
+    const VkVertexInputAttributeDescription* attributes, uint32_t attributeCount)
+{
+    ASSERT(meshIndex < file.meshCount());
+    const mesh::MeshEntry& entry = file.mesh(meshIndex);
+
+    // the attribute formats of a mesh file are VkFormat values
+    bool sameLayout = entry.stride == stride && entry.attributeCount == attributeCount;
+    for (uint32_t i = 0; sameLayout && i < attributeCount; ++i) {
+        sameLayout = static_cast<VkFormat>(entry.attributes[i].format) == attributes[i].format
+                  && entry.attributes[i].offset == attributes[i].offset;
+    }
+    if (!sameLayout) {
+        const std::string_view name = file.meshName(entry);
+        LOG_ERROR("The mesh '%.*s' doesn't have the vertex layout of its vertex type", static_cast<int>(name.size()),
+            name.data());
+        return MeshHandle();
+    }
+    return _Create(file.vertices(entry), entry.vertexCount, entry.stride, file.indices(entry), entry.indexCount,
+        entry.indexStride == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32);
+}
+
+void
+MeshManager::_DestroyRetired(bool all)
+{
+    size_t kept = 0;
+    for (size_t i = 0; i < _retired.size(); ++i) {
+        Retired& retired = _retired[i];
+        if (retired.upload.isValid()) {
+            if (all) {
+                _uploads->Wait(retired.upload);
+            } else if (_uploads->IsComplete(retired.upload)) {
+                retired.upload = UploadToken();
+                retired.frame  = _frame;
+            }
+        }
+        if (!all && (retired.upload.isValid() || _frame < retired.frame + _config.framesInFlight)) {
+            _retired[kept++] = retired;
+            continue;
+        }
+        vkDestroyBuffer(_device, retired.buffer, nullptr);
+        if (retired.memory.isValid()) {
+            _memory->Free(retired.memory);
+        }
+    }
+    _retired.resize(kept);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace vulkan
+}   // namespace gfx
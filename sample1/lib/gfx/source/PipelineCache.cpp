@@ -0,0 +1,226 @@
+#include "gfx/PipelineCache.h"
+
+#include "core/hash.h"
+#include "core/vfs.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+namespace gfx {
+namespace vulkan {
+/////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+struct FileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t driverVersion;
+    uint32_t reserved;
+    uint64_t dataSize;
+    uint64_t dataHash;
+};
+static_assert(sizeof(FileHeader) == 32, "pipeline cache header layout changed");
+
+// dataHash is hashBytesStable(): changing it requires a kFileVersion bump
+constexpr uint32_t kFileMagic    = 0x48435050;   // "PPCH"
+constexpr uint32_t kFileVersion  = 2;
+constexpr uint64_t kFileHashSeed = 0x7070632d68617368ull;
+
+//! VkPipelineCacheHeaderVersionOne, which older headers don't declare
+struct DriverHeader {
+    uint32_t headerSize;
+    uint32_t headerVersion;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint8_t  pipelineCacheUUID[VK_UUID_SIZE];
+};
+
+uint64_t
+nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+}   // namespace
+
+/////////////////////////////////////////////////////////////////////////////////
+
+bool
+PipelineCache::Init(
+    VkDevice device, VkPhysicalDevice physicalDevice, std::string nativePath, uint32_t threadCount, bool creationFeedback)
+{
+    ASSERT(_caches.empty() && threadCount > 0);
+    _device           = device;
+    _path             = std::move(nativePath);
+    _creationFeedback = creationFeedback;
+    vkGetPhysicalDeviceProperties(physicalDevice, &_properties);
+
+    const core::vfs::FileHandle file = core::vfs::FileHandle::MapFile(_path.c_str());
+    const uint8_t*              data = nullptr;
+    size_t                      size = 0;
+    if (file && _IsCompatible(file.data(), file.size())) {
+        data = file.data() + sizeof(FileHeader);
+        size = file.size() - sizeof(FileHeader);
+    } else if (file) {
+        LOG_WARN("'%s' was written by another device or driver, or is corrupted: ignored", _path.c_str());
+    }
+
+    VkPipelineCacheCreateInfo createInfo {};
+    createInfo.sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize = size;
+    createInfo.pInitialData    = data;
+
+    for (uint32_t i = 0; i < threadCount; ++i) {
+        VkPipelineCache cache = VK_NULL_HANDLE;
+        if (vkCreatePipelineCache(_device, &createInfo, nullptr, &cache) != VK_SUCCESS) {
+            LOG_ERROR("failed to create pipeline cache!");
+            Destroy();
+            return false;
+        }
+        _caches.push_back(cache);
+    }
+
+    _stats.loadedBytes = size;
+    LOG_INFO("pipeline cache: %s (%zu bytes)", size != 0 ? "warm start" : "cold start", size);
+    return true;
+}
+
+bool
+PipelineCache::_IsCompatible(const uint8_t* data, size_t size) const
+{
+    if (size < sizeof(FileHeader) + sizeof(DriverHeader)) {
+        return false;
+    }
+    FileHeader fileHeader;
+    memcpy(&fileHeader, data, sizeof(fileHeader));
+    const uint8_t* blob = data + sizeof(FileHeader);
+    if (fileHeader.magic != kFileMagic || fileHeader.version != kFileVersion
+        || fileHeader.driverVersion != _properties.driverVersion || fileHeader.dataSize != size - sizeof(FileHeader)
+        || fileHeader.dataHash != core::hashBytesStable(blob, fileHeader.dataSize, kFileHashSeed)) {
+        return false;
+    }
+
+    DriverHeader driverHeader;
+    memcpy(&driverHeader, blob, sizeof(driverHeader));
+    return driverHeader.headerSize >= sizeof(DriverHeader)
+        && driverHeader.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+        && driverHeader.vendorID == _properties.vendorID && driverHeader.deviceID == _properties.deviceID
+        && memcmp(driverHeader.pipelineCacheUUID, _properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+bool
+PipelineCache::Save()
+{
+    ASSERT(!_caches.empty());
+    if (_caches.size() > 1
+        && vkMergePipelineCaches(_device, _caches[0], static_cast<uint32_t>(_caches.size() - 1), &_caches[1])
+               != VK_SUCCESS) {
+        LOG_ERROR("failed to merge the pipeline caches!");
+        return false;
+    }
+
+    size_t size = 0;
+    if (vkGetPipelineCacheData(_device, _caches[0], &size, nullptr) != VK_SUCCESS) {
+        return false;
+    }
+    std::vector<uint8_t> data(sizeof(FileHeader) + size);
+    if (vkGetPipelineCacheData(_device, _caches[0], &size, data.data() + sizeof(FileHeader)) != VK_SUCCESS) {
+        LOG_ERROR("failed to read the pipeline cache data!");
+        return false;
+    }
+    data.resize(sizeof(FileHeader) + size);
+
+    FileHeader header {};
+    header.magic         = kFileMagic;
+    header.version       = kFileVersion;
+    header.driverVersion = _properties.driverVersion;
+    header.dataSize      = size;
+    header.dataHash      = core::hashBytesStable(data.data() + sizeof(FileHeader), size, kFileHashSeed);
+    memcpy(data.data(), &header, sizeof(header));
+
+    // the previous file stays valid until the rename
+    const std::string tmpPath = _path + ".tmp";
+    FILE*             file    = fopen(tmpPath.c_str(), "wb");
+    bool              result  = file != nullptr && fwrite(data.data(), 1, data.size(), file) == data.size();
+    result                    = (file != nullptr && fclose(file) == 0) && result;
+    std::error_code error;
+    if (result) {
+        std::filesystem::rename(tmpPath, _path, error);
+        result = !error;
+    }
+    if (!result) {
+        LOG_ERROR("failed to write the pipeline cache '%s'", _path.c_str());
+        std::filesystem::remove(tmpPath, error);
+        return false;
+    }
+
+    const Stats stats = GetStats();
+    LOG_INFO("pipeline cache: %u pipelines, %u hits (%.3f ms), %u misses (%.3f ms), %u unknown (%.3f ms), saved %zu "
+             "bytes",
+        stats.pipelineCount(), stats.hitCount, stats.hitTimeNs * 1e-6, stats.missCount, stats.missTimeNs * 1e-6,
+        stats.unknownCount, stats.unknownTimeNs * 1e-6, size);
+
+    std::lock_guard<std::mutex> lock(_statsMutex);
+    _stats.savedBytes = size;
+    return true;
+}
+
+void
+PipelineCache::Destroy()
+{
+    for (VkPipelineCache cache : _caches) {
+        vkDestroyPipelineCache(_device, cache, nullptr);
+    }
+    _caches.clear();
+}
+
+VkPipeline
+PipelineCache::CreateGraphicsPipeline(const VkGraphicsPipelineCreateInfo& createInfo, uint32_t threadIndex)
+{
+    VkGraphicsPipelineCreateInfo            info = createInfo;
+    VkPipelineCreationFeedbackEXT           feedback {};
+    VkPipelineCreationFeedbackCreateInfoEXT feedbackInfo {};
+    if (_creationFeedback) {
+        feedbackInfo.sType                     = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT;
+        feedbackInfo.pNext                     = info.pNext;
+        feedbackInfo.pPipelineCreationFeedback = &feedback;
+        info.pNext                             = &feedbackInfo;
+    }
+
+    const uint64_t start    = nowNs();
+    VkPipeline     pipeline = VK_NULL_HANDLE;
+    const VkResult result   = vkCreateGraphicsPipelines(_device, get(threadIndex), 1, &info, nullptr, &pipeline);
+    const uint64_t timeNs   = nowNs() - start;
+    if (result != VK_SUCCESS) {
+        LOG_ERROR("failed to create graphics pipeline!");
+        return VK_NULL_HANDLE;
+    }
+
+    std::lock_guard<std::mutex> lock(_statsMutex);
+    if ((feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT_EXT) == 0) {
+        ++_stats.unknownCount;
+        _stats.unknownTimeNs += timeNs;
+    } else if (feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT_EXT) {
+        ++_stats.hitCount;
+        _stats.hitTimeNs += timeNs;
+    } else {
+        ++_stats.missCount;
+        _stats.missTimeNs += timeNs;
+    }
+    return pipeline;
+}
+
+PipelineCache::Stats
+PipelineCache::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(_statsMutex);
+    return _stats;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace vulkan
+}   // namespace gfx
@@ -0,0 +1,245 @@
+#include "gfx/PipelineLayoutCache.h"
+
+#include "core/hash.h"
+#include "core/small_vector.h"
+
+#include <algorithm>
+
+namespace gfx {
+namespace vulkan {
+/////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+//! one range per stage at most
+using PushConstantRanges = core::FixedVector<VkPushConstantRange, 8>;
+
+//! bindless: set 0 is the bindless table, not reflected
+bool
+mergeStages(const ShaderReflection* const* stages, size_t stageCount, bool bindless,
+    core::SmallVector<DescriptorBinding, 32>& bindings, PushConstantRanges& pushConstants)
+{
+    for (size_t i = 0; i < stageCount; ++i) {
+        for (const DescriptorBinding& binding : stages[i]->descriptorBindings) {
+            if (bindless && binding.set == 0) {
+                continue;
+            }
+            if (binding.set >= kMaxDescriptorSets) {
+                LOG_ERROR("Descriptor set %u is over the %u sets supported", binding.set, kMaxDescriptorSets);
+                return false;
+            }
+            if (binding.count == 0) {
+                LOG_ERROR("Runtime array at set %u binding %u: needs an explicit layout", binding.set, binding.binding);
+                return false;
+            }
+            auto it = std::find_if(bindings.begin(), bindings.end(), [&binding](const DescriptorBinding& other) {
+                return other.set == binding.set && other.binding == binding.binding;
+            });
+            if (it == bindings.end()) {
+                bindings.push_back(binding);
+            } else if (it->type == binding.type && it->count == binding.count) {
+                it->stages |= binding.stages;
+            } else {
+                LOG_ERROR("The stages disagree on set %u binding %u", binding.set, binding.binding);
+                return false;
+            }
+        }
+
+        // identical ranges are shared, different ones coexist (they may overlap)
+        const VkPushConstantRange& range = stages[i]->pushConstants;
+        if (range.size == 0) {
+            continue;
+        }
+        auto it = std::find_if(pushConstants.begin(), pushConstants.end(), [&range](const VkPushConstantRange& other) {
+            return other.offset == range.offset && other.size == range.size;
+        });
+        if (it != pushConstants.end()) {
+            it->stageFlags |= range.stageFlags;
+        } else if (!pushConstants.full()) {
+            pushConstants.push_back(range);
+        } else {
+            LOG_ERROR("Too many push constant ranges");
+            return false;
+        }
+    }
+
+    std::sort(bindings.begin(), bindings.end(), [](const DescriptorBinding& a, const DescriptorBinding& b) {
+        return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+    });
+    return true;
+}
+}   // namespace
+
+/////////////////////////////////////////////////////////////////////////////////
+
+void
+PipelineLayoutCache::Init(VkDevice device)
+{
+    ASSERT(_device == VK_NULL_HANDLE);
+    _device = device;
+}
+
+void
+PipelineLayoutCache::SetBindlessLayout(VkDescriptorSetLayout setLayout, const VkPushConstantRange& pushConstants)
+{
+    ASSERT(_device != VK_NULL_HANDLE && setLayout != VK_NULL_HANDLE);
+    std::lock_guard<std::mutex> lock(_mutex);
+    ASSERT_MSG(_pipelineLayouts.empty(), "the bindless layout is set before the first pipeline layout");
+    _bindlessSetLayout     = setLayout;
+    _bindlessPushConstants = pushConstants;
+}
+
+void
+PipelineLayoutCache::Destroy()
+{
+    if (_device == VK_NULL_HANDLE) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (const auto& entry : _pipelineLayouts) {
+        vkDestroyPipelineLayout(_device, entry.second, nullptr);
+    }
+    for (const auto& entry : _setLayouts) {
+        vkDestroyDescriptorSetLayout(_device, entry.second, nullptr);
+    }
+    _pipelineLayouts.clear();
+    _setLayouts.clear();
+    _bindlessSetLayout = VK_NULL_HANDLE;
+    _device            = VK_NULL_HANDLE;
+}
+
+bool
+PipelineLayoutCache::Get(const ShaderReflection* const* stages, size_t stageCount, PipelineLayoutInfo& info)
+{
+    ASSERT(_device != VK_NULL_HANDLE);
+    info = PipelineLayoutInfo();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++_stats.requestCount;
+
+    const bool                               bindless = _bindlessSetLayout != VK_NULL_HANDLE;
+    core::SmallVector<DescriptorBinding, 32> bindings;
+    PushConstantRanges                       pushConstants;
+    if (!mergeStages(stages, stageCount, bindless, bindings, pushConstants)) {
+        return false;
+    }
+    if (bindless) {
+        // one range shared by every pipeline: the table stays bound between them
+        for (const VkPushConstantRange& range : pushConstants) {
+            if (range.offset < _bindlessPushConstants.offset
+                || range.offset + range.size > _bindlessPushConstants.offset + _bindlessPushConstants.size
+                || (range.stageFlags & ~_bindlessPushConstants.stageFlags) != 0) {
+                LOG_ERROR("Push constants [%u, %u) are outside of the bindless range [%u, %u)", range.offset,
+                    range.offset + range.size, _bindlessPushConstants.offset,
+                    _bindlessPushConstants.offset + _bindlessPushConstants.size);
+                return false;
+            }
+        }
+        pushConstants.clear();
+        pushConstants.push_back(_bindlessPushConstants);
+        info.setLayouts.push_back(_bindlessSetLayout);
+    }
+
+    // sets skipped by the shaders get an empty layout
+    const uint32_t firstSet = static_cast<uint32_t>(info.setLayouts.size());
+    const uint32_t setCount = bindings.empty() ? firstSet : bindings.back().set + 1;
+    size_t         first    = 0;
+    for (uint32_t set = firstSet; set < setCount; ++set) {
+        size_t last = first;
+        while (last < bindings.size() && bindings[last].set == set) {
+            ++last;
+        }
+        const VkDescriptorSetLayout setLayout = _GetSetLayout(bindings.data() + first, last - first);
+        if (setLayout == VK_NULL_HANDLE) {
+            return false;
+        }
+        info.setLayouts.push_back(setLayout);
+        first = last;
+    }
+
+    uint64_t key = core::hashValue(info.setLayouts.size());
+    for (const VkDescriptorSetLayout setLayout : info.setLayouts) {
+        key = core::hashCombine(key, reinterpret_cast<uint64_t>(setLayout));
+    }
+    for (const VkPushConstantRange& range : pushConstants) {
+        key = core::hashCombine(key, range.stageFlags);
+        key = core::hashCombine(key, (uint64_t(range.offset) << 32) | range.size);
+    }
+
+    auto it = _pipelineLayouts.find(key);
+    if (it != _pipelineLayouts.end()) {
+        info.layout = it->second;
+        return true;
+    }
+
+    VkPipelineLayoutCreateInfo createInfo {};
+    createInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    createInfo.setLayoutCount         = static_cast<uint32_t>(info.setLayouts.size());
+    createInfo.pSetLayouts            = info.setLayouts.data();
+    createInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstants.size());
+    createInfo.pPushConstantRanges    = pushConstants.data();
+    if (vkCreatePipelineLayout(_device, &createInfo, nullptr, &info.layout) != VK_SUCCESS) {
+        LOG_ERROR("Failed to create a pipeline layout");
+        info.layout = VK_NULL_HANDLE;
+        return false;
+    }
+    _pipelineLayouts.try_emplace(key, info.layout);
+    ++_stats.pipelineLayoutCount;
+    return true;
+}
+
+VkDescriptorSetLayout
+PipelineLayoutCache::GetSetLayout(const DescriptorBinding* bindings, size_t bindingCount)
+{
+    ASSERT(_device != VK_NULL_HANDLE);
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _GetSetLayout(bindings, bindingCount);
+}
+
+VkDescriptorSetLayout
+PipelineLayoutCache::_GetSetLayout(const DescriptorBinding* bindings, size_t bindingCount)
+{
+    uint64_t key = core::hashValue(bindingCount);
+    for (size_t i = 0; i < bindingCount; ++i) {
+        key = core::hashCombine(key, (uint64_t(bindings[i].binding) << 32) | bindings[i].type);
+        key = core::hashCombine(key, (uint64_t(bindings[i].count) << 32) | bindings[i].stages);
+    }
+    auto it = _setLayouts.find(key);
+    if (it != _setLayouts.end()) {
+        return it->second;
+    }
+
+    core::SmallVector<VkDescriptorSetLayoutBinding, 16> layoutBindings(bindingCount);
+    for (size_t i = 0; i < bindingCount; ++i) {
+        VkDescriptorSetLayoutBinding& layoutBinding = layoutBindings[i];
+        layoutBinding                               = VkDescriptorSetLayoutBinding {};
+        layoutBinding.binding                       = bindings[i].binding;
+        layoutBinding.descriptorType                = bindings[i].type;
+        layoutBinding.descriptorCount               = bindings[i].count;
+        layoutBinding.stageFlags                    = bindings[i].stages;
+    }
+
+    VkDescriptorSetLayoutCreateInfo createInfo {};
+    createInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    createInfo.bindingCount = static_cast<uint32_t>(bindingCount);
+    createInfo.pBindings    = layoutBindings.data();
+
+    VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+    if (vkCreateDescriptorSetLayout(_device, &createInfo, nullptr, &setLayout) != VK_SUCCESS) {
+        LOG_ERROR("Failed to create a descriptor set layout");
+        return VK_NULL_HANDLE;
+    }
+    _setLayouts.try_emplace(key, setLayout);
+    ++_stats.setLayoutCount;
+    return setLayout;
+}
+
+PipelineLayoutCache::Stats
+PipelineLayoutCache::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace vulkan
+}   // namespace gfx
@@ -0,0 +1,392 @@
+#include "gfx/PipelineService.h"
+
+#include "core/hash.h"
+#include "gfx/Shader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace gfx {
+namespace vulkan {
+/////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+uint64_t
+nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+//! field by field: the structs have padding
+class Hasher {
+    uint64_t _hash = core::kHashDefaultSeed;
+
+public:
+    template <typename T> Hasher& operator<<(const T& value)
+    {
+        _hash = core::hashCombine(_hash, static_cast<uint64_t>(value));
+        return *this;
+    }
+    Hasher& operator<<(const core::vfs::FileHandle& code)
+    {
+        _hash = core::hashCombine(_hash, core::hashBytes(code.data(), code.size()));
+        return *this;
+    }
+    uint64_t value() const { return _hash; }
+};
+
+bool
+sameCode(const core::vfs::FileHandle& a, const core::vfs::FileHandle& b)
+{
+    return a.size() == b.size() && (a.data() == b.data() || std::memcmp(a.data(), b.data(), a.size()) == 0);
+}
+
+//! the Vulkan structs have no operator==
+template <typename ContainerT, typename EqualT>
+bool
+sameElements(const ContainerT& a, const ContainerT& b, EqualT equal)
+{
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), equal);
+}
+
+bool
+sameBinding(const VkVertexInputBindingDescription& a, const VkVertexInputBindingDescription& b)
+{
+    return a.binding == b.binding && a.stride == b.stride && a.inputRate == b.inputRate;
+}
+
+bool
+sameAttribute(const VkVertexInputAttributeDescription& a, const VkVertexInputAttributeDescription& b)
+{
+    return a.location == b.location && a.binding == b.binding && a.format == b.format && a.offset == b.offset;
+}
+
+bool
+sameBlend(const BlendState& a, const BlendState& b)
+{
+    return a.enable == b.enable && a.srcColorFactor == b.srcColorFactor && a.dstColorFactor == b.dstColorFactor
+        && a.colorOp == b.colorOp && a.srcAlphaFactor == b.srcAlphaFactor && a.dstAlphaFactor == b.dstAlphaFactor
+        && a.alphaOp == b.alphaOp && a.writeMask == b.writeMask;
+}
+}   // namespace
+
+/////////////////////////////////////////////////////////////////////////////////
+
+uint64_t
+GraphicsPipelineDesc::Hash() const
+{
+    Hasher hasher;
+    hasher << vertexShader << fragmentShader;
+    hasher << vertexBindings.size();
+    for (const VkVertexInputBindingDescription& binding : vertexBindings) {
+        hasher << binding.binding << binding.stride << binding.inputRate;
+    }
+    hasher << vertexAttributes.size();
+    for (const VkVertexInputAttributeDescription& attribute : vertexAttributes) {
+        hasher << attribute.location << attribute.binding << attribute.format << attribute.offset;
+    }
+    hasher << topology << polygonMode << cullMode << frontFace << depthTest << depthWrite << depthCompare;
+    hasher << blendStates.size();
+    for (const BlendState& blend : blendStates) {
+        hasher << blend.enable << blend.srcColorFactor << blend.dstColorFactor << blend.colorOp << blend.srcAlphaFactor
+               << blend.dstAlphaFactor << blend.alphaOp << blend.writeMask;
+    }
+    hasher << renderPassLayout.colorFormats.size();
+    for (const VkFormat format : renderPassLayout.colorFormats) {
+        hasher << format;
+    }
+    hasher << renderPassLayout.depthFormat << renderPassLayout.samples;
+    hasher << reinterpret_cast<uintptr_t>(layout) << reinterpret_cast<uintptr_t>(renderPass) << subpass;
+    return hasher.value();
+}
+
+bool
+GraphicsPipelineDesc::operator==(const GraphicsPipelineDesc& other) const
+{
+    return sameCode(vertexShader, other.vertexShader) && sameCode(fragmentShader, other.fragmentShader)
+        && sameElements(vertexBindings, other.vertexBindings, sameBinding)
+        && sameElements(vertexAttributes, other.vertexAttributes, sameAttribute)
+        && topology == other.topology && polygonMode == other.polygonMode && cullMode == other.cullMode
+        && frontFace == other.frontFace && depthTest == other.depthTest && depthWrite == other.depthWrite
+        && depthCompare == other.depthCompare && sameElements(blendStates, other.blendStates, sameBlend)
+        && renderPassLayout.colorFormats == other.renderPassLayout.colorFormats
+        && renderPassLayout.depthFormat == other.renderPassLayout.depthFormat
+        && renderPassLayout.samples == other.renderPassLayout.samples && layout == other.layout
+        && renderPass == other.renderPass && subpass == other.subpass;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+
+bool
+PipelineService::Init(VkDevice device, PipelineCache& pipelineCache, const Config& config)
+{
+    ASSERT(!_workers && config.threadCount > 0);
+    _device        = device;
+    _pipelineCache = &pipelineCache;
+    for (uint32_t i = 0; i < config.threadCount; ++i) {
+        _freeCacheThreads.push_back(config.firstCacheThread + i);
+    }
+    _workers = std::make_unique<core::ThreadPool>(config.threadCount);
+    return true;
+}
+
+void
+PipelineService::Shutdown()
+{
+    if (!_workers) {
+        return;
+    }
+    _workers.reset();   // runs the queued compilations
+
+    for (const std::unique_ptr<Entry>& entry : _entries) {
+        if (entry->pipeline != VK_NULL_HANDLE) {
+            vkDestroyPipeline(_device, entry->pipeline, nullptr);
+        }
+    }
+    _entries.clear();
+    _entryByKey.clear();
+    _freeCacheThreads.clear();
+}
+
+PipelineHandle
+PipelineService::Request(GraphicsPipelineDesc&& desc)
+{
+    ASSERT(_workers);
+    const uint64_t key = desc.Hash();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++_stats.requestCount;
+    const uint32_t index = static_cast<uint32_t>(_entries.size());
+    auto           it    = _entryByKey.find(key);
+    if (it != _entryByKey.end()) {
+        // 64 bits make a collision unlikely, not impossible
+        for (uint32_t same = it->second;; same = _entries[same]->nextSameHash) {
+            if (_entries[same]->desc == desc) {
+                ++_stats.dedupCount;
+                return PipelineHandle {same};
+            }
+            if (_entries[same]->nextSameHash == UINT32_MAX) {
+                _entries[same]->nextSameHash = index;
+                break;
+            }
+        }
+    } else {
+        _entryByKey.try_emplace(key, index);
+    }
+
+    _entries.push_back(std::make_unique<Entry>());
+    Entry& entry    = *_entries.back();
+    entry.desc      = std::move(desc);
+    entry.requestNs = nowNs();
+
+    ++_stats.queuedCount;
+    _stats.maxQueuedCount = std::max(_stats.maxQueuedCount, _stats.queuedCount);
+    // the entry is not moved by later requests: unique_ptr
+    _workers->Submit([this, &entry]() { _Compile(entry); });
+    return PipelineHandle {index};
+}
+
+void
+PipelineService::_Compile(Entry& entry)
+{
+    uint32_t cacheThread;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        --_stats.queuedCount;
+        ++_stats.compilingCount;
+        // as many cache threads as workers: one is always free
+        ASSERT(!_freeCacheThreads.empty());
+        cacheThread = _freeCacheThreads.back();
+        _freeCacheThreads.pop_back();
+    }
+
+    // the desc is never written once requested: read without the lock
+    const VkPipeline pipeline = _Create(entry.desc, cacheThread);
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _freeCacheThreads.push_back(cacheThread);
+        --_stats.compilingCount;
+        entry.pipeline = pipeline;
+        entry.status   = pipeline != VK_NULL_HANDLE ? PipelineStatus::Ready : PipelineStatus::Failed;
+
+        const uint64_t latencyNs = nowNs() - entry.requestNs;
+        _stats.latencyNs += latencyNs;
+        _stats.maxLatencyNs = std::max(_stats.maxLatencyNs, latencyNs);
+        if (pipeline != VK_NULL_HANDLE) {
+            ++_stats.compiledCount;
+        } else {
+            ++_stats.failedCount;
+        }
+    }
+    _compiled.notify_all();
+}
+
+VkPipeline
+PipelineService::_Create(const GraphicsPipelineDesc& desc, uint32_t cacheThread) const
+{
+    const VkShaderModule vertexShaderModule   = createShaderModule(_device, desc.vertexShader);
+    const VkShaderModule fragmentShaderModule = createShaderModule(_device, desc.fragmentShader);
+    if (vertexShaderModule == VK_NULL_HANDLE || fragmentShaderModule == VK_NULL_HANDLE) {
+        vkDestroyShaderModule(_device, vertexShaderModule, nullptr);
+        vkDestroyShaderModule(_device, fragmentShaderModule, nullptr);
+        return VK_NULL_HANDLE;
+    }
+
+    VkPipelineShaderStageCreateInfo shaderStages[2] {};
+    shaderStages[0].sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[0].stage  = VK_SHADER_STAGE_VERTEX_BIT;
+    shaderStages[0].module = vertexShaderModule;
+    shaderStages[0].pName  = "main";
+    shaderStages[1].sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[1].stage  = VK_SHADER_STAGE_FRAGMENT_BIT;
+    shaderStages[1].module = fragmentShaderModule;
+    shaderStages[1].pName  = "main";
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo {};
+    vertexInputInfo.sType                           = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputInfo.vertexBindingDescriptionCount   = static_cast<uint32_t>(desc.vertexBindings.size());
+    vertexInputInfo.pVertexBindingDescriptions      = desc.vertexBindings.data();
+    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(desc.vertexAttributes.size());
+    vertexInputInfo.pVertexAttributeDescriptions    = desc.vertexAttributes.data();
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly {};
+    inputAssembly.sType                  = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology               = desc.topology;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+    const VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+
+    VkPipelineDynamicStateCreateInfo dynamicState {};
+    dynamicState.sType             = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates    = dynamicStates;
+
+    VkPipelineViewportStateCreateInfo viewportState {};
+    viewportState.sType         = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount  = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer {};
+    rasterizer.sType       = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.polygonMode = desc.polygonMode;
+    rasterizer.lineWidth   = 1.0f;
+    rasterizer.cullMode    = desc.cullMode;
+    rasterizer.frontFace   = desc.frontFace;
+
+    VkPipelineMultisampleStateCreateInfo multisampling {};
+    multisampling.sType                = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.rasterizationSamples = desc.renderPassLayout.samples;
+    multisampling.minSampleShading     = 1.0f;
+
+    VkPipelineDepthStencilStateCreateInfo depthStencil {};
+    depthStencil.sType            = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable  = desc.depthTest ? VK_TRUE : VK_FALSE;
+    depthStencil.depthWriteEnable = desc.depthWrite ? VK_TRUE : VK_FALSE;
+    depthStencil.depthCompareOp   = desc.depthCompare;
+
+    core::FixedVector<VkPipelineColorBlendAttachmentState, kMaxColorAttachments> blendAttachments;
+    for (const BlendState& blend : desc.blendStates) {
+        VkPipelineColorBlendAttachmentState attachment {};
+        attachment.blendEnable         = blend.enable ? VK_TRUE : VK_FALSE;
+        attachment.srcColorBlendFactor = blend.srcColorFactor;
+        attachment.dstColorBlendFactor = blend.dstColorFactor;
+        attachment.colorBlendOp        = blend.colorOp;
+        attachment.srcAlphaBlendFactor = blend.srcAlphaFactor;
+        attachment.dstAlphaBlendFactor = blend.dstAlphaFactor;
+        attachment.alphaBlendOp        = blend.alphaOp;
+        attachment.colorWriteMask      = blend.writeMask;
+        blendAttachments.push_back(attachment);
+    }
+
+    VkPipelineColorBlendStateCreateInfo colorBlending {};
+    colorBlending.sType           = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable   = VK_FALSE;
+    colorBlending.attachmentCount = static_cast<uint32_t>(blendAttachments.size());
+    colorBlending.pAttachments    = blendAttachments.data();
+
+    VkGraphicsPipelineCreateInfo pipelineInfo {};
+    pipelineInfo.sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount          = 2;
+    pipelineInfo.pStages             = shaderStages;
+    pipelineInfo.pVertexInputState   = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState      = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState   = &multisampling;
+    pipelineInfo.pDepthStencilState
+        = desc.renderPassLayout.depthFormat != VK_FORMAT_UNDEFINED ? &depthStencil : nullptr;
+    pipelineInfo.pColorBlendState   = &colorBlending;
+    pipelineInfo.pDynamicState      = &dynamicState;
+    pipelineInfo.layout             = desc.layout;
+    pipelineInfo.renderPass         = desc.renderPass;
+    pipelineInfo.subpass            = desc.subpass;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+    pipelineInfo.basePipelineIndex  = -1;
+
+    // dynamic rendering: the formats of the attachments stand for the render pass
+    const VkFormat depthFormat = desc.renderPassLayout.depthFormat;
+    const bool     hasStencil  = depthFormat == VK_FORMAT_S8_UINT || depthFormat == VK_FORMAT_D16_UNORM_S8_UINT
+        || depthFormat == VK_FORMAT_D24_UNORM_S8_UINT || depthFormat == VK_FORMAT_D32_SFLOAT_S8_UINT;
+    VkPipelineRenderingCreateInfoKHR renderingInfo {};
+    if (desc.renderPass == VK_NULL_HANDLE) {
+        renderingInfo.sType                   = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+        renderingInfo.colorAttachmentCount    = static_cast<uint32_t>(desc.renderPassLayout.colorFormats.size());
+        renderingInfo.pColorAttachmentFormats = desc.renderPassLayout.colorFormats.data();
+        renderingInfo.depthAttachmentFormat   = depthFormat != VK_FORMAT_S8_UINT ? depthFormat : VK_FORMAT_UNDEFINED;
+        renderingInfo.stencilAttachmentFormat = hasStencil ? depthFormat : VK_FORMAT_UNDEFINED;
+        pipelineInfo.pNext                    = &renderingInfo;
+        pipelineInfo.subpass                  = 0;
+    }
+
+    const VkPipeline pipeline = _pipelineCache->CreateGraphicsPipeline(pipelineInfo, cacheThread);
+
+    // not needed once the pipeline exists
+    vkDestroyShaderModule(_device, vertexShaderModule, nullptr);
+    vkDestroyShaderModule(_device, fragmentShaderModule, nullptr);
+    return pipeline;
+}
+
+PipelineStatus
+PipelineService::status(PipelineHandle handle) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    ASSERT(handle.index < _entries.size());
+    return _entries[handle.index]->status;
+}
+
+VkPipeline
+PipelineService::Get(PipelineHandle handle, VkPipeline fallback) const
+{
+    if (!handle.isValid()) {
+        return fallback;
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    ASSERT(handle.index < _entries.size());
+    const Entry& entry = *_entries[handle.index];
+    return entry.status == PipelineStatus::Ready ? entry.pipeline : fallback;
+}
+
+VkPipeline
+PipelineService::Wait(PipelineHandle handle) const
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    ASSERT(handle.index < _entries.size());
+    const Entry& entry = *_entries[handle.index];
+    _compiled.wait(lock, [&entry]() { return entry.status != PipelineStatus::Pending; });
+    return entry.pipeline;
+}
+
+PipelineService::Stats
+PipelineService::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace vulkan
+}   // namespace gfx
@@ -0,0 +1,1135 @@
+#include "gfx/RenderGraph.h"
+
+#include "core/hash.h"
+#include "core/memory.h"
+#include "gfx/GpuProfiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <numeric>
+
+namespace gfx {
+namespace vulkan {
+/////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+constexpr VkAccessFlags kWriteAccess = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+    | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+struct UsageInfo {
+    VkImageLayout        layout     = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkPipelineStageFlags stages     = 0;
+    VkAccessFlags        access     = 0;
+    VkImageUsageFlags    imageUsage = 0;
+};
+
+UsageInfo
+usageInfo(RenderUsage usage, RenderPassType type)
+{
+    const VkPipelineStageFlags shaderStages = type == RenderPassType::Compute
+        ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+        : VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    const VkPipelineStageFlags depthStages
+        = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+
+    switch (usage) {
+    case RenderUsage::ColorAttachment:
+        return {VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT};
+    case RenderUsage::DepthAttachment:
+        return {VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, depthStages,
+            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT};
+    case RenderUsage::DepthRead:
+        return {VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, depthStages,
+            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT};
+    case RenderUsage::Sampled:
+        return {VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, shaderStages, VK_ACCESS_SHADER_READ_BIT,
+            VK_IMAGE_USAGE_SAMPLED_BIT};
+    case RenderUsage::StorageRead:
+        return {VK_IMAGE_LAYOUT_GENERAL, shaderStages, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_USAGE_STORAGE_BIT};
+    case RenderUsage::StorageWrite:
+        return {VK_IMAGE_LAYOUT_GENERAL, shaderStages, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+            VK_IMAGE_USAGE_STORAGE_BIT};
+    case RenderUsage::TransferSrc:
+        return {VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+            VK_IMAGE_USAGE_TRANSFER_SRC_BIT};
+    case RenderUsage::TransferDst:
+        return {VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_IMAGE_USAGE_TRANSFER_DST_BIT};
+    }
+    return {};
+}
+
+bool
+isWriteUsage(RenderUsage usage)
+{
+    return usage == RenderUsage::ColorAttachment || usage == RenderUsage::DepthAttachment
+        || usage == RenderUsage::StorageWrite || usage == RenderUsage::TransferDst;
+}
+
+bool
+isAttachmentUsage(RenderUsage usage)
+{
+    return usage == RenderUsage::ColorAttachment || usage == RenderUsage::DepthAttachment
+        || usage == RenderUsage::DepthRead;
+}
+
+bool
+hasStencil(VkFormat format)
+{
+    switch (format) {
+    case VK_FORMAT_S8_UINT:
+    case VK_FORMAT_D16_UNORM_S8_UINT:
+    case VK_FORMAT_D24_UNORM_S8_UINT:
+    case VK_FORMAT_D32_SFLOAT_S8_UINT:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool
+isDepthFormat(VkFormat format)
+{
+    switch (format) {
+    case VK_FORMAT_D16_UNORM:
+    case VK_FORMAT_X8_D24_UNORM_PACK32:
+    case VK_FORMAT_D32_SFLOAT:
+        return true;
+    default:
+        return hasStencil(format);
+    }
+}
+
+//! barriers cover every aspect, views of depth stencil images the depth only
+VkImageAspectFlags
+aspectMask(VkFormat format, bool view)
+{
+    if (!isDepthFormat(format)) {
+        return VK_IMAGE_ASPECT_COLOR_BIT;
+    }
+    VkImageAspectFlags aspect = format == VK_FORMAT_S8_UINT ? 0 : VK_IMAGE_ASPECT_DEPTH_BIT;
+    if (hasStencil(format) && (!view || aspect == 0)) {
+        aspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+    }
+    return aspect;
+}
+
+VkAttachmentLoadOp
+attachmentLoadOp(const RenderUsage usage, LoadOp loadOp)
+{
+    if (!isWriteUsage(usage)) {
+        return VK_ATTACHMENT_LOAD_OP_LOAD;
+    }
+    switch (loadOp) {
+    case LoadOp::Load:
+        return VK_ATTACHMENT_LOAD_OP_LOAD;
+    case LoadOp::Clear:
+        return VK_ATTACHMENT_LOAD_OP_CLEAR;
+    case LoadOp::DontCare:
+        return VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    }
+    return VK_ATTACHMENT_LOAD_OP_LOAD;
+}
+
+const char*
+usageName(RenderUsage usage)
+{
+    switch (usage) {
+    case RenderUsage::ColorAttachment:
+        return "color";
+    case RenderUsage::DepthAttachment:
+        return "depth";
+    case RenderUsage::DepthRead:
+        return "depth read";
+    case RenderUsage::Sampled:
+        return "sampled";
+    case RenderUsage::StorageRead:
+        return "storage read";
+    case RenderUsage::StorageWrite:
+        return "storage write";
+    case RenderUsage::TransferSrc:
+        return "transfer src";
+    case RenderUsage::TransferDst:
+        return "transfer dst";
+    }
+    return "?";
+}
+
+template <typename... ArgsT>
+void
+appendFormat(std::string& out, const char* format, ArgsT... args)
+{
+    char buffer[512];
+    const int length = snprintf(buffer, sizeof(buffer), format, args...);
+    out.append(buffer, std::min<size_t>(std::max(length, 0), sizeof(buffer) - 1));
+}
+
+}   // namespace
+
+/////////////////////////////////////////////////////////////////////////////////
+
+RenderResource
+RenderGraph::PassBuilder::CreateTexture(const char* name, const RenderTextureDesc& desc)
+{
+    ASSERT(desc.format != VK_FORMAT_UNDEFINED && desc.width != 0 && desc.height != 0);
+    Resource& resource = _graph._resources.emplace_back();
+    resource.name      = name;
+    resource.desc      = desc;
+    return {static_cast<uint32_t>(_graph._resources.size() - 1)};
+}
+
+void
+RenderGraph::PassBuilder::Write(RenderResource resource, RenderUsage usage, LoadOp loadOp, const VkClearValue& clear)
+{
+    ASSERT_MSG(isWriteUsage(usage), "%s is not a write", usageName(usage));
+    ASSERT_MSG(loadOp != LoadOp::Clear || isAttachmentUsage(usage), "only attachments are cleared");
+    ASSERT(resource.index < _graph._resources.size());
+    Pass& pass = _graph._passes[_pass];
+    for (const Access& access : pass.accesses) {
+        ASSERT_MSG(access.resource != resource.index, "pass %s uses %s twice", pass.name.c_str(),
+            _graph._resources[resource.index].name.c_str());
+    }
+    Access& access  = pass.accesses.emplace_back();
+    access.resource = resource.index;
+    access.usage    = usage;
+    access.loadOp   = loadOp;
+    access.write    = true;
+    access.clear    = clear;
+}
+
+void
+RenderGraph::PassBuilder::Read(RenderResource resource, RenderUsage usage)
+{
+    ASSERT_MSG(!isWriteUsage(usage), "%s is not a read", usageName(usage));
+    ASSERT(resource.index < _graph._resources.size());
+    Pass& pass = _graph._passes[_pass];
+    for (const Access& access : pass.accesses) {
+        ASSERT_MSG(access.resource != resource.index, "pass %s uses %s twice", pass.name.c_str(),
+            _graph._resources[resource.index].name.c_str());
+    }
+    Access& access  = pass.accesses.emplace_back();
+    access.resource = resource.index;
+    access.usage    = usage;
+}
+
+void
+RenderGraph::PassBuilder::SideEffect()
+{
+    _graph._passes[_pass].sideEffect = true;
+}
+
+void
+RenderGraph::PassBuilder::SecondaryCommandBuffers()
+{
+    Pass& pass = _graph._passes[_pass];
+    ASSERT_MSG(pass.type == RenderPassType::Graphics, "pass %s is not a graphics pass", pass.name.c_str());
+    pass.secondary = true;
+}
+
+void
+RenderGraph::PassBuilder::UseRenderPass()
+{
+    Pass& pass = _graph._passes[_pass];
+    ASSERT_MSG(pass.type == RenderPassType::Graphics, "pass %s is not a graphics pass", pass.name.c_str());
+    pass.useRenderPass = true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+
+void
+RenderGraph::Init(VkDevice device, DeviceMemoryAllocator& memory, const Config& config)
+{
+    ASSERT(_device == VK_NULL_HANDLE);
+    ASSERT(config.framesInFlight != 0);
+    _device = device;
+    _memory = &memory;
+    _config = config;
+    if (config.dynamicRendering) {
+        _cmdBeginRendering
+            = reinterpret_cast<PFN_vkCmdBeginRenderingKHR>(vkGetDeviceProcAddr(device, "vkCmdBeginRenderingKHR"));
+        _cmdEndRendering
+            = reinterpret_cast<PFN_vkCmdEndRenderingKHR>(vkGetDeviceProcAddr(device, "vkCmdEndRenderingKHR"));
+        ASSERT_MSG(_cmdBeginRendering != nullptr && _cmdEndRendering != nullptr,
+            "VK_KHR_dynamic_rendering is not enabled on the device");
+    }
+}
+
+void
+RenderGraph::Destroy()
+{
+    if (_device == VK_NULL_HANDLE) {
+        return;
+    }
+    Reset();
+    _RetireTransients(_retired.emplace_back());
+    _DestroyRetired(true);
+    for (const auto& entry : _renderPasses) {
+        vkDestroyRenderPass(_device, entry.second, nullptr);
+    }
+    _renderPasses.clear();
+    _device = VK_NULL_HANDLE;
+}
+
+void
+RenderGraph::Reset()
+{
+    _passes.clear();
+    _resources.clear();
+    _alivePasses.clear();
+    _barriers.clear();
+    _finalBarrierCount = 0;
+    _compiled          = false;
+}
+
+RenderResource
+RenderGraph::Import(const char* name, const RenderImport& image)
+{
+    ASSERT(image.image != VK_NULL_HANDLE && image.format != VK_FORMAT_UNDEFINED);
+    Resource& resource    = _resources.emplace_back();
+    resource.name         = name;
+    resource.imported     = true;
+    resource.import       = image;
+    resource.desc.format  = image.format;
+    resource.desc.width   = image.width;
+    resource.desc.height  = image.height;
+    resource.desc.samples = image.samples;
+    resource.image        = image.image;
+    resource.view         = image.view;
+    return {static_cast<uint32_t>(_resources.size() - 1)};
+}
+
+RenderGraph::PassBuilder
+RenderGraph::AddPass(const char* name, RenderPassType type, ExecuteFunction&& execute)
+{
+    Pass& pass   = _passes.emplace_back();
+    pass.name    = name;
+    pass.type    = type;
+    pass.execute = std::move(execute);
+    return PassBuilder(*this, static_cast<uint32_t>(_passes.size() - 1));
+}
+
+bool
+RenderGraph::Compile()
+{
+    ASSERT(_device != VK_NULL_HANDLE);
+    ++_frame;
+    _DestroyRetired(false);
+
+    _compiled = false;
+    _Cull();
+    _ComputeLifetimes();
+    if (!_CreateTransients()) {
+        return false;
+    }
+    _ComputeBarriers();
+    if (!_CreateRenderPasses()) {
+        return false;
+    }
+    _compiled = true;
+    return true;
+}
+
+void
+RenderGraph::Execute(VkCommandBuffer cmd, GpuProfiler* profiler)
+{
+    ASSERT_MSG(_compiled, "RenderGraph::Compile() first");
+    for (uint32_t position = 0; position < _alivePasses.size(); ++position) {
+        Pass&    pass = _passes[_alivePasses[position]];
+        uint32_t zone = GpuProfiler::kInvalidZone;
+        if (profiler != nullptr) {
+            zone = profiler->BeginZone(cmd, pass.name.c_str());
+        }
+        if (pass.barrierCount != 0) {
+            vkCmdPipelineBarrier(cmd, pass.srcStages, pass.dstStages, 0, 0, nullptr, 0, nullptr, pass.barrierCount,
+                &_barriers[pass.firstBarrier]);
+        }
+        if (!pass.rendering) {
+            if (pass.execute) {
+                pass.execute(cmd);
+            }
+            if (profiler != nullptr) {
+                profiler->EndZone(cmd, zone);
+            }
+            continue;
+        }
+
+        if (pass.renderPass != VK_NULL_HANDLE) {
+            _BeginRenderPass(cmd, pass);
+        } else {
+            _BeginRendering(cmd, pass, position);
+        }
+        if (pass.execute) {
+            pass.execute(cmd);
+        }
+        if (pass.renderPass != VK_NULL_HANDLE) {
+            vkCmdEndRenderPass(cmd);
+        } else {
+            _cmdEndRendering(cmd);
+        }
+        _inheritance = VkCommandBufferInheritanceInfo {};
+        if (profiler != nullptr) {
+            profiler->EndZone(cmd, zone);
+        }
+    }
+    if (_finalBarrierCount != 0) {
+        vkCmdPipelineBarrier(cmd, _finalSrcStages, _finalDstStages, 0, 0, nullptr, 0, nullptr, _finalBarrierCount,
+            &_barriers[_barriers.size() - _finalBarrierCount]);
+    }
+}
+
+VkImage
+RenderGraph::GetImage(RenderResource resource) const
+{
+    ASSERT(resource.index < _resources.size());
+    return _resources[resource.index].image;
+}
+
+VkImageView
+RenderGraph::GetView(RenderResource resource) const
+{
+    ASSERT(resource.index < _resources.size());
+    return _resources[resource.index].view;
+}
+
+void
+RenderGraph::InvalidateFramebuffers()
+{
+    Retired& retired = _retired.emplace_back();
+    retired.frame    = _frame;
+    for (const auto& entry : _framebuffers) {
+        retired.framebuffers.push_back(entry.second);
+    }
+    _framebuffers.clear();
+}
+
+std::string
+RenderGraph::Dump() const
+{
+    std::string out = "digraph RenderGraph {\n    rankdir=LR;\n    node [fontname=\"Helvetica\", fontsize=10];\n";
+    const VkDeviceSize saved = _stats.unaliasedBytes - std::min(_stats.unaliasedBytes, _stats.transientBytes);
+    appendFormat(out,
+        "    labelloc=t;\n    label=\"%u passes (%u culled), %u barriers in %u batches, %u transient images: "
+        "%llu KB aliased, %llu KB without aliasing (%llu KB saved)\";\n",
+        _stats.passCount, _stats.culledPassCount, _stats.barrierCount, _stats.barrierBatchCount,
+        _stats.transientCount, static_cast<unsigned long long>(_stats.transientBytes >> 10),
+        static_cast<unsigned long long>(_stats.unaliasedBytes >> 10), static_cast<unsigned long long>(saved >> 10));
+
+    for (uint32_t i = 0; i < _passes.size(); ++i) {
+        const Pass& pass = _passes[i];
+        if (pass.alive) {
+            appendFormat(out, "    p%u [shape=box, style=filled, fillcolor=lightblue, label=\"%s\\n%u barriers\"];\n",
+                i, pass.name.c_str(), pass.barrierCount);
+        } else {
+            appendFormat(out, "    p%u [shape=box, style=dashed, color=gray, label=\"%s\\nculled\"];\n", i,
+                pass.name.c_str());
+        }
+    }
+    for (uint32_t i = 0; i < _resources.size(); ++i) {
+        const Resource& resource = _resources[i];
+        appendFormat(out, "    r%u [shape=ellipse, label=\"%s\\n%ux%u format %d", i, resource.name.c_str(),
+            resource.desc.width, resource.desc.height, static_cast<int>(resource.desc.format));
+        if (resource.imported) {
+            out += "\\nimported\"];\n";
+        } else if (resource.transient != kNone) {
+            const Transient& transient = _transients[resource.transient];
+            appendFormat(out, "\\npasses %u-%u\\n%llu KB at %llu KB\", style=filled, fillcolor=khaki];\n",
+                resource.firstPass, resource.lastPass, static_cast<unsigned long long>(transient.size >> 10),
+                static_cast<unsigned long long>(transient.offset >> 10));
+        } else {
+            out += "\\nunused\", style=dashed, color=gray];\n";
+        }
+    }
+    for (uint32_t i = 0; i < _passes.size(); ++i) {
+        for (const Access& access : _passes[i].accesses) {
+            if (access.write) {
+                appendFormat(out, "    p%u -> r%u [color=red, label=\"%s\"];\n", i, access.resource,
+                    usageName(access.usage));
+            } else {
+                appendFormat(out, "    r%u -> p%u [label=\"%s\"];\n", access.resource, i, usageName(access.usage));
+            }
+        }
+    }
+    out += "}\n";
+    return out;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+
+void
+RenderGraph::_Cull()
+{
+    // backwards: a pass is needed when it has side effects, or writes what a
+    // later needed pass or the outside of the graph reads
+    std::vector<bool> needed(_resources.size());
+    for (uint32_t i = 0; i < _resources.size(); ++i) {
+        needed[i] = _resources[i].imported;
+    }
+    for (size_t i = _passes.size(); i-- > 0;) {
+        Pass& pass = _passes[i];
+        pass.alive = pass.sideEffect;
+        for (const Access& access : pass.accesses) {
+            pass.alive |= access.write && needed[access.resource];
+        }
+        if (!pass.alive) {
+            continue;
+        }
+        // what the pass overwrites is not needed before it, what it reads is
+        for (const Access& access : pass.accesses) {
+            if (access.write && access.loadOp != LoadOp::Load) {
+                needed[access.resource] = false;
+            }
+        }
+        for (const Access& access : pass.accesses) {
+            if (!access.write || access.loadOp == LoadOp::Load) {
+                needed[access.resource] = true;
+            }
+        }
+    }
+
+    _alivePasses.clear();
+    for (uint32_t i = 0; i < _passes.size(); ++i) {
+        if (_passes[i].alive) {
+            _alivePasses.push_back(i);
+        }
+    }
+    _stats.passCount       = static_cast<uint32_t>(_passes.size());
+    _stats.culledPassCount = static_cast<uint32_t>(_passes.size() - _alivePasses.size());
+}
+
+void
+RenderGraph::_ComputeLifetimes()
+{
+    for (Resource& resource : _resources) {
+        resource.usage     = 0;
+        resource.firstPass = kNone;
+        resource.lastPass  = kNone;
+    }
+    for (uint32_t position = 0; position < _alivePasses.size(); ++position) {
+        const Pass& pass = _passes[_alivePasses[position]];
+        for (const Access& access : pass.accesses) {
+            Resource& resource = _resources[access.resource];
+            resource.usage |= usageInfo(access.usage, pass.type).imageUsage;
+            if (resource.firstPass == kNone) {
+                resource.firstPass = position;
+            }
+            resource.lastPass = position;
+        }
+    }
+}
+
+bool
+RenderGraph::_CreateTransients()
+{
+    // the transient images used by the passes alive, and the shape of the graph
+    std::vector<uint32_t> transients;
+    uint64_t              hash = core::hashValue(_resources.size());
+    for (uint32_t i = 0; i < _resources.size(); ++i) {
+        Resource& resource = _resources[i];
+        resource.transient = kNone;
+        if (resource.imported || resource.firstPass == kNone) {
+            continue;
+        }
+        resource.transient = static_cast<uint32_t>(transients.size());
+        transients.push_back(i);
+        hash = core::hashCombine(hash, i);
+        hash = core::hashCombine(hash, (uint64_t(resource.desc.format) << 32) | resource.desc.samples);
+        hash = core::hashCombine(hash, (uint64_t(resource.desc.width) << 32) | resource.desc.height);
+        hash = core::hashCombine(hash, resource.usage);
+        hash = core::hashCombine(hash, (uint64_t(resource.firstPass) << 32) | resource.lastPass);
+    }
+
+    if (hash != _transientHash || transients.size() != _transients.size()) {
+        // new images: the previous ones wait for the frames in flight
+        Retired& retired = _retired.emplace_back();
+        retired.frame    = _frame;
+        _RetireTransients(retired);
+        ++_stats.rebuildCount;
+
+        std::vector<VkMemoryRequirements> requirements(transients.size());
+        VkMemoryRequirements              heapRequirements {};
+        heapRequirements.alignment      = 1;
+        heapRequirements.memoryTypeBits = ~0u;
+        for (uint32_t k = 0; k < transients.size(); ++k) {
+            const Resource& resource = _resources[transients[k]];
+
+            VkImageCreateInfo imageInfo {};
+            imageInfo.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            imageInfo.imageType     = VK_IMAGE_TYPE_2D;
+            imageInfo.format        = resource.desc.format;
+            imageInfo.extent        = {resource.desc.width, resource.desc.height, 1};
+            imageInfo.mipLevels     = 1;
+            imageInfo.arrayLayers   = 1;
+            imageInfo.samples       = resource.desc.samples;
+            imageInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
+            imageInfo.usage         = resource.usage;
+            imageInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+            imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            Transient& transient    = _transients.emplace_back();
+            if (vkCreateImage(_device, &imageInfo, nullptr, &transient.image) != VK_SUCCESS) {
+                LOG_ERROR("Failed to create the transient image %s", resource.name.c_str());
+                return false;
+            }
+            vkGetImageMemoryRequirements(_device, transient.image, &requirements[k]);
+            heapRequirements.alignment = std::max(heapRequirements.alignment, requirements[k].alignment);
+            heapRequirements.memoryTypeBits &= requirements[k].memoryTypeBits;
+        }
+        if (!transients.empty()) {
+            if (heapRequirements.memoryTypeBits == 0) {
+                LOG_ERROR("The transient images have no memory type in common");
+                return false;
+            }
+            _PlaceTransients(transients, requirements, heapRequirements.size);
+            if (!_memory->Allocate(heapRequirements, MemoryUsage::GpuOnly, ResourceKind::Optimal, _transientMemory)) {
+                LOG_ERROR("Failed to allocate %llu KB of transient images",
+                    static_cast<unsigned long long>(heapRequirements.size >> 10));
+                return false;
+            }
+        }
+        _transientHeapSize = heapRequirements.size;
+
+        for (uint32_t k = 0; k < transients.size(); ++k) {
+            const Resource& resource  = _resources[transients[k]];
+            Transient&      transient = _transients[k];
+            VK_CHECK(vkBindImageMemory(
+                _device, transient.image, _transientMemory.memory, _transientMemory.offset + transient.offset));
+
+            VkImageViewCreateInfo viewInfo {};
+            viewInfo.sType                       = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewInfo.image                       = transient.image;
+            viewInfo.viewType                    = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format                      = resource.desc.format;
+            viewInfo.subresourceRange.aspectMask = aspectMask(resource.desc.format, true);
+            viewInfo.subresourceRange.levelCount = 1;
+            viewInfo.subresourceRange.layerCount = 1;
+            if (vkCreateImageView(_device, &viewInfo, nullptr, &transient.view) != VK_SUCCESS) {
+                LOG_ERROR("Failed to create the view of the transient image %s", resource.name.c_str());
+                return false;
+            }
+        }
+        _transientHash = hash;
+    }
+
+    _stats.transientCount = static_cast<uint32_t>(transients.size());
+    _stats.transientBytes = _transientHeapSize;
+    _stats.unaliasedBytes = 0;
+    for (uint32_t k = 0; k < transients.size(); ++k) {
+        Resource& resource = _resources[transients[k]];
+        resource.image     = _transients[k].image;
+        resource.view      = _transients[k].view;
+        _stats.unaliasedBytes += _transients[k].size;
+    }
+    return true;
+}
+
+void
+RenderGraph::_PlaceTransients(const std::vector<uint32_t>& transients,
+    const std::vector<VkMemoryRequirements>& requirements, VkDeviceSize& heapSize)
+{
+    // biggest first, each at the lowest offset not used during its lifetime
+    std::vector<uint32_t> order(transients.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+        [&requirements](uint32_t a, uint32_t b) { return requirements[a].size > requirements[b].size; });
+
+    heapSize = 0;
+    for (size_t i = 0; i < order.size(); ++i) {
+        const uint32_t  k        = order[i];
+        const Resource& resource = _resources[transients[k]];
+        Transient&      placed   = _transients[k];
+        placed.size              = requirements[k].size;
+        placed.offset            = 0;
+        // move past the images in the way: the offsets skipped all overlap them
+        for (bool moved = true; moved;) {
+            moved = false;
+            for (size_t j = 0; j < i; ++j) {
+                const Resource&  other          = _resources[transients[order[j]]];
+                const Transient& otherTransient = _transients[order[j]];
+                const bool liveTogether = resource.firstPass <= other.lastPass && other.firstPass <= resource.lastPass;
+                if (liveTogether && placed.offset < otherTransient.offset + otherTransient.size
+                    && otherTransient.offset < placed.offset + placed.size) {
+                    const VkDeviceSize end = otherTransient.offset + otherTransient.size;
+                    placed.offset          = core::alignUp(end, static_cast<size_t>(requirements[k].alignment));
+                    moved         = true;
+                }
+            }
+        }
+        heapSize = std::max(heapSize, placed.offset + placed.size);
+    }
+}
+
+void
+RenderGraph::_ComputeBarriers()
+{
+    struct State {
+        VkImageLayout        layout        = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags writeStages   = 0;   //!< last write
+        VkAccessFlags        writeAccess   = 0;
+        VkPipelineStageFlags readStages    = 0;   //!< reads since the last write
+        VkPipelineStageFlags visibleStages = 0;   //!< the last write is visible to
+        VkAccessFlags        visibleAccess = 0;
+    };
+    std::vector<State> states(_resources.size());
+    for (uint32_t i = 0; i < _resources.size(); ++i) {
+        if (_resources[i].imported) {
+            states[i].layout      = _resources[i].import.initialLayout;
+            states[i].writeStages = _resources[i].import.initialStages;
+            states[i].writeAccess = _resources[i].import.initialAccess;
+        }
+    }
+
+    _barriers.clear();
+    for (uint32_t position = 0; position < _alivePasses.size(); ++position) {
+        Pass& pass        = _passes[_alivePasses[position]];
+        pass.firstBarrier = static_cast<uint32_t>(_barriers.size());
+        pass.srcStages    = 0;
+        pass.dstStages    = 0;
+        for (const Access& access : pass.accesses) {
+            const Resource& resource = _resources[access.resource];
+            State&          state    = states[access.resource];
+            const UsageInfo info     = usageInfo(access.usage, pass.type);
+            const bool      discard  = access.write && access.loadOp != LoadOp::Load;
+            const bool      first    = !resource.imported && resource.firstPass == position;
+
+            bool                 needed    = false;
+            VkPipelineStageFlags srcStages = 0;
+            VkAccessFlags        srcAccess = 0;
+            if (first) {
+                ASSERT_MSG(discard, "transient image %s is used by %s before being written", resource.name.c_str(),
+                    pass.name.c_str());
+                // the memory held other images, their last uses come first
+                const Transient& transient = _transients[resource.transient];
+                for (const Resource& other : _resources) {
+                    if (other.transient == kNone || other.lastPass >= position) {
+                        continue;
+                    }
+                    const Transient& otherTransient = _transients[other.transient];
+                    if (transient.offset < otherTransient.offset + otherTransient.size
+                        && otherTransient.offset < transient.offset + transient.size) {
+                        const State& otherState = states[&other - _resources.data()];
+                        srcStages |= otherState.writeStages | otherState.readStages;
+                        srcAccess |= otherState.writeAccess;
+                    }
+                }
+                if (srcStages == 0) {
+                    // The transients are shared by the frames in flight: the
+                    // first image of the memory waits for the previous frame.
+                    srcStages = _transientLastStages;
+                    srcAccess = _transientLastAccess;
+                }
+                needed = true;
+            } else if (state.layout != info.layout || access.write) {
+                // transition or write after write/read
+                srcStages = state.writeStages | state.readStages;
+                srcAccess = state.writeAccess;
+                needed    = state.layout != info.layout || srcStages != 0;
+            } else if (state.writeAccess != 0
+                && ((state.visibleStages & info.stages) != info.stages
+                    || (state.visibleAccess & info.access) != info.access)) {
+                // read after write, not made visible to this read yet
+                srcStages = state.writeStages;
+                srcAccess = state.writeAccess;
+                needed    = true;
+            }
+
+            if (needed) {
+                VkImageMemoryBarrier& barrier           = _barriers.emplace_back();
+                barrier                                 = {};
+                barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                barrier.srcAccessMask                   = srcAccess;
+                barrier.dstAccessMask                   = info.access;
+                barrier.oldLayout                       = discard ? VK_IMAGE_LAYOUT_UNDEFINED : state.layout;
+                barrier.newLayout                       = info.layout;
+                barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+                barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+                barrier.image                           = resource.image;
+                barrier.subresourceRange.aspectMask     = aspectMask(resource.desc.format, false);
+                barrier.subresourceRange.baseMipLevel   = 0;
+                barrier.subresourceRange.levelCount     = 1;
+                barrier.subresourceRange.baseArrayLayer = 0;
+                barrier.subresourceRange.layerCount     = 1;
+                pass.srcStages |= srcStages;
+                pass.dstStages |= info.stages;
+            }
+
+            if (access.write) {
+                state.writeStages   = info.stages;
+                state.writeAccess   = info.access & kWriteAccess;
+                state.readStages    = 0;
+                state.visibleStages = 0;
+                state.visibleAccess = 0;
+            } else {
+                state.readStages |= info.stages;
+                if (needed && state.layout != info.layout) {
+                    // the transition is a write, visible to this read only
+                    state.visibleStages = info.stages;
+                    state.visibleAccess = info.access;
+                } else if (needed) {
+                    state.visibleStages |= info.stages;
+                    state.visibleAccess |= info.access;
+                }
+            }
+            state.layout = info.layout;
+        }
+        pass.barrierCount = static_cast<uint32_t>(_barriers.size() - pass.firstBarrier);
+        if (pass.srcStages == 0) {
+            pass.srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        }
+    }
+
+    _transientLastStages = 0;
+    _transientLastAccess = 0;
+    for (uint32_t i = 0; i < _resources.size(); ++i) {
+        if (_resources[i].transient != kNone) {
+            _transientLastStages |= states[i].writeStages | states[i].readStages;
+            _transientLastAccess |= states[i].writeAccess;
+        }
+    }
+
+    // imported images leave the graph in their final layout
+    const size_t firstFinalBarrier = _barriers.size();
+    _finalSrcStages                = 0;
+    _finalDstStages                = 0;
+    for (uint32_t i = 0; i < _resources.size(); ++i) {
+        const Resource& resource = _resources[i];
+        const State&    state    = states[i];
+        if (!resource.imported || resource.import.finalLayout == VK_IMAGE_LAYOUT_UNDEFINED
+            || (resource.firstPass == kNone && state.layout == resource.import.finalLayout)) {
+            continue;
+        }
+        VkImageMemoryBarrier& barrier           = _barriers.emplace_back();
+        barrier                                 = {};
+        barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask                   = state.writeAccess;
+        barrier.dstAccessMask                   = resource.import.finalAccess;
+        barrier.oldLayout                       = state.layout;
+        barrier.newLayout                       = resource.import.finalLayout;
+        barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image                           = resource.image;
+        barrier.subresourceRange.aspectMask     = aspectMask(resource.desc.format, false);
+        barrier.subresourceRange.levelCount     = 1;
+        barrier.subresourceRange.layerCount     = 1;
+        _finalSrcStages |= state.writeStages | state.readStages;
+        _finalDstStages |= resource.import.finalStages;
+    }
+    _finalBarrierCount = static_cast<uint32_t>(_barriers.size() - firstFinalBarrier);
+    if (_finalSrcStages == 0) {
+        _finalSrcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    }
+
+    _stats.barrierCount      = static_cast<uint32_t>(_barriers.size());
+    _stats.barrierBatchCount = _finalBarrierCount != 0 ? 1 : 0;
+    for (uint32_t passIndex : _alivePasses) {
+        _stats.barrierBatchCount += _passes[passIndex].barrierCount != 0 ? 1 : 0;
+    }
+}
+
+bool
+RenderGraph::_CreateRenderPasses()
+{
+    for (uint32_t position = 0; position < _alivePasses.size(); ++position) {
+        Pass& pass       = _passes[_alivePasses[position]];
+        pass.rendering   = false;
+        pass.renderPass  = VK_NULL_HANDLE;
+        pass.framebuffer = VK_NULL_HANDLE;
+        pass.extent      = {};
+        if (pass.type != RenderPassType::Graphics) {
+            continue;
+        }
+        for (const Access& access : pass.accesses) {
+            if (!isAttachmentUsage(access.usage)) {
+                continue;
+            }
+            const Resource& resource = _resources[access.resource];
+            if (!pass.rendering) {
+                pass.extent = {resource.desc.width, resource.desc.height};
+            }
+            ASSERT_MSG(resource.desc.width == pass.extent.width && resource.desc.height == pass.extent.height,
+                "the attachments of %s have different sizes", pass.name.c_str());
+            pass.rendering = true;
+        }
+        // dynamic rendering: begun with the views, nothing to create
+        if (!pass.rendering || (_config.dynamicRendering && !pass.useRenderPass)) {
+            continue;
+        }
+        pass.renderPass = _GetRenderPass(pass, position);
+        if (pass.renderPass == VK_NULL_HANDLE) {
+            return false;
+        }
+        pass.framebuffer = _GetFramebuffer(pass, pass.renderPass);
+        if (pass.framebuffer == VK_NULL_HANDLE) {
+            return false;
+        }
+    }
+    _stats.framebufferCount = static_cast<uint32_t>(_framebuffers.size());
+    return true;
+}
+
+VkRenderPass
+RenderGraph::_GetRenderPass(const Pass& pass, uint32_t position)
+{
+    // the graph does the layout transitions: attachments stay in their layout
+    core::SmallVector<VkAttachmentDescription, 8> attachments;
+    core::SmallVector<VkAttachmentReference, 8>   colorReferences;
+    VkAttachmentReference                         depthReference {};
+    bool                                          hasDepth = false;
+
+    uint64_t key = core::hashValue(pass.accesses.size());
+    for (const Access& access : pass.accesses) {
+        if (!isAttachmentUsage(access.usage)) {
+            continue;
+        }
+        const Resource& resource = _resources[access.resource];
+        const UsageInfo info     = usageInfo(access.usage, pass.type);
+        const bool      store    = _Store(resource, position);
+
+        VkAttachmentDescription& attachment = attachments.emplace_back();
+        attachment                          = {};
+        attachment.format                   = resource.desc.format;
+        attachment.samples                  = resource.desc.samples;
+        attachment.loadOp                   = attachmentLoadOp(access.usage, access.loadOp);
+        attachment.storeOp        = store ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachment.stencilLoadOp  = hasStencil(resource.desc.format) ? attachment.loadOp
+                                                                     : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachment.stencilStoreOp = hasStencil(resource.desc.format) ? attachment.storeOp
+                                                                     : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachment.initialLayout  = info.layout;
+        attachment.finalLayout    = info.layout;
+
+        const VkAttachmentReference reference {static_cast<uint32_t>(attachments.size() - 1), info.layout};
+        if (access.usage == RenderUsage::ColorAttachment) {
+            colorReferences.push_back(reference);
+        } else {
+            ASSERT_MSG(!hasDepth, "pass %s has two depth attachments", pass.name.c_str());
+            depthReference = reference;
+            hasDepth       = true;
+        }
+
+        key = core::hashCombine(key, (uint64_t(attachment.format) << 32) | attachment.samples);
+        key = core::hashCombine(key, (uint64_t(attachment.loadOp) << 32) | attachment.storeOp);
+        key = core::hashCombine(key, (uint64_t(attachment.initialLayout) << 32) | uint64_t(access.usage));
+    }
+
+    auto it = _renderPasses.find(key);
+    if (it != _renderPasses.end()) {
+        return it->second;
+    }
+
+    VkSubpassDescription subpass {};
+    subpass.pipelineBindPoint       = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount    = static_cast<uint32_t>(colorReferences.size());
+    subpass.pColorAttachments       = colorReferences.data();
+    subpass.pDepthStencilAttachment = hasDepth ? &depthReference : nullptr;
+
+    VkRenderPassCreateInfo renderPassInfo {};
+    renderPassInfo.sType           = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+    renderPassInfo.pAttachments    = attachments.data();
+    renderPassInfo.subpassCount    = 1;
+    renderPassInfo.pSubpasses      = &subpass;
+
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    if (vkCreateRenderPass(_device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+        LOG_ERROR("Failed to create the render pass of %s", pass.name.c_str());
+        return VK_NULL_HANDLE;
+    }
+    _renderPasses.try_emplace(key, renderPass);
+    return renderPass;
+}
+
+VkFramebuffer
+RenderGraph::_GetFramebuffer(Pass& pass, VkRenderPass renderPass)
+{
+    core::SmallVector<VkImageView, 8> views;
+    uint64_t                          key = core::hashValue(reinterpret_cast<uint64_t>(renderPass));
+    for (const Access& access : pass.accesses) {
+        if (!isAttachmentUsage(access.usage)) {
+            continue;
+        }
+        const Resource& resource = _resources[access.resource];
+        ASSERT_MSG(resource.view != VK_NULL_HANDLE, "attachment %s has no view", resource.name.c_str());
+        views.push_back(resource.view);
+        key = core::hashCombine(key, reinterpret_cast<uint64_t>(resource.view));
+    }
+    key = core::hashCombine(key, (uint64_t(pass.extent.width) << 32) | pass.extent.height);
+
+    auto it = _framebuffers.find(key);
+    if (it != _framebuffers.end()) {
+        return it->second;
+    }
+
+    VkFramebufferCreateInfo framebufferInfo {};
+    framebufferInfo.sType           = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass      = renderPass;
+    framebufferInfo.attachmentCount = static_cast<uint32_t>(views.size());
+    framebufferInfo.pAttachments    = views.data();
+    framebufferInfo.width           = pass.extent.width;
+    framebufferInfo.height          = pass.extent.height;
+    framebufferInfo.layers          = 1;
+
+    VkFramebuffer framebuffer = VK_NULL_HANDLE;
+    if (vkCreateFramebuffer(_device, &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS) {
+        LOG_ERROR("Failed to create the framebuffer of %s", pass.name.c_str());
+        return VK_NULL_HANDLE;
+    }
+    _framebuffers.try_emplace(key, framebuffer);
+    return framebuffer;
+}
+
+bool
+RenderGraph::_Store(const Resource& resource, uint32_t position) const
+{
+    // last use of a transient image: its content can be dropped
+    return resource.imported || resource.lastPass != position;
+}
+
+void
+RenderGraph::_BeginRenderPass(VkCommandBuffer cmd, const Pass& pass)
+{
+    // in the order of the attachments
+    core::SmallVector<VkClearValue, 8> clearValues;
+    for (const Access& access : pass.accesses) {
+        if (isAttachmentUsage(access.usage)) {
+            clearValues.push_back(access.clear);
+        }
+    }
+    VkRenderPassBeginInfo beginInfo {};
+    beginInfo.sType             = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    beginInfo.renderPass        = pass.renderPass;
+    beginInfo.framebuffer       = pass.framebuffer;
+    beginInfo.renderArea.extent = pass.extent;
+    beginInfo.clearValueCount   = static_cast<uint32_t>(clearValues.size());
+    beginInfo.pClearValues      = clearValues.data();
+    const VkSubpassContents contents
+        = pass.secondary ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE;
+    vkCmdBeginRenderPass(cmd, &beginInfo, contents);
+    _inheritance             = VkCommandBufferInheritanceInfo {};
+    _inheritance.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    _inheritance.renderPass  = pass.renderPass;
+    _inheritance.subpass     = 0;
+    _inheritance.framebuffer = pass.framebuffer;
+}
+
+void
+RenderGraph::_BeginRendering(VkCommandBuffer cmd, const Pass& pass, uint32_t position)
+{
+    // the graph did the layout transitions: the attachments are in their layout
+    core::SmallVector<VkRenderingAttachmentInfoKHR, 8> colorAttachments;
+    VkRenderingAttachmentInfoKHR                       depthAttachment {};
+    VkFormat                                           depthFormat = VK_FORMAT_UNDEFINED;
+    VkSampleCountFlagBits                              samples     = VK_SAMPLE_COUNT_1_BIT;
+    _inheritanceFormats.clear();
+    for (const Access& access : pass.accesses) {
+        if (!isAttachmentUsage(access.usage)) {
+            continue;
+        }
+        const Resource& resource = _resources[access.resource];
+        ASSERT_MSG(resource.view != VK_NULL_HANDLE, "attachment %s has no view", resource.name.c_str());
+
+        VkRenderingAttachmentInfoKHR attachment {};
+        attachment.sType       = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+        attachment.imageView   = resource.view;
+        attachment.imageLayout = usageInfo(access.usage, pass.type).layout;
+        attachment.resolveMode = VK_RESOLVE_MODE_NONE;
+        attachment.loadOp      = attachmentLoadOp(access.usage, access.loadOp);
+        attachment.storeOp     = _Store(resource, position) ? VK_ATTACHMENT_STORE_OP_STORE
+                                                            : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachment.clearValue  = access.clear;
+        samples                = resource.desc.samples;
+        if (access.usage == RenderUsage::ColorAttachment) {
+            colorAttachments.push_back(attachment);
+            _inheritanceFormats.push_back(resource.desc.format);
+        } else {
+            ASSERT_MSG(depthFormat == VK_FORMAT_UNDEFINED, "pass %s has two depth attachments", pass.name.c_str());
+            depthAttachment = attachment;
+            depthFormat     = resource.desc.format;
+        }
+    }
+
+    const bool hasDepth         = depthFormat != VK_FORMAT_UNDEFINED && depthFormat != VK_FORMAT_S8_UINT;
+    const bool hasStencilAspect = hasStencil(depthFormat);
+
+    VkRenderingInfoKHR renderingInfo {};
+    renderingInfo.sType                = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+    renderingInfo.flags                = pass.secondary ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR : 0;
+    renderingInfo.renderArea.extent    = pass.extent;
+    renderingInfo.layerCount           = 1;
+    renderingInfo.colorAttachmentCount = static_cast<uint32_t>(colorAttachments.size());
+    renderingInfo.pColorAttachments    = colorAttachments.data();
+    renderingInfo.pDepthAttachment     = hasDepth ? &depthAttachment : nullptr;
+    renderingInfo.pStencilAttachment   = hasStencilAspect ? &depthAttachment : nullptr;
+    _cmdBeginRendering(cmd, &renderingInfo);
+
+    _inheritanceRendering                         = VkCommandBufferInheritanceRenderingInfoKHR {};
+    _inheritanceRendering.sType                   = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO_KHR;
+    _inheritanceRendering.flags                   = renderingInfo.flags;
+    _inheritanceRendering.colorAttachmentCount    = renderingInfo.colorAttachmentCount;
+    _inheritanceRendering.pColorAttachmentFormats = _inheritanceFormats.data();
+    _inheritanceRendering.depthAttachmentFormat   = hasDepth ? depthFormat : VK_FORMAT_UNDEFINED;
+    _inheritanceRendering.stencilAttachmentFormat = hasStencilAspect ? depthFormat : VK_FORMAT_UNDEFINED;
+    _inheritanceRendering.rasterizationSamples    = samples;
+    _inheritance                                  = VkCommandBufferInheritanceInfo {};
+    _inheritance.sType                            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    _inheritance.pNext                            = &_inheritanceRendering;
+}
+
+void
+RenderGraph::_RetireTransients(Retired& retired)
+{
+    retired.frame = _frame;
+    for (const Transient& transient : _transients) {
+        if (transient.view != VK_NULL_HANDLE) {
+            retired.views.push_back(transient.view);
+        }
+        if (transient.image != VK_NULL_HANDLE) {
+            retired.images.push_back(transient.image);
+        }
+    }
+    _transients.clear();
+    // the framebuffers may use their views
+    for (const auto& entry : _framebuffers) {
+        retired.framebuffers.push_back(entry.second);
+    }
+    _framebuffers.clear();
+    retired.memory     = _transientMemory;
+    _transientMemory   = {};
+    _transientHeapSize = 0;
+    _transientHash     = 0;
+}
+
+void
+RenderGraph::_DestroyRetired(bool all)
+{
+    size_t kept = 0;
+    for (size_t i = 0; i < _retired.size(); ++i) {
+        Retired& retired = _retired[i];
+        if (!all && _frame < retired.frame + _config.framesInFlight) {
+            if (kept != i) {
+                _retired[kept] = std::move(retired);
+            }
+            ++kept;
+            continue;
+        }
+        for (VkFramebuffer framebuffer : retired.framebuffers) {
+            vkDestroyFramebuffer(_device, framebuffer, nullptr);
+        }
+        for (VkImageView view : retired.views) {
+            vkDestroyImageView(_device, view, nullptr);
+        }
+        for (VkImage image : retired.images) {
+            vkDestroyImage(_device, image, nullptr);
+        }
+        if (retired.memory.isValid()) {
+            _memory->Free(retired.memory);
+        }
+    }
+    _retired.resize(kept);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace vulkan
+}   // namespace gfx
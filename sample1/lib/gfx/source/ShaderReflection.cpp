@@ -0,0 +1,603 @@
+#include "gfx/ShaderReflection.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace gfx {
+namespace vulkan {
+/////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+constexpr uint32_t kSpirvMagic      = 0x07230203;
+constexpr uint32_t kHeaderWordCount = 5;
+constexpr uint32_t kNone            = UINT32_MAX;
+constexpr int      kMaxTypeDepth    = 16;
+constexpr uint32_t kMaxLocations    = 64;   // above any device maxVertexInputAttributes
+
+// the subset of the SPIR-V specification used here
+namespace spv {
+enum Op : uint32_t {
+    OpEntryPoint                   = 15,
+    OpTypeBool                     = 20,
+    OpTypeInt                      = 21,
+    OpTypeFloat                    = 22,
+    OpTypeVector                   = 23,
+    OpTypeMatrix                   = 24,
+    OpTypeImage                    = 25,
+    OpTypeSampler                  = 26,
+    OpTypeSampledImage             = 27,
+    OpTypeArray                    = 28,
+    OpTypeRuntimeArray             = 29,
+    OpTypeStruct                   = 30,
+    OpTypePointer                  = 32,
+    OpConstant                     = 43,
+    OpSpecConstantTrue             = 48,
+    OpSpecConstantFalse            = 49,
+    OpSpecConstant                 = 50,
+    OpVariable                     = 59,
+    OpDecorate                     = 71,
+    OpMemberDecorate               = 72,
+    OpTypeAccelerationStructureKHR = 5341,
+};
+
+enum Decoration : uint32_t {
+    SpecId        = 1,
+    Block         = 2,
+    BufferBlock   = 3,
+    RowMajor      = 4,
+    ArrayStride   = 6,
+    MatrixStride  = 7,
+    BuiltIn       = 11,
+    Location      = 30,
+    Binding       = 33,
+    DescriptorSet = 34,
+    Offset        = 35,
+};
+
+enum StorageClass : uint32_t {
+    UniformConstant = 0,
+    Input           = 1,
+    Uniform         = 2,
+    PushConstant    = 9,
+    StorageBuffer   = 12,
+};
+
+enum Dim : uint32_t {
+    DimBuffer      = 5,
+    DimSubpassData = 6,
+};
+
+enum ImageSampled : uint32_t {
+    SampledWithSampler = 1,
+    SampledStorage     = 2,
+};
+}   // namespace spv
+
+//! operands read from the declaring instructions, result id included
+uint32_t
+minOperandCount(uint32_t opcode)
+{
+    switch (opcode) {
+    case spv::OpTypeImage: return 8;
+    case spv::OpTypeInt:
+    case spv::OpTypeVector:
+    case spv::OpTypeMatrix:
+    case spv::OpTypeArray:
+    case spv::OpTypePointer:
+    case spv::OpConstant:
+    case spv::OpSpecConstant:
+    case spv::OpVariable: return 3;
+    case spv::OpTypeFloat:
+    case spv::OpTypeSampledImage:
+    case spv::OpTypeRuntimeArray:
+    case spv::OpSpecConstantTrue:
+    case spv::OpSpecConstantFalse: return 2;
+    default: return 1;
+    }
+}
+
+VkShaderStageFlagBits
+stageFromExecutionModel(uint32_t model)
+{
+    switch (model) {
+    case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+    case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+    case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+    case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+    case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+    case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+    default: return VK_SHADER_STAGE_ALL;   // unsupported
+    }
+}
+
+//! [component count - 1][unsigned, signed, float]
+const VkFormat k16BitFormats[4][3] = {
+    {VK_FORMAT_R16_UINT, VK_FORMAT_R16_SINT, VK_FORMAT_R16_SFLOAT},
+    {VK_FORMAT_R16G16_UINT, VK_FORMAT_R16G16_SINT, VK_FORMAT_R16G16_SFLOAT},
+    {VK_FORMAT_R16G16B16_UINT, VK_FORMAT_R16G16B16_SINT, VK_FORMAT_R16G16B16_SFLOAT},
+    {VK_FORMAT_R16G16B16A16_UINT, VK_FORMAT_R16G16B16A16_SINT, VK_FORMAT_R16G16B16A16_SFLOAT},
+};
+const VkFormat k32BitFormats[4][3] = {
+    {VK_FORMAT_R32_UINT, VK_FORMAT_R32_SINT, VK_FORMAT_R32_SFLOAT},
+    {VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32_SFLOAT},
+    {VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32_SFLOAT},
+    {VK_FORMAT_R32G32B32A32_UINT, VK_FORMAT_R32G32B32A32_SINT, VK_FORMAT_R32G32B32A32_SFLOAT},
+};
+const VkFormat k64BitFormats[4][3] = {
+    {VK_FORMAT_R64_UINT, VK_FORMAT_R64_SINT, VK_FORMAT_R64_SFLOAT},
+    {VK_FORMAT_R64G64_UINT, VK_FORMAT_R64G64_SINT, VK_FORMAT_R64G64_SFLOAT},
+    {VK_FORMAT_R64G64B64_UINT, VK_FORMAT_R64G64B64_SINT, VK_FORMAT_R64G64B64_SFLOAT},
+    {VK_FORMAT_R64G64B64A64_UINT, VK_FORMAT_R64G64B64A64_SINT, VK_FORMAT_R64G64B64A64_SFLOAT},
+};
+
+//! Decorations and declaring instruction of every id: one pass over the
+//! module, then the queries below follow the type ids.
+class Module {
+public:
+    struct Id {
+        uint32_t opcode      = 0;   //!< declaring instruction, 0 for ids not declared by one of the ops above
+        uint32_t offset      = 0;   //!< of the instruction, in words
+        uint32_t set         = kNone;
+        uint32_t binding     = kNone;
+        uint32_t location    = kNone;
+        uint32_t specId      = kNone;
+        uint32_t arrayStride = 0;
+        bool     block       = false;
+        bool     bufferBlock = false;
+        bool     builtIn     = false;
+    };
+
+    struct MemberDecoration {
+        uint32_t structId;
+        uint32_t member;
+        uint32_t decoration;
+        uint32_t value;
+    };
+
+    bool Parse(const uint32_t* words, size_t wordCount);
+
+    const Id& id(uint32_t index) const { return _ids[index]; }
+    //! operand i of the declaring instruction of index (0 is the first word after the opcode)
+    uint32_t operand(uint32_t index, uint32_t i) const { return _words[_ids[index].offset + 1 + i]; }
+    uint32_t operandCount(uint32_t index) const { return (_words[_ids[index].offset] >> 16) - 1; }
+    bool     isValid(uint32_t index) const { return index < _ids.size() && _ids[index].opcode != 0; }
+    bool     is(uint32_t index, uint32_t opcode) const { return index < _ids.size() && _ids[index].opcode == opcode; }
+
+    uint32_t entryPointModel() const { return _entryPointModel; }
+    const std::vector<uint32_t>& variables() const { return _variables; }
+    const std::vector<uint32_t>& specConstants() const { return _specConstants; }
+
+    //! kNone when not decorated
+    uint32_t MemberDecorationValue(uint32_t structId, uint32_t member, uint32_t decoration) const;
+
+    //! in bytes, with the explicit layout decorations (push constants, buffers)
+    bool TypeSize(uint32_t typeId, uint32_t matrixStride, bool rowMajor, uint32_t& size, int depth = 0) const;
+    bool StructSize(uint32_t structId, uint32_t& offset, uint32_t& size, int depth = 0) const;
+    //! OpTypeArray length, kNone when not a constant
+    uint32_t ArrayLength(uint32_t arrayId) const;
+
+private:
+    const uint32_t*               _words = nullptr;
+    std::vector<Id>               _ids;
+    std::vector<MemberDecoration> _memberDecorations;
+    std::vector<uint32_t>         _variables;
+    std::vector<uint32_t>         _specConstants;
+    uint32_t                      _entryPointModel = kNone;
+};
+
+bool
+Module::Parse(const uint32_t* words, size_t wordCount)
+{
+    if (wordCount < kHeaderWordCount || words[0] != kSpirvMagic) {
+        LOG_ERROR("Not SPIR-V (or not in the host byte order)");
+        return false;
+    }
+    const uint32_t bound = words[3];
+    // every id is declared by at least one instruction word
+    if (bound > wordCount) {
+        LOG_ERROR("Invalid SPIR-V id bound %u", bound);
+        return false;
+    }
+    _words = words;
+    _ids.assign(bound, Id());
+
+    size_t offset = kHeaderWordCount;
+    while (offset < wordCount) {
+        const uint32_t  instructionWordCount = words[offset] >> 16;
+        const uint32_t  opcode               = words[offset] & 0xffff;
+        const uint32_t* operands             = words + offset + 1;
+        if (instructionWordCount == 0 || instructionWordCount > wordCount - offset) {
+            LOG_ERROR("Malformed SPIR-V instruction at word %zu", offset);
+            return false;
+        }
+        const uint32_t operandCount = instructionWordCount - 1;
+
+        // position of the result id, 0 when not declared by this instruction
+        uint32_t resultIndex = 0;
+        switch (opcode) {
+        case spv::OpEntryPoint:
+            // "main\0" followed by the padding: 2 words
+            if (_entryPointModel == kNone && operandCount >= 4
+                && strncmp(reinterpret_cast<const char*>(operands + 2), "main", 8) == 0) {
+                _entryPointModel = operands[0];
+            }
+            break;
+        case spv::OpTypeBool:
+        case spv::OpTypeInt:
+        case spv::OpTypeFloat:
+        case spv::OpTypeVector:
+        case spv::OpTypeMatrix:
+        case spv::OpTypeImage:
+        case spv::OpTypeSampler:
+        case spv::OpTypeSampledImage:
+        case spv::OpTypeArray:
+        case spv::OpTypeRuntimeArray:
+        case spv::OpTypeStruct:
+        case spv::OpTypePointer:
+        case spv::OpTypeAccelerationStructureKHR: resultIndex = 1; break;
+        case spv::OpConstant:
+        case spv::OpSpecConstantTrue:
+        case spv::OpSpecConstantFalse:
+        case spv::OpSpecConstant:
+        case spv::OpVariable: resultIndex = 2; break;
+        case spv::OpDecorate:
+            if (operandCount >= 2 && operands[0] < bound) {
+                Id&            target = _ids[operands[0]];
+                const uint32_t value  = operandCount >= 3 ? operands[2] : 0;
+                switch (operands[1]) {
+                case spv::SpecId: target.specId = value; break;
+                case spv::Block: target.block = true; break;
+                case spv::BufferBlock: target.bufferBlock = true; break;
+                case spv::ArrayStride: target.arrayStride = value; break;
+                case spv::BuiltIn: target.builtIn = true; break;
+                case spv::Location: target.location = value; break;
+                case spv::Binding: target.binding = value; break;
+                case spv::DescriptorSet: target.set = value; break;
+                default: break;
+                }
+            }
+            break;
+        case spv::OpMemberDecorate:
+            if (operandCount >= 3) {
+                _memberDecorations.push_back(
+                    MemberDecoration {operands[0], operands[1], operands[2], operandCount >= 4 ? operands[3] : 0});
+            }
+            break;
+        default: break;
+        }
+
+        if (resultIndex != 0) {
+            const uint32_t result = operandCount >= minOperandCount(opcode) ? operands[resultIndex - 1] : kNone;
+            if (result >= bound || _ids[result].opcode != 0) {
+                LOG_ERROR("Malformed SPIR-V instruction at word %zu", offset);
+                return false;
+            }
+            _ids[result].opcode = opcode;
+            _ids[result].offset = static_cast<uint32_t>(offset);
+            if (opcode == spv::OpVariable) {
+                _variables.push_back(result);
+            } else if (opcode != spv::OpConstant && resultIndex == 2) {
+                _specConstants.push_back(result);
+            }
+        }
+        offset += instructionWordCount;
+    }
+
+    if (_entryPointModel == kNone) {
+        LOG_ERROR("No 'main' entry point");
+        return false;
+    }
+    return true;
+}
+
+uint32_t
+Module::MemberDecorationValue(uint32_t structId, uint32_t member, uint32_t decoration) const
+{
+    for (const MemberDecoration& memberDecoration : _memberDecorations) {
+        if (memberDecoration.structId == structId && memberDecoration.member == member
+            && memberDecoration.decoration == decoration) {
+            return memberDecoration.value;
+        }
+    }
+    return kNone;
+}
+
+uint32_t
+Module::ArrayLength(uint32_t arrayId) const
+{
+    // OpTypeArray <result> <element type> <length constant>
+    const uint32_t lengthId = operand(arrayId, 2);
+    if (!is(lengthId, spv::OpConstant) && !is(lengthId, spv::OpSpecConstant)) {
+        return kNone;
+    }
+    // OpConstant <type> <result> <value>: the low word, lengths are 32 bits in practice
+    return operand(lengthId, 2);
+}
+
+bool
+Module::TypeSize(uint32_t typeId, uint32_t matrixStride, bool rowMajor, uint32_t& size, int depth) const
+{
+    if (!isValid(typeId) || depth > kMaxTypeDepth) {
+        return false;
+    }
+    switch (id(typeId).opcode) {
+    case spv::OpTypeBool: size = 4; return true;
+    case spv::OpTypeInt:
+    case spv::OpTypeFloat: size = operand(typeId, 1) / 8; return true;
+    case spv::OpTypeVector: {
+        uint32_t componentSize;
+        if (!TypeSize(operand(typeId, 1), 0, false, componentSize, depth + 1)) {
+            return false;
+        }
+        size = componentSize * operand(typeId, 2);
+        return true;
+    }
+    case spv::OpTypeMatrix: {
+        // columns are vectors: rows = their component count
+        const uint32_t columnId    = operand(typeId, 1);
+        const uint32_t columnCount = operand(typeId, 2);
+        if (!is(columnId, spv::OpTypeVector)) {
+            return false;
+        }
+        if (matrixStride == 0 || matrixStride == kNone) {
+            uint32_t columnSize;
+            if (!TypeSize(columnId, 0, false, columnSize, depth + 1)) {
+                return false;
+            }
+            size = columnSize * columnCount;
+        } else {
+            size = matrixStride * (rowMajor ? operand(columnId, 2) : columnCount);
+        }
+        return true;
+    }
+    case spv::OpTypeArray: {
+        const uint32_t length = ArrayLength(typeId);
+        if (length == kNone || id(typeId).arrayStride == 0) {
+            return false;
+        }
+        size = length * id(typeId).arrayStride;
+        return true;
+    }
+    case spv::OpTypeStruct: {
+        uint32_t offset;
+        if (!StructSize(typeId, offset, size, depth + 1)) {
+            return false;
+        }
+        size += offset;
+        return true;
+    }
+    default: return false;
+    }
+}
+
+bool
+Module::StructSize(uint32_t structId, uint32_t& offset, uint32_t& size, int depth) const
+{
+    uint32_t begin = UINT32_MAX;
+    uint32_t end   = 0;
+    for (uint32_t member = 0; member < operandCount(structId) - 1; ++member) {
+        const uint32_t memberOffset = MemberDecorationValue(structId, member, spv::Offset);
+        const uint32_t matrixStride = MemberDecorationValue(structId, member, spv::MatrixStride);
+        const bool     rowMajor     = MemberDecorationValue(structId, member, spv::RowMajor) != kNone;
+        uint32_t       memberSize;
+        if (memberOffset == kNone || !TypeSize(operand(structId, member + 1), matrixStride, rowMajor, memberSize, depth)) {
+            return false;
+        }
+        begin = std::min(begin, memberOffset);
+        end   = std::max(end, memberOffset + memberSize);
+    }
+    offset = begin != UINT32_MAX ? begin : 0;
+    size   = end - offset;
+    return true;
+}
+
+VkFormat
+vertexInputFormat(const Module& module, uint32_t typeId)
+{
+    uint32_t componentCount = 1;
+    if (module.is(typeId, spv::OpTypeVector)) {
+        componentCount = module.operand(typeId, 2);
+        typeId         = module.operand(typeId, 1);
+    }
+    if (componentCount < 1 || componentCount > 4) {
+        return VK_FORMAT_UNDEFINED;
+    }
+
+    // OpTypeInt <result> <width> <signedness>, OpTypeFloat <result> <width>
+    size_t kind;
+    if (module.is(typeId, spv::OpTypeFloat)) {
+        kind = 2;
+    } else if (module.is(typeId, spv::OpTypeInt)) {
+        kind = module.operand(typeId, 2) != 0 ? 1 : 0;
+    } else {
+        return VK_FORMAT_UNDEFINED;
+    }
+    switch (module.operand(typeId, 1)) {
+    case 16: return k16BitFormats[componentCount - 1][kind];
+    case 32: return k32BitFormats[componentCount - 1][kind];
+    case 64: return k64BitFormats[componentCount - 1][kind];
+    default: return VK_FORMAT_UNDEFINED;
+    }
+}
+
+//! VK_DESCRIPTOR_TYPE_MAX_ENUM when the variable is not a descriptor
+VkDescriptorType
+descriptorType(const Module& module, uint32_t typeId, uint32_t storageClass)
+{
+    switch (module.id(typeId).opcode) {
+    case spv::OpTypeSampler: return VK_DESCRIPTOR_TYPE_SAMPLER;
+    case spv::OpTypeSampledImage: {
+        const uint32_t imageId = module.operand(typeId, 1);
+        return module.is(imageId, spv::OpTypeImage) && module.operand(imageId, 2) == spv::DimBuffer
+                 ? VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER
+                 : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    }
+    case spv::OpTypeImage: {
+        // OpTypeImage <result> <sampled type> <dim> <depth> <arrayed> <ms> <sampled> <format>
+        const uint32_t dim     = module.operand(typeId, 2);
+        const uint32_t sampled = module.operand(typeId, 6);
+        if (dim == spv::DimBuffer) {
+            return sampled == spv::SampledStorage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER
+                                                  : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+        }
+        if (dim == spv::DimSubpassData) {
+            return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+        }
+        return sampled == spv::SampledStorage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    }
+    case spv::OpTypeStruct:
+        if (storageClass == spv::StorageBuffer || module.id(typeId).bufferBlock) {
+            return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        }
+        return module.id(typeId).block ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_MAX_ENUM;
+    case spv::OpTypeAccelerationStructureKHR: return VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+    default: return VK_DESCRIPTOR_TYPE_MAX_ENUM;
+    }
+}
+}   // namespace
+
+/////////////////////////////////////////////////////////////////////////////////
+
+bool
+reflectShader(const core::vfs::FileHandle& code, ShaderReflection& reflection)
+{
+    reflection = ShaderReflection();
+    if (code.size() % sizeof(uint32_t) != 0) {
+        LOG_ERROR("Invalid SPIR-V size: %zu bytes", code.size());
+        return false;
+    }
+
+    Module module;
+    if (!module.Parse(code.dataAs<uint32_t>(), code.size() / sizeof(uint32_t))) {
+        return false;
+    }
+    reflection.stage = stageFromExecutionModel(module.entryPointModel());
+    if (reflection.stage == VK_SHADER_STAGE_ALL) {
+        LOG_ERROR("Unsupported SPIR-V execution model %u", module.entryPointModel());
+        return false;
+    }
+
+    for (const uint32_t variable : module.variables()) {
+        // OpVariable <pointer type> <result> <storage class>
+        const uint32_t pointerId    = module.operand(variable, 0);
+        const uint32_t storageClass = module.operand(variable, 2);
+        if (!module.is(pointerId, spv::OpTypePointer)) {
+            LOG_ERROR("Malformed SPIR-V variable %u", variable);
+            return false;
+        }
+        // OpTypePointer <result> <storage class> <type>
+        uint32_t typeId = module.operand(pointerId, 2);
+
+        if (storageClass == spv::PushConstant) {
+            uint32_t offset, size;
+            if (reflection.pushConstants.size != 0 || !module.is(typeId, spv::OpTypeStruct)
+                || !module.StructSize(typeId, offset, size)) {
+                LOG_ERROR("Unsupported push constant block %u", variable);
+                return false;
+            }
+            reflection.pushConstants.stageFlags = reflection.stage;
+            reflection.pushConstants.offset     = offset;
+            reflection.pushConstants.size       = size;
+            continue;
+        }
+
+        if (storageClass == spv::Input && reflection.stage == VK_SHADER_STAGE_VERTEX_BIT) {
+            const Module::Id& input = module.id(variable);
+            if (input.builtIn || input.location == kNone) {
+                continue;
+            }
+            uint32_t locationCount = 1;
+            if (module.is(typeId, spv::OpTypeArray)) {
+                locationCount = module.ArrayLength(typeId);
+                typeId        = module.operand(typeId, 1);
+            }
+            if (module.is(typeId, spv::OpTypeMatrix) && locationCount <= kMaxLocations) {
+                locationCount *= module.operand(typeId, 2);
+                typeId = module.operand(typeId, 1);
+            }
+            const VkFormat format = vertexInputFormat(module, typeId);
+            if (format == VK_FORMAT_UNDEFINED || input.location >= kMaxLocations
+                || locationCount > kMaxLocations - input.location) {
+                LOG_ERROR("Unsupported vertex input at location %u", input.location);
+                return false;
+            }
+            for (uint32_t i = 0; i < locationCount; ++i) {
+                reflection.vertexInputs.push_back(VertexInput {input.location + i, format});
+            }
+            continue;
+        }
+
+        if (storageClass != spv::UniformConstant && storageClass != spv::Uniform
+            && storageClass != spv::StorageBuffer) {
+            continue;
+        }
+        const Module::Id& resource = module.id(variable);
+        if (resource.binding == kNone) {
+            continue;   // not a descriptor (e.g. OpenGL style default uniforms)
+        }
+
+        DescriptorBinding binding;
+        binding.set     = resource.set != kNone ? resource.set : 0;
+        binding.binding = resource.binding;
+        binding.stages  = reflection.stage;
+        for (int depth = 0; depth < kMaxTypeDepth; ++depth) {
+            if (module.is(typeId, spv::OpTypeArray)) {
+                const uint32_t length = module.ArrayLength(typeId);
+                binding.count *= length != kNone ? length : 0;
+            } else if (module.is(typeId, spv::OpTypeRuntimeArray)) {
+                binding.count = 0;
+            } else {
+                break;
+            }
+            typeId = module.operand(typeId, 1);
+        }
+        binding.type = module.isValid(typeId) ? descriptorType(module, typeId, storageClass)
+                                                : VK_DESCRIPTOR_TYPE_MAX_ENUM;
+        if (binding.type == VK_DESCRIPTOR_TYPE_MAX_ENUM) {
+            LOG_ERROR("Unsupported descriptor at set %u binding %u", binding.set, binding.binding);
+            return false;
+        }
+        reflection.descriptorBindings.push_back(binding);
+    }
+
+    for (const uint32_t constant : module.specConstants()) {
+        const uint32_t specId = module.id(constant).specId;
+        if (specId == kNone) {
+            continue;   // OpSpecConstant without SpecId: not settable from the API
+        }
+        SpecializationConstant specialization;
+        specialization.id = specId;
+        if (!module.TypeSize(module.operand(constant, 0), 0, false, specialization.size)) {
+            LOG_ERROR("Unsupported specialization constant %u", specId);
+            return false;
+        }
+        reflection.specializationConstants.push_back(specialization);
+    }
+
+    std::sort(reflection.descriptorBindings.begin(), reflection.descriptorBindings.end(),
+        [](const DescriptorBinding& a, const DescriptorBinding& b) {
+            return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+        });
+    std::sort(reflection.vertexInputs.begin(), reflection.vertexInputs.end(),
+        [](const VertexInput& a, const VertexInput& b) { return a.location < b.location; });
+    std::sort(reflection.specializationConstants.begin(), reflection.specializationConstants.end(),
+        [](const SpecializationConstant& a, const SpecializationConstant& b) { return a.id < b.id; });
+
+    // aliased resources share a binding: fine when they agree on the descriptor
+    auto& bindings = reflection.descriptorBindings;
+    for (size_t i = 1; i < bindings.size(); ++i) {
+        if (bindings[i].set == bindings[i - 1].set && bindings[i].binding == bindings[i - 1].binding) {
+            if (bindings[i].type != bindings[i - 1].type || bindings[i].count != bindings[i - 1].count) {
+                LOG_ERROR("Conflicting descriptors at set %u binding %u", bindings[i].set, bindings[i].binding);
+                return false;
+            }
+            bindings.erase(bindings.begin() + i--);
+        }
+    }
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace vulkan
+}   // namespace gfx
@@ -0,0 +1,571 @@
+#include "gfx/UploadManager.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace gfx {
+namespace vulkan {
+/////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+// what the consumer stages read from the uploaded resources
+constexpr VkAccessFlags kBufferConsumerAccess = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_INDEX_READ_BIT
+    | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+constexpr VkAccessFlags kImageConsumerAccess = VK_ACCESS_SHADER_READ_BIT;
+}   // namespace
+
+bool
+UploadManager::Init(VkDevice device, DeviceMemoryAllocator& memory, const Queues& queues, const Config& config)
+{
+    ASSERT(_device == VK_NULL_HANDLE);
+    ASSERT_MSG(!queues.isDedicated() || queues.timelineSemaphore,
+        "a dedicated transfer queue requires VK_KHR_timeline_semaphore");
+    ASSERT_MSG(queues.imageGranularity.width == 1 && queues.imageGranularity.height == 1
+            && queues.imageGranularity.depth == 1,
+        "image uploads split by rows require a (1, 1, 1) transfer granularity, upload on the graphics family");
+    ASSERT_MSG(config.ringSize % kStagingAlignment == 0, "the staging ring size must be a multiple of 16");
+    // a budget over half the ring would leave the next frame waiting for the GPU
+    ASSERT_MSG(config.frameBudget != 0 && config.frameBudget <= config.ringSize / 2,
+        "the upload frame budget must fit twice in the staging ring");
+
+    _device = device;
+    _memory = &memory;
+    _queues = queues;
+    _config = config;
+
+    VkBufferCreateInfo bufferInfo {};
+    bufferInfo.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size        = config.ringSize;
+    bufferInfo.usage       = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (vkCreateBuffer(_device, &bufferInfo, nullptr, &_stagingBuffer) != VK_SUCCESS
+        || !_memory->AllocateForBuffer(_stagingBuffer, MemoryUsage::Upload, _stagingMemory)) {
+        LOG_ERROR("Failed to create the %llu bytes staging ring", static_cast<unsigned long long>(config.ringSize));
+        Destroy();
+        return false;
+    }
+    _ring = core::RingAllocator(config.ringSize);
+
+    if (queues.timelineSemaphore) {
+        _getSemaphoreCounterValue = reinterpret_cast<PFN_vkGetSemaphoreCounterValueKHR>(
+            vkGetDeviceProcAddr(_device, "vkGetSemaphoreCounterValueKHR"));
+        _waitSemaphores
+            = reinterpret_cast<PFN_vkWaitSemaphoresKHR>(vkGetDeviceProcAddr(_device, "vkWaitSemaphoresKHR"));
+
+        VkSemaphoreTypeCreateInfoKHR typeInfo {};
+        typeInfo.sType         = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+        typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+        typeInfo.initialValue  = 0;
+        VkSemaphoreCreateInfo semaphoreInfo {};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphoreInfo.pNext = &typeInfo;
+        if (_getSemaphoreCounterValue == nullptr || _waitSemaphores == nullptr
+            || vkCreateSemaphore(_device, &semaphoreInfo, nullptr, &_timeline) != VK_SUCCESS) {
+            LOG_ERROR("Failed to create the upload timeline semaphore");
+            Destroy();
+            return false;
+        }
+    }
+
+    VkCommandPoolCreateInfo poolInfo {};
+    poolInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = queues.transferFamily;
+
+    VkFenceCreateInfo fenceInfo {};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    // otherwise the timeline semaphore tells when the batches complete
+    const bool needsFence = _timeline == VK_NULL_HANDLE;
+    for (uint32_t i = 0; i < kMaxBatches; ++i) {
+        Batch& batch = _batches.emplace_back();
+        if (vkCreateCommandPool(_device, &poolInfo, nullptr, &batch.commandPool) != VK_SUCCESS
+            || (needsFence && vkCreateFence(_device, &fenceInfo, nullptr, &batch.fence) != VK_SUCCESS)) {
+            LOG_ERROR("Failed to create the upload batches");
+            Destroy();
+            return false;
+        }
+        VkCommandBufferAllocateInfo allocateInfo {};
+        allocateInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocateInfo.commandPool        = batch.commandPool;
+        allocateInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocateInfo.commandBufferCount = 1;
+        VK_CHECK(vkAllocateCommandBuffers(_device, &allocateInfo, &batch.commandBuffer));
+    }
+    return true;
+}
+
+void
+UploadManager::Destroy()
+{
+    if (_device == VK_NULL_HANDLE) {
+        return;
+    }
+    while (_WaitOldestBatch()) {
+    }
+    if (!_pending.empty()) {
+        LOG_WARN("%zu uploads dropped", _pending.size());
+        _pending.clear();
+    }
+    if (_recording) {
+        // never submitted: the pool is destroyed with it
+        vkEndCommandBuffer(_batches[_currentBatch].commandBuffer);
+        _recording = false;
+    }
+    for (Batch& batch : _batches) {
+        VK_DESTROY_WITH_DEVICE(vkDestroyFence, _device, batch.fence, nullptr);
+        VK_DESTROY_WITH_DEVICE(vkDestroyCommandPool, _device, batch.commandPool, nullptr);
+    }
+    _batches.clear();
+    _releasedBuffers.clear();
+    _releasedImages.clear();
+    _acquireBuffers.clear();
+    _acquireImages.clear();
+    VK_DESTROY_WITH_DEVICE(vkDestroySemaphore, _device, _timeline, nullptr);
+    _timelineValue = 0;
+    VK_DESTROY_WITH_DEVICE(vkDestroyBuffer, _device, _stagingBuffer, nullptr);
+    _memory->Free(_stagingMemory);
+    _device = VK_NULL_HANDLE;
+}
+
+UploadToken
+UploadManager::UploadBuffer(VkBuffer buffer, VkDeviceSize offset, const void* data, VkDeviceSize size)
+{
+    ASSERT(_device != VK_NULL_HANDLE && buffer != VK_NULL_HANDLE);
+    const UploadToken token {++_uploadCount};
+    const uint8_t*    bytes = static_cast<const uint8_t*>(data);
+
+    // behind pending uploads: everything waits for a later frame
+    VkDeviceSize done = 0;
+    if (_pending.empty() && _StageBuffer(buffer, offset, bytes, size, done)) {
+        _recordedUpload = token.value;
+        return token;
+    }
+    PendingUpload& pending = _pending.emplace_back();
+    pending.token          = token.value;
+    pending.buffer         = buffer;
+    pending.offset         = offset + done;
+    pending.data.assign(bytes + done, bytes + size);
+    return token;
+}
+
+UploadToken
+UploadManager::UploadImage(const ImageUpload& image, const void* data)
+{
+    ASSERT(_device != VK_NULL_HANDLE && image.image != VK_NULL_HANDLE);
+    ASSERT_MSG(kStagingAlignment % image.bytesPerTexel == 0, "unsupported texel size %u", image.bytesPerTexel);
+    const UploadToken token {++_uploadCount};
+    const uint8_t*    bytes   = static_cast<const uint8_t*>(data);
+    const size_t      rowSize = size_t(image.width) * image.bytesPerTexel;
+
+    uint32_t row = 0;
+    if (_pending.empty() && _StageImage(image, bytes, 0, row)) {
+        _recordedUpload = token.value;
+        return token;
+    }
+    PendingUpload& pending = _pending.emplace_back();
+    pending.token          = token.value;
+    pending.image          = image;
+    pending.firstRow       = row;
+    pending.row            = row;
+    pending.data.assign(bytes + row * rowSize, bytes + image.height * rowSize);
+    return token;
+}
+
+UploadToken
+UploadManager::Record(core::InplaceFunction<void(VkCommandBuffer)>&& commands)
+{
+    ASSERT(_device != VK_NULL_HANDLE);
+    const UploadToken token {++_uploadCount};
+    if (_pending.empty()) {
+        commands(_CommandBuffer());
+        _recordedUpload = token.value;
+        return token;
+    }
+    PendingUpload& pending = _pending.emplace_back();
+    pending.token          = token.value;
+    pending.commands       = std::move(commands);
+    return token;
+}
+
+void
+UploadManager::Flush()
+{
+    ASSERT(_device != VK_NULL_HANDLE);
+    _Reclaim();
+    _ProcessPending();
+    if (_recording) {
+        _Submit();
+    }
+    _lastFrameBytes = _frameBytes;
+    _frameBytes     = 0;
+}
+
+bool
+UploadManager::IsComplete(UploadToken token)
+{
+    if (token.value > _completedUpload) {
+        _Reclaim();
+    }
+    return token.value <= _completedUpload;
+}
+
+void
+UploadManager::Wait(UploadToken token)
+{
+    ASSERT(token.value <= _uploadCount);
+    while (!IsComplete(token)) {
+        if (token.value > _submittedUpload) {
+            const uint64_t submittedUpload = _submittedUpload;
+            Flush();
+            if (_submittedUpload != submittedUpload) {
+                continue;
+            }
+        }
+        // the ring is full: the oldest batch frees its space
+        if (!_WaitOldestBatch()) {
+            LOG_ERROR("Upload %llu can not make progress", static_cast<unsigned long long>(token.value));
+            return;
+        }
+    }
+}
+
+UploadManager::QueueWait
+UploadManager::GetQueueWait() const
+{
+    QueueWait wait;
+    if (_queues.isDedicated() && _timelineValue != 0) {
+        wait.semaphore = _timeline;
+        wait.value     = _timelineValue;
+        wait.stages    = kConsumerStages;
+    }
+    return wait;
+}
+
+void
+UploadManager::RecordAcquireBarriers(VkCommandBuffer cmd)
+{
+    if (_acquireBuffers.empty() && _acquireImages.empty()) {
+        return;
+    }
+    // chained to the semaphore wait by the stages
+    vkCmdPipelineBarrier(cmd, kConsumerStages, kConsumerStages, 0, 0, nullptr,
+        static_cast<uint32_t>(_acquireBuffers.size()), _acquireBuffers.data(),
+        static_cast<uint32_t>(_acquireImages.size()), _acquireImages.data());
+    _acquireBuffers.clear();
+    _acquireImages.clear();
+}
+
+UploadManager::Stats
+UploadManager::GetStats() const
+{
+    Stats stats;
+    stats.uploadCount    = _uploadCount;
+    stats.completedCount = _completedUpload;
+    stats.frameBytes     = _lastFrameBytes;
+    stats.ringUsedBytes  = _ring.usedBytes();
+    stats.stallCount     = _stallCount;
+    stats.dedicatedQueue = _queues.isDedicated();
+    for (const PendingUpload& pending : _pending) {
+        stats.pendingBytes += pending.data.size();
+    }
+    for (const Batch& batch : _batches) {
+        stats.batchesInFlight += batch.inFlight ? 1 : 0;
+    }
+    return stats;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+
+VkCommandBuffer
+UploadManager::_CommandBuffer()
+{
+    Batch& batch = _batches[_currentBatch];
+    if (_recording) {
+        return batch.commandBuffer;
+    }
+    if (batch.inFlight) {
+        // every batch is in flight: the GPU is kMaxBatches frames behind
+        ++_stallCount;
+        while (batch.inFlight) {
+            _WaitOldestBatch();
+        }
+    }
+    vkResetCommandPool(_device, batch.commandPool, 0);
+
+    VkCommandBufferBeginInfo beginInfo {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    VK_CHECK(vkBeginCommandBuffer(batch.commandBuffer, &beginInfo));
+    _recording = true;
+    return batch.commandBuffer;
+}
+
+bool
+UploadManager::_StageBuffer(
+    VkBuffer buffer, VkDeviceSize offset, const uint8_t* data, VkDeviceSize size, VkDeviceSize& done)
+{
+    while (done < size) {
+        if (_frameBytes >= _config.frameBudget) {
+            return false;
+        }
+        const VkDeviceSize chunk      = std::min(size - done, _config.frameBudget - _frameBytes);
+        VkCommandBuffer    cmd        = _CommandBuffer();
+        const uint64_t     ringOffset = _ring.Allocate(chunk, kStagingAlignment);
+        if (ringOffset == core::RingAllocator::kInvalidOffset) {
+            return false;
+        }
+        std::memcpy(static_cast<uint8_t*>(_stagingMemory.mapped) + ringOffset, data + done, chunk);
+        _memory->Flush(_stagingMemory, ringOffset, chunk);
+
+        VkBufferCopy copy {};
+        copy.srcOffset = ringOffset;
+        copy.dstOffset = offset + done;
+        copy.size      = chunk;
+        vkCmdCopyBuffer(cmd, _stagingBuffer, buffer, 1, &copy);
+        if (_queues.isDedicated()) {
+            _ReleaseBuffer(cmd, buffer, copy.dstOffset, chunk);
+        }
+
+        done += chunk;
+        _frameBytes += chunk;
+    }
+    return true;
+}
+
+bool
+UploadManager::_StageImage(const ImageUpload& image, const uint8_t* data, uint32_t firstRow, uint32_t& row)
+{
+    const VkDeviceSize rowSize = VkDeviceSize(image.width) * image.bytesPerTexel;
+
+    VkImageMemoryBarrier barrier {};
+    barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image                           = image.image;
+    barrier.subresourceRange.aspectMask     = image.aspect;
+    barrier.subresourceRange.baseMipLevel   = image.mipLevel;
+    barrier.subresourceRange.levelCount     = 1;
+    barrier.subresourceRange.baseArrayLayer = image.arrayLayer;
+    barrier.subresourceRange.layerCount     = 1;
+
+    while (row < image.height) {
+        // whole rows, at least one per frame: any row offset is allowed by
+        // the (1, 1, 1) transfer granularity of the queue
+        if (_frameBytes != 0 && _frameBytes + rowSize > _config.frameBudget) {
+            return false;
+        }
+        const VkDeviceSize budgetRows = std::max<VkDeviceSize>((_config.frameBudget - _frameBytes) / rowSize, 1);
+        const uint32_t     rows       = static_cast<uint32_t>(std::min<VkDeviceSize>(image.height - row, budgetRows));
+        const VkDeviceSize chunk      = rows * rowSize;
+        ASSERT_MSG(chunk <= _ring.size(), "an image row does not fit in the staging ring");
+        VkCommandBuffer cmd        = _CommandBuffer();
+        const uint64_t  ringOffset = _ring.Allocate(chunk, kStagingAlignment);
+        if (ringOffset == core::RingAllocator::kInvalidOffset) {
+            return false;
+        }
+        std::memcpy(static_cast<uint8_t*>(_stagingMemory.mapped) + ringOffset,
+            data + (row - firstRow) * rowSize, chunk);
+        _memory->Flush(_stagingMemory, ringOffset, chunk);
+
+        if (row == 0) {
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.oldLayout     = VK_IMAGE_LAYOUT_UNDEFINED;
+            barrier.newLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0,
+                nullptr, 0, nullptr, 1, &barrier);
+        }
+
+        VkBufferImageCopy copy {};
+        copy.bufferOffset                    = ringOffset;
+        copy.imageSubresource.aspectMask     = image.aspect;
+        copy.imageSubresource.mipLevel       = image.mipLevel;
+        copy.imageSubresource.baseArrayLayer = image.arrayLayer;
+        copy.imageSubresource.layerCount     = 1;
+        copy.imageOffset                     = {0, static_cast<int32_t>(row), 0};
+        copy.imageExtent                     = {image.width, rows, 1};
+        vkCmdCopyBufferToImage(cmd, _stagingBuffer, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
+
+        row += rows;
+        _frameBytes += chunk;
+        if (row == image.height) {
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = kImageConsumerAccess;
+            barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.newLayout     = image.finalLayout;
+            if (_queues.isDedicated()) {
+                _ReleaseImage(cmd, barrier);
+            } else {
+                vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0,
+                    nullptr, 0, nullptr, 1, &barrier);
+            }
+        }
+    }
+    return true;
+}
+
+void
+UploadManager::_ProcessPending()
+{
+    while (!_pending.empty()) {
+        PendingUpload& pending = _pending.front();
+        if (pending.commands) {
+            pending.commands(_CommandBuffer());
+        } else if (pending.buffer != VK_NULL_HANDLE) {
+            if (!_StageBuffer(pending.buffer, pending.offset, pending.data.data(), pending.data.size(), pending.done)) {
+                return;
+            }
+        } else if (!_StageImage(pending.image, pending.data.data(), pending.firstRow, pending.row)) {
+            return;
+        }
+        _recordedUpload = pending.token;
+        _pending.pop_front();
+    }
+}
+
+void
+UploadManager::_ReleaseBuffer(VkCommandBuffer cmd, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size)
+{
+    VkBufferMemoryBarrier barrier {};
+    barrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask       = 0;
+    barrier.srcQueueFamilyIndex = _queues.transferFamily;
+    barrier.dstQueueFamilyIndex = _queues.graphicsFamily;
+    barrier.buffer              = buffer;
+    barrier.offset              = offset;
+    barrier.size                = size;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1,
+        &barrier, 0, nullptr);
+
+    // the acquire matches the release, its access scope is on the graphics queue
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = kBufferConsumerAccess;
+    _releasedBuffers.push_back(barrier);
+}
+
+void
+UploadManager::_ReleaseImage(VkCommandBuffer cmd, const VkImageMemoryBarrier& transition)
+{
+    // the layout transition happens once, between the release and the acquire
+    VkImageMemoryBarrier barrier = transition;
+    barrier.dstAccessMask        = 0;
+    barrier.srcQueueFamilyIndex  = _queues.transferFamily;
+    barrier.dstQueueFamilyIndex  = _queues.graphicsFamily;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0,
+        nullptr, 1, &barrier);
+
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = transition.dstAccessMask;
+    _releasedImages.push_back(barrier);
+}
+
+void
+UploadManager::_Submit()
+{
+    Batch& batch = _batches[_currentBatch];
+
+    if (!_queues.isDedicated()) {
+        // the copies are visible to everything submitted after
+        VkMemoryBarrier barrier {};
+        barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+        vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+            0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+    VK_CHECK(vkEndCommandBuffer(batch.commandBuffer));
+
+    VkSubmitInfo submitInfo {};
+    submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers    = &batch.commandBuffer;
+
+    VkTimelineSemaphoreSubmitInfoKHR timelineInfo {};
+    if (_timeline != VK_NULL_HANDLE) {
+        batch.timelineValue = ++_timelineValue;
+
+        timelineInfo.sType                     = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+        timelineInfo.signalSemaphoreValueCount = 1;
+        timelineInfo.pSignalSemaphoreValues    = &batch.timelineValue;
+        submitInfo.pNext                       = &timelineInfo;
+        submitInfo.signalSemaphoreCount        = 1;
+        submitInfo.pSignalSemaphores           = &_timeline;
+    }
+    VK_CHECK_MSG(vkQueueSubmit(_queues.transfer, 1, &submitInfo, batch.fence), "failed to submit uploads");
+
+    // the graphics queue acquires what the batch released once it waits for it
+    _acquireBuffers.insert(_acquireBuffers.end(), _releasedBuffers.begin(), _releasedBuffers.end());
+    _acquireImages.insert(_acquireImages.end(), _releasedImages.begin(), _releasedImages.end());
+    _releasedBuffers.clear();
+    _releasedImages.clear();
+
+    batch.ringMarker = _ring.head();
+    batch.lastUpload = _recordedUpload;
+    batch.inFlight   = true;
+    _submittedUpload = _recordedUpload;
+    _recording       = false;
+    _currentBatch    = (_currentBatch + 1) % kMaxBatches;
+}
+
+void
+UploadManager::_Reclaim()
+{
+    // one query for all the batches
+    uint64_t completedValue = 0;
+    if (_timeline != VK_NULL_HANDLE) {
+        VK_CHECK(_getSemaphoreCounterValue(_device, _timeline, &completedValue));
+    }
+    // in submission order, starting with the oldest
+    for (uint32_t i = 0; i < _batches.size(); ++i) {
+        Batch& batch = _batches[(_currentBatch + i) % _batches.size()];
+        if (!batch.inFlight) {
+            continue;
+        }
+        const bool complete = _timeline != VK_NULL_HANDLE ? batch.timelineValue <= completedValue
+                                                          : vkGetFenceStatus(_device, batch.fence) == VK_SUCCESS;
+        if (!complete) {
+            return;
+        }
+        _CompleteBatch(batch);
+    }
+}
+
+bool
+UploadManager::_WaitOldestBatch()
+{
+    for (uint32_t i = 0; i < _batches.size(); ++i) {
+        Batch& batch = _batches[(_currentBatch + i) % _batches.size()];
+        if (batch.inFlight) {
+            if (_timeline != VK_NULL_HANDLE) {
+                VkSemaphoreWaitInfoKHR waitInfo {};
+                waitInfo.sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+                waitInfo.semaphoreCount = 1;
+                waitInfo.pSemaphores    = &_timeline;
+                waitInfo.pValues        = &batch.timelineValue;
+                _waitSemaphores(_device, &waitInfo, UINT64_MAX);
+            } else {
+                vkWaitForFences(_device, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+            }
+            _CompleteBatch(batch);
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+UploadManager::_CompleteBatch(Batch& batch)
+{
+    if (batch.fence != VK_NULL_HANDLE) {
+        vkResetFences(_device, 1, &batch.fence);
+    }
+    _ring.Release(batch.ringMarker);
+    _completedUpload = batch.lastUpload;
+    batch.inFlight   = false;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace vulkan
+}   // namespace gfx
@@ -0,0 +1,271 @@
+#include "gfx/DeviceMemory.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <vector>
+
+namespace {
+/////////////////////////////////////////////////////////////////////////////////
+
+using gfx::vulkan::DeviceMemoryAllocator;
+using gfx::vulkan::MemoryAllocation;
+using gfx::vulkan::MemoryUsage;
+
+//! A device on lavapipe, the CPU implementation of Mesa: the tests are skipped
+//! on machines without it, a GPU driver would make them depend on its memory
+//! types and limits.
+class DeviceMemory : public ::testing::Test {
+protected:
+    struct Buffer {
+        VkBuffer         buffer = VK_NULL_HANDLE;
+        MemoryAllocation allocation;
+    };
+
+    void
+    SetUp() override
+    {
+        VkApplicationInfo applicationInfo {};
+        applicationInfo.sType      = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+        applicationInfo.apiVersion = VK_API_VERSION_1_0;
+        VkInstanceCreateInfo instanceInfo {};
+        instanceInfo.sType            = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+        instanceInfo.pApplicationInfo = &applicationInfo;
+        if (vkCreateInstance(&instanceInfo, nullptr, &_instance) != VK_SUCCESS) {
+            _instance = VK_NULL_HANDLE;
+            GTEST_SKIP() << "no Vulkan implementation";
+        }
+
+        uint32_t count = 0;
+        vkEnumeratePhysicalDevices(_instance, &count, nullptr);
+        std::vector<VkPhysicalDevice> physicalDevices(count);
+        vkEnumeratePhysicalDevices(_instance, &count, physicalDevices.data());
+        for (VkPhysicalDevice physicalDevice : physicalDevices) {
+            VkPhysicalDeviceProperties properties;
+            vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+            if (properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU) {
+                _physicalDevice = physicalDevice;
+                break;
+            }
+        }
+        if (_physicalDevice == VK_NULL_HANDLE) {
+            GTEST_SKIP() << "no lavapipe device";
+        }
+
+        const float             priority = 1.f;
+        VkDeviceQueueCreateInfo queueInfo {};
+        queueInfo.sType            = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+        queueInfo.queueFamilyIndex = 0;
+        queueInfo.queueCount       = 1;
+        queueInfo.pQueuePriorities = &priority;
+        VkDeviceCreateInfo deviceInfo {};
+        deviceInfo.sType                = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        deviceInfo.queueCreateInfoCount = 1;
+        deviceInfo.pQueueCreateInfos    = &queueInfo;
+        ASSERT_EQ(vkCreateDevice(_physicalDevice, &deviceInfo, nullptr, &_device), VK_SUCCESS);
+
+        // small blocks: a few buffers fill one
+        DeviceMemoryAllocator::Config config;
+        config.blockSize          = 1024 * 1024;
+        config.dedicatedThreshold = 4 * 1024 * 1024;
+        ASSERT_TRUE(_allocator.Init(_physicalDevice, _device, config));
+    }
+
+    void
+    TearDown() override
+    {
+        if (_device != VK_NULL_HANDLE) {
+            _allocator.Destroy();
+            vkDestroyDevice(_device, nullptr);
+        }
+        if (_instance != VK_NULL_HANDLE) {
+            vkDestroyInstance(_instance, nullptr);
+        }
+    }
+
+    VkBuffer
+    createBuffer(VkDeviceSize size)
+    {
+        VkBufferCreateInfo bufferInfo {};
+        bufferInfo.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size        = size;
+        bufferInfo.usage       = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        VkBuffer buffer        = VK_NULL_HANDLE;
+        EXPECT_EQ(vkCreateBuffer(_device, &bufferInfo, nullptr, &buffer), VK_SUCCESS);
+        return buffer;
+    }
+
+    void
+    destroyBuffer(Buffer& buffer)
+    {
+        vkDestroyBuffer(_device, buffer.buffer, nullptr);
+        _allocator.Free(buffer.allocation);
+        buffer = Buffer();
+    }
+
+    //! the stats of every heap added up
+    DeviceMemoryAllocator::HeapStats
+    totalStats() const
+    {
+        const DeviceMemoryAllocator::Stats stats = _allocator.GetStats();
+        DeviceMemoryAllocator::HeapStats   total;
+        for (uint32_t heap = 0; heap < stats.heapCount; ++heap) {
+            total.blockCount += stats.heaps[heap].blockCount;
+            total.usedBytes += stats.heaps[heap].usedBytes;
+            total.allocationCount += stats.heaps[heap].allocationCount;
+            total.dedicatedCount += stats.heaps[heap].dedicatedCount;
+        }
+        return total;
+    }
+
+    VkInstance            _instance       = VK_NULL_HANDLE;
+    VkPhysicalDevice      _physicalDevice = VK_NULL_HANDLE;
+    VkDevice              _device         = VK_NULL_HANDLE;
+    DeviceMemoryAllocator _allocator;
+};
+
+//! a pattern that differs between buffers
+void
+fill(const MemoryAllocation& allocation, uint32_t seed)
+{
+    uint32_t* words = static_cast<uint32_t*>(allocation.mapped);
+    for (VkDeviceSize i = 0; i < allocation.size / sizeof(uint32_t); ++i) {
+        words[i] = seed * 2654435761u + uint32_t(i);
+    }
+}
+
+bool
+matches(const MemoryAllocation& allocation, uint32_t seed)
+{
+    const uint32_t* words = static_cast<const uint32_t*>(allocation.mapped);
+    for (VkDeviceSize i = 0; i < allocation.size / sizeof(uint32_t); ++i) {
+        if (words[i] != seed * 2654435761u + uint32_t(i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+TEST_F(DeviceMemory, allocateAndFree)
+{
+    constexpr VkDeviceSize kSize = 64 * 1024;
+    std::vector<Buffer>    buffers(8);
+    for (uint32_t i = 0; i < buffers.size(); ++i) {
+        buffers[i].buffer = createBuffer(kSize);
+        ASSERT_TRUE(_allocator.AllocateForBuffer(buffers[i].buffer, MemoryUsage::Upload, buffers[i].allocation));
+        const MemoryAllocation& allocation = buffers[i].allocation;
+        EXPECT_FALSE(allocation.isDedicated());
+        EXPECT_GE(allocation.size, kSize);
+        EXPECT_EQ(allocation.offset % allocation.alignment, 0u);
+        // Upload memory is persistently mapped
+        ASSERT_NE(allocation.mapped, nullptr);
+        fill(allocation, i);
+        _allocator.Flush(allocation);
+    }
+    for (uint32_t i = 0; i < buffers.size(); ++i) {
+        EXPECT_TRUE(matches(buffers[i].allocation, i));
+    }
+
+    DeviceMemoryAllocator::HeapStats stats = totalStats();
+    EXPECT_EQ(stats.allocationCount, buffers.size());
+    EXPECT_GE(stats.usedBytes, buffers.size() * kSize);
+    // sub-allocated: far fewer VkDeviceMemory than buffers
+    EXPECT_LT(_allocator.GetStats().deviceMemoryCount, buffers.size());
+
+    for (Buffer& buffer : buffers) {
+        destroyBuffer(buffer);
+    }
+    stats = totalStats();
+    EXPECT_EQ(stats.allocationCount, 0u);
+    EXPECT_EQ(stats.usedBytes, 0u);
+    // one empty block is kept
+    EXPECT_LE(stats.blockCount, 1u);
+}
+
+TEST_F(DeviceMemory, dedicated)
+{
+    VkMemoryRequirements requirements {};
+    requirements.size           = 8 * 1024 * 1024;
+    requirements.alignment      = 256;
+    requirements.memoryTypeBits = UINT32_MAX;
+    MemoryAllocation allocation;
+    ASSERT_TRUE(_allocator.AllocateDedicated(requirements, MemoryUsage::GpuOnly, allocation));
+    EXPECT_TRUE(allocation.isDedicated());
+    EXPECT_EQ(allocation.offset, 0u);
+    EXPECT_EQ(totalStats().dedicatedCount, 1u);
+
+    _allocator.Free(allocation);
+    EXPECT_FALSE(allocation.isValid());
+    EXPECT_EQ(totalStats().dedicatedCount, 0u);
+}
+
+TEST_F(DeviceMemory, defragment)
+{
+    // 64 buffers over several blocks, then every other pair freed: the blocks are half empty. Pairs, the TLSF
+    // allocator only takes a free region that fits size + alignment - 1 rounded up to its size class.
+    constexpr VkDeviceSize kSize = 64 * 1024;
+    std::vector<Buffer>    buffers(64);
+    for (uint32_t i = 0; i < buffers.size(); ++i) {
+        buffers[i].buffer = createBuffer(kSize);
+        ASSERT_TRUE(_allocator.AllocateForBuffer(buffers[i].buffer, MemoryUsage::Upload, buffers[i].allocation));
+        fill(buffers[i].allocation, i);
+    }
+    for (size_t i = 0; i < buffers.size(); i += 4) {
+        destroyBuffer(buffers[i]);
+        destroyBuffer(buffers[i + 1]);
+    }
+    const DeviceMemoryAllocator::HeapStats before = totalStats();
+    ASSERT_GT(before.blockCount, 2u);
+
+    std::vector<MemoryAllocation*> allocations;
+    for (Buffer& buffer : buffers) {
+        if (buffer.allocation.isValid()) {
+            allocations.push_back(&buffer.allocation);
+        }
+    }
+    std::vector<DeviceMemoryAllocator::Move> moves;
+    _allocator.BeginDefragmentation(allocations.data(), allocations.size(), VK_WHOLE_SIZE, moves);
+    ASSERT_FALSE(moves.empty());
+
+    // the copy a GPU would do, and the rebinding: a buffer can not be bound twice
+    std::vector<VkBuffer> oldBuffers;
+    for (const DeviceMemoryAllocator::Move& move : moves) {
+        Buffer* buffer = nullptr;
+        for (Buffer& candidate : buffers) {
+            if (&candidate.allocation == move.allocation) {
+                buffer = &candidate;
+            }
+        }
+        ASSERT_NE(buffer, nullptr);
+        ASSERT_NE(move.destination.mapped, nullptr);
+        std::memcpy(move.destination.mapped, move.allocation->mapped, size_t(move.allocation->size));
+        oldBuffers.push_back(buffer->buffer);
+        buffer->buffer = createBuffer(kSize);
+        ASSERT_EQ(
+            vkBindBufferMemory(_device, buffer->buffer, move.destination.memory, move.destination.offset), VK_SUCCESS);
+    }
+    _allocator.EndDefragmentation(moves);
+    for (VkBuffer buffer : oldBuffers) {
+        vkDestroyBuffer(_device, buffer, nullptr);
+    }
+
+    const DeviceMemoryAllocator::HeapStats after = totalStats();
+    EXPECT_EQ(after.allocationCount, before.allocationCount);
+    EXPECT_EQ(after.usedBytes, before.usedBytes);
+    EXPECT_LT(after.blockCount, before.blockCount);
+    for (uint32_t i = 0; i < buffers.size(); ++i) {
+        if (buffers[i].allocation.isValid()) {
+            EXPECT_TRUE(matches(buffers[i].allocation, i)) << "buffer " << i;
+        }
+    }
+
+    for (Buffer& buffer : buffers) {
+        if (buffer.allocation.isValid()) {
+            destroyBuffer(buffer);
+        }
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "core/vfs.h"
+#include "mesh/mesh.h"
+
+namespace mesh {
+////////////////////////////////////////////////////////////////////////////////
+// glTF 2.0 scenes, .gltf (external or data: URI buffers) and .glb. Every
+// triangle primitive becomes a mesh of Vertex (POSITION, NORMAL and
+// TEXCOORD_0 when present, float or normalized texture coordinates), the
+// nodes of the default scene are flattened with their world transform.
+// Not supported: sparse accessors, quantized positions, other primitive
+// modes, materials, skins and animations.
+
+//! false and logs when the file can not be read or is not supported
+bool loadGltf(const char* nativePath, Scene& scene);
+
+//! the file data (.gltf or .glb); the relative buffer URIs are resolved in
+//! baseDirectory
+bool parseGltf(const core::vfs::FileHandle& file, const std::string& baseDirectory, Scene& scene);
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace mesh
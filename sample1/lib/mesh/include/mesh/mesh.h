@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mesh {
+////////////////////////////////////////////////////////////////////////////////
+
+//! An indexed triangle list. The vertices are opaque bytes of a fixed stride
+//! (the GPU layout), the processing only reads their float3 position.
+struct MeshData {
+    std::vector<uint8_t>  vertices;
+    std::vector<uint32_t> indices;
+    uint32_t              stride         = 0;
+    uint32_t              positionOffset = 0;   //!< 3 floats
+
+    size_t vertexCount() const { return stride != 0 ? vertices.size() / stride : 0; }
+};
+
+//! the vertices of the importers (OBJ, glTF)
+struct Vertex {
+    float position[3];
+    float normal[3];
+    float uv[2];
+};
+
+//! An imported scene: the hierarchy is flattened, every node instances one
+//! mesh with its world transform.
+struct Scene {
+    struct Mesh {
+        std::string name;
+        MeshData    data;
+    };
+    struct Node {
+        std::string name;
+        uint32_t    mesh = 0;
+        float       transform[16];   //!< column major
+    };
+
+    std::vector<Mesh> meshes;
+    std::vector<Node> nodes;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace mesh
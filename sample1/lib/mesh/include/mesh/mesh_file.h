@@ -0,0 +1,216 @@
+#pragma once
+
+#include "core/core.h"
+#include "core/vfs.h"
+#include "mesh/mesh.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mesh {
+////////////////////////////////////////////////////////////////////////////////
+// Mesh files (.mesh): meshes and scene nodes with their vertex and index
+// streams in the GPU layout, loaded without parsing: the runtime maps the
+// file (or reads it through the vfs, pak entries stored raw) and copies the
+// streams as they are to a staging buffer.
+//
+// Layout (little endian), every offset is relative to the start of the file:
+//   Header                  at offset 0
+//   MeshEntry[meshCount]    16 bytes aligned
+//   Node[nodeCount]
+//   names                   not null terminated
+//   streams                 the first 4K aligned (a page of the mapping),
+//                           every vertex and index stream kStreamAlignment
+//
+// tocHash covers the tables and the names, not the streams: Open() does not
+// touch the pages of the streams (a pak verifies them with its content hash).
+// tocHash is core::hashBytesStable() with kMeshFileHashSeed.
+// Changing the layout or the hash requires a kMeshFileVersion bump.
+
+static constexpr uint32_t kMeshFileMagic       = 0x3148534d;   // "MSH1"
+static constexpr uint32_t kMeshFileVersion     = 1;
+static constexpr uint64_t kStreamsAlignment    = 4096;
+static constexpr uint64_t kStreamAlignment     = 64;
+static constexpr uint64_t kMeshFileHashSeed    = 0x6d6573682d686173ull;
+static constexpr uint32_t kMaxVertexAttributes = 8;
+
+//! the values of the matching VkFormat: the runtime passes them through
+enum class AttributeFormat : uint32_t {
+    Unorm8x4 = 37,    // VK_FORMAT_R8G8B8A8_UNORM
+    Float1   = 100,   // VK_FORMAT_R32_SFLOAT
+    Float2   = 103,   // VK_FORMAT_R32G32_SFLOAT
+    Float3   = 106,   // VK_FORMAT_R32G32B32_SFLOAT
+    Float4   = 109,   // VK_FORMAT_R32G32B32A32_SFLOAT
+};
+
+enum class AttributeSemantic : uint8_t { Position = 0, Normal = 1, TexCoord = 2, Color = 3, Tangent = 4 };
+
+//! bytes, 0 for an unknown format
+inline uint32_t
+formatSize(AttributeFormat format)
+{
+    switch (format) {
+    case AttributeFormat::Unorm8x4:
+    case AttributeFormat::Float1: return 4;
+    case AttributeFormat::Float2: return 8;
+    case AttributeFormat::Float3: return 12;
+    case AttributeFormat::Float4: return 16;
+    }
+    return 0;
+}
+
+struct VertexAttribute {
+    AttributeFormat   format;
+    uint16_t          offset;   //!< in the vertex
+    AttributeSemantic semantic;
+    uint8_t           reserved;
+};
+static_assert(sizeof(VertexAttribute) == 8, "mesh file attribute layout changed");
+
+//! the layout of Vertex
+static constexpr VertexAttribute kVertexAttributes[] = {
+    {AttributeFormat::Float3, offsetof(Vertex, position), AttributeSemantic::Position, 0},
+    {AttributeFormat::Float3, offsetof(Vertex, normal), AttributeSemantic::Normal, 0},
+    {AttributeFormat::Float2, offsetof(Vertex, uv), AttributeSemantic::TexCoord, 0},
+};
+
+struct MeshFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t meshCount;
+    uint32_t nodeCount;
+    uint64_t meshesOffset;
+    uint64_t nodesOffset;
+    uint64_t namesOffset;
+    uint64_t namesSize;
+    uint64_t fileSize;
+    uint64_t tocHash;   //!< meshes + nodes + names
+};
+static_assert(sizeof(MeshFileHeader) == 64, "mesh file header layout changed");
+
+struct MeshEntry {
+    uint64_t        vertexOffset;
+    uint64_t        vertexSize;
+    uint64_t        indexOffset;
+    uint64_t        indexSize;
+    uint32_t        vertexCount;
+    uint32_t        indexCount;
+    uint32_t        stride;
+    uint32_t        indexStride;   //!< 2 (up to 65536 vertices) or 4 bytes
+    uint32_t        attributeCount;
+    uint32_t        nameOffset;
+    uint16_t        nameLength;
+    uint16_t        reserved0;
+    uint32_t        reserved1;
+    float           boundsMin[3];
+    float           boundsMax[3];
+    uint32_t        reserved2[2];
+    VertexAttribute attributes[kMaxVertexAttributes];
+};
+static_assert(sizeof(MeshEntry) == 160, "mesh file entry layout changed");
+
+struct MeshNode {
+    float    transform[16];   //!< world, column major
+    uint32_t mesh;
+    uint32_t nameOffset;
+    uint16_t nameLength;
+    uint16_t reserved0;
+    uint32_t reserved1;
+};
+static_assert(sizeof(MeshNode) == 80, "mesh file node layout changed");
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! Builds a mesh file (offline, see the mesh_converter tool)
+class MeshFileWriter {
+    struct Input {
+        std::string     name;
+        MeshData        data;
+        VertexAttribute attributes[kMaxVertexAttributes];
+        uint32_t        attributeCount;
+    };
+    struct NodeInput {
+        std::string name;
+        uint32_t    mesh;
+        float       transform[16];
+    };
+    std::vector<Input>     _meshes;
+    std::vector<NodeInput> _nodes;
+
+public:
+    struct Summary {
+        uint32_t meshCount   = 0;
+        uint32_t nodeCount   = 0;
+        uint64_t vertexBytes = 0;
+        uint64_t indexBytes  = 0;
+        uint64_t fileSize    = 0;
+    };
+
+    //! attributes: the layout of the mesh.stride bytes vertices. Returns the
+    //! index of the mesh, UINT32_MAX (and logs) when the mesh is invalid.
+    uint32_t AddMesh(std::string name, MeshData mesh, const VertexAttribute* attributes, uint32_t attributeCount);
+    //! mesh: an index returned by AddMesh()
+    void AddNode(std::string name, uint32_t mesh, const float transform[16]);
+    //! every mesh of the scene (Vertex vertices) and its nodes
+    bool AddScene(const Scene& scene);
+
+    //! writes to nativePath + ".tmp" then renames, the previous file stays valid until then
+    bool Write(const char* nativePath, Summary* summary = nullptr) const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! A loaded mesh file: the tables and the streams are views of the file data.
+//!
+//!     mesh::MeshFile file;
+//!     if (file.Open(fileSystem.Open("meshes/level.mesh"), "meshes/level.mesh")) {
+//!         const mesh::MeshEntry& entry = file.mesh(0);
+//!         upload(file.vertices(entry), entry.vertexSize);
+//!     }
+class MeshFile {
+    core::vfs::FileHandle _file;
+    const MeshEntry*      _meshes    = nullptr;
+    const MeshNode*       _nodes     = nullptr;
+    const char*           _names     = nullptr;
+    uint32_t              _meshCount = 0;
+    uint32_t              _nodeCount = 0;
+
+public:
+    //! Validates the header and the tables (the streams are not read), false
+    //! and logs when the data is not a valid mesh file. name: for the logs.
+    bool Open(core::vfs::FileHandle file, const char* name);
+
+    uint32_t         meshCount() const { return _meshCount; }
+    const MeshEntry& mesh(uint32_t index) const
+    {
+        ASSERT(index < _meshCount);
+        return _meshes[index];
+    }
+    uint32_t        nodeCount() const { return _nodeCount; }
+    const MeshNode& node(uint32_t index) const
+    {
+        ASSERT(index < _nodeCount);
+        return _nodes[index];
+    }
+    std::string_view meshName(const MeshEntry& entry) const
+    {
+        return std::string_view(_names + entry.nameOffset, entry.nameLength);
+    }
+    std::string_view nodeName(const MeshNode& node) const
+    {
+        return std::string_view(_names + node.nameOffset, node.nameLength);
+    }
+
+    //! entry.vertexSize bytes
+    const uint8_t* vertices(const MeshEntry& entry) const { return _file.data() + entry.vertexOffset; }
+    //! entry.indexSize bytes of 16 or 32 bit indices
+    const uint8_t* indices(const MeshEntry& entry) const { return _file.data() + entry.indexOffset; }
+
+    const core::vfs::FileHandle& file() const { return _file; }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace mesh
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "mesh/mesh.h"
+
+#include <string>
+#include <string_view>
+
+namespace mesh {
+////////////////////////////////////////////////////////////////////////////////
+// Wavefront OBJ, the subset exported by the usual tools: v, vt, vn and
+// polygonal f (triangle fans), negative indices. Materials, groups and
+// smoothing are ignored.
+
+//! Vertex vertices indexed in the order of the file (the identical vertices
+//! shared), normals 0 when the file has none. False and logs on malformed
+//! input.
+bool parseObj(std::string_view text, MeshData& mesh);
+
+//! the triangles of mesh (Vertex vertices) as OBJ text
+std::string writeObj(const MeshData& mesh);
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace mesh
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "mesh/mesh.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace mesh {
+////////////////////////////////////////////////////////////////////////////////
+// Offline optimizations of the vertex pipeline, in the order they run:
+// - generateVertexRemap(): merges the vertices with identical bytes,
+// - optimizeVertexCache(): triangle order for the post transform cache
+//   (Forsyth), or optimizeVertexCacheTipsify() followed by optimizeOverdraw()
+//   (Sander et al.: clusters of the cache order sorted front to back),
+// - optimizeVertexFetch(): vertex order of first use, the fetches stream,
+// - stripify(): strips with primitive restart, for the index bandwidth.
+//
+// Indices are 32 bits triangle lists; the dst arrays are allocated by the
+// caller and may not alias the inputs unless stated otherwise.
+//
+// ACMR: vertex shader invocations per triangle (0.5 at best on a regular
+// grid, 3 without reuse); ATVR: invocations per vertex (1 at best).
+
+namespace detail {
+//! FIFO post transform cache of the analysis and of Tipsify
+constexpr uint32_t kCacheSize = 16;
+}   // namespace detail
+
+struct VertexCacheStats {
+    uint32_t invocations = 0;
+    float    acmr        = 0.f;
+    float    atvr        = 0.f;
+};
+
+struct VertexFetchStats {
+    uint64_t bytesFetched = 0;     //!< 64 bytes lines through an 8 KB cache
+    float    overfetch    = 0.f;   //!< bytesFetched / vertex buffer size
+};
+
+//! remap[vertexCount]: the new index of every vertex, vertices with the same
+//! bytes share it. indices (nullptr: unindexed) only counts the used ones,
+//! unused vertices get ~0u. Returns the new vertex count.
+uint32_t generateVertexRemap(uint32_t* remap, const uint32_t* indices, size_t indexCount, const void* vertices,
+    size_t vertexCount, size_t stride);
+
+//! dst[i] = remap[indices[i]] (indices nullptr: remap[i]); dst may be indices
+void remapIndices(uint32_t* dst, const uint32_t* indices, size_t indexCount, const uint32_t* remap);
+
+//! dst: the new vertex count * stride bytes
+void remapVertices(void* dst, const void* vertices, size_t vertexCount, size_t stride, const uint32_t* remap);
+
+//! Forsyth's "Linear-speed vertex cache optimisation": greedy, scores the
+//! vertices on their cache position and remaining triangles.
+void optimizeVertexCache(uint32_t* dst, const uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+//! Tipsify (Sander et al. 2007): fans around the vertices of a FIFO cache of
+//! cacheSize, faster than Forsyth and slightly worse ACMR. Its dead ends (a
+//! triangle missing the cache on its 3 vertices) are the hard cluster
+//! boundaries optimizeOverdraw() finds in the index order.
+void optimizeVertexCacheTipsify(
+    uint32_t* dst, const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = detail::kCacheSize);
+
+//! Reorders clusters of a vertex cache optimized list (Tipsify) so the
+//! triangles likely in front draw first, view independent. The cache order
+//! is split further while a cluster stays under threshold * ACMR of the
+//! input: 1.05 gives up to 5% of the vertex cache efficiency.
+void optimizeOverdraw(uint32_t* dst, const uint32_t* indices, size_t indexCount, const void* vertices,
+    size_t vertexCount, size_t stride, size_t positionOffset, float threshold = 1.05f);
+
+//! remap for the order of first use (unused vertices ~0u), returns the new
+//! vertex count
+uint32_t optimizeVertexFetchRemap(uint32_t* remap, const uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+//! Reorders the vertices in the order of first use and rewrites indices in
+//! place. dst: vertexCount * stride bytes, returns the new vertex count.
+uint32_t optimizeVertexFetch(
+    void* dst, uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t stride);
+
+//! capacity of the dst of stripify()
+inline size_t
+stripifyBound(size_t indexCount)
+{
+    return indexCount / 3 * 4;
+}
+
+//! Triangle strips separated by restartIndex (~0u: VK_INDEX_TYPE_UINT32
+//! primitive restart), the winding of the list is kept. Degenerate triangles
+//! are dropped. Returns the index count.
+size_t stripify(uint32_t* dst, const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t restartIndex);
+
+//! back to a list (dst: (stripCount - 2) * 3 indices at most), returns the
+//! index count
+size_t unstripify(uint32_t* dst, const uint32_t* strip, size_t stripCount, uint32_t restartIndex);
+
+VertexCacheStats analyzeVertexCache(
+    const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = detail::kCacheSize);
+VertexFetchStats analyzeVertexFetch(const uint32_t* indices, size_t indexCount, size_t vertexCount, size_t stride);
+
+//! The pipeline above on a mesh, in place
+struct OptimizeOptions {
+    bool  overdraw          = true;   //!< Tipsify + optimizeOverdraw(), Forsyth otherwise
+    float overdrawThreshold = 1.05f;
+    bool  strip             = false;   //!< measured only: OptimizeReport::stripIndexCount
+};
+
+struct OptimizeReport {
+    uint32_t         vertexCountBefore = 0;
+    uint32_t         vertexCountAfter  = 0;
+    VertexCacheStats cacheBefore;
+    VertexCacheStats cacheAfter;
+    VertexFetchStats fetchBefore;
+    VertexFetchStats fetchAfter;
+    size_t           stripIndexCount = 0;   //!< restarts included
+};
+
+OptimizeReport optimize(MeshData& mesh, const OptimizeOptions& options = OptimizeOptions());
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace mesh
@@ -0,0 +1,526 @@
+#include "mesh/gltf.h"
+
+#include "core/core.h"
+#include "json.h"
+
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+namespace mesh {
+/////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+constexpr uint32_t kGlbMagic     = 0x46546c67;   // "glTF"
+constexpr uint32_t kGlbJsonChunk = 0x4e4f534a;   // "JSON"
+constexpr uint32_t kGlbBinChunk  = 0x004e4942;   // "BIN\0"
+constexpr uint32_t kMaxNodeDepth = 64;
+
+enum ComponentType : uint32_t {
+    kByte          = 5120,
+    kUnsignedByte  = 5121,
+    kShort         = 5122,
+    kUnsignedShort = 5123,
+    kUnsignedInt   = 5125,
+    kFloat         = 5126,
+};
+
+struct Document {
+    json::Value                        root;
+    core::vfs::FileHandle              glbBinary;
+    std::vector<core::vfs::FileHandle> buffers;
+};
+
+//! the elements of an accessor, validated against its buffer
+struct AccessorView {
+    const uint8_t* data          = nullptr;
+    size_t         count         = 0;
+    size_t         stride        = 0;
+    uint32_t       componentType = 0;
+    uint32_t       components    = 0;
+};
+
+uint32_t
+componentSize(uint32_t componentType)
+{
+    switch (componentType) {
+    case kByte:
+    case kUnsignedByte: return 1;
+    case kShort:
+    case kUnsignedShort: return 2;
+    case kUnsignedInt:
+    case kFloat: return 4;
+    default: return 0;
+    }
+}
+
+uint32_t
+componentCount(const std::string& type)
+{
+    if (type == "SCALAR") {
+        return 1;
+    }
+    if (type.size() == 4 && type.compare(0, 3, "VEC") == 0 && type[3] >= '2' && type[3] <= '4') {
+        return static_cast<uint32_t>(type[3] - '0');
+    }
+    return 0;
+}
+
+const json::Value*
+element(const json::Value& root, const char* array, double index)
+{
+    const json::Value* values = root.Find(array);
+    if (values == nullptr || !values->isArray() || index < 0 || index >= static_cast<double>(values->array.size())) {
+        return nullptr;
+    }
+    return &values->array[static_cast<size_t>(index)];
+}
+
+bool
+decodeBase64(std::string_view text, std::vector<uint8_t>& data)
+{
+    uint32_t bits     = 0;
+    uint32_t bitCount = 0;
+    for (char c : text) {
+        uint32_t value;
+        if (c >= 'A' && c <= 'Z') {
+            value = c - 'A';
+        } else if (c >= 'a' && c <= 'z') {
+            value = c - 'a' + 26;
+        } else if (c >= '0' && c <= '9') {
+            value = c - '0' + 52;
+        } else if (c == '+') {
+            value = 62;
+        } else if (c == '/') {
+            value = 63;
+        } else if (c == '=') {
+            break;
+        } else {
+            return false;
+        }
+        bits = (bits << 6) | value;
+        bitCount += 6;
+        if (bitCount >= 8) {
+            bitCount -= 8;
+            data.push_back(static_cast<uint8_t>(bits >> bitCount));
+        }
+    }
+    return true;
+}
+
+bool
+loadBuffers(Document& document, const std::string& baseDirectory)
+{
+    const json::Value* buffers = document.root.Find("buffers");
+    if (buffers == nullptr) {
+        return true;
+    }
+    for (size_t i = 0; i < buffers->array.size(); ++i) {
+        const json::Value&    buffer     = buffers->array[i];
+        const json::Value*    uri        = buffer.Find("uri");
+        const double          byteLength = buffer.Number("byteLength", -1.0);
+        core::vfs::FileHandle data;
+        if (uri == nullptr || !uri->isString()) {
+            // the binary chunk of a .glb
+            if (i == 0) {
+                data = document.glbBinary;
+            }
+        } else if (uri->string.compare(0, 5, "data:") == 0) {
+            const size_t         base64 = uri->string.find(";base64,");
+            std::vector<uint8_t> bytes;
+            if (base64 != std::string::npos
+                && decodeBase64(std::string_view(uri->string).substr(base64 + 8), bytes)) {
+                data = core::vfs::FileHandle::Allocate(bytes.size());
+                if (!bytes.empty()) {
+                    memcpy(data.MutableData(), bytes.data(), bytes.size());
+                }
+            }
+        } else {
+            const std::string path = (std::filesystem::path(baseDirectory) / uri->string).string();
+            data                   = core::vfs::FileHandle::MapFile(path.c_str());
+        }
+        if (!data || byteLength < 0.0 || static_cast<double>(data.size()) < byteLength) {
+            LOG_ERROR("glTF: buffer %u can not be read", static_cast<uint32_t>(i));
+            return false;
+        }
+        document.buffers.push_back(std::move(data));
+    }
+    return true;
+}
+
+bool
+accessorView(const Document& document, double index, AccessorView& view)
+{
+    const json::Value* accessor = element(document.root, "accessors", index);
+    if (accessor == nullptr) {
+        LOG_ERROR("glTF: invalid accessor %g", index);
+        return false;
+    }
+    const json::Value* type = accessor->Find("type");
+    view.componentType      = static_cast<uint32_t>(accessor->Number("componentType", 0.0));
+    view.components         = type != nullptr && type->isString() ? componentCount(type->string) : 0;
+    view.count              = static_cast<size_t>(accessor->Number("count", 0.0));
+    const size_t size       = size_t(componentSize(view.componentType)) * view.components;
+    if (accessor->Find("sparse") != nullptr || size == 0) {
+        LOG_ERROR("glTF: accessor %g is sparse or of an unsupported type", index);
+        return false;
+    }
+
+    const json::Value* bufferView = element(document.root, "bufferViews", accessor->Number("bufferView", -1.0));
+    if (bufferView == nullptr) {
+        LOG_ERROR("glTF: accessor %g has no buffer view", index);
+        return false;
+    }
+    const double buffer     = bufferView->Number("buffer", -1.0);
+    const size_t viewOffset = static_cast<size_t>(bufferView->Number("byteOffset", 0.0));
+    const size_t viewLength = static_cast<size_t>(bufferView->Number("byteLength", 0.0));
+    const size_t offset     = static_cast<size_t>(accessor->Number("byteOffset", 0.0));
+    view.stride             = static_cast<size_t>(bufferView->Number("byteStride", static_cast<double>(size)));
+    if (buffer < 0 || buffer >= static_cast<double>(document.buffers.size())) {
+        LOG_ERROR("glTF: accessor %g has no buffer", index);
+        return false;
+    }
+    const core::vfs::FileHandle& data = document.buffers[static_cast<size_t>(buffer)];
+    const size_t                 end  = view.count != 0 ? offset + view.stride * (view.count - 1) + size : 0;
+    if (view.stride < size || viewOffset + viewLength > data.size() || end > viewLength) {
+        LOG_ERROR("glTF: accessor %g is out of its buffer", index);
+        return false;
+    }
+    view.data = data.data() + viewOffset + offset;
+    return true;
+}
+
+//! float or normalized components
+float
+readComponent(const AccessorView& view, size_t element, uint32_t component)
+{
+    const uint8_t* data = view.data + element * view.stride + component * componentSize(view.componentType);
+    switch (view.componentType) {
+    case kFloat: {
+        float value;
+        memcpy(&value, data, sizeof(value));
+        return value;
+    }
+    case kUnsignedByte: return *data / 255.f;
+    case kUnsignedShort: {
+        uint16_t value;
+        memcpy(&value, data, sizeof(value));
+        return value / 65535.f;
+    }
+    default: return 0.f;
+    }
+}
+
+uint32_t
+readIndex(const AccessorView& view, size_t element)
+{
+    const uint8_t* data = view.data + element * view.stride;
+    switch (view.componentType) {
+    case kUnsignedByte: return *data;
+    case kUnsignedShort: {
+        uint16_t value;
+        memcpy(&value, data, sizeof(value));
+        return value;
+    }
+    default: {
+        uint32_t value;
+        memcpy(&value, data, sizeof(value));
+        return value;
+    }
+    }
+}
+
+bool
+loadPrimitive(const Document& document, const json::Value& primitive, MeshData& mesh)
+{
+    const json::Value* attributes = primitive.Find("attributes");
+    if (primitive.Number("mode", 4.0) != 4.0 || attributes == nullptr || attributes->Find("POSITION") == nullptr) {
+        LOG_ERROR("glTF: only triangle lists with positions are supported");
+        return false;
+    }
+    AccessorView positions;
+    if (!accessorView(document, attributes->Number("POSITION", -1.0), positions)) {
+        return false;
+    }
+    if (positions.componentType != kFloat || positions.components != 3) {
+        LOG_ERROR("glTF: the positions are not float3");
+        return false;
+    }
+    AccessorView normals;
+    AccessorView uvs;
+    const bool   hasNormals = attributes->Find("NORMAL") != nullptr;
+    const bool   hasUvs     = attributes->Find("TEXCOORD_0") != nullptr;
+    if ((hasNormals && !accessorView(document, attributes->Number("NORMAL", -1.0), normals))
+        || (hasUvs && !accessorView(document, attributes->Number("TEXCOORD_0", -1.0), uvs))) {
+        return false;
+    }
+    const bool uvsSupported = uvs.componentType == kFloat || uvs.componentType == kUnsignedByte
+        || uvs.componentType == kUnsignedShort;
+    if ((hasNormals && (normals.count != positions.count || normals.components != 3 || normals.componentType != kFloat))
+        || (hasUvs && (uvs.count != positions.count || uvs.components != 2 || !uvsSupported))) {
+        LOG_ERROR("glTF: unsupported normals or texture coordinates");
+        return false;
+    }
+
+    std::vector<Vertex> vertices(positions.count);
+    for (size_t v = 0; v < positions.count; ++v) {
+        Vertex& vertex = vertices[v];
+        memset(&vertex, 0, sizeof(vertex));
+        for (uint32_t k = 0; k < 3; ++k) {
+            vertex.position[k] = readComponent(positions, v, k);
+            vertex.normal[k]   = hasNormals ? readComponent(normals, v, k) : 0.f;
+        }
+        for (uint32_t k = 0; hasUvs && k < 2; ++k) {
+            vertex.uv[k] = readComponent(uvs, v, k);
+        }
+    }
+
+    mesh.indices.clear();
+    if (primitive.Find("indices") != nullptr) {
+        AccessorView indices;
+        if (!accessorView(document, primitive.Number("indices", -1.0), indices)) {
+            return false;
+        }
+        if (indices.components != 1 || indices.componentType == kFloat || componentSize(indices.componentType) == 0) {
+            LOG_ERROR("glTF: unsupported index type");
+            return false;
+        }
+        mesh.indices.resize(indices.count);
+        for (size_t i = 0; i < indices.count; ++i) {
+            mesh.indices[i] = readIndex(indices, i);
+            if (mesh.indices[i] >= positions.count) {
+                LOG_ERROR("glTF: index %u out of range", mesh.indices[i]);
+                return false;
+            }
+        }
+    } else {
+        mesh.indices.resize(positions.count);
+        for (size_t i = 0; i < positions.count; ++i) {
+            mesh.indices[i] = static_cast<uint32_t>(i);
+        }
+    }
+    if (mesh.indices.size() % 3 != 0) {
+        LOG_ERROR("glTF: %u indices is not a triangle list", static_cast<uint32_t>(mesh.indices.size()));
+        return false;
+    }
+
+    mesh.stride         = sizeof(Vertex);
+    mesh.positionOffset = offsetof(Vertex, position);
+    mesh.vertices.resize(vertices.size() * sizeof(Vertex));
+    if (!vertices.empty()) {
+        memcpy(mesh.vertices.data(), vertices.data(), mesh.vertices.size());
+    }
+    return true;
+}
+
+void
+multiply(const float a[16], const float b[16], float result[16])
+{
+    for (uint32_t column = 0; column < 4; ++column) {
+        for (uint32_t row = 0; row < 4; ++row) {
+            float sum = 0.f;
+            for (uint32_t k = 0; k < 4; ++k) {
+                sum += a[k * 4 + row] * b[column * 4 + k];
+            }
+            result[column * 4 + row] = sum;
+        }
+    }
+}
+
+//! matrix, or translation * rotation * scale
+void
+localTransform(const json::Value& node, float transform[16])
+{
+    const json::Value* matrix = node.Find("matrix");
+    if (matrix != nullptr && matrix->isArray() && matrix->array.size() == 16) {
+        for (uint32_t i = 0; i < 16; ++i) {
+            transform[i] = static_cast<float>(matrix->array[i].number);
+        }
+        return;
+    }
+    float              t[3] = {0.f, 0.f, 0.f};
+    float              r[4] = {0.f, 0.f, 0.f, 1.f};
+    float              s[3] = {1.f, 1.f, 1.f};
+    const json::Value* translation = node.Find("translation");
+    const json::Value* rotation    = node.Find("rotation");
+    const json::Value* scale       = node.Find("scale");
+    for (uint32_t i = 0; translation != nullptr && i < 3 && i < translation->array.size(); ++i) {
+        t[i] = static_cast<float>(translation->array[i].number);
+    }
+    for (uint32_t i = 0; rotation != nullptr && i < 4 && i < rotation->array.size(); ++i) {
+        r[i] = static_cast<float>(rotation->array[i].number);
+    }
+    for (uint32_t i = 0; scale != nullptr && i < 3 && i < scale->array.size(); ++i) {
+        s[i] = static_cast<float>(scale->array[i].number);
+    }
+    const float x = r[0], y = r[1], z = r[2], w = r[3];
+    transform[0]  = (1.f - 2.f * (y * y + z * z)) * s[0];
+    transform[1]  = 2.f * (x * y + z * w) * s[0];
+    transform[2]  = 2.f * (x * z - y * w) * s[0];
+    transform[3]  = 0.f;
+    transform[4]  = 2.f * (x * y - z * w) * s[1];
+    transform[5]  = (1.f - 2.f * (x * x + z * z)) * s[1];
+    transform[6]  = 2.f * (y * z + x * w) * s[1];
+    transform[7]  = 0.f;
+    transform[8]  = 2.f * (x * z + y * w) * s[2];
+    transform[9]  = 2.f * (y * z - x * w) * s[2];
+    transform[10] = (1.f - 2.f * (x * x + y * y)) * s[2];
+    transform[11] = 0.f;
+    transform[12] = t[0];
+    transform[13] = t[1];
+    transform[14] = t[2];
+    transform[15] = 1.f;
+}
+
+//! primitiveMeshes[m]: the scene meshes of the primitives of the glTF mesh m
+bool
+addNode(const Document& document, double index, const float parent[16],
+    const std::vector<std::vector<uint32_t>>& primitiveMeshes, uint32_t depth, Scene& scene)
+{
+    const json::Value* node = element(document.root, "nodes", index);
+    if (node == nullptr || depth > kMaxNodeDepth) {
+        LOG_ERROR("glTF: invalid node %g", index);
+        return false;
+    }
+    float local[16];
+    float world[16];
+    localTransform(*node, local);
+    multiply(parent, local, world);
+
+    const json::Value* name = node->Find("name");
+    const double       mesh = node->Number("mesh", -1.0);
+    if (mesh >= 0.0) {
+        if (mesh >= static_cast<double>(primitiveMeshes.size())) {
+            LOG_ERROR("glTF: node %g has an invalid mesh", index);
+            return false;
+        }
+        for (uint32_t sceneMesh : primitiveMeshes[static_cast<size_t>(mesh)]) {
+            Scene::Node& sceneNode = scene.nodes.emplace_back();
+            sceneNode.name         = name != nullptr && name->isString() ? name->string : std::string();
+            sceneNode.mesh         = sceneMesh;
+            memcpy(sceneNode.transform, world, sizeof(world));
+        }
+    }
+    const json::Value* children = node->Find("children");
+    for (size_t i = 0; children != nullptr && i < children->array.size(); ++i) {
+        if (!addNode(document, children->array[i].number, world, primitiveMeshes, depth + 1, scene)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//! the JSON chunk, the binary chunk into document.glbBinary
+bool
+splitGlb(const core::vfs::FileHandle& file, std::string_view& json, Document& document)
+{
+    uint32_t header[3];
+    if (file.size() < sizeof(header) + 8) {
+        return false;
+    }
+    memcpy(header, file.data(), sizeof(header));
+    if (header[0] != kGlbMagic || header[1] != 2 || header[2] > file.size()) {
+        LOG_ERROR("glTF: unsupported .glb version");
+        return false;
+    }
+    for (size_t offset = sizeof(header); offset + 8 <= header[2];) {
+        uint32_t chunk[2];
+        memcpy(chunk, file.data() + offset, sizeof(chunk));
+        offset += sizeof(chunk);
+        if (chunk[0] > header[2] - offset) {
+            LOG_ERROR("glTF: truncated .glb chunk");
+            return false;
+        }
+        if (chunk[1] == kGlbJsonChunk && json.empty()) {
+            json = std::string_view(reinterpret_cast<const char*>(file.data() + offset), chunk[0]);
+        } else if (chunk[1] == kGlbBinChunk && !document.glbBinary) {
+            document.glbBinary = file.SubView(offset, chunk[0]);
+        }
+        offset += (chunk[0] + 3) & ~3u;
+    }
+    return !json.empty();
+}
+
+}   // namespace
+
+/////////////////////////////////////////////////////////////////////////////////
+
+bool
+loadGltf(const char* nativePath, Scene& scene)
+{
+    const core::vfs::FileHandle file = core::vfs::FileHandle::MapFile(nativePath);
+    if (!file) {
+        LOG_ERROR("Couldn't read '%s'", nativePath);
+        return false;
+    }
+    return parseGltf(file, std::filesystem::path(nativePath).parent_path().string(), scene);
+}
+
+bool
+parseGltf(const core::vfs::FileHandle& file, const std::string& baseDirectory, Scene& scene)
+{
+    Document         document;
+    std::string_view text = file.asString();
+    if (file.size() >= 4 && memcmp(file.data(), "glTF", 4) == 0) {
+        text = std::string_view();
+        if (!splitGlb(file, text, document)) {
+            return false;
+        }
+    }
+    if (!json::parse(text, document.root) || !document.root.isObject()) {
+        LOG_ERROR("glTF: invalid JSON");
+        return false;
+    }
+    const json::Value* asset   = document.root.Find("asset");
+    const json::Value* version = asset != nullptr ? asset->Find("version") : nullptr;
+    if (version == nullptr || !version->isString() || version->string.compare(0, 2, "2.") != 0) {
+        LOG_ERROR("glTF: not a glTF 2 asset");
+        return false;
+    }
+    if (!loadBuffers(document, baseDirectory)) {
+        return false;
+    }
+
+    scene = Scene();
+    std::vector<std::vector<uint32_t>> primitiveMeshes;
+    const json::Value*                 meshes = document.root.Find("meshes");
+    for (size_t m = 0; meshes != nullptr && m < meshes->array.size(); ++m) {
+        const json::Value& mesh       = meshes->array[m];
+        const json::Value* name       = mesh.Find("name");
+        const json::Value* primitives = mesh.Find("primitives");
+        std::vector<uint32_t>& sceneMeshes = primitiveMeshes.emplace_back();
+        for (size_t p = 0; primitives != nullptr && p < primitives->array.size(); ++p) {
+            sceneMeshes.push_back(static_cast<uint32_t>(scene.meshes.size()));
+            Scene::Mesh& sceneMesh = scene.meshes.emplace_back();
+            sceneMesh.name = (name != nullptr && name->isString() ? name->string : "mesh" + std::to_string(m)) + "/"
+                + std::to_string(p);
+            if (!loadPrimitive(document, primitives->array[p], sceneMesh.data)) {
+                return false;
+            }
+        }
+    }
+
+    const float identity[16] = {1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f};
+    const json::Value* root = element(document.root, "scenes", document.root.Number("scene", 0.0));
+    if (root == nullptr) {
+        // no scene: every mesh once, in place
+        for (uint32_t m = 0; m < scene.meshes.size(); ++m) {
+            Scene::Node& node = scene.nodes.emplace_back();
+            node.name         = scene.meshes[m].name;
+            node.mesh         = m;
+            memcpy(node.transform, identity, sizeof(identity));
+        }
+        return true;
+    }
+    const json::Value* nodes = root->Find("nodes");
+    for (size_t i = 0; nodes != nullptr && i < nodes->array.size(); ++i) {
+        if (!addNode(document, nodes->array[i].number, identity, primitiveMeshes, 0, scene)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace mesh
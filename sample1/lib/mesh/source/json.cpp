@@ -0,0 +1,238 @@
+#include "json.h"
+
+#include "core/core.h"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace mesh {
+namespace json {
+/////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+constexpr uint32_t kMaxDepth = 64;
+
+class Parser {
+public:
+    explicit Parser(std::string_view text)
+        : _text(text)
+    {
+    }
+
+    bool Parse(Value& value)
+    {
+        if (!_Value(value, 0)) {
+            return false;
+        }
+        _SkipSpaces();
+        return _position == _text.size() || _Fail("trailing characters");
+    }
+
+private:
+    bool _Fail(const char* what)
+    {
+        LOG_ERROR("JSON offset %llu: %s", static_cast<unsigned long long>(_position), what);
+        return false;
+    }
+
+    void _SkipSpaces()
+    {
+        while (_position < _text.size()
+               && (_text[_position] == ' ' || _text[_position] == '\t' || _text[_position] == '\n'
+                   || _text[_position] == '\r')) {
+            ++_position;
+        }
+    }
+
+    bool _Consume(char c)
+    {
+        _SkipSpaces();
+        if (_position < _text.size() && _text[_position] == c) {
+            ++_position;
+            return true;
+        }
+        return false;
+    }
+
+    bool _Literal(const char* literal)
+    {
+        const size_t length = strlen(literal);
+        if (_text.substr(_position, length) != literal) {
+            return _Fail("invalid literal");
+        }
+        _position += length;
+        return true;
+    }
+
+    bool _Value(Value& value, uint32_t depth)
+    {
+        if (depth > kMaxDepth) {
+            return _Fail("too deep");
+        }
+        _SkipSpaces();
+        if (_position == _text.size()) {
+            return _Fail("unexpected end");
+        }
+        switch (_text[_position]) {
+        case '{': return _Object(value, depth);
+        case '[': return _Array(value, depth);
+        case '"':
+            value.type = Value::Type::String;
+            return _String(value.string);
+        case 't':
+            value.type    = Value::Type::Bool;
+            value.boolean = true;
+            return _Literal("true");
+        case 'f':
+            value.type    = Value::Type::Bool;
+            value.boolean = false;
+            return _Literal("false");
+        case 'n': return _Literal("null");
+        default: return _Number(value);
+        }
+    }
+
+    bool _Object(Value& value, uint32_t depth)
+    {
+        value.type = Value::Type::Object;
+        ++_position;
+        if (_Consume('}')) {
+            return true;
+        }
+        do {
+            std::pair<std::string, Value>& member = value.object.emplace_back();
+            _SkipSpaces();
+            if (_position == _text.size() || _text[_position] != '"' || !_String(member.first)) {
+                return _Fail("object key expected");
+            }
+            if (!_Consume(':')) {
+                return _Fail("':' expected");
+            }
+            if (!_Value(member.second, depth + 1)) {
+                return false;
+            }
+        } while (_Consume(','));
+        return _Consume('}') || _Fail("'}' expected");
+    }
+
+    bool _Array(Value& value, uint32_t depth)
+    {
+        value.type = Value::Type::Array;
+        ++_position;
+        if (_Consume(']')) {
+            return true;
+        }
+        do {
+            if (!_Value(value.array.emplace_back(), depth + 1)) {
+                return false;
+            }
+        } while (_Consume(','));
+        return _Consume(']') || _Fail("']' expected");
+    }
+
+    //! _text[_position] == '"'; \u escapes are written as UTF-8
+    bool _String(std::string& string)
+    {
+        ++_position;
+        while (_position < _text.size() && _text[_position] != '"') {
+            char c = _text[_position++];
+            if (c != '\\') {
+                string += c;
+                continue;
+            }
+            if (_position == _text.size()) {
+                break;
+            }
+            c = _text[_position++];
+            switch (c) {
+            case 'b': string += '\b'; break;
+            case 'f': string += '\f'; break;
+            case 'n': string += '\n'; break;
+            case 'r': string += '\r'; break;
+            case 't': string += '\t'; break;
+            case 'u': {
+                if (_position + 4 > _text.size()) {
+                    return _Fail("invalid escape");
+                }
+                const std::string hex(_text.substr(_position, 4));
+                char*             end       = nullptr;
+                const uint32_t    codePoint = static_cast<uint32_t>(strtoul(hex.c_str(), &end, 16));
+                if (end != hex.c_str() + 4) {
+                    return _Fail("invalid escape");
+                }
+                _position += 4;
+                if (codePoint < 0x80) {
+                    string += static_cast<char>(codePoint);
+                } else if (codePoint < 0x800) {
+                    string += static_cast<char>(0xc0 | (codePoint >> 6));
+                    string += static_cast<char>(0x80 | (codePoint & 0x3f));
+                } else {
+                    string += static_cast<char>(0xe0 | (codePoint >> 12));
+                    string += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+                    string += static_cast<char>(0x80 | (codePoint & 0x3f));
+                }
+                break;
+            }
+            default: string += c; break;
+            }
+        }
+        if (_position == _text.size()) {
+            return _Fail("unterminated string");
+        }
+        ++_position;
+        return true;
+    }
+
+    bool _Number(Value& value)
+    {
+        // strtod needs a terminated string: numbers are short
+        size_t end = _position;
+        while (end < _text.size() && strchr("+-0123456789.eE", _text[end]) != nullptr) {
+            ++end;
+        }
+        const std::string number(_text.substr(_position, end - _position));
+        char*             parsed = nullptr;
+        value.type               = Value::Type::Number;
+        value.number             = strtod(number.c_str(), &parsed);
+        if (number.empty() || parsed != number.c_str() + number.size()) {
+            return _Fail("invalid value");
+        }
+        _position = end;
+        return true;
+    }
+
+    std::string_view _text;
+    size_t           _position = 0;
+};
+}   // namespace
+
+/////////////////////////////////////////////////////////////////////////////////
+
+const Value*
+Value::Find(std::string_view key) const
+{
+    for (const std::pair<std::string, Value>& member : object) {
+        if (member.first == key) {
+            return &member.second;
+        }
+    }
+    return nullptr;
+}
+
+double
+Value::Number(std::string_view key, double fallback) const
+{
+    const Value* value = Find(key);
+    return value != nullptr && value->isNumber() ? value->number : fallback;
+}
+
+bool
+parse(std::string_view text, Value& value)
+{
+    value = Value();
+    return Parser(text).Parse(value);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace json
+}   // namespace mesh
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace mesh {
+namespace json {
+////////////////////////////////////////////////////////////////////////////////
+// The JSON documents of the importers (glTF): a DOM, no streaming.
+
+struct Value {
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    Type                                       type    = Type::Null;
+    bool                                       boolean = false;
+    double                                     number  = 0.0;
+    std::string                                string;
+    std::vector<Value>                         array;
+    std::vector<std::pair<std::string, Value>> object;   //!< in the order of the document
+
+    bool isNumber() const { return type == Type::Number; }
+    bool isString() const { return type == Type::String; }
+    bool isArray() const { return type == Type::Array; }
+    bool isObject() const { return type == Type::Object; }
+
+    //! nullptr when missing (or not an object)
+    const Value* Find(std::string_view key) const;
+    //! the number of key, fallback when missing or not a number
+    double Number(std::string_view key, double fallback) const;
+};
+
+//! false (and logs the offset) on malformed documents
+bool parse(std::string_view text, Value& value);
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace json
+}   // namespace mesh
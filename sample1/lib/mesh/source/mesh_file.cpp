@@ -0,0 +1,292 @@
+#include "mesh/mesh_file.h"
+
+#include "core/hash.h"
+#include "core/memory.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+
+namespace mesh {
+/////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+bool
+writeAt(FILE* file, uint64_t offset, const void* data, size_t size)
+{
+    // empty sections may come from empty vectors: no data pointer for fwrite
+    if (size == 0) {
+        return true;
+    }
+    // fseek offsets are long: fine for the sizes mesh files are built for
+    return fseek(file, static_cast<long>(offset), SEEK_SET) == 0 && fwrite(data, 1, size, file) == size;
+}
+
+uint64_t
+tocHash(const void* meshes, size_t meshesSize, const void* nodes, size_t nodesSize, const void* names,
+    size_t namesSize)
+{
+    const uint64_t hash = core::hashBytesStable(meshes, meshesSize, kMeshFileHashSeed);
+    return core::hashBytesStable(names, namesSize, core::hashBytesStable(nodes, nodesSize, hash));
+}
+}   // namespace
+
+uint32_t
+MeshFileWriter::AddMesh(std::string name, MeshData mesh, const VertexAttribute* attributes, uint32_t attributeCount)
+{
+    // empty meshes are rejected: the runtime creates no empty buffer
+    const size_t vertexCount = mesh.vertexCount();
+    bool         valid       = mesh.stride != 0 && vertexCount != 0 && vertexCount <= UINT32_MAX
+                  && mesh.vertices.size() == vertexCount * mesh.stride && !mesh.indices.empty()
+                  && mesh.indices.size() % 3 == 0 && mesh.indices.size() <= UINT32_MAX
+                  && attributeCount <= kMaxVertexAttributes && name.size() <= UINT16_MAX
+                  && mesh.positionOffset + 3 * sizeof(float) <= mesh.stride;
+    for (uint32_t i = 0; valid && i < attributeCount; ++i) {
+        const uint32_t size = formatSize(attributes[i].format);
+        valid               = size != 0 && attributes[i].offset + size <= mesh.stride;
+    }
+    for (size_t i = 0; valid && i < mesh.indices.size(); ++i) {
+        valid = mesh.indices[i] < vertexCount;
+    }
+    if (!valid) {
+        LOG_ERROR("Invalid mesh '%s'", name.c_str());
+        return UINT32_MAX;
+    }
+
+    Input& input = _meshes.emplace_back();
+    input.name   = std::move(name);
+    input.data   = std::move(mesh);
+    memset(input.attributes, 0, sizeof(input.attributes));
+    memcpy(input.attributes, attributes, attributeCount * sizeof(VertexAttribute));
+    input.attributeCount = attributeCount;
+    return static_cast<uint32_t>(_meshes.size() - 1);
+}
+
+void
+MeshFileWriter::AddNode(std::string name, uint32_t mesh, const float transform[16])
+{
+    ASSERT_MSG(mesh < _meshes.size(), "invalid mesh for the node '%s'", name.c_str());
+    NodeInput& node = _nodes.emplace_back();
+    node.name       = std::move(name);
+    node.mesh       = mesh;
+    memcpy(node.transform, transform, sizeof(node.transform));
+}
+
+bool
+MeshFileWriter::AddScene(const Scene& scene)
+{
+    const uint32_t first = static_cast<uint32_t>(_meshes.size());
+    for (const Scene::Mesh& mesh : scene.meshes) {
+        if (mesh.data.stride != sizeof(Vertex)
+            || AddMesh(mesh.name, mesh.data, kVertexAttributes, std::size(kVertexAttributes)) == UINT32_MAX) {
+            LOG_ERROR("The mesh '%s' is not made of Vertex", mesh.name.c_str());
+            return false;
+        }
+    }
+    for (const Scene::Node& node : scene.nodes) {
+        if (node.mesh >= scene.meshes.size()) {
+            LOG_ERROR("Invalid mesh for the node '%s'", node.name.c_str());
+            return false;
+        }
+        AddNode(node.name.size() <= UINT16_MAX ? node.name : std::string(), first + node.mesh, node.transform);
+    }
+    return true;
+}
+
+bool
+MeshFileWriter::Write(const char* nativePath, Summary* summary) const
+{
+    const std::string tmpPath = std::string(nativePath) + ".tmp";
+    FILE*             file    = fopen(tmpPath.c_str(), "wb");
+    if (file == nullptr) {
+        LOG_ERROR("Couldn't create '%s'", tmpPath.c_str());
+        return false;
+    }
+
+    Summary                stats;
+    std::vector<MeshEntry> meshes(_meshes.size());
+    std::vector<MeshNode>  nodes(_nodes.size());
+    std::string            names;
+    std::vector<uint16_t>  shortIndices;
+
+    MeshFileHeader header {};
+    header.magic        = kMeshFileMagic;
+    header.version      = kMeshFileVersion;
+    header.meshCount    = static_cast<uint32_t>(meshes.size());
+    header.nodeCount    = static_cast<uint32_t>(nodes.size());
+    header.meshesOffset = core::alignUp(sizeof(MeshFileHeader), 16);
+    header.nodesOffset  = header.meshesOffset + meshes.size() * sizeof(MeshEntry);
+    header.namesOffset  = header.nodesOffset + nodes.size() * sizeof(MeshNode);
+
+    for (size_t i = 0; i < _nodes.size(); ++i) {
+        const NodeInput& input = _nodes[i];
+        MeshNode&        node  = nodes[i];
+        memset(&node, 0, sizeof(node));
+        memcpy(node.transform, input.transform, sizeof(node.transform));
+        node.mesh       = input.mesh;
+        node.nameOffset = static_cast<uint32_t>(names.size());
+        node.nameLength = static_cast<uint16_t>(input.name.size());
+        names += input.name;
+    }
+    for (size_t i = 0; i < _meshes.size(); ++i) {
+        meshes[i].nameOffset = static_cast<uint32_t>(names.size());
+        names += _meshes[i].name;
+    }
+    header.namesSize = names.size();
+
+    uint64_t offset = core::alignUp(header.namesOffset + header.namesSize, kStreamsAlignment);
+    bool     result = true;
+    for (size_t i = 0; i < _meshes.size() && result; ++i) {
+        const Input&    input      = _meshes[i];
+        const MeshData& data       = input.data;
+        MeshEntry&      entry      = meshes[i];
+        const uint32_t  nameOffset = entry.nameOffset;
+        memset(&entry, 0, sizeof(entry));
+        entry.vertexCount    = static_cast<uint32_t>(data.vertexCount());
+        entry.indexCount     = static_cast<uint32_t>(data.indices.size());
+        entry.stride         = data.stride;
+        entry.indexStride    = entry.vertexCount <= UINT16_MAX + 1u ? 2 : 4;
+        entry.attributeCount = input.attributeCount;
+        entry.nameOffset     = nameOffset;
+        entry.nameLength     = static_cast<uint16_t>(input.name.size());
+        memcpy(entry.attributes, input.attributes, sizeof(entry.attributes));
+
+        for (uint32_t k = 0; k < 3; ++k) {
+            entry.boundsMin[k] = FLT_MAX;
+            entry.boundsMax[k] = -FLT_MAX;
+        }
+        for (uint32_t v = 0; v < entry.vertexCount; ++v) {
+            float position[3];
+            memcpy(position, data.vertices.data() + size_t(v) * data.stride + data.positionOffset, sizeof(position));
+            for (uint32_t k = 0; k < 3; ++k) {
+                entry.boundsMin[k] = std::min(entry.boundsMin[k], position[k]);
+                entry.boundsMax[k] = std::max(entry.boundsMax[k], position[k]);
+            }
+        }
+
+        // the indices narrowed to the size the GPU reads
+        const void* indices = data.indices.data();
+        if (entry.indexStride == 2) {
+            shortIndices.assign(data.indices.begin(), data.indices.end());
+            indices = shortIndices.data();
+        }
+        entry.vertexOffset = core::alignUp(offset, kStreamAlignment);
+        entry.vertexSize   = data.vertices.size();
+        entry.indexOffset  = core::alignUp(entry.vertexOffset + entry.vertexSize, kStreamAlignment);
+        entry.indexSize    = uint64_t(entry.indexCount) * entry.indexStride;
+        result             = writeAt(file, entry.vertexOffset, data.vertices.data(), entry.vertexSize)
+                 && writeAt(file, entry.indexOffset, indices, entry.indexSize);
+        offset = entry.indexOffset + entry.indexSize;
+        stats.vertexBytes += entry.vertexSize;
+        stats.indexBytes += entry.indexSize;
+    }
+
+    const size_t meshesSize = meshes.size() * sizeof(MeshEntry);
+    const size_t nodesSize  = nodes.size() * sizeof(MeshNode);
+    header.fileSize         = std::max(offset, header.namesOffset + header.namesSize);
+    header.tocHash          = tocHash(meshes.data(), meshesSize, nodes.data(), nodesSize, names.data(), names.size());
+
+    result = result && writeAt(file, header.meshesOffset, meshes.data(), meshesSize)
+          && writeAt(file, header.nodesOffset, nodes.data(), nodesSize)
+          && writeAt(file, header.namesOffset, names.data(), names.size())
+          && writeAt(file, 0, &header, sizeof(header));
+    result = (fclose(file) == 0) && result;
+
+    std::error_code error;
+    if (result) {
+        std::filesystem::rename(tmpPath, nativePath, error);
+        result = !error;
+    }
+    if (!result) {
+        LOG_ERROR("Couldn't write '%s'", nativePath);
+        std::filesystem::remove(tmpPath, error);
+        return false;
+    }
+
+    stats.meshCount = header.meshCount;
+    stats.nodeCount = header.nodeCount;
+    stats.fileSize  = header.fileSize;
+    if (summary != nullptr) {
+        *summary = stats;
+    }
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+
+bool
+MeshFile::Open(core::vfs::FileHandle file, const char* name)
+{
+    *this = MeshFile();
+    if (!file || file.size() < sizeof(MeshFileHeader) || !core::isAligned(file.data(), 8)) {
+        LOG_ERROR("'%s' is not a mesh file", name);
+        return false;
+    }
+    const MeshFileHeader& header = *file.dataAs<MeshFileHeader>();
+    if (header.magic != kMeshFileMagic || header.version != kMeshFileVersion) {
+        LOG_ERROR("'%s' is not a mesh file or has an unsupported version", name);
+        return false;
+    }
+    const uint64_t fileSize   = file.size();
+    const uint64_t meshesSize = uint64_t(header.meshCount) * sizeof(MeshEntry);
+    const uint64_t nodesSize  = uint64_t(header.nodeCount) * sizeof(MeshNode);
+    if (header.fileSize != fileSize || !core::isAligned(header.meshesOffset, 16) || header.meshesOffset > fileSize
+        || meshesSize > fileSize - header.meshesOffset || header.nodesOffset != header.meshesOffset + meshesSize
+        || nodesSize > fileSize - header.nodesOffset || header.namesOffset != header.nodesOffset + nodesSize
+        || header.namesSize > fileSize - header.namesOffset) {
+        LOG_ERROR("'%s': corrupted mesh file tables", name);
+        return false;
+    }
+    const uint8_t* meshes = file.data() + header.meshesOffset;
+    const uint8_t* nodes  = file.data() + header.nodesOffset;
+    const char*    names  = reinterpret_cast<const char*>(file.data() + header.namesOffset);
+    if (tocHash(meshes, meshesSize, nodes, nodesSize, names, header.namesSize) != header.tocHash) {
+        LOG_ERROR("'%s': mesh file tables hash mismatch", name);
+        return false;
+    }
+
+    const auto inFile = [fileSize](uint64_t offset, uint64_t size) {
+        return core::isAligned(offset, kStreamAlignment) && offset <= fileSize && size <= fileSize - offset;
+    };
+    const MeshEntry* entries = reinterpret_cast<const MeshEntry*>(meshes);
+    for (uint32_t i = 0; i < header.meshCount; ++i) {
+        const MeshEntry& entry = entries[i];
+        bool             valid = entry.stride != 0 && entry.vertexCount != 0 && entry.indexCount != 0
+                     && (entry.indexStride == 2 || entry.indexStride == 4)
+                     && entry.vertexSize == uint64_t(entry.vertexCount) * entry.stride
+                     && entry.indexSize == uint64_t(entry.indexCount) * entry.indexStride && entry.indexCount % 3 == 0
+                     && inFile(entry.vertexOffset, entry.vertexSize) && inFile(entry.indexOffset, entry.indexSize)
+                     && entry.attributeCount <= kMaxVertexAttributes
+                     && uint64_t(entry.nameOffset) + entry.nameLength <= header.namesSize;
+        for (uint32_t a = 0; valid && a < entry.attributeCount; ++a) {
+            const uint32_t size = formatSize(entry.attributes[a].format);
+            valid               = size != 0 && entry.attributes[a].offset + size <= entry.stride;
+        }
+        if (!valid) {
+            LOG_ERROR("'%s': corrupted mesh %u", name, i);
+            return false;
+        }
+    }
+    const MeshNode* nodeEntries = reinterpret_cast<const MeshNode*>(nodes);
+    for (uint32_t i = 0; i < header.nodeCount; ++i) {
+        const MeshNode& node = nodeEntries[i];
+        if (node.mesh >= header.meshCount || uint64_t(node.nameOffset) + node.nameLength > header.namesSize) {
+            LOG_ERROR("'%s': corrupted node %u", name, i);
+            return false;
+        }
+    }
+
+    _file      = std::move(file);
+    _meshes    = entries;
+    _nodes     = nodeEntries;
+    _names     = names;
+    _meshCount = header.meshCount;
+    _nodeCount = header.nodeCount;
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace mesh
@@ -0,0 +1,206 @@
+#include "mesh/obj.h"
+
+#include "core/core.h"
+#include "mesh/optimize.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace mesh {
+/////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+bool
+isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+const char*
+skipSpaces(const char* p)
+{
+    while (isSpace(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+//! "v", "vt"... followed by a space
+bool
+startsWith(const char* p, const char* keyword)
+{
+    const size_t length = strlen(keyword);
+    return strncmp(p, keyword, length) == 0 && isSpace(p[length]);
+}
+
+bool
+readFloats(const char* p, float* values, uint32_t count, uint32_t requiredCount)
+{
+    for (uint32_t i = 0; i < count; ++i) {
+        char* end = nullptr;
+        values[i] = strtof(p, &end);
+        if (end == p) {
+            return i >= requiredCount;
+        }
+        p = end;
+    }
+    return true;
+}
+
+//! 1 based, negative: relative to the end. False when out of range.
+bool
+resolveIndex(long index, size_t count, uint32_t& resolved)
+{
+    if (index > 0 && static_cast<size_t>(index) <= count) {
+        resolved = static_cast<uint32_t>(index - 1);
+        return true;
+    }
+    if (index < 0 && static_cast<size_t>(-index) <= count) {
+        resolved = static_cast<uint32_t>(count + index);
+        return true;
+    }
+    return false;
+}
+
+}   // namespace
+
+/////////////////////////////////////////////////////////////////////////////////
+
+bool
+parseObj(std::string_view text, MeshData& mesh)
+{
+    std::vector<float>  positions;
+    std::vector<float>  normals;
+    std::vector<float>  uvs;
+    std::vector<Vertex> vertices;   // unindexed
+    std::vector<Vertex> polygon;
+
+    std::string line;
+    uint32_t    lineNumber = 0;
+    for (size_t begin = 0; begin < text.size();) {
+        size_t end = text.find('\n', begin);
+        if (end == std::string_view::npos) {
+            end = text.size();
+        }
+        line.assign(text.data() + begin, end - begin);
+        begin = end + 1;
+        ++lineNumber;
+
+        const char* p = skipSpaces(line.c_str());
+        if (startsWith(p, "v")) {
+            float position[3];
+            if (!readFloats(p + 1, position, 3, 3)) {
+                LOG_ERROR("OBJ line %u: invalid position", lineNumber);
+                return false;
+            }
+            positions.insert(positions.end(), position, position + 3);
+        } else if (startsWith(p, "vn")) {
+            float normal[3];
+            if (!readFloats(p + 2, normal, 3, 3)) {
+                LOG_ERROR("OBJ line %u: invalid normal", lineNumber);
+                return false;
+            }
+            normals.insert(normals.end(), normal, normal + 3);
+        } else if (startsWith(p, "vt")) {
+            float uv[2] = {};
+            if (!readFloats(p + 2, uv, 2, 1)) {
+                LOG_ERROR("OBJ line %u: invalid texture coordinates", lineNumber);
+                return false;
+            }
+            uvs.insert(uvs.end(), uv, uv + 2);
+        } else if (startsWith(p, "f")) {
+            // v, v/vt, v//vn or v/vt/vn per corner
+            polygon.clear();
+            for (p = skipSpaces(p + 1); *p != '\0'; p = skipSpaces(p)) {
+                long  corner[3] = {};
+                char* end       = nullptr;
+                for (uint32_t k = 0; k < 3; ++k) {
+                    corner[k] = strtol(p, &end, 10);
+                    if (end == p && k == 0) {
+                        LOG_ERROR("OBJ line %u: invalid face", lineNumber);
+                        return false;
+                    }
+                    p = end;
+                    if (*p != '/') {
+                        break;
+                    }
+                    ++p;
+                }
+
+                Vertex   vertex {};
+                uint32_t index = 0;
+                if (!resolveIndex(corner[0], positions.size() / 3, index)) {
+                    LOG_ERROR("OBJ line %u: position %ld out of range", lineNumber, corner[0]);
+                    return false;
+                }
+                memcpy(vertex.position, &positions[index * 3], sizeof(vertex.position));
+                if (corner[1] != 0) {
+                    if (!resolveIndex(corner[1], uvs.size() / 2, index)) {
+                        LOG_ERROR("OBJ line %u: texture coordinates %ld out of range", lineNumber, corner[1]);
+                        return false;
+                    }
+                    memcpy(vertex.uv, &uvs[index * 2], sizeof(vertex.uv));
+                }
+                if (corner[2] != 0) {
+                    if (!resolveIndex(corner[2], normals.size() / 3, index)) {
+                        LOG_ERROR("OBJ line %u: normal %ld out of range", lineNumber, corner[2]);
+                        return false;
+                    }
+                    memcpy(vertex.normal, &normals[index * 3], sizeof(vertex.normal));
+                }
+                polygon.push_back(vertex);
+            }
+            if (polygon.size() < 3) {
+                LOG_ERROR("OBJ line %u: face with %u vertices", lineNumber, static_cast<uint32_t>(polygon.size()));
+                return false;
+            }
+            for (size_t i = 1; i + 1 < polygon.size(); ++i) {
+                vertices.push_back(polygon[0]);
+                vertices.push_back(polygon[i]);
+                vertices.push_back(polygon[i + 1]);
+            }
+        }
+    }
+
+    // shares the corners with the same position, normal and uv
+    std::vector<uint32_t> remap(vertices.size());
+    const uint32_t        uniqueCount = generateVertexRemap(
+        remap.data(), nullptr, vertices.size(), vertices.data(), vertices.size(), sizeof(Vertex));
+    mesh.stride         = sizeof(Vertex);
+    mesh.positionOffset = offsetof(Vertex, position);
+    mesh.vertices.resize(uniqueCount * sizeof(Vertex));
+    mesh.indices.resize(vertices.size());
+    remapVertices(mesh.vertices.data(), vertices.data(), vertices.size(), sizeof(Vertex), remap.data());
+    remapIndices(mesh.indices.data(), nullptr, vertices.size(), remap.data());
+    return true;
+}
+
+std::string
+writeObj(const MeshData& mesh)
+{
+    ASSERT(mesh.stride == sizeof(Vertex));
+    std::string text;
+    char        line[256];
+    for (size_t v = 0; v < mesh.vertexCount(); ++v) {
+        Vertex vertex;
+        memcpy(&vertex, mesh.vertices.data() + v * sizeof(Vertex), sizeof(Vertex));
+        snprintf(line, sizeof(line), "v %.9g %.9g %.9g\nvt %.9g %.9g\nvn %.9g %.9g %.9g\n", vertex.position[0],
+            vertex.position[1], vertex.position[2], vertex.uv[0], vertex.uv[1], vertex.normal[0], vertex.normal[1],
+            vertex.normal[2]);
+        text += line;
+    }
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        const unsigned a = mesh.indices[i] + 1;
+        const unsigned b = mesh.indices[i + 1] + 1;
+        const unsigned c = mesh.indices[i + 2] + 1;
+        snprintf(line, sizeof(line), "f %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, b, b, b, c, c, c);
+        text += line;
+    }
+    return text;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace mesh
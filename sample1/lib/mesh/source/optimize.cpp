@@ -0,0 +1,698 @@
+#include "mesh/optimize.h"
+
+#include "core/core.h"
+#include "core/hash.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace mesh {
+/////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+using detail::kCacheSize;
+
+constexpr uint32_t kInvalidIndex = ~0u;
+
+//! the triangles of every vertex: triangles[offsets[v], offsets[v + 1])
+struct Adjacency {
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> triangles;
+    std::vector<uint32_t> liveCounts;   //!< triangles not emitted yet
+};
+
+void
+buildAdjacency(Adjacency& adjacency, const uint32_t* indices, size_t indexCount, size_t vertexCount)
+{
+    adjacency.liveCounts.assign(vertexCount, 0);
+    for (size_t i = 0; i < indexCount; ++i) {
+        ASSERT(indices[i] < vertexCount);
+        ++adjacency.liveCounts[indices[i]];
+    }
+    adjacency.offsets.resize(vertexCount + 1);
+    adjacency.offsets[0] = 0;
+    for (size_t v = 0; v < vertexCount; ++v) {
+        adjacency.offsets[v + 1] = adjacency.offsets[v] + adjacency.liveCounts[v];
+    }
+    std::vector<uint32_t> fill(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+    adjacency.triangles.resize(indexCount);
+    for (size_t i = 0; i < indexCount; ++i) {
+        adjacency.triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+}
+
+void
+readPosition(float position[3], const uint8_t* vertices, size_t stride, size_t positionOffset, uint32_t index)
+{
+    memcpy(position, vertices + index * stride + positionOffset, 3 * sizeof(float));
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+// Forsyth
+
+constexpr uint32_t kForsythCacheSize = 32;
+
+float
+forsythScore(int32_t cachePosition, uint32_t liveTriangles)
+{
+    if (liveTriangles == 0) {
+        return -1.f;
+    }
+    float score = 0.f;
+    if (cachePosition >= 0) {
+        if (cachePosition < 3) {
+            // the last triangle: no preference between its vertices
+            score = 0.75f;
+        } else {
+            const float scale = 1.f / (kForsythCacheSize - 3);
+            score             = powf(1.f - (cachePosition - 3) * scale, 1.5f);
+        }
+    }
+    // valence boost: finishes the vertices with few triangles left
+    return score + 2.f / sqrtf(static_cast<float>(liveTriangles));
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+// Tipsify
+
+uint32_t
+skipDeadEnd(const Adjacency& adjacency, std::vector<uint32_t>& deadEnds, size_t& cursor)
+{
+    while (!deadEnds.empty()) {
+        const uint32_t vertex = deadEnds.back();
+        deadEnds.pop_back();
+        if (adjacency.liveCounts[vertex] > 0) {
+            return vertex;
+        }
+    }
+    for (; cursor < adjacency.liveCounts.size(); ++cursor) {
+        if (adjacency.liveCounts[cursor] > 0) {
+            return static_cast<uint32_t>(cursor);
+        }
+    }
+    return kInvalidIndex;
+}
+
+void
+tipsify(uint32_t* dst, const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+{
+    Adjacency adjacency;
+    buildAdjacency(adjacency, indices, indexCount, vertexCount);
+
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<uint8_t>  emitted(indexCount / 3, 0);
+    std::vector<uint32_t> deadEnds;
+    std::vector<uint32_t> candidates;
+    deadEnds.reserve(indexCount);
+
+    uint32_t time   = cacheSize + 1;
+    size_t   cursor = 0;
+    size_t   out    = 0;
+    uint32_t fan    = skipDeadEnd(adjacency, deadEnds, cursor);
+    while (fan != kInvalidIndex) {
+        candidates.clear();
+        for (uint32_t i = adjacency.offsets[fan]; i < adjacency.offsets[fan + 1]; ++i) {
+            const uint32_t triangle = adjacency.triangles[i];
+            if (emitted[triangle]) {
+                continue;
+            }
+            emitted[triangle] = 1;
+            for (uint32_t k = 0; k < 3; ++k) {
+                const uint32_t vertex = indices[triangle * 3 + k];
+                dst[out++]            = vertex;
+                deadEnds.push_back(vertex);
+                candidates.push_back(vertex);
+                --adjacency.liveCounts[vertex];
+                if (time - cacheTime[vertex] > cacheSize) {
+                    cacheTime[vertex] = time++;
+                }
+            }
+        }
+
+        // the next fan: the oldest candidate still in the cache once its
+        // remaining triangles are emitted
+        uint32_t next         = kInvalidIndex;
+        int64_t  bestPriority = -1;
+        for (uint32_t vertex : candidates) {
+            const uint32_t live = adjacency.liveCounts[vertex];
+            if (live == 0) {
+                continue;
+            }
+            const int64_t age      = time - cacheTime[vertex];
+            const int64_t priority = age + 2 * live <= cacheSize ? age : 0;
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                next         = vertex;
+            }
+        }
+        if (next == kInvalidIndex) {
+            next = skipDeadEnd(adjacency, deadEnds, cursor);
+        }
+        fan = next;
+    }
+    ASSERT(out == indexCount);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+// strips
+
+//! the live triangle with the directed edge a -> b, its third vertex
+uint32_t
+findTriangle(const Adjacency& adjacency, const uint32_t* indices, const std::vector<uint8_t>& emitted, uint32_t a,
+    uint32_t b, uint32_t& third)
+{
+    for (uint32_t i = adjacency.offsets[a]; i < adjacency.offsets[a + 1]; ++i) {
+        const uint32_t triangle = adjacency.triangles[i];
+        if (emitted[triangle]) {
+            continue;
+        }
+        const uint32_t* vertices = indices + triangle * 3;
+        for (uint32_t k = 0; k < 3; ++k) {
+            if (vertices[k] == a && vertices[(k + 1) % 3] == b) {
+                third = vertices[(k + 2) % 3];
+                return triangle;
+            }
+        }
+    }
+    return kInvalidIndex;
+}
+
+}   // namespace
+
+/////////////////////////////////////////////////////////////////////////////////
+
+uint32_t
+generateVertexRemap(uint32_t* remap, const uint32_t* indices, size_t indexCount, const void* vertices,
+    size_t vertexCount, size_t stride)
+{
+    std::fill(remap, remap + vertexCount, kInvalidIndex);
+
+    // open addressing on the vertex bytes, at most half full
+    size_t tableSize = 16;
+    while (tableSize < vertexCount * 2) {
+        tableSize *= 2;
+    }
+    std::vector<uint32_t> table(tableSize, kInvalidIndex);
+    const uint8_t* const  bytes = static_cast<const uint8_t*>(vertices);
+
+    uint32_t   uniqueCount = 0;
+    const auto add         = [&](uint32_t vertex) {
+        if (remap[vertex] != kInvalidIndex) {
+            return;
+        }
+        const uint8_t* data = bytes + vertex * stride;
+        size_t         slot = static_cast<size_t>(core::hashBytes(data, stride)) & (tableSize - 1);
+        for (; table[slot] != kInvalidIndex; slot = (slot + 1) & (tableSize - 1)) {
+            if (memcmp(bytes + table[slot] * stride, data, stride) == 0) {
+                remap[vertex] = remap[table[slot]];
+                return;
+            }
+        }
+        table[slot]   = vertex;
+        remap[vertex] = uniqueCount++;
+    };
+    if (indices != nullptr) {
+        for (size_t i = 0; i < indexCount; ++i) {
+            ASSERT(indices[i] < vertexCount);
+            add(indices[i]);
+        }
+    } else {
+        for (size_t v = 0; v < vertexCount; ++v) {
+            add(static_cast<uint32_t>(v));
+        }
+    }
+    return uniqueCount;
+}
+
+void
+remapIndices(uint32_t* dst, const uint32_t* indices, size_t indexCount, const uint32_t* remap)
+{
+    for (size_t i = 0; i < indexCount; ++i) {
+        dst[i] = remap[indices != nullptr ? indices[i] : i];
+        ASSERT(dst[i] != kInvalidIndex);
+    }
+}
+
+void
+remapVertices(void* dst, const void* vertices, size_t vertexCount, size_t stride, const uint32_t* remap)
+{
+    uint8_t* const       out   = static_cast<uint8_t*>(dst);
+    const uint8_t* const bytes = static_cast<const uint8_t*>(vertices);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        if (remap[v] != kInvalidIndex) {
+            memcpy(out + remap[v] * stride, bytes + v * stride, stride);
+        }
+    }
+}
+
+void
+optimizeVertexCache(uint32_t* dst, const uint32_t* indices, size_t indexCount, size_t vertexCount)
+{
+    ASSERT(indexCount % 3 == 0);
+    const size_t triangleCount = indexCount / 3;
+
+    Adjacency adjacency;
+    buildAdjacency(adjacency, indices, indexCount, vertexCount);
+
+    std::vector<int32_t> cachePosition(vertexCount, -1);
+    std::vector<float>   vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        vertexScore[v] = forsythScore(-1, adjacency.liveCounts[v]);
+    }
+    std::vector<float>   triangleScore(triangleCount);
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        const uint32_t* triangle = indices + t * 3;
+        triangleScore[t]         = vertexScore[triangle[0]] + vertexScore[triangle[1]] + vertexScore[triangle[2]];
+    }
+
+    // the triangle vertices join before the oldest are pushed out
+    uint32_t cache[kForsythCacheSize + 3];
+    uint32_t newCache[kForsythCacheSize + 3];
+    uint32_t cacheCount = 0;
+    size_t   cursor     = 0;
+    uint32_t best       = triangleCount != 0 ? 0 : kInvalidIndex;
+    for (size_t out = 0; out < triangleCount; ++out) {
+        if (best == kInvalidIndex) {
+            // nothing left around the cache: the input order
+            while (emitted[cursor]) {
+                ++cursor;
+            }
+            best = static_cast<uint32_t>(cursor);
+        }
+        const uint32_t* triangle = indices + best * 3;
+        dst[out * 3]             = triangle[0];
+        dst[out * 3 + 1]         = triangle[1];
+        dst[out * 3 + 2]         = triangle[2];
+        emitted[best]            = 1;
+        for (uint32_t k = 0; k < 3; ++k) {
+            const uint32_t vertex = triangle[k];
+            uint32_t*      begin  = adjacency.triangles.data() + adjacency.offsets[vertex];
+            uint32_t*      end    = begin + adjacency.liveCounts[vertex];
+            std::iter_swap(std::find(begin, end, best), end - 1);
+            --adjacency.liveCounts[vertex];
+        }
+
+        uint32_t newCount = 0;
+        for (uint32_t k = 0; k < 3; ++k) {
+            if (std::find(newCache, newCache + newCount, triangle[k]) == newCache + newCount) {
+                newCache[newCount++] = triangle[k];
+            }
+        }
+        for (uint32_t i = 0; i < cacheCount; ++i) {
+            if (cache[i] != triangle[0] && cache[i] != triangle[1] && cache[i] != triangle[2]) {
+                newCache[newCount++] = cache[i];
+            }
+        }
+
+        // rescores the vertices that moved (the pushed out ones included) and
+        // their triangles
+        for (uint32_t i = 0; i < newCount; ++i) {
+            const uint32_t vertex   = newCache[i];
+            const int32_t  position = i < kForsythCacheSize ? static_cast<int32_t>(i) : -1;
+            cachePosition[vertex]   = position;
+            const float score       = forsythScore(position, adjacency.liveCounts[vertex]);
+            const float delta       = score - vertexScore[vertex];
+            vertexScore[vertex]     = score;
+            for (uint32_t j = 0; j < adjacency.liveCounts[vertex]; ++j) {
+                triangleScore[adjacency.triangles[adjacency.offsets[vertex] + j]] += delta;
+            }
+        }
+        cacheCount = std::min(newCount, kForsythCacheSize);
+        std::copy(newCache, newCache + cacheCount, cache);
+
+        best            = kInvalidIndex;
+        float bestScore = std::numeric_limits<float>::lowest();
+        for (uint32_t i = 0; i < cacheCount; ++i) {
+            const uint32_t vertex = cache[i];
+            for (uint32_t j = 0; j < adjacency.liveCounts[vertex]; ++j) {
+                const uint32_t candidate = adjacency.triangles[adjacency.offsets[vertex] + j];
+                if (triangleScore[candidate] > bestScore) {
+                    bestScore = triangleScore[candidate];
+                    best      = candidate;
+                }
+            }
+        }
+    }
+}
+
+void
+optimizeVertexCacheTipsify(
+    uint32_t* dst, const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+{
+    ASSERT(indexCount % 3 == 0);
+    tipsify(dst, indices, indexCount, vertexCount, cacheSize);
+}
+
+void
+optimizeOverdraw(uint32_t* dst, const uint32_t* indices, size_t indexCount, const void* vertices,
+    size_t vertexCount, size_t stride, size_t positionOffset, float threshold)
+{
+    ASSERT(indexCount % 3 == 0);
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+    const uint8_t* const bytes = static_cast<const uint8_t*>(vertices);
+
+    // hard boundaries: a triangle missing the cache on its 3 vertices (the
+    // dead ends of Tipsify). Soft boundaries: the cluster so far stays under
+    // the ACMR budget when it starts with a cold cache, as it will once the
+    // clusters are reordered.
+    std::vector<uint32_t> clusters;
+    {
+        const float maxAcmr = analyzeVertexCache(indices, indexCount, vertexCount).acmr * threshold;
+
+        std::vector<uint32_t> cacheTime(vertexCount, 0);
+        std::vector<uint32_t> clusterCacheTime(vertexCount, 0);
+        uint32_t              time             = kCacheSize + 1;
+        uint32_t              clusterTime      = kCacheSize + 1;
+        uint32_t              clusterMisses    = 0;
+        uint32_t              clusterTriangles = 0;
+        for (size_t t = 0; t < triangleCount; ++t) {
+            uint32_t misses = 0;
+            for (uint32_t k = 0; k < 3; ++k) {
+                const uint32_t vertex = indices[t * 3 + k];
+                if (time - cacheTime[vertex] > kCacheSize) {
+                    cacheTime[vertex] = time++;
+                    ++misses;
+                }
+            }
+            const bool hard = misses == 3;
+            const bool soft = clusterTriangles != 0 && clusterMisses <= maxAcmr * clusterTriangles;
+            if (t == 0 || hard || soft) {
+                clusters.push_back(static_cast<uint32_t>(t));
+                clusterTime += kCacheSize + 1;   // flushed
+                clusterMisses    = 0;
+                clusterTriangles = 0;
+            }
+            for (uint32_t k = 0; k < 3; ++k) {
+                const uint32_t vertex = indices[t * 3 + k];
+                if (clusterTime - clusterCacheTime[vertex] > kCacheSize) {
+                    clusterCacheTime[vertex] = clusterTime++;
+                    ++clusterMisses;
+                }
+            }
+            ++clusterTriangles;
+        }
+    }
+    const size_t clusterCount = clusters.size();
+    clusters.push_back(static_cast<uint32_t>(triangleCount));
+
+    // area weighted centroids and normals
+    std::vector<float> clusterData(clusterCount * 6, 0.f);   // centroid * area, normal * 2 area
+    float              meshCentroid[3] = {};
+    float              meshArea        = 0.f;
+    for (size_t c = 0; c < clusterCount; ++c) {
+        float* const centroid = &clusterData[c * 6];
+        float* const normal   = &clusterData[c * 6 + 3];
+        for (uint32_t t = clusters[c]; t < clusters[c + 1]; ++t) {
+            float p0[3], p1[3], p2[3];
+            readPosition(p0, bytes, stride, positionOffset, indices[t * 3]);
+            readPosition(p1, bytes, stride, positionOffset, indices[t * 3 + 1]);
+            readPosition(p2, bytes, stride, positionOffset, indices[t * 3 + 2]);
+            const float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+            const float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+            const float n[3]  = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2],
+                 e1[0] * e2[1] - e1[1] * e2[0]};
+            const float area  = 0.5f * sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            for (uint32_t k = 0; k < 3; ++k) {
+                const float weighted = area * (p0[k] + p1[k] + p2[k]) / 3.f;
+                centroid[k] += weighted;
+                meshCentroid[k] += weighted;
+                normal[k] += n[k];
+            }
+            meshArea += area;
+        }
+    }
+    if (meshArea > 0.f) {
+        for (float& value : meshCentroid) {
+            value /= meshArea;
+        }
+    }
+
+    // front to back without a view: the clusters facing away from the center
+    // are in front of the others
+    std::vector<float> sortKeys(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c) {
+        const float* const centroid = &clusterData[c * 6];
+        const float* const normal   = &clusterData[c * 6 + 3];
+        const float area = 0.5f * sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        if (area <= 0.f) {
+            sortKeys[c] = 0.f;
+            continue;
+        }
+        float key = 0.f;
+        for (uint32_t k = 0; k < 3; ++k) {
+            key += (centroid[k] / area - meshCentroid[k]) * normal[k] / (2.f * area);
+        }
+        sortKeys[c] = key;
+    }
+    std::vector<uint32_t> order(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c) {
+        order[c] = static_cast<uint32_t>(c);
+    }
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+    size_t out = 0;
+    for (uint32_t c : order) {
+        const size_t begin = clusters[c] * size_t(3);
+        const size_t end   = clusters[c + 1] * size_t(3);
+        std::copy(indices + begin, indices + end, dst + out);
+        out += end - begin;
+    }
+}
+
+uint32_t
+optimizeVertexFetchRemap(uint32_t* remap, const uint32_t* indices, size_t indexCount, size_t vertexCount)
+{
+    std::fill(remap, remap + vertexCount, kInvalidIndex);
+    uint32_t next = 0;
+    for (size_t i = 0; i < indexCount; ++i) {
+        ASSERT(indices[i] < vertexCount);
+        if (remap[indices[i]] == kInvalidIndex) {
+            remap[indices[i]] = next++;
+        }
+    }
+    return next;
+}
+
+uint32_t
+optimizeVertexFetch(
+    void* dst, uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t stride)
+{
+    std::vector<uint32_t> remap(vertexCount);
+    const uint32_t        usedCount = optimizeVertexFetchRemap(remap.data(), indices, indexCount, vertexCount);
+    remapVertices(dst, vertices, vertexCount, stride, remap.data());
+    remapIndices(indices, indices, indexCount, remap.data());
+    return usedCount;
+}
+
+size_t
+stripify(uint32_t* dst, const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t restartIndex)
+{
+    ASSERT(indexCount % 3 == 0);
+    const size_t triangleCount = indexCount / 3;
+
+    Adjacency adjacency;
+    buildAdjacency(adjacency, indices, indexCount, vertexCount);
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        const uint32_t* triangle = indices + t * 3;
+        emitted[t] = triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[0] == triangle[2];
+    }
+
+    // the strips start in the input order: keeps its vertex cache locality
+    size_t out    = 0;
+    size_t cursor = 0;
+    for (;;) {
+        while (cursor < triangleCount && emitted[cursor]) {
+            ++cursor;
+        }
+        if (cursor == triangleCount) {
+            break;
+        }
+        const uint32_t* triangle = indices + cursor * 3;
+        emitted[cursor]          = 1;
+
+        // the rotation (a, b, c) continuing with the triangle of the edge c -> b
+        uint32_t rotation = 0;
+        for (uint32_t r = 0; r < 3; ++r) {
+            uint32_t third;
+            if (findTriangle(adjacency, indices, emitted, triangle[(r + 2) % 3], triangle[(r + 1) % 3], third)
+                != kInvalidIndex) {
+                rotation = r;
+                break;
+            }
+        }
+        if (out != 0) {
+            dst[out++] = restartIndex;
+        }
+        dst[out++] = triangle[rotation];
+        dst[out++] = triangle[(rotation + 1) % 3];
+        dst[out++] = triangle[(rotation + 2) % 3];
+
+        // the triangle k of a strip is (k, k + 1, k + 2), (k + 1, k, k + 2) when k is odd
+        uint32_t p   = triangle[(rotation + 1) % 3];
+        uint32_t q   = triangle[(rotation + 2) % 3];
+        bool     odd = true;
+        for (;;) {
+            uint32_t       third;
+            const uint32_t next = odd ? findTriangle(adjacency, indices, emitted, q, p, third)
+                                      : findTriangle(adjacency, indices, emitted, p, q, third);
+            if (next == kInvalidIndex) {
+                break;
+            }
+            emitted[next] = 1;
+            dst[out++]    = third;
+            p             = q;
+            q             = third;
+            odd           = !odd;
+        }
+    }
+    ASSERT(out <= stripifyBound(indexCount));
+    return out;
+}
+
+size_t
+unstripify(uint32_t* dst, const uint32_t* strip, size_t stripCount, uint32_t restartIndex)
+{
+    size_t out   = 0;
+    size_t start = 0;
+    for (size_t i = 0; i < stripCount; ++i) {
+        if (strip[i] == restartIndex) {
+            start = i + 1;
+            continue;
+        }
+        if (i - start < 2) {
+            continue;
+        }
+        uint32_t a = strip[i - 2];
+        uint32_t b = strip[i - 1];
+        if ((i - start) % 2 == 1) {
+            std::swap(a, b);
+        }
+        const uint32_t c = strip[i];
+        if (a != b && b != c && a != c) {
+            dst[out++] = a;
+            dst[out++] = b;
+            dst[out++] = c;
+        }
+    }
+    return out;
+}
+
+VertexCacheStats
+analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+{
+    VertexCacheStats stats;
+    if (indexCount == 0) {
+        return stats;
+    }
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    uint32_t              time = cacheSize + 1;
+    for (size_t i = 0; i < indexCount; ++i) {
+        ASSERT(indices[i] < vertexCount);
+        if (time - cacheTime[indices[i]] > cacheSize) {
+            cacheTime[indices[i]] = time++;
+            ++stats.invocations;
+        }
+    }
+    // every used vertex missed once
+    const size_t usedCount = vertexCount - std::count(cacheTime.begin(), cacheTime.end(), 0u);
+    stats.acmr             = static_cast<float>(stats.invocations) / static_cast<float>(indexCount / 3);
+    stats.atvr             = static_cast<float>(stats.invocations) / static_cast<float>(usedCount);
+    return stats;
+}
+
+VertexFetchStats
+analyzeVertexFetch(const uint32_t* indices, size_t indexCount, size_t vertexCount, size_t stride)
+{
+    constexpr size_t   kLineSize  = 64;
+    constexpr uint32_t kLineCount = 128;
+
+    VertexFetchStats stats;
+    const size_t     bufferSize = vertexCount * stride;
+    if (indexCount == 0 || bufferSize == 0) {
+        return stats;
+    }
+    // the vertex shader invocations (post transform cache misses) fetch
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<uint32_t> lineTime((bufferSize + kLineSize - 1) / kLineSize, 0);
+    uint32_t              time     = kCacheSize + 1;
+    uint32_t              lineTick = kLineCount + 1;
+    for (size_t i = 0; i < indexCount; ++i) {
+        const uint32_t vertex = indices[i];
+        if (time - cacheTime[vertex] <= kCacheSize) {
+            continue;
+        }
+        cacheTime[vertex] = time++;
+        for (size_t line = vertex * stride / kLineSize; line <= (vertex * stride + stride - 1) / kLineSize; ++line) {
+            if (lineTick - lineTime[line] > kLineCount) {
+                lineTime[line] = lineTick++;
+                stats.bytesFetched += kLineSize;
+            }
+        }
+    }
+    stats.overfetch = static_cast<float>(stats.bytesFetched) / static_cast<float>(bufferSize);
+    return stats;
+}
+
+OptimizeReport
+optimize(MeshData& mesh, const OptimizeOptions& options)
+{
+    ASSERT(mesh.stride != 0 && mesh.indices.size() % 3 == 0);
+    OptimizeReport report;
+    const size_t   indexCount  = mesh.indices.size();
+    const size_t   stride      = mesh.stride;
+    size_t         vertexCount = mesh.vertexCount();
+
+    report.vertexCountBefore = static_cast<uint32_t>(vertexCount);
+    report.cacheBefore       = analyzeVertexCache(mesh.indices.data(), indexCount, vertexCount);
+    report.fetchBefore       = analyzeVertexFetch(mesh.indices.data(), indexCount, vertexCount, stride);
+
+    // identical vertices
+    std::vector<uint32_t> remap(vertexCount);
+    const uint32_t        uniqueCount = generateVertexRemap(
+        remap.data(), mesh.indices.data(), indexCount, mesh.vertices.data(), vertexCount, stride);
+    if (uniqueCount < vertexCount) {
+        std::vector<uint8_t> vertices(uniqueCount * stride);
+        remapVertices(vertices.data(), mesh.vertices.data(), vertexCount, stride, remap.data());
+        remapIndices(mesh.indices.data(), mesh.indices.data(), indexCount, remap.data());
+        mesh.vertices.swap(vertices);
+        vertexCount = uniqueCount;
+    }
+
+    // triangle order
+    std::vector<uint32_t> indices(indexCount);
+    if (options.overdraw) {
+        optimizeVertexCacheTipsify(indices.data(), mesh.indices.data(), indexCount, vertexCount);
+        optimizeOverdraw(mesh.indices.data(), indices.data(), indexCount, mesh.vertices.data(), vertexCount, stride,
+            mesh.positionOffset, options.overdrawThreshold);
+    } else {
+        optimizeVertexCache(indices.data(), mesh.indices.data(), indexCount, vertexCount);
+        mesh.indices.swap(indices);
+    }
+
+    // vertex order
+    std::vector<uint8_t> vertices(vertexCount * stride);
+    vertexCount = optimizeVertexFetch(
+        vertices.data(), mesh.indices.data(), indexCount, mesh.vertices.data(), vertexCount, stride);
+    vertices.resize(vertexCount * stride);
+    mesh.vertices.swap(vertices);
+
+    report.vertexCountAfter = static_cast<uint32_t>(vertexCount);
+    report.cacheAfter       = analyzeVertexCache(mesh.indices.data(), indexCount, vertexCount);
+    report.fetchAfter       = analyzeVertexFetch(mesh.indices.data(), indexCount, vertexCount, stride);
+    if (options.strip) {
+        std::vector<uint32_t> strip(stripifyBound(indexCount));
+        report.stripIndexCount = stripify(strip.data(), mesh.indices.data(), indexCount, vertexCount, ~0u);
+    }
+    return report;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace mesh
@@ -0,0 +1,130 @@
+#include "mesh/gltf.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+/////////////////////////////////////////////////////////////////////////////////
+
+std::string
+base64(const std::vector<uint8_t>& data)
+{
+    static const char* const kDigits = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string              text;
+    for (size_t i = 0; i < data.size(); i += 3) {
+        const uint32_t bits = data[i] << 16 | (i + 1 < data.size() ? data[i + 1] << 8 : 0)
+                            | (i + 2 < data.size() ? data[i + 2] : 0);
+        text += kDigits[bits >> 18];
+        text += kDigits[(bits >> 12) & 63];
+        text += i + 1 < data.size() ? kDigits[(bits >> 6) & 63] : '=';
+        text += i + 2 < data.size() ? kDigits[bits & 63] : '=';
+    }
+    return text;
+}
+
+//! a triangle: 3 float3 positions then 3 uint16 indices (and 2 padding bytes)
+std::vector<uint8_t>
+triangleBuffer()
+{
+    const float          positions[9] = {0, 0, 0, 1, 0, 0, 0, 1, 0};
+    const uint16_t       indices[4]   = {0, 2, 1, 0};
+    std::vector<uint8_t> data(sizeof(positions) + sizeof(indices));
+    memcpy(data.data(), positions, sizeof(positions));
+    memcpy(data.data() + sizeof(positions), indices, sizeof(indices));
+    return data;
+}
+
+//! bufferUri empty: the binary chunk of a .glb
+std::string
+triangleJson(const std::string& bufferUri)
+{
+    return R"({"asset": {"version": "2.0"}, "scene": 0,
+        "scenes": [{"nodes": [0]}],
+        "nodes": [{"name": "root", "translation": [1, 2, 3], "children": [1]},
+                  {"name": "child", "mesh": 0, "scale": [2, 2, 2]}],
+        "meshes": [{"name": "triangle", "primitives": [{"attributes": {"POSITION": 0}, "indices": 1}]}],
+        "accessors": [
+            {"bufferView": 0, "componentType": 5126, "count": 3, "type": "VEC3"},
+            {"bufferView": 1, "componentType": 5123, "count": 3, "type": "SCALAR"}],
+        "bufferViews": [
+            {"buffer": 0, "byteOffset": 0, "byteLength": 36},
+            {"buffer": 0, "byteOffset": 36, "byteLength": 6}],
+        "buffers": [{"byteLength": 44)"
+         + (bufferUri.empty() ? std::string() : ", \"uri\": \"" + bufferUri + "\"") + "}]}";
+}
+
+core::vfs::FileHandle
+makeFile(const std::string& text)
+{
+    core::vfs::FileHandle file = core::vfs::FileHandle::Allocate(text.size());
+    memcpy(file.MutableData(), text.data(), text.size());
+    return file;
+}
+
+void
+expectTriangle(const mesh::Scene& scene)
+{
+    ASSERT_EQ(scene.meshes.size(), 1u);
+    ASSERT_EQ(scene.nodes.size(), 1u);
+    EXPECT_EQ(scene.meshes[0].name, "triangle/0");
+    EXPECT_EQ(scene.nodes[0].name, "child");
+
+    const mesh::MeshData& mesh = scene.meshes[0].data;
+    EXPECT_EQ(mesh.vertexCount(), 3u);
+    EXPECT_EQ(mesh.indices, std::vector<uint32_t>({0, 2, 1}));
+    mesh::Vertex vertex;
+    memcpy(&vertex, mesh.vertices.data() + 2 * mesh.stride, sizeof(vertex));
+    EXPECT_EQ(vertex.position[1], 1.f);
+
+    // the transforms of the hierarchy composed: the parent translation, the child scale
+    const float* transform = scene.nodes[0].transform;
+    EXPECT_FLOAT_EQ(transform[0], 2.f);
+    EXPECT_FLOAT_EQ(transform[10], 2.f);
+    EXPECT_FLOAT_EQ(transform[12], 1.f);
+    EXPECT_FLOAT_EQ(transform[14], 3.f);
+}
+
+TEST(MeshGltf, embeddedBuffer)
+{
+    mesh::Scene scene;
+    ASSERT_TRUE(mesh::parseGltf(
+        makeFile(triangleJson("data:application/octet-stream;base64," + base64(triangleBuffer()))), "", scene));
+    expectTriangle(scene);
+}
+
+TEST(MeshGltf, binary)
+{
+    std::string json = triangleJson("");
+    json.resize((json.size() + 3) & ~size_t(3), ' ');
+    const std::vector<uint8_t> buffer = triangleBuffer();
+
+    std::string    glb(12, '\0');
+    const uint32_t jsonChunk[2] = {static_cast<uint32_t>(json.size()), 0x4e4f534a};
+    const uint32_t binChunk[2]  = {static_cast<uint32_t>(buffer.size()), 0x004e4942};
+    glb.append(reinterpret_cast<const char*>(jsonChunk), sizeof(jsonChunk)).append(json);
+    glb.append(reinterpret_cast<const char*>(binChunk), sizeof(binChunk));
+    glb.append(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+    const uint32_t header[3] = {0x46546c67, 2, static_cast<uint32_t>(glb.size())};
+    memcpy(glb.data(), header, sizeof(header));
+
+    mesh::Scene scene;
+    ASSERT_TRUE(mesh::parseGltf(makeFile(glb), "", scene));
+    expectTriangle(scene);
+}
+
+TEST(MeshGltf, unsupported)
+{
+    mesh::Scene scene;
+    EXPECT_FALSE(mesh::parseGltf(makeFile(R"({"asset": {"version": "1.0"}})"), "", scene));
+    EXPECT_FALSE(mesh::parseGltf(makeFile("{\"asset\": "), "", scene));
+    // the buffer is too short for its accessors
+    std::string json = triangleJson("data:application/octet-stream;base64," + base64({1, 2, 3}));
+    EXPECT_FALSE(mesh::parseGltf(makeFile(json), "", scene));
+    EXPECT_FALSE(mesh::parseGltf(makeFile(triangleJson("missing.bin")), "", scene));
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace
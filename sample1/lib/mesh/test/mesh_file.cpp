@@ -0,0 +1,130 @@
+#include "mesh/mesh_file.h"
+
+#include "core/memory.h"
+#include "core/test/temp_directory.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+namespace {
+/////////////////////////////////////////////////////////////////////////////////
+
+//! a grid of size * size quads of Vertex
+mesh::MeshData
+makeGrid(uint32_t size)
+{
+    mesh::MeshData mesh;
+    mesh.stride         = sizeof(mesh::Vertex);
+    mesh.positionOffset = offsetof(mesh::Vertex, position);
+    for (uint32_t y = 0; y <= size; ++y) {
+        for (uint32_t x = 0; x <= size; ++x) {
+            const mesh::Vertex vertex {{float(x), float(y), 0.f}, {0.f, 0.f, 1.f}, {x / float(size), y / float(size)}};
+            const uint8_t*     bytes = reinterpret_cast<const uint8_t*>(&vertex);
+            mesh.vertices.insert(mesh.vertices.end(), bytes, bytes + sizeof(vertex));
+        }
+    }
+    for (uint32_t y = 0; y < size; ++y) {
+        for (uint32_t x = 0; x < size; ++x) {
+            const uint32_t corner = y * (size + 1) + x;
+            mesh.indices.insert(mesh.indices.end(), {corner, corner + 1, corner + size + 2});
+            mesh.indices.insert(mesh.indices.end(), {corner, corner + size + 2, corner + size + 1});
+        }
+    }
+    return mesh;
+}
+
+using MeshFile = core::test::TempDirectoryTest;
+
+TEST_F(MeshFile, writeAndOpen)
+{
+    const mesh::MeshData small = makeGrid(4);
+    const mesh::MeshData large = makeGrid(300);   // more than 65536 vertices: 32 bit indices
+    const float          transform[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 2, 3, 4, 1};
+
+    mesh::MeshFileWriter writer;
+    EXPECT_EQ(writer.AddMesh("small", small, mesh::kVertexAttributes, 3), 0u);
+    EXPECT_EQ(writer.AddMesh("large", large, mesh::kVertexAttributes, 3), 1u);
+    EXPECT_EQ(writer.AddMesh("empty", mesh::MeshData(), mesh::kVertexAttributes, 3), UINT32_MAX);
+    writer.AddNode("node", 1, transform);
+    mesh::MeshFileWriter::Summary summary;
+    ASSERT_TRUE(writer.Write(nativePath("grid.mesh").c_str(), &summary));
+    EXPECT_FALSE(std::filesystem::exists(nativePath("grid.mesh.tmp")));
+    EXPECT_EQ(summary.meshCount, 2u);
+    EXPECT_EQ(summary.nodeCount, 1u);
+    EXPECT_EQ(summary.vertexBytes, small.vertices.size() + large.vertices.size());
+    EXPECT_EQ(summary.indexBytes, small.indices.size() * 2 + large.indices.size() * 4);
+    EXPECT_EQ(summary.fileSize, std::filesystem::file_size(nativePath("grid.mesh")));
+
+    mesh::MeshFile file;
+    ASSERT_TRUE(file.Open(core::vfs::FileHandle::MapFile(nativePath("grid.mesh").c_str()), "grid.mesh"));
+    ASSERT_EQ(file.meshCount(), 2u);
+    ASSERT_EQ(file.nodeCount(), 1u);
+    EXPECT_EQ(file.meshName(file.mesh(0)), "small");
+    EXPECT_EQ(file.nodeName(file.node(0)), "node");
+    EXPECT_EQ(file.node(0).mesh, 1u);
+    EXPECT_EQ(file.node(0).transform[13], 3.f);
+
+    // the streams are the GPU data as it is: 16 bit indices when they fit
+    const mesh::MeshEntry& entry = file.mesh(0);
+    EXPECT_EQ(entry.indexStride, 2u);
+    EXPECT_EQ(entry.attributeCount, 3u);
+    EXPECT_EQ(entry.attributes[2].format, mesh::AttributeFormat::Float2);
+    EXPECT_EQ(entry.boundsMax[0], 4.f);
+    EXPECT_TRUE(core::isAligned(file.vertices(entry), mesh::kStreamAlignment));
+    EXPECT_EQ(memcmp(file.vertices(entry), small.vertices.data(), entry.vertexSize), 0);
+    const uint16_t* indices = reinterpret_cast<const uint16_t*>(file.indices(entry));
+    for (uint32_t i = 0; i < entry.indexCount; ++i) {
+        ASSERT_EQ(indices[i], small.indices[i]);
+    }
+
+    const mesh::MeshEntry& largeEntry = file.mesh(1);
+    EXPECT_EQ(largeEntry.indexStride, 4u);
+    EXPECT_EQ(largeEntry.vertexCount, large.vertexCount());
+    EXPECT_EQ(memcmp(file.indices(largeEntry), large.indices.data(), largeEntry.indexSize), 0);
+}
+
+TEST_F(MeshFile, rejectsCorruption)
+{
+    mesh::MeshFileWriter writer;
+    writer.AddMesh("grid", makeGrid(8), mesh::kVertexAttributes, 3);
+    ASSERT_TRUE(writer.Write(nativePath("grid.mesh").c_str()));
+    const std::string path = nativePath("grid.mesh");
+
+    const auto patch = [&](uint64_t offset) {
+        std::FILE* file = std::fopen(path.c_str(), "r+b");
+        std::fseek(file, static_cast<long>(offset), SEEK_SET);
+        const int byte = std::fgetc(file);
+        std::fseek(file, static_cast<long>(offset), SEEK_SET);
+        std::fputc(byte ^ 0x5a, file);
+        std::fclose(file);
+    };
+    const auto open = [&]() {
+        mesh::MeshFile file;
+        return file.Open(core::vfs::FileHandle::MapFile(path.c_str()), "grid.mesh");
+    };
+
+    mesh::MeshFile missing;
+    EXPECT_FALSE(missing.Open(core::vfs::FileHandle::MapFile(nativePath("missing.mesh").c_str()), "missing.mesh"));
+    ASSERT_TRUE(open());
+
+    // the mesh table: caught by the hash
+    patch(sizeof(mesh::MeshFileHeader) + offsetof(mesh::MeshEntry, vertexCount));
+    EXPECT_FALSE(open());
+    patch(sizeof(mesh::MeshFileHeader) + offsetof(mesh::MeshEntry, vertexCount));
+    EXPECT_TRUE(open());
+
+    patch(offsetof(mesh::MeshFileHeader, version));
+    EXPECT_FALSE(open());
+    patch(offsetof(mesh::MeshFileHeader, version));
+
+    // truncated
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+    EXPECT_FALSE(open());
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace
@@ -0,0 +1,73 @@
+#include "mesh/obj.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+namespace {
+/////////////////////////////////////////////////////////////////////////////////
+
+mesh::Vertex
+vertexAt(const mesh::MeshData& mesh, uint32_t index)
+{
+    mesh::Vertex vertex;
+    memcpy(&vertex, mesh.vertices.data() + index * mesh.stride, sizeof(vertex));
+    return vertex;
+}
+
+TEST(MeshObj, parseQuad)
+{
+    const char* const text = "# quad\n"
+                             "v 0 0 0\n"
+                             "v 1 0 0\n"
+                             "v 1 1 0\n"
+                             "v 0 1 0\n"
+                             "vt 0 0\n"
+                             "vt 1 1 0\n"
+                             "vn 0 0 1\n"
+                             "g quad\r\n"
+                             "f 1/1/1 2/1/1 3/2/1 -1/2/-1\n";
+    mesh::MeshData mesh;
+    ASSERT_TRUE(mesh::parseObj(text, mesh));
+    EXPECT_EQ(mesh.stride, sizeof(mesh::Vertex));
+    EXPECT_EQ(mesh.vertexCount(), 4u);
+    ASSERT_EQ(mesh.indices.size(), 6u);
+    // a fan around the first corner, shared corners indexed once
+    EXPECT_EQ(mesh.indices[0], mesh.indices[3]);
+    EXPECT_EQ(mesh.indices[2], mesh.indices[4]);
+
+    const mesh::Vertex last = vertexAt(mesh, mesh.indices[5]);
+    EXPECT_EQ(last.position[1], 1.f);
+    EXPECT_EQ(last.uv[0], 1.f);
+    EXPECT_EQ(last.normal[2], 1.f);
+}
+
+TEST(MeshObj, positionsOnly)
+{
+    mesh::MeshData mesh;
+    ASSERT_TRUE(mesh::parseObj("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3", mesh));
+    EXPECT_EQ(mesh.indices.size(), 3u);
+    EXPECT_EQ(vertexAt(mesh, 1).normal[2], 0.f);
+}
+
+TEST(MeshObj, malformed)
+{
+    mesh::MeshData mesh;
+    EXPECT_FALSE(mesh::parseObj("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 4\n", mesh));
+    EXPECT_FALSE(mesh::parseObj("v 0 0 0\nv 1 0 0\nf 1 2\n", mesh));
+    EXPECT_FALSE(mesh::parseObj("v 0 zero 0\n", mesh));
+    EXPECT_FALSE(mesh::parseObj("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1/2 2/2 3/2\n", mesh));
+}
+
+TEST(MeshObj, writeRoundTrip)
+{
+    mesh::MeshData mesh;
+    ASSERT_TRUE(mesh::parseObj("v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0.5\nvt 0.25 0.75\nf 1/1 2/1 3/1 4/1\n", mesh));
+    mesh::MeshData copy;
+    ASSERT_TRUE(mesh::parseObj(mesh::writeObj(mesh), copy));
+    EXPECT_EQ(copy.indices, mesh.indices);
+    EXPECT_EQ(copy.vertices, mesh.vertices);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace
@@ -0,0 +1,234 @@
+#include "mesh/optimize.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+/////////////////////////////////////////////////////////////////////////////////
+
+struct Vertex {
+    float position[3];
+    float uv[2];
+};
+
+//! size x size quads of a sphere-ish height field, the triangles shuffled
+mesh::MeshData
+makeGrid(uint32_t size, bool shuffle)
+{
+    mesh::MeshData mesh;
+    mesh.stride         = sizeof(Vertex);
+    mesh.positionOffset = 0;
+    std::vector<Vertex> vertices;
+    for (uint32_t y = 0; y <= size; ++y) {
+        for (uint32_t x = 0; x <= size; ++x) {
+            const float u = static_cast<float>(x) / size;
+            const float v = static_cast<float>(y) / size;
+            vertices.push_back(Vertex {{u, v, 0.25f - (u - 0.5f) * (u - 0.5f) - (v - 0.5f) * (v - 0.5f)}, {u, v}});
+        }
+    }
+    mesh.vertices.resize(vertices.size() * sizeof(Vertex));
+    memcpy(mesh.vertices.data(), vertices.data(), mesh.vertices.size());
+
+    std::vector<std::array<uint32_t, 3>> triangles;
+    for (uint32_t y = 0; y < size; ++y) {
+        for (uint32_t x = 0; x < size; ++x) {
+            const uint32_t i = y * (size + 1) + x;
+            triangles.push_back({i, i + 1, i + size + 1});
+            triangles.push_back({i + 1, i + size + 2, i + size + 1});
+        }
+    }
+    if (shuffle) {
+        std::mt19937 random(5);
+        std::shuffle(triangles.begin(), triangles.end(), random);
+    }
+    for (const std::array<uint32_t, 3>& triangle : triangles) {
+        mesh.indices.insert(mesh.indices.end(), triangle.begin(), triangle.end());
+    }
+    return mesh;
+}
+
+//! the triangles as positions, rotated to start with the smallest vertex:
+//! order independent, the winding is kept
+std::vector<std::array<float, 9>>
+triangleSet(const std::vector<uint32_t>& indices, const std::vector<uint8_t>& vertices, uint32_t stride)
+{
+    std::vector<std::array<float, 9>> triangles;
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        std::array<std::array<float, 3>, 3> corners;
+        for (uint32_t k = 0; k < 3; ++k) {
+            memcpy(corners[k].data(), vertices.data() + indices[i + k] * stride, sizeof(corners[k]));
+        }
+        std::rotate(corners.begin(), std::min_element(corners.begin(), corners.end()), corners.end());
+        std::array<float, 9> triangle;
+        for (uint32_t k = 0; k < 3; ++k) {
+            std::copy(corners[k].begin(), corners[k].end(), triangle.begin() + k * 3);
+        }
+        triangles.push_back(triangle);
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+float
+acmr(const mesh::MeshData& mesh)
+{
+    return mesh::analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount()).acmr;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+
+TEST(MeshOptimize, vertexRemapMergesIdenticalVertices)
+{
+    const Vertex          vertices[] = {{{0, 0, 0}, {0, 0}}, {{1, 0, 0}, {0, 0}}, {{0, 0, 0}, {0, 0}},
+                 {{0, 1, 0}, {0, 0}}, {{5, 5, 5}, {0, 0}}};
+    const uint32_t        indices[]  = {0, 1, 3, 2, 3, 1};
+    std::vector<uint32_t> remap(5);
+    EXPECT_EQ(mesh::generateVertexRemap(remap.data(), indices, 6, vertices, 5, sizeof(Vertex)), 3u);
+    EXPECT_EQ(remap[0], remap[2]);
+    EXPECT_NE(remap[0], remap[1]);
+    EXPECT_EQ(remap[4], ~0u);   // unused
+
+    uint32_t remapped[6];
+    mesh::remapIndices(remapped, indices, 6, remap.data());
+    EXPECT_EQ(remapped[0], remapped[3]);
+
+    EXPECT_EQ(mesh::generateVertexRemap(remap.data(), nullptr, 0, vertices, 5, sizeof(Vertex)), 4u);
+}
+
+TEST(MeshOptimize, analyzeVertexCache)
+{
+    const uint32_t indices[] = {0, 1, 2, 2, 1, 3};
+    const mesh::VertexCacheStats stats = mesh::analyzeVertexCache(indices, 6, 4);
+    EXPECT_EQ(stats.invocations, 4u);
+    EXPECT_FLOAT_EQ(stats.acmr, 2.f);
+    EXPECT_FLOAT_EQ(stats.atvr, 1.f);
+}
+
+TEST(MeshOptimize, vertexCacheImprovesAcmr)
+{
+    const mesh::MeshData grid = makeGrid(64, true);
+    const float          before = acmr(grid);
+
+    mesh::MeshData forsyth = grid;
+    mesh::optimizeVertexCache(forsyth.indices.data(), grid.indices.data(), grid.indices.size(), grid.vertexCount());
+    EXPECT_LT(acmr(forsyth), 0.8f);
+    EXPECT_LT(acmr(forsyth), before * 0.5f);
+    EXPECT_EQ(triangleSet(forsyth.indices, forsyth.vertices, forsyth.stride),
+        triangleSet(grid.indices, grid.vertices, grid.stride));
+
+    mesh::MeshData tipsify = grid;
+    mesh::optimizeVertexCacheTipsify(
+        tipsify.indices.data(), grid.indices.data(), grid.indices.size(), grid.vertexCount());
+    EXPECT_LT(acmr(tipsify), 0.9f);
+    EXPECT_EQ(triangleSet(tipsify.indices, tipsify.vertices, tipsify.stride),
+        triangleSet(grid.indices, grid.vertices, grid.stride));
+}
+
+TEST(MeshOptimize, overdrawKeepsTheTrianglesAndMostOfTheCache)
+{
+    const mesh::MeshData grid = makeGrid(64, true);
+    mesh::MeshData       tipsify = grid;
+    mesh::optimizeVertexCacheTipsify(
+        tipsify.indices.data(), grid.indices.data(), grid.indices.size(), grid.vertexCount());
+
+    mesh::MeshData overdraw = tipsify;
+    mesh::optimizeOverdraw(overdraw.indices.data(), tipsify.indices.data(), tipsify.indices.size(),
+        tipsify.vertices.data(), tipsify.vertexCount(), tipsify.stride, tipsify.positionOffset, 1.05f);
+    EXPECT_EQ(triangleSet(overdraw.indices, overdraw.vertices, overdraw.stride),
+        triangleSet(grid.indices, grid.vertices, grid.stride));
+    EXPECT_LT(acmr(overdraw), acmr(tipsify) * 1.25f);
+}
+
+TEST(MeshOptimize, vertexFetchFollowsTheFirstUse)
+{
+    // the vertices shuffled
+    mesh::MeshData        grid = makeGrid(64, false);
+    std::vector<uint32_t> permutation(grid.vertexCount());
+    for (uint32_t v = 0; v < permutation.size(); ++v) {
+        permutation[v] = v;
+    }
+    std::shuffle(permutation.begin(), permutation.end(), std::mt19937(3));
+    std::vector<uint8_t> shuffled(grid.vertices.size());
+    mesh::remapVertices(shuffled.data(), grid.vertices.data(), grid.vertexCount(), grid.stride, permutation.data());
+    mesh::remapIndices(grid.indices.data(), grid.indices.data(), grid.indices.size(), permutation.data());
+    grid.vertices.swap(shuffled);
+
+    std::vector<uint8_t> vertices(grid.vertices.size());
+    std::vector<uint32_t> indices = grid.indices;
+    const uint32_t       vertexCount = mesh::optimizeVertexFetch(
+        vertices.data(), indices.data(), indices.size(), grid.vertices.data(), grid.vertexCount(), grid.stride);
+    EXPECT_EQ(vertexCount, grid.vertexCount());
+
+    uint32_t next = 0;
+    for (uint32_t index : indices) {
+        EXPECT_LE(index, next);
+        next = std::max(next, index + 1);
+    }
+    EXPECT_EQ(triangleSet(indices, vertices, grid.stride), triangleSet(grid.indices, grid.vertices, grid.stride));
+
+    const mesh::VertexFetchStats before = mesh::analyzeVertexFetch(
+        grid.indices.data(), grid.indices.size(), grid.vertexCount(), grid.stride);
+    const mesh::VertexFetchStats after
+        = mesh::analyzeVertexFetch(indices.data(), indices.size(), vertexCount, grid.stride);
+    EXPECT_LT(after.bytesFetched, before.bytesFetched);
+}
+
+TEST(MeshOptimize, stripRoundTrip)
+{
+    const mesh::MeshData grid = makeGrid(32, false);
+    std::vector<uint32_t> list(grid.indices.size());
+    mesh::optimizeVertexCache(list.data(), grid.indices.data(), grid.indices.size(), grid.vertexCount());
+
+    std::vector<uint32_t> strip(mesh::stripifyBound(list.size()));
+    const size_t          stripCount = mesh::stripify(strip.data(), list.data(), list.size(), grid.vertexCount(), ~0u);
+    strip.resize(stripCount);
+    EXPECT_LT(stripCount, list.size());
+
+    std::vector<uint32_t> unstripped(stripCount * 3);
+    unstripped.resize(mesh::unstripify(unstripped.data(), strip.data(), strip.size(), ~0u));
+    EXPECT_EQ(triangleSet(unstripped, grid.vertices, grid.stride), triangleSet(list, grid.vertices, grid.stride));
+}
+
+TEST(MeshOptimize, stripDropsDegenerateTriangles)
+{
+    const uint32_t indices[] = {0, 1, 2, 3, 3, 1, 2, 1, 3};
+    uint32_t       strip[12];
+    const size_t   stripCount = mesh::stripify(strip, indices, 9, 4, ~0u);
+    uint32_t       list[12];
+    EXPECT_EQ(mesh::unstripify(list, strip, stripCount, ~0u), 6u);
+}
+
+TEST(MeshOptimize, optimizeReportsTheMetrics)
+{
+    for (bool overdraw : {true, false}) {
+        mesh::MeshData grid = makeGrid(48, true);
+        // every vertex twice: the duplicates are merged
+        const size_t vertexCount = grid.vertexCount();
+        grid.vertices.insert(grid.vertices.end(), grid.vertices.begin(), grid.vertices.end());
+        for (size_t i = 0; i < grid.indices.size(); i += 2) {
+            grid.indices[i] += static_cast<uint32_t>(vertexCount);
+        }
+        const std::vector<std::array<float, 9>> triangles = triangleSet(grid.indices, grid.vertices, grid.stride);
+
+        mesh::OptimizeOptions options;
+        options.overdraw                   = overdraw;
+        options.strip                      = true;
+        const mesh::OptimizeReport report = mesh::optimize(grid, options);
+        EXPECT_EQ(report.vertexCountBefore, vertexCount * 2);
+        EXPECT_EQ(report.vertexCountAfter, vertexCount);
+        EXPECT_EQ(grid.vertexCount(), vertexCount);
+        EXPECT_LT(report.cacheAfter.acmr, report.cacheBefore.acmr * 0.5f);
+        EXPECT_LT(report.cacheAfter.atvr, report.cacheBefore.atvr);
+        EXPECT_LT(report.fetchAfter.bytesFetched, report.fetchBefore.bytesFetched);
+        EXPECT_NE(report.stripIndexCount, 0u);
+        EXPECT_EQ(triangleSet(grid.indices, grid.vertices, grid.stride), triangles);
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace
@@ -0,0 +1,142 @@
+// Converts OBJ and glTF (.gltf, .glb) files to one mesh file (mesh/mesh_file.h)
+// and compares its load time with the parse time of the text formats.
+//
+//   mesh_converter [-no-optimize] <output.mesh> <input.obj|.gltf|.glb>...
+//
+// Every mesh goes through mesh::optimize() (vertex cache, overdraw, vertex
+// fetch) unless -no-optimize. The meshes of an OBJ file are named after the
+// file, an identity node instances them.
+#include "core/vfs.h"
+#include "mesh/gltf.h"
+#include "mesh/mesh_file.h"
+#include "mesh/obj.h"
+#include "mesh/optimize.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace {
+////////////////////////////////////////////////////////////////////////////////
+
+int
+usage()
+{
+    fprintf(stderr, "usage: mesh_converter [-no-optimize] <output.mesh> <input.obj|.gltf|.glb>...\n");
+    return 2;
+}
+
+double
+elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool
+loadObj(const char* nativePath, mesh::Scene& scene)
+{
+    const core::vfs::FileHandle file = core::vfs::FileHandle::MapFile(nativePath);
+    mesh::Scene::Mesh           mesh;
+    if (!file || !mesh::parseObj(file.asString(), mesh.data)) {
+        return false;
+    }
+    mesh.name = std::filesystem::path(nativePath).stem().string();
+
+    mesh::Scene::Node& node = scene.nodes.emplace_back();
+    node.name               = mesh.name;
+    node.mesh               = 0;
+    memset(node.transform, 0, sizeof(node.transform));
+    node.transform[0] = node.transform[5] = node.transform[10] = node.transform[15] = 1.f;
+    scene.meshes.push_back(std::move(mesh));
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace
+
+int
+main(int argc, char** argv)
+{
+    bool optimize = true;
+    int  arg      = 1;
+    for (; arg < argc && argv[arg][0] == '-'; ++arg) {
+        if (strcmp(argv[arg], "-no-optimize") == 0) {
+            optimize = false;
+        } else {
+            return usage();
+        }
+    }
+    if (argc - arg < 2) {
+        return usage();
+    }
+    const char* const outputPath = argv[arg++];
+
+    mesh::MeshFileWriter writer;
+    double               parseMs = 0.0;
+    for (; arg < argc; ++arg) {
+        const char* const inputPath = argv[arg];
+        const std::string extension = std::filesystem::path(inputPath).extension().string();
+        mesh::Scene       scene;
+        auto              start  = std::chrono::steady_clock::now();
+        const bool        loaded = extension == ".obj" ? loadObj(inputPath, scene) : mesh::loadGltf(inputPath, scene);
+        const double      ms     = elapsedMs(start);
+        if (!loaded) {
+            fprintf(stderr, "error: couldn't load '%s'\n", inputPath);
+            return 1;
+        }
+        parseMs += ms;
+
+        uint64_t triangles = 0;
+        for (mesh::Scene::Mesh& sceneMesh : scene.meshes) {
+            triangles += sceneMesh.data.indices.size() / 3;
+            if (optimize) {
+                const mesh::OptimizeReport report = mesh::optimize(sceneMesh.data);
+                printf("  %s: ACMR %.3f -> %.3f, overfetch %.3f -> %.3f\n", sceneMesh.name.c_str(),
+                    report.cacheBefore.acmr, report.cacheAfter.acmr, report.fetchBefore.overfetch,
+                    report.fetchAfter.overfetch);
+            }
+        }
+        if (!writer.AddScene(scene)) {
+            fprintf(stderr, "error: couldn't convert '%s'\n", inputPath);
+            return 1;
+        }
+        printf("%s: %u meshes, %u nodes, %llu triangles, parsed in %.2f ms\n", inputPath,
+            static_cast<uint32_t>(scene.meshes.size()), static_cast<uint32_t>(scene.nodes.size()),
+            static_cast<unsigned long long>(triangles), ms);
+    }
+
+    mesh::MeshFileWriter::Summary summary;
+    if (!writer.Write(outputPath, &summary)) {
+        return 1;
+    }
+
+    // the load of the runtime: map + validate, then the streams copied as they
+    // are (to the staging buffer)
+    auto           start = std::chrono::steady_clock::now();
+    mesh::MeshFile file;
+    if (!file.Open(core::vfs::FileHandle::MapFile(outputPath), outputPath)) {
+        return 1;
+    }
+    const double         openMs = elapsedMs(start);
+    std::vector<uint8_t> staging(summary.vertexBytes + summary.indexBytes);
+    start              = std::chrono::steady_clock::now();
+    uint8_t* stagingAt = staging.data();
+    for (uint32_t i = 0; i < file.meshCount(); ++i) {
+        const mesh::MeshEntry& entry = file.mesh(i);
+        memcpy(stagingAt, file.vertices(entry), entry.vertexSize);
+        memcpy(stagingAt + entry.vertexSize, file.indices(entry), entry.indexSize);
+        stagingAt += entry.vertexSize + entry.indexSize;
+    }
+    const double copyMs = elapsedMs(start);
+
+    printf("%s: %u meshes, %u nodes, %llu bytes (%llu vertex, %llu index)\n", outputPath, summary.meshCount,
+        summary.nodeCount, static_cast<unsigned long long>(summary.fileSize),
+        static_cast<unsigned long long>(summary.vertexBytes), static_cast<unsigned long long>(summary.indexBytes));
+    printf("load: parse %.2f ms, binary open %.3f ms + stream copy %.3f ms (%.0fx)\n", parseMs, openMs, copyMs,
+        parseMs / std::max(openMs + copyMs, 1e-3));
+    return 0;
+}
@@ -0,0 +1,125 @@
+// Packs asset directories into a pak archive (core/pak.h).
+//
+//   pak_packer [-s] <output.pak> <root> [subdir...]   pack root (or only root/subdir...)
+//   pak_packer -l <archive.pak>                        list the entries
+//   pak_packer -v <archive.pak>                        check every content hash
+//
+// Entry paths are relative to root with '/' separators: "shaders/shader.vert.spv".
+// -s stores everything uncompressed. SPIR-V and mesh files are always stored
+// uncompressed, they are handed to the driver (or copied to the GPU) straight
+// from the mapping.
+#include "core/pak.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+namespace {
+////////////////////////////////////////////////////////////////////////////////
+
+bool
+isReadInPlace(const std::filesystem::path& path)
+{
+    return path.extension() == ".spv" || path.extension() == ".mesh";
+}
+
+bool
+addDirectory(core::pak::PakWriter& writer, const std::filesystem::path& root, const std::filesystem::path& directory,
+    bool compress)
+{
+    std::error_code error;
+    for (std::filesystem::recursive_directory_iterator it(directory, error), end; !error && it != end;
+         it.increment(error)) {
+        if (!it->is_regular_file()) {
+            continue;
+        }
+        const std::string     path = std::filesystem::relative(it->path(), root).generic_string();
+        core::vfs::FileHandle data = core::vfs::FileHandle::MapFile(it->path().string().c_str());
+        if (!data) {
+            fprintf(stderr, "error: couldn't read '%s'\n", it->path().string().c_str());
+            return false;
+        }
+        writer.Add(path, std::move(data), compress && !isReadInPlace(it->path()));
+    }
+    if (error) {
+        fprintf(stderr, "error: couldn't walk '%s': %s\n", directory.string().c_str(), error.message().c_str());
+        return false;
+    }
+    return true;
+}
+
+int
+list(const char* archivePath, bool verify)
+{
+    std::unique_ptr<core::pak::ArchiveMount> archive = core::pak::ArchiveMount::Load(archivePath);
+    if (!archive) {
+        return 1;
+    }
+    if (verify) {
+        const bool valid = archive->Verify();
+        printf("%s: %u entries, %s\n", archivePath, archive->entryCount(), valid ? "ok" : "CORRUPTED");
+        return valid ? 0 : 1;
+    }
+    for (uint32_t i = 0; i < archive->entryCount(); ++i) {
+        const core::pak::Entry& entry = archive->entry(i);
+        const std::string_view  path  = archive->entryPath(entry);
+        printf("%10llu %10llu %4s %016llx %.*s\n", static_cast<unsigned long long>(entry.size),
+            static_cast<unsigned long long>(entry.storedSize),
+            entry.compression == core::pak::Compression::Lz4 ? "lz4" : "raw",
+            static_cast<unsigned long long>(entry.contentHash), static_cast<int>(path.size()), path.data());
+    }
+    return 0;
+}
+
+int
+usage()
+{
+    fprintf(stderr,
+        "usage: pak_packer [-s] <output.pak> <root> [subdir...]\n"
+        "       pak_packer -l|-v <archive.pak>\n");
+    return 2;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace
+
+int
+main(int argc, char** argv)
+{
+    if (argc == 3 && (strcmp(argv[1], "-l") == 0 || strcmp(argv[1], "-v") == 0)) {
+        return list(argv[2], argv[1][1] == 'v');
+    }
+
+    int        arg      = 1;
+    const bool compress = !(arg < argc && strcmp(argv[arg], "-s") == 0);
+    if (!compress) {
+        ++arg;
+    }
+    if (argc - arg < 2) {
+        return usage();
+    }
+    const char* const           outputPath = argv[arg++];
+    const std::filesystem::path root       = argv[arg++];
+
+    core::pak::PakWriter writer;
+    if (arg == argc) {
+        if (!addDirectory(writer, root, root, compress)) {
+            return 1;
+        }
+    }
+    for (; arg < argc; ++arg) {
+        if (!addDirectory(writer, root, root / argv[arg], compress)) {
+            return 1;
+        }
+    }
+
+    core::pak::PakWriter::Summary summary;
+    if (!writer.Write(outputPath, &summary)) {
+        return 1;
+    }
+    printf("%s: %u entries (%u compressed), %llu -> %llu bytes\n", outputPath, summary.entryCount,
+        summary.compressedCount, static_cast<unsigned long long>(summary.uncompressedSize),
+        static_cast<unsigned long long>(summary.archiveSize));
+    return 0;
+}
@@ -0,0 +1,126 @@
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace gfx {
+namespace vk {
+/////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+float
+elapsedMs(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+{
+    return std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+//! the OS wakes the thread late: the end of the wait spins
+constexpr std::chrono::microseconds kSpinTime {1000};
+}   // namespace
+
+/////////////////////////////////////////////////////////////////////////////////
+
+void
+FramePacer::Init(const Config& config)
+{
+    ASSERT(config.historySize != 0);
+    _config = config;
+    _frameTimes.samples.assign(config.historySize, 0.f);
+    _inputLatencies.samples.assign(config.historySize, 0.f);
+    _sorted.reserve(config.historySize);
+}
+
+void
+FramePacer::OnInput()
+{
+    // the oldest event waiting for a present is the latency seen
+    if (!_inputPending) {
+        _input        = Clock::now();
+        _inputPending = true;
+    }
+}
+
+void
+FramePacer::OnPresent()
+{
+    if (_inputPending) {
+        _inputLatencies.Push(elapsedMs(_input, Clock::now()));
+        _inputPending = false;
+    }
+}
+
+void
+FramePacer::EndFrame()
+{
+    Clock::time_point now = Clock::now();
+    if (_config.maxFps > 0.f) {
+        const auto period = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<float>(1.f / _config.maxFps));
+        // a late frame does not make the next ones catch up
+        _nextFrame = std::max(_nextFrame + period, now);
+        if (_nextFrame - now > kSpinTime) {
+            std::this_thread::sleep_until(_nextFrame - kSpinTime);
+        }
+        while (Clock::now() < _nextFrame) {
+            std::this_thread::yield();
+        }
+        now = Clock::now();
+    } else {
+        _nextFrame = now;
+    }
+
+    if (_started) {
+        _frameTimes.Push(elapsedMs(_frameEnd, now));
+    }
+    _frameEnd = now;
+    _started  = true;
+}
+
+FramePacer::Stats
+FramePacer::GetStats() const
+{
+    Stats stats;
+    stats.frameTime          = _Percentiles(_frameTimes);
+    stats.inputLatency       = _Percentiles(_inputLatencies);
+    stats.frameSampleCount   = _frameTimes.count;
+    stats.latencySampleCount = _inputLatencies.count;
+    return stats;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+
+void
+FramePacer::History::Push(float sampleMs)
+{
+    samples[next] = sampleMs;
+    next          = (next + 1) % samples.size();
+    count         = std::min(count + 1, static_cast<uint32_t>(samples.size()));
+}
+
+FramePacer::Percentiles
+FramePacer::_Percentiles(const History& history) const
+{
+    Percentiles percentiles;
+    if (history.count == 0) {
+        return percentiles;
+    }
+
+    // nearest rank on a copy, the ring keeps its order: the sample of rank
+    // ceil(percent * n / 100), in integers so 99% of 100 samples is rank 99
+    _sorted.assign(history.samples.begin(), history.samples.begin() + history.count);
+    auto rank = [this](size_t percent) {
+        const size_t rank  = (percent * _sorted.size() + 99) / 100;
+        const size_t index = std::min(std::max<size_t>(rank, 1), _sorted.size()) - 1;
+        std::nth_element(_sorted.begin(), _sorted.begin() + index, _sorted.end());
+        return _sorted[index];
+    };
+    percentiles.p50Ms = rank(50);
+    percentiles.p95Ms = rank(95);
+    percentiles.p99Ms = rank(99);
+    percentiles.maxMs = *std::max_element(_sorted.begin(), _sorted.end());
+    return percentiles;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace vk
+}   // namespace gfx
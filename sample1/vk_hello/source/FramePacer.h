@@ -0,0 +1,85 @@
+#pragma once
+
+#include "core/core.h"
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace gfx {
+namespace vk {
+////////////////////////////////////////////////////////////////////////////////
+
+//! Frame limiter of the main loop, and what the frame pacing costs:
+//! - the frame times (end of frame to end of frame, the limiter included)
+//! - the input latency: from the first input event polled after a present to
+//!   the next present call. The presentation engine adds its queue on top of
+//!   it (the frames in flight, the swapchain images for FIFO).
+//!
+//! The limiter sleeps at the end of the frame, after the present: the input is
+//! polled right after it, as late as possible before the next recording.
+class FramePacer {
+public:
+    struct Config {
+        float    maxFps      = 0.f;   //!< 0: unlimited, the present mode paces
+        uint32_t historySize = 256;   //!< samples of the percentiles
+    };
+
+    struct Percentiles {
+        float p50Ms = 0.f;
+        float p95Ms = 0.f;
+        float p99Ms = 0.f;
+        float maxMs = 0.f;
+    };
+
+    struct Stats {
+        Percentiles frameTime;
+        Percentiles inputLatency;
+        uint32_t    frameSampleCount   = 0;
+        uint32_t    latencySampleCount = 0;
+    };
+
+    void Init(const Config& config);
+
+    //! an input event was polled
+    void OnInput();
+    //! right after vkQueuePresentKHR()
+    void OnPresent();
+    //! sleeps until the next frame with maxFps, samples the frame time
+    void EndFrame();
+
+    float maxFps() const { return _config.maxFps; }
+    void  SetMaxFps(float maxFps) { _config.maxFps = maxFps; }
+
+    Stats GetStats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    //! a ring of the last historySize samples
+    struct History {
+        std::vector<float> samples;
+        uint32_t           next  = 0;
+        uint32_t           count = 0;
+
+        void Push(float sampleMs);
+    };
+
+    Percentiles _Percentiles(const History& history) const;
+
+    Config            _config;
+    Clock::time_point _frameEnd;
+    Clock::time_point _nextFrame;   //!< of the limiter
+    Clock::time_point _input;
+    bool              _inputPending = false;
+    bool              _started      = false;
+
+    History _frameTimes;
+    History _inputLatencies;
+
+    mutable std::vector<float> _sorted;   //!< scratch of the percentiles
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace vk
+}   // namespace gfx
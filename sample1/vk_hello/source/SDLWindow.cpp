@@ -82,6 +82,14 @@ SDLWindow::_OnResize(uint32_t /* width */, uint32_t /* height */)
 
 ////////////////////////////////////////////////////////////////////////////////
 
+void
+SDLWindow::_OnInput()
+{
+    // nothing
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 void
 SDLWindow::Run()
 {
@@ -95,10 +103,15 @@ SDLWindow::Run()
     SDL_Event e;
     bool      quit = false;
     while (!quit) {
+        // a resize sends several events: the window is resized once per frame, to the last size
+        bool     resized      = false;
+        uint32_t resizeWidth  = 0;
+        uint32_t resizeHeight = 0;
         while (SDL_PollEvent(&e)) {
             ImGui_ImplSDL2_ProcessEvent(&e);
             // printf("Event: %d\n", e.type);
             if (e.type == SDL_JOYBUTTONDOWN) {
+                _OnInput();
                 // SDL_JOYAXISMOTION = 0x600, /**< Joystick axis motion */
                 // SDL_JOYBALLMOTION,     /**< Joystick trackball motion */
                 // SDL_JOYHATMOTION,      /**< Joystick hat position change */
@@ -108,6 +121,7 @@ SDLWindow::Run()
                 // into the system */ SDL_JOYDEVICEREMOVED,  /**< An opened
                 // joystick has been removed */
             } else if (e.type == SDL_MOUSEMOTION || e.type == SDL_MOUSEBUTTONDOWN || e.type == SDL_MOUSEBUTTONUP) {
+                _OnInput();
                 int x, y;
                 SDL_GetMouseState(&x, &y);
                 switch (e.type) {
@@ -119,6 +133,7 @@ SDLWindow::Run()
                     break;
                 }
             } else if (e.type == SDL_KEYDOWN || e.type == SDL_KEYUP) {
+                _OnInput();
                 // const Uint8 *currentKeyStates = SDL_GetKeyboardState(NULL);
                 // if (currentKeyStates[SDL_SCANCODE_UP])
                 // {
@@ -133,11 +148,10 @@ SDLWindow::Run()
             } else if (e.type == SDL_WINDOWEVENT) {
                 switch (e.window.event) {
                 case SDL_WINDOWEVENT_SIZE_CHANGED:
-                    _OnResize(e.window.data1, e.window.data2);
-                    _shouldRender = e.window.data1 > kMinSizeToDraw && e.window.data2 > kMinSizeToDraw;
-                    break;
-                case SDL_WINDOWEVENT_RESIZED:
-                    _OnResize(e.window.data1, e.window.data2);
+                case SDL_WINDOWEVENT_RESIZED:   // after SIZE_CHANGED when the resize is external
+                    resized       = true;
+                    resizeWidth   = e.window.data1;
+                    resizeHeight  = e.window.data2;
                     _shouldRender = e.window.data1 > kMinSizeToDraw && e.window.data2 > kMinSizeToDraw;
                     break;
                 case SDL_WINDOWEVENT_MAXIMIZED:
@@ -171,6 +185,9 @@ SDLWindow::Run()
             }
         }
 
+        if (resized) {
+            _OnResize(resizeWidth, resizeHeight);
+        }
         if (_shouldRender) {
             _DrawFrame();
         }
@@ -19,6 +19,9 @@ protected:
     virtual void _OnMainLoopExit() = 0;
 
     virtual void _OnResize(uint32_t width, uint32_t height) = 0;
+
+    //! a keyboard, mouse or joystick event was polled
+    virtual void _OnInput() = 0;
 };
 
 class SDLWindow : public Window {
@@ -47,4 +50,5 @@ protected:
     void _OnMainLoopExit() override;
 
     void _OnResize(uint32_t width, uint32_t height) override;
+    void _OnInput() override;
 };
@@ -1,9 +1,9 @@
 #include "SDLWindowVulkan.h"
 
-#include "Shader.h"
-#include "core/scoped.h"
+#include "core/pak.h"
 #include "gfx/vk_init.h"
 #include "gfx/vk_types.h"
+#include "mesh/mesh_file.h"
 
 #include <backends/imgui_impl_sdl2.h>
 #include <backends/imgui_impl_vulkan.h>
@@ -14,6 +14,9 @@
 #include <vulkan/vulkan_core.h>
 
 #include <algorithm>   // Necessary for std::clamp
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
 #include <limits>   // Necessary for std::numeric_limits
 #include <optional>
 #include <set>
@@ -24,6 +27,11 @@ namespace gfx {
 /////////////////////////////////////////////////////////////////////////////////
 
 SDLWindowVulkan::SDLWindowVulkan()
+    : SDLWindowVulkan(FramePacing(), Headless(), Features())
+{
+}
+
+SDLWindowVulkan::SDLWindowVulkan(const FramePacing& pacing, const Headless& headless, const Features& features)
     : SDLWindow()
     , _deviceExtensions {VK_KHR_SWAPCHAIN_EXTENSION_NAME}
 #if USING(VALIDATION_LAYERS)
@@ -31,32 +39,205 @@ SDLWindowVulkan::SDLWindowVulkan()
           "VK_LAYER_KHRONOS_validation",
       })
 #endif   // #if USING(VALIDATION_LAYERS)
+    , _pacing(pacing)
+    , _headless(headless)
+    , _features(features)
+{
+    _maxFramesInFlight     = std::clamp(pacing.framesInFlight, 1u, MAX_FRAMES_IN_FLIGHT);
+    _pacing.framesInFlight = _maxFramesInFlight;
+    _framesInFlight        = _maxFramesInFlight;
+    if (_headless.enabled) {
+        _deviceExtensions.clear();   // no swapchain
+    }
+}
+
+namespace {
+struct PresentModeNameEntry {
+    VkPresentModeKHR mode;
+    const char*      name;
+};
+//! the modes FramePacing chooses from
+constexpr PresentModeNameEntry kPresentModeNames[] = {
+    {VK_PRESENT_MODE_FIFO_KHR, "fifo"},
+    {VK_PRESENT_MODE_FIFO_RELAXED_KHR, "fifo_relaxed"},
+    {VK_PRESENT_MODE_MAILBOX_KHR, "mailbox"},
+    {VK_PRESENT_MODE_IMMEDIATE_KHR, "immediate"},
+};
+
+//! the inputs of shader.vert, the layout of mesh::Vertex (the mesh files)
+struct Vertex {
+    math::vec3f position;   // layout(location = 0)
+    math::vec3f normal;     // layout(location = 1)
+    math::vec2f uv;         // layout(location = 2)
+
+    static constexpr auto Layout()
+    {
+        return vulkan::makeVertexLayout<Vertex>(
+            GFX_VERTEX_FIELD(Vertex, position), GFX_VERTEX_FIELD(Vertex, normal), GFX_VERTEX_FIELD(Vertex, uv));
+    }
+};
+
+// clockwise, see _GraphicsPipelineDesc(); res/meshes/quad.obj when the mesh file is missing
+constexpr Vertex kQuadVertices[] = {
+    {{-0.5f, -0.5f, 0.0f}, {0.0f, 0.0f, -1.0f}, {0.0f, 0.0f}},
+    {{0.5f, -0.5f, 0.0f}, {0.0f, 0.0f, -1.0f}, {1.0f, 0.0f}},
+    {{0.5f, 0.5f, 0.0f}, {0.0f, 0.0f, -1.0f}, {1.0f, 1.0f}},
+    {{-0.5f, 0.5f, 0.0f}, {0.0f, 0.0f, -1.0f}, {0.0f, 1.0f}},
+};
+constexpr uint16_t kQuadIndices[] = {0, 1, 2, 2, 3, 0};
+}   // namespace
+
+const char*
+SDLWindowVulkan::PresentModeName(VkPresentModeKHR mode)
 {
+    for (const PresentModeNameEntry& entry : kPresentModeNames) {
+        if (entry.mode == mode) {
+            return entry.name;
+        }
+    }
+    return "unknown";
+}
+
+bool
+SDLWindowVulkan::ParsePresentMode(const char* name, VkPresentModeKHR& mode)
+{
+    for (const PresentModeNameEntry& entry : kPresentModeNames) {
+        if (strcmp(entry.name, name) == 0) {
+            mode = entry.mode;
+            return true;
+        }
+    }
+    return false;
 }
 
 bool
 SDLWindowVulkan::Init()
 {
     bool result = true;
-    result &= SDLWindow::Init();
-    ASSERT(result);
+    if (!_headless.enabled) {
+        result &= SDLWindow::Init();
+        ASSERT(result);
+    }
+
+    // assets come from bin/data.pak (one open + one mmap); the loose files of
+    // the working directory (bin/) are the fallback, and override the pak in
+    // debug so that freshly compiled shaders are picked up
+    std::unique_ptr<core::pak::ArchiveMount> dataPak = core::pak::ArchiveMount::Load("data.pak");
+#if USING(IS_DEBUG)
+    if (dataPak) {
+        _fileSystem.Mount("", std::move(dataPak));
+    }
+    _fileSystem.Mount("", std::make_unique<core::vfs::DirectoryMount>("."));
+#else   // #if USING(IS_DEBUG)
+    _fileSystem.Mount("", std::make_unique<core::vfs::DirectoryMount>("."));
+    if (dataPak) {
+        _fileSystem.Mount("", std::move(dataPak));
+    }
+#endif   // #else   // #if USING(IS_DEBUG)
 
     result &= _CreateInstance();
     ASSERT(result);
-    result &= _CreateSurface();
-    ASSERT(result);
+    if (!_headless.enabled) {
+        result &= _CreateSurface();
+        ASSERT(result);
+    }
     result &= _SelectAdapter();
     ASSERT(result);
     result &= _CreateLogicalDevice();
     ASSERT(result);
-    result &= _CreateSwapChain();
+    result &= _deviceMemory.Init(_physicalDevice, _device, vulkan::DeviceMemoryAllocator::Config());
+    ASSERT(result);
+    {
+        vulkan::UploadManager::Queues queues;
+        queues.transfer          = _transferQueue;
+        queues.transferFamily    = _transferQueueFamily;
+        queues.graphicsFamily    = _graphicsQueueFamily;
+        queues.timelineSemaphore = _timelineSemaphore;
+
+        uint32_t familyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(_physicalDevice, &familyCount, nullptr);
+        core::SmallVector<VkQueueFamilyProperties, 8> families(familyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(_physicalDevice, &familyCount, families.data());
+        queues.imageGranularity = families[_transferQueueFamily].minImageTransferGranularity;
+        result &= _uploads.Init(_device, _deviceMemory, queues, vulkan::UploadManager::Config());
+        ASSERT(result);
+    }
+    {
+        vulkan::MeshManager::Config config;
+        config.framesInFlight = _maxFramesInFlight;
+        _meshes.Init(_device, _deviceMemory, _uploads, config);
+        // uploaded with the first frame, drawn once resident: the streams of
+        // the mesh file are copied from the mapping to the staging ring
+        const core::vfs::FileHandle quadFile = _fileSystem.Open(kQuadMeshPath, core::vfs::CacheMode::Uncached);
+        mesh::MeshFile              quadMesh;
+        if (quadFile && quadMesh.Open(quadFile, kQuadMeshPath) && quadMesh.meshCount() != 0) {
+            _quad = _meshes.Create<Vertex>(quadMesh, 0);
+        }
+        if (!_quad.isValid()) {
+            LOG_WARN("'%s' not loaded, drawing the built-in quad", kQuadMeshPath);
+            _quad = _meshes.Create(kQuadVertices, static_cast<uint32_t>(std::size(kQuadVertices)), kQuadIndices,
+                static_cast<uint32_t>(std::size(kQuadIndices)));
+        }
+        result &= _quad.isValid();
+        ASSERT(result);
+    }
+    {
+        vulkan::RenderGraph::Config config;
+        config.framesInFlight   = _maxFramesInFlight;
+        config.dynamicRendering = _dynamicRendering;
+        _renderGraph.Init(_device, _deviceMemory, config);
+    }
+    {
+        vulkan::CommandRecorder::Config config;
+        config.queueFamilyIndex = _graphicsQueueFamily;
+        config.framesInFlight   = _maxFramesInFlight;
+        result &= _recorder.Init(_device, config);
+        ASSERT(result);
+    }
+    {   // optional
+        vulkan::GpuProfiler::Config config;
+        config.framesInFlight     = _maxFramesInFlight;
+        config.pipelineStatistics = _pipelineStatistics;
+        _gpuProfiler.Init(_physicalDevice, _device, _graphicsQueueFamily, config);
+    }
+    result &= _pipelineCache.Init(
+        _device, _physicalDevice, "pipeline_cache.bin", kPipelineThreadCount, _pipelineCreationFeedback);
+    ASSERT(result);
+    {
+        vulkan::PipelineService::Config config;
+        config.threadCount      = kPipelineThreadCount;
+        config.firstCacheThread = 0;
+        result &= _pipelineService.Init(_device, _pipelineCache, config);
+        ASSERT(result);
+    }
+    _pipelineLayouts.Init(_device);
+    if (_descriptorIndexing) {
+        vulkan::BindlessTable::Config config;
+        config.framesInFlight = _maxFramesInFlight;
+        result &= _bindless.Init(_instance, _physicalDevice, _device, config);
+        ASSERT(result);
+        // every pipeline layout starts with the table
+        _pipelineLayouts.SetBindlessLayout(_bindless.setLayout(), vulkan::BindlessTable::pushConstantRange());
+    }
+    {
+        vulkan::DescriptorAllocator::Config config;
+        config.framesInFlight = _maxFramesInFlight;
+        _descriptors.Init(_device, config);
+    }
+    if (_headless.enabled) {
+        result &= _CreateOffscreenImages();
+        vulkan::FrameReadback::Config config;
+        config.framesInFlight = _maxFramesInFlight;
+        _readback.Init(_device, _deviceMemory, config,
+            [this](const vulkan::FrameReadback::Image& image) { _OnFrameReadback(image); });
+    } else {
+        result &= _CreateSwapChain(VK_NULL_HANDLE);
+    }
     ASSERT(result);
     result &= _CreateImageViews();
     ASSERT(result);
     result &= _CreateRenderPass();
     ASSERT(result);
-    result &= _CreateFramebuffers();
-    ASSERT(result);
     result &= _CreateGraphicsPipeline();
     ASSERT(result);
     result &= _CreateCommandPool();
@@ -71,7 +252,25 @@ SDLWindowVulkan::Init()
     ASSERT(result);
 #endif   // #if USING(VALIDATION_LAYERS)
 
-    _InitImgui();
+#if USING(SHADER_HOT_RELOAD)
+    if (!_InitShaderHotReload()) {
+        LOG_WARN("shader hot reload is not available");
+    }
+#endif   // #if USING(SHADER_HOT_RELOAD)
+
+    if (!_headless.enabled) {
+        _InitImgui();
+    } else if (!_headless.outputDirectory.empty()) {
+        std::error_code error;
+        std::filesystem::create_directories(_headless.outputDirectory, error);
+        _imageWriter = std::make_unique<core::ThreadPool>(1);
+    }
+
+    {
+        vk::FramePacer::Config config;
+        config.maxFps = _pacing.maxFps;
+        _framePacer.Init(config);
+    }
 
     return result;
 }
@@ -89,8 +288,28 @@ SDLWindowVulkan::Close()
 
     _CleanupSwapChain();
 
-    VK_DESTROY_WITH_DEVICE(vkDestroyPipeline, _device, _graphicsPipeline, nullptr);
-    VK_DESTROY_WITH_DEVICE(vkDestroyPipelineLayout, _device, _pipelineLayout, nullptr);
+#if USING(SHADER_HOT_RELOAD)
+    _shaderHotReload.Shutdown();
+#endif   // #if USING(SHADER_HOT_RELOAD)
+
+    // destroys every pipeline requested
+    _pipelineService.Shutdown();
+    _pipelineLayouts.Destroy();
+    _bindless.Destroy();
+    _descriptors.Destroy();
+    // next launch starts warm
+    _pipelineCache.Save();
+    _pipelineCache.Destroy();
+
+    _imageWriter.reset();   // waits for the files
+    _readback.Destroy();
+    _gpuProfiler.Destroy();
+    _recorder.Destroy();
+    _renderGraph.Destroy();
+    _meshes.Destroy();
+    _uploads.Destroy();
+    _deviceMemory.Destroy();
+
     VK_DESTROY_WITH_DEVICE(vkDestroyRenderPass, _device, _renderPass, nullptr);
 
     {   // _DestroySyncObjects()
@@ -119,7 +338,11 @@ SDLWindowVulkan::_DrawFrame()
 {
     SDLWindow::_DrawFrame();
 
-    {   // imgui
+    // heap activity of the whole previous main loop iteration
+    _lastFrameAllocations = _frameAllocationCounter.Get();
+    _frameAllocationCounter.Reset();
+
+    if (!_headless.enabled) {   // imgui, no window to show it in headless
         ImGui_ImplVulkan_NewFrame();
         ImGui_ImplSDL2_NewFrame(_window);
 
@@ -127,56 +350,195 @@ SDLWindowVulkan::_DrawFrame()
         ImGui::NewFrame();
         {
             ImGui::ShowDemoWindow();
+            _ShowGpuProfiler();
+            _ShowFramePacing();
+
+            ImGui::Begin("Stats");
+#if USING(TRACK_ALLOCATIONS)
+            ImGui::Text("Heap allocations/frame: %llu (%llu bytes)",
+                static_cast<unsigned long long>(_lastFrameAllocations.allocationCount),
+                static_cast<unsigned long long>(_lastFrameAllocations.allocatedBytes));
+#else   // #if USING(TRACK_ALLOCATIONS)
+            ImGui::Text("Heap allocations/frame: not tracked (CORE_TRACK_ALLOCATIONS)");
+#endif   // #else   // #if USING(TRACK_ALLOCATIONS)
+            const core::vfs::Stats vfsStats = _fileSystem.GetStats();
+            ImGui::Text("Files: %llu opened, %llu cache hits, %llu KB loaded in %.3f ms (max %.3f ms)",
+                static_cast<unsigned long long>(vfsStats.openCount),
+                static_cast<unsigned long long>(vfsStats.cacheHitCount),
+                static_cast<unsigned long long>(vfsStats.bytesLoaded / 1024), vfsStats.loadTimeNs * 1e-6,
+                vfsStats.maxLoadTimeNs * 1e-6);
+            const vulkan::PipelineCache::Stats cacheStats = _pipelineCache.GetStats();
+            ImGui::Text("Pipelines: %s start, %u hits (%.3f ms), %u misses (%.3f ms), %u unknown (%.3f ms)",
+                cacheStats.loadedBytes != 0 ? "warm" : "cold", cacheStats.hitCount, cacheStats.hitTimeNs * 1e-6,
+                cacheStats.missCount, cacheStats.missTimeNs * 1e-6, cacheStats.unknownCount,
+                cacheStats.unknownTimeNs * 1e-6);
+            const vulkan::PipelineService::Stats serviceStats = _pipelineService.GetStats();
+            ImGui::Text("Pipeline compiles: %u requested (%u deduplicated), %u queued (max %u), %u compiling, "
+                        "%u done (%u failed), latency %.1f ms (max %.1f ms)",
+                serviceStats.requestCount, serviceStats.dedupCount, serviceStats.queuedCount,
+                serviceStats.maxQueuedCount, serviceStats.compilingCount, serviceStats.compiledCount,
+                serviceStats.failedCount, serviceStats.averageLatencyMs(), serviceStats.maxLatencyNs * 1e-6);
+            const vulkan::UploadManager::Stats uploadStats = _uploads.GetStats();
+            ImGui::Text("Uploads (%s queue): %llu/%llu done, %llu KB last frame, %llu KB pending, ring %llu KB, %u "
+                        "batches in flight, %u stalls",
+                uploadStats.dedicatedQueue ? "transfer" : "graphics",
+                static_cast<unsigned long long>(uploadStats.completedCount),
+                static_cast<unsigned long long>(uploadStats.uploadCount),
+                static_cast<unsigned long long>(uploadStats.frameBytes >> 10),
+                static_cast<unsigned long long>(uploadStats.pendingBytes >> 10),
+                static_cast<unsigned long long>(uploadStats.ringUsedBytes >> 10), uploadStats.batchesInFlight,
+                uploadStats.stallCount);
+            const vulkan::MeshManager::Stats meshStats = _meshes.GetStats();
+            ImGui::Text("Meshes: %u (%u resident), %llu KB vertices, %llu KB indices", meshStats.meshCount,
+                meshStats.residentCount, static_cast<unsigned long long>(meshStats.vertexBytes >> 10),
+                static_cast<unsigned long long>(meshStats.indexBytes >> 10));
+            const vulkan::RenderGraph::Stats graphStats = _renderGraph.GetStats();
+            ImGui::Text("Render graph: %u passes (%u culled), %u barriers in %u batches, %u transient images in "
+                        "%llu KB (%llu KB without aliasing), %u rebuilds",
+                graphStats.passCount, graphStats.culledPassCount, graphStats.barrierCount,
+                graphStats.barrierBatchCount, graphStats.transientCount,
+                static_cast<unsigned long long>(graphStats.transientBytes >> 10),
+                static_cast<unsigned long long>(graphStats.unaliasedBytes >> 10), graphStats.rebuildCount);
+            ImGui::Text("Rendering: %s, %u framebuffers", _dynamicRendering ? "dynamic" : "render passes",
+                graphStats.framebufferCount);
+            if (_descriptorIndexing) {
+                const vulkan::BindlessTable::Stats bindlessStats = _bindless.GetStats();
+                ImGui::Text("Bindless: %u images, %u samplers, %u buffers (%u retired), %u writes, %u binds/frame",
+                    bindlessStats.sampledImageCount, bindlessStats.samplerCount, bindlessStats.storageBufferCount,
+                    bindlessStats.retiredCount, bindlessStats.frameWriteCount, bindlessStats.frameBindCount);
+            }
+            const vulkan::CommandRecorder::Stats recorderStats = _recorder.GetStats();
+            ImGui::Text("Recording: %u threads, %u chunks in %u passes, %.0f%% on the workers, %u command buffers",
+                recorderStats.threadCount, recorderStats.frameChunkCount, recorderStats.frameRecordCount,
+                recorderStats.frameParallelPercent, recorderStats.commandBufferCount);
+            const vulkan::DescriptorAllocator::Stats descriptorStats = _descriptors.GetStats();
+            ImGui::Text("Descriptor sets: %u allocated, %u cached, %u writes/frame, %u pools (%u out of pool memory)",
+                descriptorStats.frameAllocations, descriptorStats.frameCacheHits, descriptorStats.frameWrites,
+                descriptorStats.poolCount, descriptorStats.outOfPoolCount);
+            const vulkan::DeviceMemoryAllocator::Stats memoryStats = _deviceMemory.GetStats();
+            for (uint32_t heap = 0; heap < memoryStats.heapCount; ++heap) {
+                const vulkan::DeviceMemoryAllocator::HeapStats& heapStats = memoryStats.heaps[heap];
+                ImGui::Text("Heap %u (%s, %llu MB): %u blocks, %llu/%llu KB in %u allocations (%.0f%% fragmented), "
+                            "%u dedicated (%llu KB)",
+                    heap, heapStats.deviceLocal ? "device" : "host",
+                    static_cast<unsigned long long>(heapStats.heapSize >> 20), heapStats.blockCount,
+                    static_cast<unsigned long long>(heapStats.usedBytes >> 10),
+                    static_cast<unsigned long long>(heapStats.blockBytes >> 10), heapStats.allocationCount,
+                    heapStats.fragmentation * 100.f, heapStats.dedicatedCount,
+                    static_cast<unsigned long long>(heapStats.dedicatedBytes >> 10));
+            }
+#if USING(SHADER_HOT_RELOAD)
+            const vk::ShaderHotReload::Stats reloadStats = _shaderHotReload.GetStats();
+            ImGui::Text("Shader reloads: %u (%u compiles, %u failed, %.1f ms)", reloadStats.reloadCount,
+                reloadStats.compileCount, reloadStats.compileFailureCount, reloadStats.lastCompileMs);
+#endif   // #if USING(SHADER_HOT_RELOAD)
+            ImGui::End();
         }
         // finish imgui commands
         ImGui::Render();
     }
 
-    const uint32_t currentFrame = _currentFrameIndex++ % MAX_FRAMES_IN_FLIGHT;
+    // once per frame however many events asked for it
+    if (_swapChainDirty && !_RecreateSwapChain()) {
+        _framePacer.EndFrame();
+        return;
+    }
+
+    const uint64_t frameNumber  = _frameNumber++;
+    const uint32_t currentFrame = static_cast<uint32_t>(frameNumber % _framesInFlight);
+    ++_currentFrameIndex;   // wraps around: drives the clear color animation
 
     const uint64_t fenceTimeout = UINT64_MAX;
+    _gpuProfiler.BeginCpuZone("wait for the frame in flight");
     vkWaitForFences(_device, 1, &_inFlightFences[currentFrame], VK_TRUE, fenceTimeout);
+    _gpuProfiler.EndCpuZone();
+    _DestroyRetiredSwapChains(false);
 
     uint32_t swapchainIndex;
-    {
+    if (_headless.enabled) {
+        // the frames in flight are complete up to this image's previous use
+        swapchainIndex = static_cast<uint32_t>(frameNumber % _swapChainImages.size());
+        _readback.BeginFrame();
+    } else {
         VkResult result = vkAcquireNextImageKHR(
             _device, _swapChain, UINT64_MAX, _imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &swapchainIndex);
         if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-            _RecreateSwapChain();
+            // nothing submitted: the fence of the frame in flight stays signaled
+            _swapChainDirty = true;
+            _framePacer.EndFrame();
             return;
-        } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+        } else if (result == VK_SUBOPTIMAL_KHR) {
+            _swapChainDirty = true;   // still presentable, this frame goes on
+        } else if (result != VK_SUCCESS) {
             LOG_ERROR("failed to acquire swap chain image!");
         }
     }
 
+    // frame boundary: swap in a pipeline compiled in the background
+    _UpdateGraphicsPipeline();
+
     // only reset if we are submitting work to avoid deadlock due to no signaling
     vkResetFences(_device, 1, &_inFlightFences[currentFrame]);
 
+    // the meshes uploaded by the previous frames can draw
+    _meshes.Update();
+    // the copies of this frame execute before its draws, the command buffer
+    // acquires what they write
+    _uploads.Flush();
+    if (_descriptorIndexing) {
+        _bindless.BeginFrame();
+    }
+    _descriptors.BeginFrame();
+    _recorder.BeginFrame();
+
     VkCommandBuffer commandBuffer = _commandBuffers[currentFrame];
     // VkCommandBufferResetFlagBits::VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT
     VkCommandBufferResetFlags commandBufferFlags {};
     vkResetCommandBuffer(commandBuffer, commandBufferFlags);
+    _gpuProfiler.BeginCpuZone("record");
     _RecordCommandBuffer(commandBuffer, swapchainIndex);
+    _gpuProfiler.EndCpuZone();
 
     VkSubmitInfo submitInfo {};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-    VkSemaphore          waitSemaphores[] = {_imageAvailableSemaphores[currentFrame]};
-    VkPipelineStageFlags waitStages[]     = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    submitInfo.waitSemaphoreCount         = 1;
+    // headless: no image acquired, nothing presents
+    const uint32_t swapChainSemaphoreCount = _headless.enabled ? 0 : 1;
+
+    VkSemaphore          waitSemaphores[] = {_imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE};
+    VkPipelineStageFlags waitStages[]     = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0};
+    uint64_t             waitValues[]     = {0, 0};   // binary semaphores ignore it
+    submitInfo.waitSemaphoreCount         = swapChainSemaphoreCount;
     submitInfo.pWaitSemaphores            = waitSemaphores;
     submitInfo.pWaitDstStageMask          = waitStages;
     submitInfo.commandBufferCount         = 1;
     submitInfo.pCommandBuffers            = &_commandBuffers[currentFrame];
 
     VkSemaphore signalSemaphores[]  = {_renderFinishedSemaphores[currentFrame]};
-    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.signalSemaphoreCount = swapChainSemaphoreCount;
     submitInfo.pSignalSemaphores    = signalSemaphores;
 
+    // dedicated transfer queue: only the stages reading uploads wait for it
+    const vulkan::UploadManager::QueueWait uploadWait = _uploads.GetQueueWait();
+    VkTimelineSemaphoreSubmitInfoKHR       timelineInfo {};
+    if (uploadWait.semaphore != VK_NULL_HANDLE) {
+        waitSemaphores[swapChainSemaphoreCount] = uploadWait.semaphore;
+        waitStages[swapChainSemaphoreCount]     = uploadWait.stages;
+        waitValues[swapChainSemaphoreCount]     = uploadWait.value;
+        submitInfo.waitSemaphoreCount           = swapChainSemaphoreCount + 1;
+
+        timelineInfo.sType                   = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+        timelineInfo.waitSemaphoreValueCount = submitInfo.waitSemaphoreCount;
+        timelineInfo.pWaitSemaphoreValues    = waitValues;
+        submitInfo.pNext                     = &timelineInfo;
+    }
+
+    _gpuProfiler.BeginCpuZone("submit");
     VK_CHECK_MSG(vkQueueSubmit(_graphicsQueue, 1, &submitInfo, _inFlightFences[currentFrame]),
         "failed to submit draw command buffer!");
+    _gpuProfiler.EndCpuZone();
 
-    {
+    if (!_headless.enabled) {
         VkPresentInfoKHR presentInfo {};
         presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
@@ -192,14 +554,17 @@ SDLWindowVulkan::_DrawFrame()
 
         {
             VkResult result = vkQueuePresentKHR(_presentQueue, &presentInfo);
-            if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-                _RecreateSwapChain();
-                return;
-            } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+            _framePacer.OnPresent();
+            if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+                _swapChainDirty = true;
+            } else if (result != VK_SUCCESS) {
                 LOG_ERROR("failed to acquire swap chain image!");
             }
         }
     }
+
+    // after the present: the input is polled right after the limiter
+    _framePacer.EndFrame();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -218,7 +583,96 @@ SDLWindowVulkan::_OnResize(uint32_t width, uint32_t height)
 {
     SDLWindow::_OnResize(width, height);
 
-    _RecreateSwapChain();
+    // the next frame recreates the swapchain
+    _swapChainDirty = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void
+SDLWindowVulkan::_OnInput()
+{
+    SDLWindow::_OnInput();
+
+    _framePacer.OnInput();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void
+SDLWindowVulkan::Run()
+{
+    if (!_headless.enabled) {
+        SDLWindow::Run();
+        return;
+    }
+
+    for (uint32_t frame = 0; frame < _headless.frameCount; ++frame) {
+        _DrawFrame();
+    }
+    _OnMainLoopExit();
+    // the GPU is idle: the frames still in flight
+    _readback.Flush();
+    if (_imageWriter) {
+        _imageWriter->WaitIdle();
+    }
+
+    const vk::FramePacer::Stats stats = _framePacer.GetStats();
+    LOG_INFO("%u frames of %ux%u: p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, max %.3f ms (last %u frames)",
+        _headless.frameCount, _headless.width, _headless.height, stats.frameTime.p50Ms, stats.frameTime.p95Ms,
+        stats.frameTime.p99Ms, stats.frameTime.maxMs, stats.frameSampleCount);
+}
+
+namespace {
+//! binary PPM: RGB, no dependency, compared byte to byte by the regression tests
+bool
+writePpm(const std::string& path, const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height, bool bgra)
+{
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        LOG_ERROR("Failed to open %s", path.c_str());
+        return false;
+    }
+    fprintf(file, "P6\n%u %u\n255\n", width, height);
+
+    std::vector<uint8_t> row(static_cast<size_t>(width) * 3);
+    bool                 result = true;
+    for (uint32_t y = 0; y < height && result; ++y) {
+        const uint8_t* texel = pixels.data() + static_cast<size_t>(y) * width * 4;
+        for (uint32_t x = 0; x < width; ++x, texel += 4) {
+            row[x * 3 + 0] = texel[bgra ? 2 : 0];
+            row[x * 3 + 1] = texel[1];
+            row[x * 3 + 2] = texel[bgra ? 0 : 2];
+        }
+        result = fwrite(row.data(), 1, row.size(), file) == row.size();
+    }
+    result &= fclose(file) == 0;
+    if (!result) {
+        LOG_ERROR("Failed to write %s", path.c_str());
+    }
+    return result;
+}
+}   // namespace
+
+void
+SDLWindowVulkan::_OnFrameReadback(const vulkan::FrameReadback::Image& image)
+{
+    if (_frameCallback) {
+        _frameCallback(image);
+    }
+    if (!_imageWriter) {
+        return;
+    }
+
+    // the readback buffer is recorded again once the callback returns
+    std::vector<uint8_t> pixels(image.pixels, image.pixels + static_cast<size_t>(image.width) * image.height * 4);
+    const bool bgra = image.format == VK_FORMAT_B8G8R8A8_UNORM || image.format == VK_FORMAT_B8G8R8A8_SRGB;
+    _imageWriter->Submit(
+        [this, pixels = std::move(pixels), frame = image.frame, width = image.width, height = image.height, bgra]() {
+            char name[32];
+            snprintf(name, sizeof(name), "frame_%05llu.ppm", static_cast<unsigned long long>(frame));
+            writePpm(_headless.outputDirectory + "/" + name, pixels, width, height, bgra);
+        });
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -268,17 +722,48 @@ SDLWindowVulkan::_InitImgui()
     init_info.Device                    = _device;
     init_info.Queue                     = _graphicsQueue;
     init_info.DescriptorPool            = imguiPool;
-    init_info.MinImageCount             = 3;
-    init_info.ImageCount                = 3;
+    init_info.MinImageCount             = std::max(_swapChainMinImageCount, 2u);
+    // imgui rotates its vertex buffers over ImageCount frames: at least the frames in flight
+    init_info.ImageCount = std::max({init_info.MinImageCount, static_cast<uint32_t>(_swapChainImages.size()),
+        _maxFramesInFlight});
     init_info.MSAASamples               = VK_SAMPLE_COUNT_1_BIT;
 
-    ImGui_ImplVulkan_Init(&init_info, _renderPass);
-
-    // execute a gpu command to upload imgui font textures
-    _ImmediateSubmit([&](VkCommandBuffer cmd) { ImGui_ImplVulkan_CreateFontsTexture(cmd); });
-
-    // clear font textures from cpu data
-    ImGui_ImplVulkan_DestroyFontUploadObjects();
+#if defined(IMGUI_IMPL_VULKAN_HAS_DYNAMIC_RENDERING)
+    // its pipeline against the format of the back buffer, no render pass
+    init_info.UseDynamicRendering   = _dynamicRendering;
+    init_info.ColorAttachmentFormat = _swapChainImageFormat;
+    _imguiRenderPass                = !_dynamicRendering;
+#endif   // #if defined(IMGUI_IMPL_VULKAN_HAS_DYNAMIC_RENDERING)
+
+    ImGui_ImplVulkan_Init(&init_info, _imguiRenderPass ? _renderPass : VK_NULL_HANDLE);
+
+    {   // upload imgui font textures, its staging buffer is released once done
+        // imgui transitions the texture for the fragment shader: graphics queue
+        VkCommandBufferAllocateInfo allocInfo {};
+        allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool        = _commandPool;
+        allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+        VkCommandBuffer cmd;
+        VK_CHECK(vkAllocateCommandBuffers(_device, &allocInfo, &cmd));
+
+        VkCommandBufferBeginInfo beginInfo {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        VK_CHECK(vkBeginCommandBuffer(cmd, &beginInfo));
+        ImGui_ImplVulkan_CreateFontsTexture(cmd);
+        VK_CHECK(vkEndCommandBuffer(cmd));
+
+        VkSubmitInfo submitInfo {};
+        submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers    = &cmd;
+        VK_CHECK(vkQueueSubmit(_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE));
+        // once, at startup
+        vkQueueWaitIdle(_graphicsQueue);
+        vkFreeCommandBuffers(_device, _commandPool, 1, &cmd);
+        ImGui_ImplVulkan_DestroyFontUploadObjects();
+    }
 
     // add the destroy the imgui created structures
     _EnqueueForDeletion(DeletionQueue::Main, [this, imguiPool]() {
@@ -287,42 +772,95 @@ SDLWindowVulkan::_InitImgui()
     });
 }
 
-/////////////////////////////////////////////////////////////////////////////////
-
 void
-SDLWindowVulkan::_ImmediateSubmit(std::function<void(VkCommandBuffer cmd)>&& function)
+SDLWindowVulkan::_ShowGpuProfiler()
 {
-    VkCommandBuffer cmd = _uploadContext._commandBuffer;
-
-    // begin the command buffer recording. We will use this command buffer exactly once before resetting, so we tell
-    // vulkan that
-    VkCommandBufferBeginInfo cmdBeginInfo
-        = vk_init::command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-
-    VK_CHECK(vkBeginCommandBuffer(cmd, &cmdBeginInfo));
-
-    // execute the function
-    function(cmd);
-
-    VK_CHECK(vkEndCommandBuffer(cmd));
-
-    VkSubmitInfo submit = vk_init::submit_info(&cmd);
+    ImGui::Begin("GPU profiler");
+    const vulkan::GpuProfiler::Frame* frame = _gpuProfiler.lastFrame();
+    if (frame == nullptr) {
+        ImGui::Text("No GPU timings (yet)");
+        ImGui::End();
+        return;
+    }
 
-    // submit command buffer to the queue and execute it.
-    //  _uploadFence will now block until the graphic commands finish execution
-    VK_CHECK(vkQueueSubmit(_graphicsQueue, 1, &submit, _uploadContext._uploadFence));
+    ImGui::Text("Frame %llu: %.3f ms on the GPU", static_cast<unsigned long long>(frame->frame), frame->gpuMs);
+    for (const vulkan::GpuProfiler::Zone& zone : frame->zones) {
+        ImGui::Text("%*s%-24s %7.3f ms (at %.3f ms)", static_cast<int>(2 * zone.depth), "",
+            _gpuProfiler.zoneName(zone.name), zone.durationMs, zone.startMs);
+    }
+    if (_pipelineStatistics) {
+        const vulkan::GpuProfiler::PipelineStatistics& statistics = frame->statistics;
+        ImGui::Separator();
+        ImGui::Text("Input assembly: %llu vertices, %llu primitives",
+            static_cast<unsigned long long>(statistics.inputAssemblyVertices),
+            static_cast<unsigned long long>(statistics.inputAssemblyPrimitives));
+        ImGui::Text("Invocations: %llu vertex, %llu fragment, %llu compute",
+            static_cast<unsigned long long>(statistics.vertexShaderInvocations),
+            static_cast<unsigned long long>(statistics.fragmentShaderInvocations),
+            static_cast<unsigned long long>(statistics.computeShaderInvocations));
+        ImGui::Text("Clipping: %llu primitives in, %llu out",
+            static_cast<unsigned long long>(statistics.clippingInvocations),
+            static_cast<unsigned long long>(statistics.clippingPrimitives));
+    }
+    const vulkan::GpuProfiler::Stats stats = _gpuProfiler.GetStats();
+    if (stats.droppedZones != 0 || stats.droppedFrames != 0) {
+        ImGui::Text("Dropped: %u zones, %u frames", stats.droppedZones, stats.droppedFrames);
+    }
 
-    vkWaitForFences(_device, 1, &_uploadContext._uploadFence, true, 9999999999);
-    vkResetFences(_device, 1, &_uploadContext._uploadFence);
+    ImGui::Separator();
+    // CPU and GPU zones of the last frames, for chrome://tracing or Perfetto
+    if (ImGui::Button("Export trace")) {
+        _gpuProfiler.ExportTrace("frame_trace.json");
+    }
+    ImGui::End();
+}
 
-    // reset the command buffers inside the command pool
-    vkResetCommandPool(_device, _uploadContext._commandPool, 0);
+void
+SDLWindowVulkan::_ShowFramePacing()
+{
+    ImGui::Begin("Frame pacing");
+    const vk::FramePacer::Stats stats = _framePacer.GetStats();
+    ImGui::Text("%s, %u swapchain images, %u frames in flight", PresentModeName(_presentMode),
+        static_cast<uint32_t>(_swapChainImages.size()), _framesInFlight);
+    ImGui::Text("Frame time: p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, max %.2f ms (%u frames)", stats.frameTime.p50Ms,
+        stats.frameTime.p95Ms, stats.frameTime.p99Ms, stats.frameTime.maxMs, stats.frameSampleCount);
+    ImGui::Text("Input to present: p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, max %.2f ms (%u inputs)",
+        stats.inputLatency.p50Ms, stats.inputLatency.p95Ms, stats.inputLatency.p99Ms, stats.inputLatency.maxMs,
+        stats.latencySampleCount);
+
+    ImGui::Separator();
+    ImGui::Text("Swapchain: %u recreations, %u retired in flight", _swapChainRecreateCount,
+        static_cast<uint32_t>(_retiredSwapChains.size()));
+    // applied before the next frame: the swapchain is recreated
+    for (VkPresentModeKHR mode : _presentModes) {
+        if (ImGui::RadioButton(PresentModeName(mode), _pacing.presentMode == mode)) {
+            _pacing.presentMode = mode;
+            _swapChainDirty     = true;
+        }
+        ImGui::SameLine();
+    }
+    ImGui::NewLine();
+    int framesInFlight = static_cast<int>(_pacing.framesInFlight);
+    if (ImGui::SliderInt("Frames in flight", &framesInFlight, 1, static_cast<int>(_maxFramesInFlight))) {
+        _pacing.framesInFlight = static_cast<uint32_t>(framesInFlight);
+        _swapChainDirty        = true;
+    }
+    int imageCount = static_cast<int>(_pacing.swapChainImageCount);
+    if (ImGui::SliderInt("Swapchain images (0: auto)", &imageCount, 0, static_cast<int>(kMaxSwapChainImages))) {
+        _pacing.swapChainImageCount = static_cast<uint32_t>(imageCount);
+        _swapChainDirty             = true;
+    }
+    if (ImGui::InputFloat("Max FPS (0: unlimited)", &_pacing.maxFps, 10.f, 60.f, "%.0f")) {
+        _pacing.maxFps = std::max(_pacing.maxFps, 0.f);
+        _framePacer.SetMaxFps(_pacing.maxFps);
+    }
+    ImGui::End();
 }
 
-////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////
 
 void
-SDLWindowVulkan::_EnqueueForDeletion(DeletionQueue queue, std::function<void()> func)
+SDLWindowVulkan::_EnqueueForDeletion(DeletionQueue queue, core::InplaceFunction<void()> func)
 {
     assert(queue == DeletionQueue::Main);
     _mainDeletionQueue.push_back(std::move(func));
@@ -343,7 +881,7 @@ SDLWindowVulkan::_CreateInstance()
 #endif   // #if USING(VALIDATION_LAYERS)
 
     std::vector<const char*> requiredExtensionNames;
-    {
+    if (!_headless.enabled) {   // headless: no surface
         unsigned int requiredExtensionsCount = 0;
         bool         success = SDL_Vulkan_GetInstanceExtensions(_window, &requiredExtensionsCount, nullptr);
         ASSERT(success);
@@ -351,9 +889,21 @@ SDLWindowVulkan::_CreateInstance()
         requiredExtensionNames.resize(requiredExtensionsCount);
         success = SDL_Vulkan_GetInstanceExtensions(_window, &requiredExtensionsCount, requiredExtensionNames.data());
         ASSERT(success);
-    }
 
-    requiredExtensionNames.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
+        requiredExtensionNames.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
+    }
+    {   // optional: the feature queries of device extensions (descriptor indexing)
+        uint32_t extensionCount = 0;
+        vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+        vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, availableExtensions.data());
+        for (const VkExtensionProperties& extension : availableExtensions) {
+            if (strcmp(extension.extensionName, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) == 0) {
+                _physicalDeviceProperties2 = true;
+                requiredExtensionNames.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+            }
+        }
+    }
     std::cout << "Required extensions(" << requiredExtensionNames.size() << "):" << std::endl;
     for (const char* name : requiredExtensionNames) {
         std::cout << name << std::endl;
@@ -409,6 +959,10 @@ SDLWindowVulkan::_CreateInstance()
 struct QueueFamilyIndices {
     std::optional<uint32_t> optGraphicsFamily;
     std::optional<uint32_t> optPresentFamily;
+    //! optional: transfer without graphics, copies overlap with rendering
+    std::optional<uint32_t> optTransferFamily;
+    //! optional: compute without graphics (async compute)
+    std::optional<uint32_t> optComputeFamily;
 
     bool IsComplete() const { return optGraphicsFamily.has_value() && optPresentFamily.has_value(); }
 };
@@ -420,23 +974,44 @@ findQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface)
 
     uint32_t queueFamilyCount = 0;
     vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
-    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    core::SmallVector<VkQueueFamilyProperties, 8> queueFamilies(queueFamilyCount);
     vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
 
-    int i = 0;
-    for (const auto& queueFamily : queueFamilies) {
-        if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-            indices.optGraphicsFamily = i;
+    // the transfer family without compute is the copy engine (DMA), prefer it
+    bool transferOnly = false;
+    for (uint32_t i = 0; i < queueFamilyCount; ++i) {
+        const VkQueueFlags flags = queueFamilies[i].queueFlags;
+        // the uploads split images by rows: any texel offset must be allowed
+        const VkExtent3D granularity = queueFamilies[i].minImageTransferGranularity;
+        const bool       anyOffset   = granularity.width == 1 && granularity.height == 1 && granularity.depth == 1;
+        if (flags & VK_QUEUE_GRAPHICS_BIT) {
+            if (!indices.optGraphicsFamily.has_value()) {
+                indices.optGraphicsFamily = i;
+            }
+        } else if (flags & VK_QUEUE_COMPUTE_BIT) {
+            if (!indices.optComputeFamily.has_value()) {
+                indices.optComputeFamily = i;
+            }
+            // compute queues support transfers too
+            if (!indices.optTransferFamily.has_value() && anyOffset) {
+                indices.optTransferFamily = i;
+            }
+        } else if ((flags & VK_QUEUE_TRANSFER_BIT) && !transferOnly && anyOffset) {
+            indices.optTransferFamily = i;
+            transferOnly              = true;
         }
+        // prefer presenting from the graphics family
         VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
-        if (presentSupport) {
-            indices.optPresentFamily = i;
+        if (surface != VK_NULL_HANDLE) {
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
         }
-        if (indices.IsComplete()) {
-            break;
+        if (presentSupport && (!indices.optPresentFamily.has_value() || indices.optGraphicsFamily == i)) {
+            indices.optPresentFamily = i;
         }
-        i++;
+    }
+    // headless: the present queue is the graphics one, it presents nothing
+    if (surface == VK_NULL_HANDLE) {
+        indices.optPresentFamily = indices.optGraphicsFamily;
     }
 
     return indices;
@@ -460,9 +1035,12 @@ checkDeviceExtensionSupport(VkPhysicalDevice device, const std::vector<const cha
 }
 
 struct SwapChainSupportDetails {
-    VkSurfaceCapabilitiesKHR        capabilities;
-    std::vector<VkSurfaceFormatKHR> formats;
-    std::vector<VkPresentModeKHR>   presentModes;
+    using FormatList      = core::SmallVector<VkSurfaceFormatKHR, 16>;
+    using PresentModeList = core::SmallVector<VkPresentModeKHR, 8>;
+
+    VkSurfaceCapabilitiesKHR capabilities;
+    FormatList               formats;
+    PresentModeList          presentModes;
 };
 SwapChainSupportDetails
 querySwapChainSupport(VkPhysicalDevice device, VkSurfaceKHR surface)
@@ -496,12 +1074,14 @@ SDLWindowVulkan::_IsPhysicalDeviceSuitable(VkPhysicalDevice device, VkSurfaceKHR
     VkPhysicalDeviceProperties adapterProperties;
     vkGetPhysicalDeviceProperties(device, &adapterProperties);
 
-    const std::vector<const char*> deviceExtensions    = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
-    const bool                     extensionsSupported = checkDeviceExtensionSupport(device, deviceExtensions);
+    const std::vector<const char*> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+    // headless: no swapchain
+    const bool headless            = surface == VK_NULL_HANDLE;
+    const bool extensionsSupported = headless || checkDeviceExtensionSupport(device, deviceExtensions);
     ASSERT(extensionsSupported);
 
-    bool swapChainAdequate = false;
-    if (extensionsSupported) {
+    bool swapChainAdequate = headless;
+    if (extensionsSupported && !headless) {
         const SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device, surface);
         swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
         ASSERT(swapChainAdequate);
@@ -522,7 +1102,7 @@ SDLWindowVulkan::_IsPhysicalDeviceSuitable(VkPhysicalDevice device, VkSurfaceKHR
 bool
 SDLWindowVulkan::_SelectAdapter()
 {
-    ASSERT(_surface != nullptr);
+    ASSERT(_surface != nullptr || _headless.enabled);
 
     uint32_t deviceCount = 0;
     vkEnumeratePhysicalDevices(_instance, &deviceCount, nullptr);
@@ -534,11 +1114,36 @@ SDLWindowVulkan::_SelectAdapter()
     std::vector<VkPhysicalDevice> physicalDevices(deviceCount);
     vkEnumeratePhysicalDevices(_instance, &deviceCount, physicalDevices.data());
 
+    // headless: the best of any kind, a software ICD (lavapipe) last
+    auto rank = [](VkPhysicalDevice physicalDevice) {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        switch (properties.deviceType) {
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+            return 4;
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+            return 3;
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+            return 2;
+        case VK_PHYSICAL_DEVICE_TYPE_CPU:
+            return 1;
+        default:
+            return 0;
+        }
+    };
+    int bestRank = -1;
     for (const VkPhysicalDevice& physicalDevice : physicalDevices) {
-        if (_IsPhysicalDeviceSuitable(physicalDevice, _surface)) {
+        if (!_IsPhysicalDeviceSuitable(physicalDevice, _surface)) {
+            continue;
+        }
+        if (!_headless.enabled) {
             _physicalDevice = physicalDevice;
             break;
         }
+        if (rank(physicalDevice) > bestRank) {
+            _physicalDevice = physicalDevice;
+            bestRank        = rank(physicalDevice);
+        }
     }
     ASSERT(_physicalDevice != VK_NULL_HANDLE);
 
@@ -546,6 +1151,9 @@ SDLWindowVulkan::_SelectAdapter()
         LOG_ERROR("Couldn't select physical device");
         return false;
     }
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(_physicalDevice, &properties);
+    LOG_INFO("Physical device: %s", properties.deviceName);
 
     return true;
 }
@@ -555,25 +1163,147 @@ SDLWindowVulkan::_SelectAdapter()
 bool
 SDLWindowVulkan::_CreateLogicalDevice()
 {
-    ASSERT(_physicalDevice != nullptr && _surface != nullptr);
+    ASSERT(_physicalDevice != nullptr && (_surface != nullptr || _headless.enabled));
 
-    QueueFamilyIndices indices = findQueueFamilies(_physicalDevice, _surface);
+    const QueueFamilyIndices indices = findQueueFamilies(_physicalDevice, _surface);
+    ASSERT(indices.IsComplete());
 
-    VkDeviceQueueCreateInfo queueCreateInfo {};
-    queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-    ASSERT(indices.optGraphicsFamily.has_value());
-    queueCreateInfo.queueFamilyIndex = indices.optGraphicsFamily.value();
-    queueCreateInfo.queueCount       = 1;
+    VkPhysicalDeviceFeatures deviceFeatures {};
 
-    float queuePriority              = 1.0f;
-    queueCreateInfo.pQueuePriorities = &queuePriority;
+    // optional: the pipeline statistics of the GPU profiler, the query stays
+    // active around the secondary command buffers of the recorder
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(_physicalDevice, &supportedFeatures);
+    _pipelineStatistics = supportedFeatures.pipelineStatisticsQuery && supportedFeatures.inheritedQueries;
+    deviceFeatures.pipelineStatisticsQuery = _pipelineStatistics;
+    deviceFeatures.inheritedQueries        = _pipelineStatistics;
+
+    // optional: tells whether pipelines came from the pipeline cache
+    _pipelineCreationFeedback
+        = checkDeviceExtensionSupport(_physicalDevice, {VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME});
+    if (_pipelineCreationFeedback) {
+        _deviceExtensions.push_back(VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+    }
 
-    VkPhysicalDeviceFeatures deviceFeatures {};
+    // optional: cross queue synchronization of the uploads, core in Vulkan 1.2
+    VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures {};
+    timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+    _timelineSemaphore     = _physicalDeviceProperties2
+        && checkDeviceExtensionSupport(_physicalDevice, {VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME});
+    if (_timelineSemaphore) {
+        const auto getFeatures2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2KHR>(
+            vkGetInstanceProcAddr(_instance, "vkGetPhysicalDeviceFeatures2KHR"));
+        VkPhysicalDeviceFeatures2KHR features {};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+        features.pNext = &timelineFeatures;
+        getFeatures2(_physicalDevice, &features);
+        _timelineSemaphore     = timelineFeatures.timelineSemaphore;
+        timelineFeatures.pNext = nullptr;
+    }
+    if (_timelineSemaphore) {
+        _deviceExtensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+    }
+
+    // optional: the bindless table, core in Vulkan 1.2
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures {};
+    indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    _descriptorIndexing    = _physicalDeviceProperties2
+        && checkDeviceExtensionSupport(
+            _physicalDevice, {VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME, VK_KHR_MAINTENANCE3_EXTENSION_NAME});
+    if (_descriptorIndexing) {
+        const auto getFeatures2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2KHR>(
+            vkGetInstanceProcAddr(_instance, "vkGetPhysicalDeviceFeatures2KHR"));
+        VkPhysicalDeviceFeatures2KHR features {};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+        features.pNext = &indexingFeatures;
+        getFeatures2(_physicalDevice, &features);
+        // enabled as supported, the non uniform indexing included
+        _descriptorIndexing = indexingFeatures.runtimeDescriptorArray
+            && indexingFeatures.descriptorBindingPartiallyBound
+            && indexingFeatures.descriptorBindingSampledImageUpdateAfterBind
+            && indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind;
+        indexingFeatures.pNext = nullptr;
+    }
+    if (_descriptorIndexing) {
+        _deviceExtensions.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+        _deviceExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+    } else {
+        LOG_WARN("Descriptor indexing is not supported: no bindless table");
+    }
+
+    // optional: no render pass nor framebuffer objects, core in Vulkan 1.3
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR renderingFeatures {};
+    renderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+    const std::vector<const char*> renderingExtensions = {
+        VK_KHR_MULTIVIEW_EXTENSION_NAME,
+        VK_KHR_MAINTENANCE2_EXTENSION_NAME,
+        VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME,
+        VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME,
+        VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME,
+    };
+    _dynamicRendering = _features.dynamicRendering && _physicalDeviceProperties2
+        && checkDeviceExtensionSupport(_physicalDevice, renderingExtensions);
+    if (_dynamicRendering) {
+        const auto getFeatures2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2KHR>(
+            vkGetInstanceProcAddr(_instance, "vkGetPhysicalDeviceFeatures2KHR"));
+        VkPhysicalDeviceFeatures2KHR features {};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+        features.pNext = &renderingFeatures;
+        getFeatures2(_physicalDevice, &features);
+        _dynamicRendering       = renderingFeatures.dynamicRendering;
+        renderingFeatures.pNext = nullptr;
+    }
+    if (_dynamicRendering) {
+        // the dependencies of VK_KHR_dynamic_rendering on Vulkan 1.0
+        _deviceExtensions.insert(_deviceExtensions.end(), renderingExtensions.begin(), renderingExtensions.end());
+    } else if (_features.dynamicRendering) {
+        LOG_INFO("Dynamic rendering is not supported: render passes");
+    }
+
+    _graphicsQueueFamily = indices.optGraphicsFamily.value();
+    // uploads go to the dedicated transfer queue when they can be synchronized
+    // with the graphics queue, to the graphics queue otherwise
+    _transferQueueFamily = _timelineSemaphore ? indices.optTransferFamily.value_or(_graphicsQueueFamily)
+                                              : _graphicsQueueFamily;
+
+    // one queue per family
+    const std::set<uint32_t> uniqueQueueFamilies = {
+        _graphicsQueueFamily,
+        indices.optPresentFamily.value(),
+        _transferQueueFamily,
+        indices.optComputeFamily.value_or(_graphicsQueueFamily),
+    };
+    const float                                  queuePriority = 1.0f;
+    core::SmallVector<VkDeviceQueueCreateInfo, 4> queueCreateInfos;
+    for (uint32_t queueFamily : uniqueQueueFamilies) {
+        VkDeviceQueueCreateInfo queueCreateInfo {};
+        queueCreateInfo.sType            = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+        queueCreateInfo.queueFamilyIndex = queueFamily;
+        queueCreateInfo.queueCount       = 1;
+        queueCreateInfo.pQueuePriorities = &queuePriority;
+        queueCreateInfos.push_back(queueCreateInfo);
+    }
+
+    // the features of the optional extensions
+    void* features = nullptr;
+    if (_descriptorIndexing) {
+        indexingFeatures.pNext = features;
+        features               = &indexingFeatures;
+    }
+    if (_timelineSemaphore) {
+        timelineFeatures.pNext = features;
+        features               = &timelineFeatures;
+    }
+    if (_dynamicRendering) {
+        renderingFeatures.pNext = features;
+        features                = &renderingFeatures;
+    }
 
     VkDeviceCreateInfo createInfo {};
     createInfo.sType                = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-    createInfo.queueCreateInfoCount = 1;
-    createInfo.pQueueCreateInfos    = &queueCreateInfo;
+    createInfo.pNext                = features;
+    createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
+    createInfo.pQueueCreateInfos    = queueCreateInfos.data();
     createInfo.pEnabledFeatures     = &deviceFeatures;
     {
         createInfo.enabledExtensionCount   = _deviceExtensions.size();
@@ -592,35 +1322,24 @@ SDLWindowVulkan::_CreateLogicalDevice()
         return false;
     }
 
-    vkGetDeviceQueue(_device, indices.optGraphicsFamily.value(), 0, &_graphicsQueue);
+    vkGetDeviceQueue(_device, _graphicsQueueFamily, 0, &_graphicsQueue);
     if (_graphicsQueue == VK_NULL_HANDLE) {
         LOG_ERROR("Couldn't create graphics queue");
         return false;
     }
-
-    {   // create presentation queue
-        QueueFamilyIndices indices = findQueueFamilies(_physicalDevice, _surface);
-
-        std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-        std::set<uint32_t> uniqueQueueFamilies = {indices.optGraphicsFamily.value(), indices.optPresentFamily.value()};
-
-        float queuePriority = 1.0f;
-        for (uint32_t queueFamily : uniqueQueueFamilies) {
-            VkDeviceQueueCreateInfo queueCreateInfo {};
-            queueCreateInfo.sType            = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-            queueCreateInfo.queueFamilyIndex = queueFamily;
-            queueCreateInfo.queueCount       = 1;
-            queueCreateInfo.pQueuePriorities = &queuePriority;
-            queueCreateInfos.push_back(queueCreateInfo);
-        }
-        createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
-        createInfo.pQueueCreateInfos    = queueCreateInfos.data();
-    }
     vkGetDeviceQueue(_device, indices.optPresentFamily.value(), 0, &_presentQueue);
     if (_presentQueue == VK_NULL_HANDLE) {
         LOG_ERROR("Couldn't create present queue");
         return false;
     }
+    vkGetDeviceQueue(_device, _transferQueueFamily, 0, &_transferQueue);
+    if (indices.optComputeFamily.has_value()) {
+        vkGetDeviceQueue(_device, indices.optComputeFamily.value(), 0, &_computeQueue);
+    }
+    LOG_INFO("Queue families: graphics %u, present %u, transfer %u%s, compute %d", _graphicsQueueFamily,
+        indices.optPresentFamily.value(), _transferQueueFamily,
+        _transferQueueFamily != _graphicsQueueFamily ? " (dedicated)" : "",
+        indices.optComputeFamily.has_value() ? static_cast<int>(indices.optComputeFamily.value()) : -1);
     return true;
 }
 
@@ -655,7 +1374,7 @@ SDLWindowVulkan::_CreateSurface()
 ////////////////////////////////////////////////////////////////////////////////
 
 VkSurfaceFormatKHR
-chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats)
+chooseSwapSurfaceFormat(const SwapChainSupportDetails::FormatList& availableFormats)
 {
     for (const auto& availableFormat : availableFormats) {
         if (availableFormat.format == VK_FORMAT_B8G8R8A8_SRGB
@@ -668,19 +1387,32 @@ chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats)
 }
 
 VkPresentModeKHR
-chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes)
+chooseSwapPresentMode(const SwapChainSupportDetails::PresentModeList& availablePresentModes, VkPresentModeKHR requested)
 {
     /*
     VK_PRESENT_MODE_MAILBOX_KHR // vsync - discard any previous presentation requests on vsync
     VK_PRESENT_MODE_FIFO_KHR // double/triple buffering - sequentially execute presentation requests on vsync
+    VK_PRESENT_MODE_IMMEDIATE_KHR // no vsync - tearing, the lowest latency
     */
     for (const auto& availablePresentMode : availablePresentModes) {
-        if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
+        if (availablePresentMode == requested) {
             return availablePresentMode;
         }
     }
 
-    return VK_PRESENT_MODE_FIFO_KHR;
+    LOG_WARN("present mode not supported, falling back to FIFO: %s", SDLWindowVulkan::PresentModeName(requested));
+    return VK_PRESENT_MODE_FIFO_KHR;   // always supported
+}
+
+uint32_t
+chooseSwapImageCount(const VkSurfaceCapabilitiesKHR& capabilities, uint32_t requested)
+{
+    uint32_t imageCount = requested != 0 ? std::max(requested, capabilities.minImageCount)
+                                         : capabilities.minImageCount + 1;
+    if (capabilities.maxImageCount > 0 && imageCount > capabilities.maxImageCount) {
+        imageCount = capabilities.maxImageCount;
+    }
+    return imageCount;
 }
 
 VkExtent2D
@@ -707,17 +1439,22 @@ chooseSwapExtent(SDL_Window* window, const VkSurfaceCapabilitiesKHR& capabilitie
 }
 
 bool
-SDLWindowVulkan::_CreateSwapChain()
+SDLWindowVulkan::_CreateSwapChain(VkSwapchainKHR oldSwapChain)
 {
     const SwapChainSupportDetails swapChainSupport = querySwapChainSupport(_physicalDevice, _surface);
 
     const VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
-    const VkPresentModeKHR   presentMode   = chooseSwapPresentMode(swapChainSupport.presentModes);
+    const VkPresentModeKHR   presentMode   = chooseSwapPresentMode(swapChainSupport.presentModes, _pacing.presentMode);
     const VkExtent2D         extent        = chooseSwapExtent(_window, swapChainSupport.capabilities);
 
-    uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
-    if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount) {
-        imageCount = swapChainSupport.capabilities.maxImageCount;
+    uint32_t imageCount = chooseSwapImageCount(swapChainSupport.capabilities, _pacing.swapChainImageCount);
+
+    _presentModes.clear();
+    for (const PresentModeNameEntry& entry : kPresentModeNames) {
+        const auto& modes = swapChainSupport.presentModes;
+        if (std::find(modes.begin(), modes.end(), entry.mode) != modes.end()) {
+            _presentModes.push_back(entry.mode);
+        }
     }
 
     VkSwapchainCreateInfoKHR createInfo {};
@@ -752,7 +1489,9 @@ SDLWindowVulkan::_CreateSwapChain()
 
     createInfo.presentMode = presentMode;
 
-    createInfo.oldSwapchain = VK_NULL_HANDLE;   // should point to old one when recreating (i.e., resize)
+    // the presentation engine hands over: the images of the old one presented
+    // until the new ones are, no blank frame
+    createInfo.oldSwapchain = oldSwapChain;
 
     if (vkCreateSwapchainKHR(_device, &createInfo, nullptr, &_swapChain) != VK_SUCCESS) {
         LOG_ERROR("failed to create swap chain!");
@@ -763,8 +1502,46 @@ SDLWindowVulkan::_CreateSwapChain()
     _swapChainImages.resize(imageCount);
     vkGetSwapchainImagesKHR(_device, _swapChain, &imageCount, _swapChainImages.data());
 
-    _swapChainImageFormat = surfaceFormat.format;
-    _swapChainExtent      = extent;
+    _swapChainImageFormat   = surfaceFormat.format;
+    _swapChainExtent        = extent;
+    _swapChainMinImageCount = swapChainSupport.capabilities.minImageCount;
+    _presentMode            = presentMode;
+    // more frames in flight than images only queue up latency
+    _framesInFlight = std::clamp(std::min(_pacing.framesInFlight, imageCount), 1u, _maxFramesInFlight);
+
+    return true;
+}
+
+bool
+SDLWindowVulkan::_CreateOffscreenImages()
+{
+    // sRGB encoded like a swapchain: the files read back look the same
+    _swapChainImageFormat = VK_FORMAT_R8G8B8A8_SRGB;
+    _swapChainExtent      = {_headless.width, _headless.height};
+    // one per frame in flight, the readback copies of the previous frames included
+    _swapChainImages.resize(_maxFramesInFlight);
+    _offscreenMemory.resize(_maxFramesInFlight);
+
+    VkImageCreateInfo imageInfo {};
+    imageInfo.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType     = VK_IMAGE_TYPE_2D;
+    imageInfo.format        = _swapChainImageFormat;
+    imageInfo.extent        = {_swapChainExtent.width, _swapChainExtent.height, 1};
+    imageInfo.mipLevels     = 1;
+    imageInfo.arrayLayers   = 1;
+    imageInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage         = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    imageInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    for (size_t i = 0; i < _swapChainImages.size(); ++i) {
+        if (vkCreateImage(_device, &imageInfo, nullptr, &_swapChainImages[i]) != VK_SUCCESS
+            || !_deviceMemory.AllocateForImage(
+                _swapChainImages[i], VK_IMAGE_TILING_OPTIMAL, vulkan::MemoryUsage::GpuOnly, _offscreenMemory[i])) {
+            LOG_ERROR("failed to create the offscreen images!");
+            return false;
+        }
+    }
 
     return true;
 }
@@ -881,208 +1658,117 @@ SDLWindowVulkan::_CreateRenderPass()
 bool
 SDLWindowVulkan::_CreateGraphicsPipeline()
 {
-    auto vertShaderCode = utils::readFile("shaders/shader.vert.spv");
-    auto fragShaderCode = utils::readFile("shaders/shader.frag.spv");
-
-    VkShaderModule fragmentShaderModule;
-    core::Scoped   scopedFragmentShader(
-        [&]() { fragmentShaderModule = gfx::vk::createShaderModule(_device, fragShaderCode); },
-        [&]() {
-            vkDestroyShaderModule(_device, fragmentShaderModule, nullptr);
-            fragmentShaderModule = VK_NULL_HANDLE;
-        });
-
-    VkShaderModule vertexShaderModule;
-    core::Scoped   scopedVertexShader(
-        [&]() { vertexShaderModule = gfx::vk::createShaderModule(_device, vertShaderCode); },
-        [&]() {
-            vkDestroyShaderModule(_device, vertexShaderModule, nullptr);
-            vertexShaderModule = VK_NULL_HANDLE;
-        });
-
-    VkPipelineShaderStageCreateInfo vertShaderStageInfo {};
-    vertShaderStageInfo.sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    vertShaderStageInfo.stage               = VK_SHADER_STAGE_VERTEX_BIT;
-    vertShaderStageInfo.module              = vertexShaderModule;
-    vertShaderStageInfo.pName               = "main";
-    vertShaderStageInfo.pSpecializationInfo = nullptr;   // specify shader constants
-
-    VkPipelineShaderStageCreateInfo fragShaderStageInfo {};
-    fragShaderStageInfo.sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    fragShaderStageInfo.stage               = VK_SHADER_STAGE_FRAGMENT_BIT;
-    fragShaderStageInfo.module              = fragmentShaderModule;
-    fragShaderStageInfo.pName               = "main";
-    vertShaderStageInfo.pSpecializationInfo = nullptr;   // specify shader constants
-
-    VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
-
-    ////////////////////////////////////////////////////////////////////////////////
-
-    VkPipelineVertexInputStateCreateInfo vertexInputInfo {};
-    vertexInputInfo.sType                           = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputInfo.vertexBindingDescriptionCount   = 0;
-    vertexInputInfo.pVertexBindingDescriptions      = nullptr;   // Optional
-    vertexInputInfo.vertexAttributeDescriptionCount = 0;
-    vertexInputInfo.pVertexAttributeDescriptions    = nullptr;   // Optional
-
-    VkPipelineInputAssemblyStateCreateInfo inputAssembly {};
-    inputAssembly.sType                  = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    inputAssembly.topology               = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-    inputAssembly.primitiveRestartEnable = VK_FALSE;
-
-    ////////////////////////////////////////////////////////////////////////////////
-
-#if 1   // dynamic state to be defined
-    /// at draw time
-    std::vector<VkDynamicState> dynamicStates = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
-
-    VkPipelineDynamicStateCreateInfo dynamicState {};
-    dynamicState.sType             = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-    dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
-    dynamicState.pDynamicStates    = dynamicStates.data();
-
-    VkPipelineViewportStateCreateInfo viewportState {};
-    viewportState.sType         = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    viewportState.viewportCount = 1;
-    viewportState.scissorCount  = 1;
-#else   // specify viewport/scissor statically
-    VkViewport viewport {};
-    viewport.x        = 0.0f;
-    viewport.y        = 0.0f;
-    viewport.width    = (float)_swapChainExtent.width;
-    viewport.height   = (float)_swapChainExtent.height;
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-
-    VkRect2D scissor {};
-    scissor.offset = {0, 0};
-    scissor.extent = _swapChainExtent;
-
-    VkPipelineViewportStateCreateInfo viewportState {};
-    viewportState.sType         = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    viewportState.viewportCount = 1;
-    viewportState.pViewports    = &viewport;
-    viewportState.scissorCount  = 1;
-    viewportState.pScissors     = &scissor;
-#endif
-
-    VkPipelineRasterizationStateCreateInfo rasterizer {};
-    rasterizer.sType                   = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-    rasterizer.depthClampEnable        = VK_FALSE;
-    rasterizer.rasterizerDiscardEnable = VK_FALSE;
-    rasterizer.polygonMode             = VK_POLYGON_MODE_FILL;
-    rasterizer.lineWidth               = 1.0f;
-    rasterizer.cullMode                = VK_CULL_MODE_BACK_BIT;
-    rasterizer.frontFace               = VK_FRONT_FACE_CLOCKWISE;
-    rasterizer.depthBiasEnable         = VK_FALSE;
-    rasterizer.depthBiasConstantFactor = 0.0f;   // Optional
-    rasterizer.depthBiasClamp          = 0.0f;   // Optional
-    rasterizer.depthBiasSlopeFactor    = 0.0f;   // Optional
-
-    VkPipelineMultisampleStateCreateInfo multisampling {};
-    multisampling.sType                 = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisampling.sampleShadingEnable   = VK_FALSE;
-    multisampling.rasterizationSamples  = VK_SAMPLE_COUNT_1_BIT;
-    multisampling.minSampleShading      = 1.0f;       // Optional
-    multisampling.pSampleMask           = nullptr;    // Optional
-    multisampling.alphaToCoverageEnable = VK_FALSE;   // Optional
-    multisampling.alphaToOneEnable      = VK_FALSE;   // Optional
-
-    VkPipelineColorBlendAttachmentState colorBlendAttachment {};
-    colorBlendAttachment.colorWriteMask
-        = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorBlendAttachment.blendEnable         = VK_FALSE;
-    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;    // Optional
-    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;   // Optional
-    colorBlendAttachment.colorBlendOp        = VK_BLEND_OP_ADD;        // Optional
-    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;    // Optional
-    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;   // Optional
-    colorBlendAttachment.alphaBlendOp        = VK_BLEND_OP_ADD;        // Optional
-
-    VkPipelineColorBlendStateCreateInfo colorBlending {};
-    colorBlending.sType             = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    colorBlending.logicOpEnable     = VK_FALSE;
-    colorBlending.logicOp           = VK_LOGIC_OP_COPY;   // Optional
-    colorBlending.attachmentCount   = 1;
-    colorBlending.pAttachments      = &colorBlendAttachment;
-    colorBlending.blendConstants[0] = 0.0f;   // Optional
-    colorBlending.blendConstants[1] = 0.0f;   // Optional
-    colorBlending.blendConstants[2] = 0.0f;   // Optional
-    colorBlending.blendConstants[3] = 0.0f;   // Optional
-
-    ////////////////////////////////////////////////////////////////////////////////
-
-    // define shader uniforms
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo {};
-    pipelineLayoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount         = 0;         // Optional
-    pipelineLayoutInfo.pSetLayouts            = nullptr;   // Optional
-    pipelineLayoutInfo.pushConstantRangeCount = 0;         // Optional
-    pipelineLayoutInfo.pPushConstantRanges    = nullptr;   // Optional
-
-    if (vkCreatePipelineLayout(_device, &pipelineLayoutInfo, nullptr, &_pipelineLayout) != VK_SUCCESS) {
-        LOG_ERROR("failed to create pipeline layout!");
+    vulkan::GraphicsPipelineDesc desc;
+    if (!_GraphicsPipelineDesc(desc)) {
+        LOG_ERROR("failed to load the shaders!");
         return false;
     }
+    // compiled in the background: the first frames may not draw the quad
+    _graphicsPipeline = _pipelineService.Request(std::move(desc));
+    return true;
+}
 
-    ////////////////////////////////////////////////////////////////////////////////
-
-    VkGraphicsPipelineCreateInfo pipelineInfo {};
-    pipelineInfo.sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineInfo.stageCount          = 2;
-    pipelineInfo.pStages             = shaderStages;
-    pipelineInfo.pVertexInputState   = &vertexInputInfo;
-    pipelineInfo.pInputAssemblyState = &inputAssembly;
-    pipelineInfo.pViewportState      = &viewportState;
-    pipelineInfo.pRasterizationState = &rasterizer;
-    pipelineInfo.pMultisampleState   = &multisampling;
-    pipelineInfo.pDepthStencilState  = nullptr;   // Optional
-    pipelineInfo.pColorBlendState    = &colorBlending;
-    pipelineInfo.pDynamicState       = &dynamicState;
-
-    pipelineInfo.layout = _pipelineLayout;
-
-    pipelineInfo.renderPass = _renderPass;
-    pipelineInfo.subpass    = 0;
-
-    // using the flag VK_PIPELINE_CREATE_DERIVATIVE_BIT we can create new pipelines from existing ones(cheaper)
-    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;   // Optional
-    pipelineInfo.basePipelineIndex  = -1;               // Optional
+//! The shaders are read again on every call: picks up hot reloaded SPIR-V.
+//! The layout comes from what the shaders declare.
+bool
+SDLWindowVulkan::_GraphicsPipelineDesc(vulkan::GraphicsPipelineDesc& desc)
+{
+    desc.vertexShader   = _fileSystem.Open(kVertexShaderPath, core::vfs::CacheMode::Uncached);
+    desc.fragmentShader = _fileSystem.Open(kFragmentShaderPath, core::vfs::CacheMode::Uncached);
+    if (!desc.vertexShader || !desc.fragmentShader) {
+        return false;
+    }
 
-    ////////////////////////////////////////////////////////////////////////////////
+    vulkan::ShaderReflection vertexReflection;
+    vulkan::ShaderReflection fragmentReflection;
+    if (!vulkan::reflectShader(desc.vertexShader, vertexReflection)
+        || !vulkan::reflectShader(desc.fragmentShader, fragmentReflection)) {
+        return false;
+    }
+    const vulkan::ShaderReflection* stages[] = {&vertexReflection, &fragmentReflection};
+    vulkan::PipelineLayoutInfo      layoutInfo;
+    if (!_pipelineLayouts.Get(stages, 2, layoutInfo)) {
+        return false;
+    }
+    // the vertex layout is a constant, the shader (hot reloaded) has to match it
+    desc.SetVertexLayout<Vertex>();
+    bool layoutMatches = vertexReflection.vertexInputs.size() == desc.vertexAttributes.size();
+    for (size_t i = 0; layoutMatches && i < desc.vertexAttributes.size(); ++i) {
+        layoutMatches = vertexReflection.vertexInputs[i].location == desc.vertexAttributes[i].location
+            && vertexReflection.vertexInputs[i].format == desc.vertexAttributes[i].format;
+    }
+    if (!layoutMatches) {
+        LOG_ERROR("'%s' vertex inputs do not match the Vertex layout", kVertexShaderPath);
+        return false;
+    }
 
-    VK_CHECK(vkCreateGraphicsPipelines(_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &_graphicsPipeline));
+    desc.topology  = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    desc.cullMode  = VK_CULL_MODE_BACK_BIT;
+    desc.frontFace = VK_FRONT_FACE_CLOCKWISE;
+    desc.blendStates.push_back(vulkan::BlendState());
 
+    desc.renderPassLayout.colorFormats.push_back(_swapChainImageFormat);
+    desc.layout     = layoutInfo.layout;
+    desc.renderPass = _dynamicRendering ? VK_NULL_HANDLE : _renderPass;
+    desc.subpass    = 0;
     return true;
 }
 
-/////////////////////////////////////////////////////////////////////////////////
+void
+SDLWindowVulkan::_UpdateGraphicsPipeline()
+{
+#if USING(SHADER_HOT_RELOAD)
+    vulkan::GraphicsPipelineDesc desc;
+    if (_shaderHotReload.Update() && _GraphicsPipelineDesc(desc)) {
+        // reverting a change finds the previous pipeline: no compilation
+        _pendingGraphicsPipeline = _pipelineService.Request(std::move(desc));
+    }
+#endif   // #if USING(SHADER_HOT_RELOAD)
 
+    if (!_pendingGraphicsPipeline.isValid()) {
+        return;
+    }
+    switch (_pipelineService.status(_pendingGraphicsPipeline)) {
+    case vulkan::PipelineStatus::Pending:
+        break;
+    case vulkan::PipelineStatus::Ready:
+        // the previous pipeline stays alive (owned by the service) for the frames in flight
+        _graphicsPipeline        = _pendingGraphicsPipeline;
+        _pendingGraphicsPipeline = vulkan::PipelineHandle();
+        LOG_INFO("graphics pipeline reloaded");
+        break;
+    case vulkan::PipelineStatus::Failed:
+        _pendingGraphicsPipeline = vulkan::PipelineHandle();
+        LOG_ERROR("failed to rebuild the pipeline, keeping the current one");
+        break;
+    }
+}
+
+#if USING(SHADER_HOT_RELOAD)
 bool
-SDLWindowVulkan::_CreateFramebuffers()
+SDLWindowVulkan::_InitShaderHotReload()
 {
-    _swapChainFramebuffers.resize(_swapChainImageViews.size());
-
-    for (size_t i = 0; i < _swapChainImageViews.size(); i++) {
-        VkImageView attachments[] = {_swapChainImageViews[i]};
-
-        VkFramebufferCreateInfo framebufferInfo {};
-        framebufferInfo.sType           = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        framebufferInfo.renderPass      = _renderPass;
-        framebufferInfo.attachmentCount = 1;
-        framebufferInfo.pAttachments    = attachments;
-        framebufferInfo.width           = _swapChainExtent.width;
-        framebufferInfo.height          = _swapChainExtent.height;
-        framebufferInfo.layers          = 1;
-
-        if (vkCreateFramebuffer(_device, &framebufferInfo, nullptr, &_swapChainFramebuffers[i]) != VK_SUCCESS) {
-            LOG_ERROR("failed to create framebuffer!");
-            return false;
-        }
+    std::vector<vk::ShaderHotReload::Shader> shaders;
+    for (const char* spirvPath : {kVertexShaderPath, kFragmentShaderPath}) {
+        vk::ShaderHotReload::Shader shader;
+        shader.spirvPath = spirvPath;   // relative to bin/, like the vfs path
+#if defined(SHADER_SOURCE_DIR)
+        // "shaders/shader.vert.spv" is compiled from SHADER_SOURCE_DIR/shader.vert
+        const std::string name = shader.spirvPath.substr(shader.spirvPath.find('/') + 1);
+        shader.sourcePath      = SHADER_SOURCE_DIR "/" + name.substr(0, name.size() - 4);
+#endif   // #if defined(SHADER_SOURCE_DIR)
+        shaders.push_back(std::move(shader));
     }
 
-    return true;
+#if defined(SHADER_COMPILER)
+    std::string compilerPath = SHADER_COMPILER;
+#else   // #if defined(SHADER_COMPILER)
+    std::string compilerPath;
+#endif   // #else    // #if defined(SHADER_COMPILER)
+
+    return _shaderHotReload.Init(std::move(shaders), std::move(compilerPath));
 }
+#endif   // #if USING(SHADER_HOT_RELOAD)
 
 /////////////////////////////////////////////////////////////////////////////////
 
@@ -1102,20 +1788,6 @@ SDLWindowVulkan::_CreateCommandPool()
         return false;
     }
 
-    {   //
-        VkCommandPoolCreateInfo uploadCommandPoolInfo = vk_init::command_pool_create_info(graphicsQueueFamilyIndex);
-        // create pool for upload context
-        VK_CHECK(vkCreateCommandPool(_device, &uploadCommandPoolInfo, nullptr, &_uploadContext._commandPool));
-
-        _EnqueueForDeletion(
-            DeletionQueue::Main, [=]() { vkDestroyCommandPool(_device, _uploadContext._commandPool, nullptr); });
-
-        // allocate the default command buffer that we will use for the instant commands
-        VkCommandBufferAllocateInfo cmdAllocInfo
-            = vk_init::command_buffer_allocate_info(_uploadContext._commandPool, 1);
-        VK_CHECK(vkAllocateCommandBuffers(_device, &cmdAllocInfo, &_uploadContext._commandBuffer));
-    }
-
     return true;
 }
 
@@ -1124,7 +1796,7 @@ SDLWindowVulkan::_CreateCommandPool()
 bool
 SDLWindowVulkan::_CreateCommandBuffer()
 {
-    _commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    _commandBuffers.resize(_maxFramesInFlight);
 
     VkCommandBufferAllocateInfo allocInfo {};
     allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -1162,64 +1834,107 @@ SDLWindowVulkan::_RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t sw
         LOG_ERROR("failed to begin recording command buffer!");
         return false;
     }
+    _gpuProfiler.BeginFrame(commandBuffer);
+    _uploads.RecordAcquireBarriers(commandBuffer);
+    if (_descriptorIndexing) {
+        // the only descriptor set bind of the primary command buffer: every
+        // pipeline layout is compatible with the table (imgui binds its own
+        // set, it draws last); the secondaries bind it again
+        _bindless.Bind(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS);
+    }
 
-    {   // renderpass
-        VkRenderPassBeginInfo renderPassInfo {};
-        renderPassInfo.sType       = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.renderPass  = _renderPass;
-        renderPassInfo.framebuffer = _swapChainFramebuffers[swapchainIndex];
-
-        const VkExtent2D renderAreaExtent {
-            _swapChainExtent.width,
-            _swapChainExtent.height,
-        };
-        const VkOffset2D renderAreaOffset {0, 0};
-        renderPassInfo.renderArea.offset = renderAreaOffset;
-        renderPassInfo.renderArea.extent = renderAreaExtent;
-
-        const float  clearColorValue   = 0.25f * animatedValue;
-        VkClearValue clearColor        = {{{clearColorValue, clearColorValue, clearColorValue, 1.0f}}};
-        renderPassInfo.clearValueCount = 1;
-        renderPassInfo.pClearValues    = &clearColor;
-
-        VkViewport viewport {};
-        viewport.x        = static_cast<float>(0);
-        viewport.y        = static_cast<float>(0);
-        viewport.width    = static_cast<float>(_swapChainExtent.width);
-        viewport.height   = static_cast<float>(_swapChainExtent.height);
-        viewport.minDepth = 0.0f;
-        viewport.maxDepth = 1.0f;
-        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-
-        const VkOffset2D scissorOffset {
-            (int32_t)(0.2f * animatedValue * _swapChainExtent.width),
-            (int32_t)(0.2f * animatedValue * _swapChainExtent.height),
-        };
-        const VkExtent2D scissorExtent {
-            (uint32_t)(0.8f * (1.f - animatedValue) * _swapChainExtent.width),
-            (uint32_t)(0.8f * (1.f - animatedValue) * _swapChainExtent.height),
-        };
-        VkRect2D scissor {};
-        scissor.offset = scissorOffset;
-        scissor.extent = scissorExtent;
-        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
-
-        {
-            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _graphicsPipeline);
-
-            uint32_t vertexCount   = 3;
-            uint32_t instanceCount = 1;
-            uint32_t firstVertex   = 0;
-            uint32_t firstInstance = 0;
-            vkCmdDraw(commandBuffer, vertexCount, instanceCount, firstVertex, firstInstance);
-
-            ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), commandBuffer);
+    {   // render graph
+        _renderGraph.Reset();
+
+        vulkan::RenderImport backBufferImport;
+        backBufferImport.image  = _swapChainImages[swapchainIndex];
+        backBufferImport.view   = _swapChainImageViews[swapchainIndex];
+        backBufferImport.format = _swapChainImageFormat;
+        backBufferImport.width  = _swapChainExtent.width;
+        backBufferImport.height = _swapChainExtent.height;
+        // the acquire semaphore is waited on at this stage
+        backBufferImport.initialStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        // headless: the readback pass leaves it in its layout
+        backBufferImport.finalLayout = _headless.enabled ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        const vulkan::RenderResource backBuffer = _renderGraph.Import("back buffer", backBufferImport);
+
+        // the draws are recorded in secondary command buffers on the recorder threads
+        vulkan::RenderGraph::PassBuilder mainPass = _renderGraph.AddPass(
+            "main", vulkan::RenderPassType::Graphics, [this, animatedValue](VkCommandBuffer commandBuffer) {
+                // still compiling or uploading: skip the quad, the UI is drawn anyway
+                const VkPipeline pipeline  = _pipelineService.Get(_graphicsPipeline);
+                const uint32_t   drawCount = pipeline != VK_NULL_HANDLE && _meshes.IsResident(_quad) ? 1 : 0;
+                // the pipeline statistics query of the frame is active
+                VkCommandBufferInheritanceInfo inheritance = _renderGraph.inheritanceInfo();
+                inheritance.pipelineStatistics             = _gpuProfiler.statisticsFlags();
+                _recorder.Record(commandBuffer, inheritance, drawCount,
+                    [this, animatedValue, pipeline](VkCommandBuffer commandBuffer, uint32_t first, uint32_t count) {
+                        // a secondary command buffer inherits no state
+                        VkViewport viewport {};
+                        viewport.x        = static_cast<float>(0);
+                        viewport.y        = static_cast<float>(0);
+                        viewport.width    = static_cast<float>(_swapChainExtent.width);
+                        viewport.height   = static_cast<float>(_swapChainExtent.height);
+                        viewport.minDepth = 0.0f;
+                        viewport.maxDepth = 1.0f;
+                        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+                        const VkOffset2D scissorOffset {
+                            (int32_t)(0.2f * animatedValue * _swapChainExtent.width),
+                            (int32_t)(0.2f * animatedValue * _swapChainExtent.height),
+                        };
+                        const VkExtent2D scissorExtent {
+                            (uint32_t)(0.8f * (1.f - animatedValue) * _swapChainExtent.width),
+                            (uint32_t)(0.8f * (1.f - animatedValue) * _swapChainExtent.height),
+                        };
+                        VkRect2D scissor {};
+                        scissor.offset = scissorOffset;
+                        scissor.extent = scissorExtent;
+                        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+                        if (_descriptorIndexing) {
+                            _bindless.BindSecondary(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS);
+                        }
+                        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+                        for (uint32_t draw = first; draw < first + count; ++draw) {
+                            _meshes.Draw(commandBuffer, _quad);
+                        }
+                    });
+            });
+        mainPass.SecondaryCommandBuffers();
+        const float  clearColorValue = 0.25f * animatedValue;
+        VkClearValue clearColor      = {{{clearColorValue, clearColorValue, clearColorValue, 1.0f}}};
+        mainPass.Write(backBuffer, vulkan::RenderUsage::ColorAttachment, vulkan::LoadOp::Clear, clearColor);
+
+        if (_headless.enabled) {
+            // copied to the readback buffer of the frame, handed over framesInFlight frames later
+            vulkan::RenderGraph::PassBuilder readbackPass = _renderGraph.AddPass("readback",
+                vulkan::RenderPassType::Transfer, [this, swapchainIndex](VkCommandBuffer commandBuffer) {
+                    _readback.Copy(
+                        commandBuffer, _swapChainImages[swapchainIndex], _swapChainImageFormat, _swapChainExtent);
+                });
+            readbackPass.Read(backBuffer, vulkan::RenderUsage::TransferSrc);
+            readbackPass.SideEffect();
+        } else {
+            // imgui records inline, after the secondaries of the main pass
+            vulkan::RenderGraph::PassBuilder uiPass
+                = _renderGraph.AddPass("ui", vulkan::RenderPassType::Graphics, [](VkCommandBuffer commandBuffer) {
+                      ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), commandBuffer);
+                  });
+            uiPass.Write(backBuffer, vulkan::RenderUsage::ColorAttachment, vulkan::LoadOp::Load);
+            if (_imguiRenderPass) {
+                uiPass.UseRenderPass();
+            }
+        }
 
-            vkCmdEndRenderPass(commandBuffer);
+        if (!_renderGraph.Compile()) {
+            LOG_ERROR("failed to compile the render graph!");
+            return false;
         }
-    }   // renderPass
+        _renderGraph.Execute(commandBuffer, &_gpuProfiler);
+    }   // render graph
+
+    _gpuProfiler.EndFrame(commandBuffer);
 
     if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
         LOG_ERROR("failed to record command buffer!");
@@ -1241,23 +1956,16 @@ SDLWindowVulkan::_CreateSyncObjects()
     fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
     fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;   // first shot already signaled
 
-    _imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    _renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    _inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+    _imageAvailableSemaphores.resize(_maxFramesInFlight);
+    _renderFinishedSemaphores.resize(_maxFramesInFlight);
+    _inFlightFences.resize(_maxFramesInFlight);
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    for (size_t i = 0; i < _maxFramesInFlight; i++) {
         VK_CHECK(vkCreateSemaphore(_device, &semaphoreInfo, nullptr, &_imageAvailableSemaphores[i]));
         VK_CHECK(vkCreateSemaphore(_device, &semaphoreInfo, nullptr, &_renderFinishedSemaphores[i]));
         VK_CHECK(vkCreateFence(_device, &fenceInfo, nullptr, &_inFlightFences[i]));
     }
 
-    {   //
-        const VkFenceCreateInfo uploadFenceCreateInfo = vk_init::fence_create_info(false);
-        VK_CHECK(vkCreateFence(_device, &uploadFenceCreateInfo, nullptr, &_uploadContext._uploadFence));
-        _EnqueueForDeletion(
-            DeletionQueue::Main, [=]() { vkDestroyFence(_device, _uploadContext._uploadFence, nullptr); });
-    }
-
     return true;
 }
 
@@ -1266,24 +1974,74 @@ SDLWindowVulkan::_CreateSyncObjects()
 void
 SDLWindowVulkan::_CleanupSwapChain()
 {
-    VK_DESTROY_LIST_WITH_DEVICE(vkDestroyFramebuffer, _device, _swapChainFramebuffers, nullptr);
+    // the graph framebuffers use the views
+    _renderGraph.InvalidateFramebuffers();
     VK_DESTROY_LIST_WITH_DEVICE(vkDestroyImageView, _device, _swapChainImageViews, nullptr);
     VK_DESTROY_WITH_DEVICE(vkDestroySwapchainKHR, _device, _swapChain, nullptr);
 
-    // no need to destroy
+    // no need to destroy, but the offscreen ones
+    for (size_t i = 0; i < _offscreenMemory.size(); ++i) {
+        VK_DESTROY_WITH_DEVICE(vkDestroyImage, _device, _swapChainImages[i], nullptr);
+        if (_offscreenMemory[i].isValid()) {
+            _deviceMemory.Free(_offscreenMemory[i]);
+        }
+    }
+    _offscreenMemory.clear();
     _swapChainImages.clear();
+
+    _DestroyRetiredSwapChains(true);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
-void
+bool
 SDLWindowVulkan::_RecreateSwapChain()
 {
-    vkDeviceWaitIdle(_device);
+    // no vkDeviceWaitIdle(): the frames in flight finish with the previous
+    // swapchain, destroyed once they are complete
+    RetiredSwapChain retired;
+    retired.frame      = _frameNumber;
+    retired.swapChain  = _swapChain;
+    retired.imageViews = std::move(_swapChainImageViews);
+    _retiredSwapChains.push_back(std::move(retired));
+    _swapChain = VK_NULL_HANDLE;
+    _swapChainImageViews.clear();
+    _swapChainImages.clear();
+    // the framebuffers of the previous views are retired by the graph
+    _renderGraph.InvalidateFramebuffers();
 
-    _CreateSwapChain();
-    _CreateImageViews();
-    _CreateFramebuffers();
+    // the old swapchain is retired even when the creation fails: tried again next frame
+    if (!_CreateSwapChain(_retiredSwapChains.back().swapChain) || !_CreateImageViews()) {
+        return false;
+    }
+    _swapChainDirty = false;
+    ++_swapChainRecreateCount;
+    return true;
+}
+
+void
+SDLWindowVulkan::_DestroyRetiredSwapChains(bool all)
+{
+    size_t kept = 0;
+    for (size_t i = 0; i < _retiredSwapChains.size(); ++i) {
+        RetiredSwapChain& retired = _retiredSwapChains[i];
+        // the fences cover the frames up to _maxFramesInFlight ago, one more
+        // for their presentation, which no fence covers
+        if (!all && _frameNumber <= retired.frame + _maxFramesInFlight) {
+            if (kept != i) {
+                _retiredSwapChains[kept] = std::move(retired);
+            }
+            ++kept;
+            continue;
+        }
+        for (VkImageView view : retired.imageViews) {
+            vkDestroyImageView(_device, view, nullptr);
+        }
+        if (retired.swapChain != VK_NULL_HANDLE) {
+            vkDestroySwapchainKHR(_device, retired.swapChain, nullptr);
+        }
+    }
+    _retiredSwapChains.resize(kept);
 }
 
 /////////////////////////////////////////////////////////////////////////////////
@@ -1,10 +1,30 @@
 #pragma once
 
+#include "FramePacer.h"
 #include "SDLWindow.h"
+#include "ShaderHotReload.h"
 
+#include "core/fixed_vector.h"
+#include "core/inplace_function.h"
+#include "core/memory.h"
+#include "core/small_vector.h"
+#include "core/thread_pool.h"
+#include "gfx/BindlessTable.h"
+#include "gfx/CommandRecorder.h"
+#include "gfx/DescriptorAllocator.h"
+#include "gfx/DeviceMemory.h"
+#include "gfx/FrameReadback.h"
+#include "gfx/GpuProfiler.h"
+#include "gfx/MeshManager.h"
+#include "gfx/PipelineCache.h"
+#include "gfx/PipelineLayoutCache.h"
+#include "gfx/PipelineService.h"
+#include "gfx/RenderGraph.h"
+#include "gfx/UploadManager.h"
 #include "gfx/vk_types.h"
 
-#include <functional>
+#include <memory>
+#include <string>
 #include <vector>
 
 #define VALIDATION_LAYERS USING(IS_DEBUG)
@@ -13,16 +33,31 @@ namespace gfx {
 ////////////////////////////////////////////////////////////////////////////////
 
 class SDLWindowVulkan : public SDLWindow {
-    
-    static constexpr int MAX_FRAMES_IN_FLIGHT = 5;
+
+    //! capacity: FramePacing::framesInFlight is clamped to it
+    static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 4;
+    //! swapchains bigger than this are still supported, they just spill to the heap
+    static constexpr size_t kMaxSwapChainImages = 8;
+
+    template <typename T> using PerFrame     = core::FixedVector<T, MAX_FRAMES_IN_FLIGHT>;
+    template <typename T> using PerSwapImage = core::SmallVector<T, kMaxSwapChainImages>;
 
     VkInstance       _instance       = VK_NULL_HANDLE;
     VkPhysicalDevice _physicalDevice = VK_NULL_HANDLE;
     VkDevice         _device         = VK_NULL_HANDLE;
     VkSurfaceKHR     _surface        = VK_NULL_HANDLE;
 
-    VkQueue _graphicsQueue = VK_NULL_HANDLE;
-    VkQueue _presentQueue  = VK_NULL_HANDLE;
+    VkQueue  _graphicsQueue             = VK_NULL_HANDLE;
+    VkQueue  _presentQueue              = VK_NULL_HANDLE;
+    VkQueue  _transferQueue             = VK_NULL_HANDLE;   //!< the graphics queue without a dedicated one
+    VkQueue  _computeQueue              = VK_NULL_HANDLE;   //!< async compute, when available
+    uint32_t _graphicsQueueFamily       = 0;
+    uint32_t _transferQueueFamily       = 0;
+    bool     _timelineSemaphore         = false;
+    bool     _physicalDeviceProperties2 = false;   //!< VK_KHR_get_physical_device_properties2
+    bool     _descriptorIndexing        = false;   //!< _bindless is available
+    bool     _dynamicRendering          = false;   //!< VK_KHR_dynamic_rendering, no render pass objects
+    bool     _pipelineStatistics        = false;   //!< measured by _gpuProfiler
 
     VkDebugUtilsMessengerEXT _debugMessenger;
 
@@ -34,73 +69,194 @@ class SDLWindowVulkan : public SDLWindow {
 #endif   // #if USING(VALIDATION_LAYERS)
 
     // swapchain
-    VkSwapchainKHR             _swapChain = VK_NULL_HANDLE;
-    VkFormat                   _swapChainImageFormat;
-    VkExtent2D                 _swapChainExtent;
-    std::vector<VkImage>       _swapChainImages;
-    std::vector<VkImageView>   _swapChainImageViews;
-    std::vector<VkFramebuffer> _swapChainFramebuffers;
-
-    VkRenderPass     _renderPass;
-    VkPipelineLayout _pipelineLayout;
-    VkPipeline       _graphicsPipeline;
-
-    VkCommandPool                _commandPool;
-
-    std::vector<VkCommandBuffer> _commandBuffers;
-    std::vector<VkSemaphore>  _imageAvailableSemaphores;
-    std::vector<VkSemaphore>  _renderFinishedSemaphores;
-    std::vector<VkFence>      _inFlightFences;
+    VkSwapchainKHR            _swapChain = VK_NULL_HANDLE;
+    VkFormat                  _swapChainImageFormat;
+    VkExtent2D                _swapChainExtent;
+    PerSwapImage<VkImage>     _swapChainImages;
+    PerSwapImage<VkImageView> _swapChainImageViews;
+    uint32_t                  _swapChainMinImageCount = 2;   //!< of the surface
+    VkPresentModeKHR          _presentMode            = VK_PRESENT_MODE_FIFO_KHR;
+    //! of the surface, among the ones FramePacing chooses from
+    core::SmallVector<VkPresentModeKHR, 4> _presentModes;
+    //! recreated before the next frame: resize, out of date, FramePacing change
+    bool     _swapChainDirty         = false;
+    uint32_t _swapChainRecreateCount = 0;
+
+    //! a swapchain replaced: the frames in flight still present its images
+    struct RetiredSwapChain {
+        uint64_t                  frame     = 0;   //!< the first frame of the next swapchain
+        VkSwapchainKHR            swapChain = VK_NULL_HANDLE;
+        PerSwapImage<VkImageView> imageViews;
+    };
+    std::vector<RetiredSwapChain> _retiredSwapChains;
+
+    static constexpr const char* kVertexShaderPath   = "shaders/shader.vert.spv";
+    static constexpr const char* kFragmentShaderPath = "shaders/shader.frag.spv";
+    static constexpr const char* kQuadMeshPath       = "meshes/quad.mesh";
+
+    VkRenderPass           _renderPass;
+    vulkan::PipelineHandle _graphicsPipeline;
+    //! requested after a shader change, replaces _graphicsPipeline once compiled
+    vulkan::PipelineHandle _pendingGraphicsPipeline;
+
+    core::vfs::FileSystem _fileSystem;
+
+    vulkan::DeviceMemoryAllocator _deviceMemory;
+    vulkan::UploadManager         _uploads;
+    vulkan::MeshManager           _meshes;
+    vulkan::MeshHandle            _quad;
+    vulkan::RenderGraph           _renderGraph;
+    vulkan::CommandRecorder       _recorder;
+    vulkan::GpuProfiler           _gpuProfiler;
+    vulkan::BindlessTable         _bindless;
+    vulkan::DescriptorAllocator   _descriptors;   //!< per-frame sets of the other materials
+
+    // one pipeline cache per pipeline service worker
+    static constexpr uint32_t   kPipelineThreadCount = 2;
+    vulkan::PipelineCache       _pipelineCache;
+    vulkan::PipelineService     _pipelineService;
+    vulkan::PipelineLayoutCache _pipelineLayouts;
+    bool                        _pipelineCreationFeedback = false;
+
+#if USING(SHADER_HOT_RELOAD)
+    vk::ShaderHotReload _shaderHotReload;
+#endif   // #if USING(SHADER_HOT_RELOAD)
+
+    VkCommandPool _commandPool;
+
+    PerFrame<VkCommandBuffer> _commandBuffers;
+    PerFrame<VkSemaphore>     _imageAvailableSemaphores;
+    PerFrame<VkSemaphore>     _renderFinishedSemaphores;
+    PerFrame<VkFence>         _inFlightFences;
     uint8_t                   _currentFrameIndex = 0;
+    uint64_t                  _frameNumber       = 0;
 
-private:
-    struct UploadContext {
-        VkFence         _uploadFence;
-        VkCommandPool   _commandPool;
-        VkCommandBuffer _commandBuffer;
+    core::memory::AllocationCounter _frameAllocationCounter;
+    core::memory::AllocationStats   _lastFrameAllocations;
+
+public:
+    //! Latency against throughput, per deployment: the command line sets it,
+    //! the "Frame pacing" window changes it at runtime.
+    struct FramePacing {
+        //! 1 to MAX_FRAMES_IN_FLIGHT, no more than the swapchain images; the
+        //! subsystems are sized at Init(), it can only be lowered after
+        uint32_t framesInFlight = 2;
+        //! FIFO (always supported) when the surface does not have it
+        VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+        //! 0: the minimum of the surface plus one, clamped to the surface limits
+        uint32_t swapChainImageCount = 0;
+        //! frame limiter, 0: unlimited
+        float maxFps = 0.f;
+    };
+
+    //! Offscreen rendering without SDL nor a surface, on any device (a
+    //! software ICD such as lavapipe included): frame time benchmarks and
+    //! image regression tests on machines without a GPU or a display.
+    struct Headless {
+        bool     enabled = false;
+        uint32_t width   = 1280;
+        uint32_t height  = 720;
+        //! rendered by Run(), then the frame time percentiles are logged
+        uint32_t frameCount = 300;
+        //! a PPM file per frame ("frame_00042.ppm") written there, empty: none
+        std::string outputDirectory;
     };
-    UploadContext _uploadContext;
 
-    std::vector<std::function<void(void)>> _mainDeletionQueue;
+    //! Optional device features, used when the device supports them.
+    struct Features {
+        //! VK_KHR_dynamic_rendering: the passes are begun with the views, the
+        //! pipelines are created against the attachment formats; no render
+        //! pass nor framebuffer to create on swapchain recreations. Render
+        //! passes otherwise.
+        bool dynamicRendering = true;
+    };
+
+private:
+    FramePacing    _pacing;
+    uint32_t       _maxFramesInFlight = 2;   //!< the subsystems are sized for it
+    uint32_t       _framesInFlight    = 2;   //!< used, no more than the swapchain images
+    vk::FramePacer _framePacer;
+
+    Headless _headless;
+    Features _features;
+    //! the imgui backend has no dynamic rendering: its pass keeps a render pass
+    bool _imguiRenderPass = true;
+    //! headless: the images the swapchain would own, and their memory
+    PerSwapImage<vulkan::MemoryAllocation> _offscreenMemory;
+    vulkan::FrameReadback                  _readback;
+    vulkan::FrameReadback::Callback        _frameCallback;
+    std::unique_ptr<core::ThreadPool>      _imageWriter;   //!< one thread, the files are written off the render thread
+
+    std::vector<core::InplaceFunction<void(void)>> _mainDeletionQueue;
 
 public:
     SDLWindowVulkan();
+    SDLWindowVulkan(const FramePacing& pacing, const Headless& headless, const Features& features);
+
+    //! "fifo", "fifo_relaxed", "mailbox", "immediate": the command line names
+    static const char* PresentModeName(VkPresentModeKHR mode);
+    //! false when name is not one of the above
+    static bool ParsePresentMode(const char* name, VkPresentModeKHR& mode);
 
     bool Init() override;
     void Close() override;
 
+    //! headless: renders Headless::frameCount frames, the window otherwise
+    void Run() override;
+
+    //! Before Init(), headless: every frame read back, on the render thread
+    //! (the pixels are valid during the call only), the files are written too.
+    void SetFrameCallback(vulkan::FrameReadback::Callback&& callback) { _frameCallback = std::move(callback); }
+
 protected:
     void _DrawFrame() override;
     void _OnMainLoopExit() override;
     void _OnResize(uint32_t width, uint32_t height) override;
+    void _OnInput() override;
 
 protected:
     void _InitImgui();
-
-    void _ImmediateSubmit(std::function<void(VkCommandBuffer cmd)>&& function);
+    //! frame time and latency percentiles, the FramePacing settings
+    void _ShowFramePacing();
+    //! GPU zones of the last complete frame, the trace export
+    void _ShowGpuProfiler();
 
     enum class DeletionQueue {
         Main,
     };
-    void _EnqueueForDeletion(DeletionQueue queue, std::function<void()> func);
+    void _EnqueueForDeletion(DeletionQueue queue, core::InplaceFunction<void()> func);
 
 protected:
     bool _CreateInstance();
     bool _SelectAdapter();
     bool _CreateLogicalDevice();
     bool _CreateSurface();
-    bool _CreateSwapChain();
+    //! oldSwapChain: retired by the creation, VK_NULL_HANDLE the first time
+    bool _CreateSwapChain(VkSwapchainKHR oldSwapChain);
+    //! headless: frames in flight images in place of the swapchain ones
+    bool _CreateOffscreenImages();
+    //! headless: the files, _frameCallback
+    void _OnFrameReadback(const vulkan::FrameReadback::Image& image);
     bool _CreateImageViews();
     bool _CreateRenderPass();
     bool _CreateGraphicsPipeline();
-    bool _CreateFramebuffers();
     bool _CreateCommandPool();
     bool _CreateCommandBuffer();
     bool _RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
     bool _CreateSyncObjects();
 
     void _CleanupSwapChain();
-    void _RecreateSwapChain();
+    //! no GPU idle: the previous swapchain is retired, see _DestroyRetiredSwapChains()
+    bool _RecreateSwapChain();
+    //! all: the GPU is idle
+    void _DestroyRetiredSwapChains(bool all);
+
+    bool _GraphicsPipelineDesc(vulkan::GraphicsPipelineDesc& desc);
+    void _UpdateGraphicsPipeline();
+
+#if USING(SHADER_HOT_RELOAD)
+    bool _InitShaderHotReload();
+#endif   // #if USING(SHADER_HOT_RELOAD)
 
     bool _IsPhysicalDeviceSuitable(VkPhysicalDevice device, VkSurfaceKHR surface) const;
 
@@ -0,0 +1,114 @@
+#include "ShaderHotReload.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+
+namespace gfx {
+namespace vk {
+/////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+float
+elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+}   // namespace
+
+/////////////////////////////////////////////////////////////////////////////////
+
+ShaderHotReload::ShaderHotReload() = default;
+
+ShaderHotReload::~ShaderHotReload()
+{
+    Shutdown();
+}
+
+bool
+ShaderHotReload::Init(std::vector<Shader> shaders, std::string compilerPath)
+{
+    _shaders      = std::move(shaders);
+    _compilerPath = std::move(compilerPath);
+
+    bool result = true;
+    for (const Shader& shader : _shaders) {
+        if (!_compilerPath.empty() && !shader.sourcePath.empty()) {
+            result &= _watcher.Watch(shader.sourcePath);
+        }
+        result &= _watcher.Watch(shader.spirvPath);
+    }
+    return result;
+}
+
+void
+ShaderHotReload::Shutdown()
+{
+    _worker.WaitIdle();
+}
+
+bool
+ShaderHotReload::Update()
+{
+    _changedPaths.clear();
+    if (!_watcher.Poll(_changedPaths)) {
+        return false;
+    }
+
+    bool reload = false;
+    for (const std::string& path : _changedPaths) {
+        for (size_t i = 0; i < _shaders.size(); ++i) {
+            if (path == _shaders[i].sourcePath) {
+                LOG_INFO("'%s' changed, recompiling", path.c_str());
+                // writes the SPIR-V: reported by a later Update()
+                _worker.Submit([this, i]() { _Compile(i); });
+            } else if (path == _shaders[i].spirvPath) {
+                reload = true;
+            }
+        }
+    }
+    if (reload) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        ++_stats.reloadCount;
+    }
+    return reload;
+}
+
+ShaderHotReload::Stats
+ShaderHotReload::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+
+void
+ShaderHotReload::_Compile(size_t shaderIndex)
+{
+    const Shader&     shader  = _shaders[shaderIndex];
+    const std::string tmpPath = shader.spirvPath + ".tmp";
+    const std::string command = "\"" + _compilerPath + "\" \"" + shader.sourcePath + "\" -o \"" + tmpPath + "\"";
+
+    const auto start = std::chrono::steady_clock::now();
+    // the SPIR-V is replaced with a rename: it may be mapped by the vfs
+    bool            success = std::system(command.c_str()) == 0;
+    std::error_code error;
+    if (success) {
+        std::filesystem::rename(tmpPath, shader.spirvPath, error);
+        success = !error;
+    }
+    if (!success) {
+        LOG_ERROR("failed to compile '%s', keeping the current pipeline", shader.sourcePath.c_str());
+        std::filesystem::remove(tmpPath, error);
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++_stats.compileCount;
+    _stats.compileFailureCount += success ? 0 : 1;
+    _stats.lastCompileMs = elapsedMs(start);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+}   // namespace vk
+}   // namespace gfx
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "core/core.h"
+#include "core/file_watcher.h"
+#include "core/thread_pool.h"
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define SHADER_HOT_RELOAD USING(IS_DEBUG)
+
+namespace gfx {
+namespace vk {
+////////////////////////////////////////////////////////////////////////////////
+
+//! Watches the shaders of a pipeline:
+//! - a GLSL source is written: it is recompiled into its SPIR-V file on a
+//!   worker thread
+//! - a SPIR-V file is written (by the above, or by a build of the shaders
+//!   target): Update() returns true, the caller requests the pipeline again
+//!   from the vulkan::PipelineService, which compiles it in the background.
+class ShaderHotReload {
+public:
+    struct Shader {
+        std::string sourcePath;   //!< GLSL, empty: only the SPIR-V is watched
+        std::string spirvPath;
+    };
+
+    struct Stats {
+        uint32_t compileCount        = 0;
+        uint32_t compileFailureCount = 0;
+        uint32_t reloadCount         = 0;   //!< SPIR-V changes reported
+        float    lastCompileMs       = 0.f;
+    };
+
+    ShaderHotReload();
+    //! waits for the worker, see Shutdown()
+    ~ShaderHotReload();
+
+    //! compilerPath: glslc, empty to ignore the GLSL sources
+    bool Init(std::vector<Shader> shaders, std::string compilerPath);
+    //! waits for the compilations in progress
+    void Shutdown();
+
+    //! main thread, once per frame: starts the compilations, true when a SPIR-V file changed
+    bool Update();
+
+    Stats GetStats() const;
+
+private:
+    void _Compile(size_t shaderIndex);
+
+    std::vector<Shader>      _shaders;
+    std::string              _compilerPath;
+    core::FileWatcher        _watcher;
+    std::vector<std::string> _changedPaths;
+
+    mutable std::mutex _mutex;
+    Stats              _stats;
+
+    //! one thread: compiles run in order
+    core::ThreadPool _worker {1};
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}   // namespace vk
+}   // namespace gfx
@@ -1,16 +1,80 @@
 // https://github.com/SaschaWillems/Vulkan/blob/master/examples/triangle/triangle.cpp
 #include "SDLWindowVulkan.h"
 
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
 ////////////////////////////////////////////////////////////////////////////////
 
+namespace {
+struct Options {
+    gfx::SDLWindowVulkan::FramePacing pacing;
+    gfx::SDLWindowVulkan::Headless    headless;
+    gfx::SDLWindowVulkan::Features    features;
+};
+
+//! --frames-in-flight N --present-mode fifo|fifo_relaxed|mailbox|immediate
+//! --swapchain-images N --max-fps F
+//! --headless FRAMES --size WIDTHxHEIGHT --output DIRECTORY
+//! --dynamic-rendering on|off
+Options
+parseOptions(int argc, char** argv)
+{
+    Options                            options;
+    gfx::SDLWindowVulkan::FramePacing& pacing   = options.pacing;
+    gfx::SDLWindowVulkan::Headless&    headless = options.headless;
+    for (int i = 1; argv != nullptr && i + 1 < argc; i += 2) {
+        const char* option = argv[i];
+        const char* value  = argv[i + 1];
+        if (strcmp(option, "--frames-in-flight") == 0) {
+            pacing.framesInFlight = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+        } else if (strcmp(option, "--present-mode") == 0) {
+            if (!gfx::SDLWindowVulkan::ParsePresentMode(value, pacing.presentMode)) {
+                LOG_WARN("unknown present mode, FIFO is used: %s", value);
+            }
+        } else if (strcmp(option, "--swapchain-images") == 0) {
+            pacing.swapChainImageCount = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+        } else if (strcmp(option, "--max-fps") == 0) {
+            pacing.maxFps = strtof(value, nullptr);
+        } else if (strcmp(option, "--headless") == 0) {
+            headless.enabled    = true;
+            headless.frameCount = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+        } else if (strcmp(option, "--size") == 0) {
+            unsigned width = 0, height = 0;
+            if (sscanf(value, "%ux%u", &width, &height) == 2 && width != 0 && height != 0) {
+                headless.width  = width;
+                headless.height = height;
+            } else {
+                LOG_WARN("invalid size, WIDTHxHEIGHT expected: %s", value);
+            }
+        } else if (strcmp(option, "--output") == 0) {
+            headless.outputDirectory = value;
+        } else if (strcmp(option, "--dynamic-rendering") == 0) {
+            options.features.dynamicRendering = strcmp(value, "off") != 0;
+        } else {
+            LOG_WARN("unknown option: %s", option);
+        }
+    }
+    return options;
+}
+}   // namespace
+
 #ifdef WIN32
 #include <tchar.h>
 int _tmain(int , TCHAR**)
 #else
-int main(int /*argc*/, char** /*argv*/)
+int main(int argc, char** argv)
 #endif // ABC_PLATFORM_WINDOWS_FAMILY
 {
-    gfx::SDLWindowVulkan window;
+#ifdef WIN32
+    // null in unicode builds: the defaults
+    const Options options = parseOptions(__argc, __argv);
+#else
+    const Options options = parseOptions(argc, argv);
+#endif // WIN32
+
+    gfx::SDLWindowVulkan window(options.pacing, options.headless, options.features);
     if (window.Init()) {
         window.Run();
         window.Close();